@@ -156,6 +156,8 @@ int main(int argc, char * argv[])
     auto logger = log4cplus::Logger::getInstance("log");
     std::string output, connection_string, region_name, cities_connection_string;
     double min_non_connected_graph_ratio;
+    bool contraction_hierarchies;
+    bool flat;
     po::options_description desc("Allowed options");
     desc.add_options()
         ("help,h", "Show this message")
@@ -171,7 +173,12 @@ int main(int argc, char * argv[])
         ("connection-string", po::value<std::string>(&connection_string)->required(),
          "database connection parameters: host=localhost user=navitia dbname=navitia password=navitia")
         ("cities-connection-string", po::value<std::string>(&cities_connection_string)->default_value(""),
-         "cities database connection parameters: host=localhost user=navitia dbname=cities password=navitia");
+         "cities database connection parameters: host=localhost user=navitia dbname=cities password=navitia")
+        ("contraction-hierarchies", po::bool_switch(&contraction_hierarchies),
+         "build the contraction hierarchies of the car and bike street networks (faster street network requests)")
+        ("flat", po::bool_switch(&flat),
+         "write the street network indexes, the contraction hierarchies and the proximity lists in a "
+         "memory mappable file next to the output instead of the output (both files are then required)");
 
     po::variables_map vm;
     po::store(po::parse_command_line(argc, argv, desc), vm);
@@ -226,6 +233,12 @@ int main(int argc, char * argv[])
 
     read = (pt::microsec_clock::local_time() - start).total_milliseconds();
     data.complete();
+    if (contraction_hierarchies) {
+        start = pt::microsec_clock::local_time();
+        data.geo_ref->build_contraction_hierarchies();
+        LOG4CPLUS_INFO(logger, "contraction hierarchies built in "
+                       << (pt::microsec_clock::local_time() - start).total_milliseconds() << "ms");
+    }
     data.meta->publication_date = pt::microsec_clock::local_time();
 
     LOG4CPLUS_INFO(logger, "line: " << data.pt_data->lines.size());
@@ -247,7 +260,15 @@ int main(int argc, char * argv[])
 
     start = pt::microsec_clock::local_time();
     try {
+        data.set_flat_indexes(flat);
         data.save(output);
+        if (flat) {
+            data.save_flat(output);
+            LOG4CPLUS_INFO(logger, "flat file written: " << navitia::type::Data::flat_filename(output));
+        } else {
+            // a flat file of a previous run would not match the data
+            boost::filesystem::remove(navitia::type::Data::flat_filename(output));
+        }
     } catch(const navitia::exception &e) {
         LOG4CPLUS_ERROR(logger, "Unable to save");
         LOG4CPLUS_ERROR(logger, e.what());
@@ -107,10 +107,13 @@ void EdReader::fill(navitia::type::Data& data, const double min_non_connected_gr
     this->fill_vertex(data, work);
     this->fill_graph(data, work);
 
-    // we need the proximity_list to build bss and parking edges
+    // we need the proximity_list and the edge index to build bss and parking edges
     data.geo_ref->build_proximity_list();
+    data.geo_ref->build_street_network_indexes();
     this->fill_graph_bss(data, work);
     this->fill_graph_parking(data, work);
+    // the graph is final
+    data.geo_ref->build_street_network_indexes();
 
     //Charger les synonymes
     this->fill_synonyms(data, work);
@@ -174,7 +177,7 @@ void EdReader::fill_admins_postal_codes(navitia::type::Data& , pqxx::work& work)
     }
 }
 
-void EdReader::fill_admin_stop_areas(navitia::type::Data&, pqxx::work& work) {
+void EdReader::fill_admin_stop_areas(navitia::type::Data& data, pqxx::work& work) {
     std::string request = "SELECT admin_id, stop_area_id from navitia.admin_stop_area";
 
     size_t nb_unknown_admin(0), nb_unknown_stop(0), nb_valid_admin(0);
@@ -200,7 +203,7 @@ void EdReader::fill_admin_stop_areas(navitia::type::Data&, pqxx::work& work) {
 
         navitia::type::StopArea* sa = it_sa->second;
 
-        admin->main_stop_areas.push_back(sa);
+        data.pt_data->main_stop_areas_by_admin[admin->idx].push_back(sa);
         nb_valid_admin++;
     }
     LOG4CPLUS_INFO(log, nb_valid_admin << " admin with at least one main stop");
@@ -1290,7 +1293,7 @@ void EdReader::fill_vector_to_ignore(navitia::type::Data& , pqxx::work& work,
             navitia::georef::Edge e;
             float len;
             const_it["leng"].to(len);
-            e.duration = navitia::seconds(len / navitia::georef::default_speed[navitia::type::Mode_e::Walking]);
+            e.duration = navitia::seconds(len / navitia::georef::default_speed[navitia::type::Mode_e::Walking]).total_seconds();
             e.way_idx = const_it["way_id"].as<idx_t>();
             uint64_t source = node_map_temp[const_it["source_node_id"].as<uint64_t>()];
             uint64_t target = node_map_temp[const_it["target_node_id"].as<uint64_t>()];
@@ -1429,7 +1432,7 @@ void EdReader::fill_graph(navitia::type::Data& data, pqxx::work& work) {
 
         if (const_it["pede"].as<bool>()) {
             if (auto dur = get_duration(nt::Mode_e::Walking, len, source, target)) {
-                e.duration = navitia::seconds(*dur);
+                e.duration = navitia::seconds(*dur).total_seconds();
                 boost::add_edge(source, target, e, data.geo_ref->graph);
                 way->edges.push_back(std::make_pair(source, target));
                 nb_walking_edges++;
@@ -1437,7 +1440,7 @@ void EdReader::fill_graph(navitia::type::Data& data, pqxx::work& work) {
         }
         if (const_it["bike"].as<bool>()) {
             if (auto dur = get_duration(nt::Mode_e::Bike, len, source, target)) {
-                e.duration = navitia::seconds(*dur);
+                e.duration = navitia::seconds(*dur).total_seconds();
                 auto bike_source = data.geo_ref->offsets[nt::Mode_e::Bike] + source;
                 auto bike_target = data.geo_ref->offsets[nt::Mode_e::Bike] + target;
                 boost::add_edge(bike_source, bike_target, e, data.geo_ref->graph);
@@ -1447,7 +1450,7 @@ void EdReader::fill_graph(navitia::type::Data& data, pqxx::work& work) {
         }
         if (const_it["car"].as<bool>()) {
             if (auto dur = get_duration(nt::Mode_e::Car, len, source, target)) {
-                e.duration = navitia::seconds(*dur);
+                e.duration = navitia::seconds(*dur).total_seconds();
                 auto car_source = data.geo_ref->offsets[nt::Mode_e::Car] + source;
                 auto car_target = data.geo_ref->offsets[nt::Mode_e::Car] + target;
                 boost::add_edge(car_source, car_target, e, data.geo_ref->graph);
@@ -34,6 +34,7 @@ www.navitia.io
 #include "routing/routing.h"
 #include "utils/logger.h"
 #include <boost/graph/adjacency_list.hpp>
+#include <boost/graph/adj_list_serialize.hpp>
 #include <boost/date_time/gregorian/gregorian.hpp>
 #include <boost/serialization/serialization.hpp>
 #include <boost/date_time/gregorian/greg_serialize.hpp>
@@ -0,0 +1,223 @@
+/* Copyright © 2001-2016, Canal TP and/or its affiliates. All rights reserved.
+
+This file is part of Navitia,
+    the software to build cool stuff with public transport.
+
+Hope you'll enjoy and contribute to this project,
+    powered by Canal TP (www.canaltp.fr).
+Help us simplify mobility and open public transport:
+    a non ending quest to the responsive locomotion way of traveling!
+
+LICENCE: This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Affero General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+Stay tuned using
+twitter @navitia
+IRC #navitia on freenode
+https://groups.google.com/d/forum/navitia
+www.navitia.io
+*/
+
+#include "georef/street_network.h"
+#include "type/data.h"
+#include "utils/timer.h"
+#include "utils/init.h"
+#include <boost/graph/dijkstra_shortest_paths.hpp>
+#include <boost/graph/filtered_graph.hpp>
+#include <boost/graph/two_bit_color_map.hpp>
+#include <boost/program_options.hpp>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <unistd.h>
+
+using namespace navitia;
+namespace po = boost::program_options;
+namespace ng = navitia::georef;
+
+// Compares the street network representations on a real data.nav.lz4: the
+// layered boost::adjacency_list (one out edge vector by vertex) the kraken
+// used to load, and the street topology (packed arrays) it loads now.
+// The same boost dijkstra is run on both, only the graph differs.
+
+namespace {
+
+const uint32_t infinity = std::numeric_limits<uint32_t>::max();
+
+struct RadiusReached {};
+
+// stops the dijkstra when the next vertex is farther than the radius
+struct RadiusVisitor: public boost::dijkstra_visitor<> {
+    const std::vector<uint32_t>& distances;
+    uint32_t radius;
+    RadiusVisitor(const std::vector<uint32_t>& distances, uint32_t radius):
+        distances(distances), radius(radius) {}
+
+    template<typename G>
+    void examine_vertex(typename boost::graph_traits<G>::vertex_descriptor u, const G&) {
+        if (distances[u] > radius) { throw RadiusReached(); }
+    }
+};
+
+// keeps the vertices of the allowed layers, like the filtered graph of the
+// adjacency list did
+struct LayerFilter {
+    nt::idx_t nb_vertex_by_layer = 1;
+    uint8_t allowed_layers = 0;
+    LayerFilter() {}
+    LayerFilter(nt::idx_t nb_vertex_by_layer, uint8_t allowed_layers):
+        nb_vertex_by_layer(nb_vertex_by_layer), allowed_layers(allowed_layers) {}
+    bool operator()(const ng::vertex_t v) const {
+        return allowed_layers & (1 << (v / nb_vertex_by_layer));
+    }
+};
+
+// resident memory of the process, in bytes
+size_t resident_memory() {
+    std::ifstream statm("/proc/self/statm");
+    size_t size = 0, resident = 0;
+    statm >> size >> resident;
+    return resident * sysconf(_SC_PAGESIZE);
+}
+
+// the layered adjacency list, with the edges in the order of the topology
+ng::Graph build_adjacency_list(const ng::StreetTopology& topology) {
+    ng::Graph graph(topology.nb_vertices());
+    for (uint32_t v = 0; v < topology.nb_vertices(); ++v) {
+        graph[v].coord = topology.coord(v);
+        topology.for_each_out_edge(v, [&](const ng::LayeredEdge& e) {
+            boost::add_edge(v, topology.target(e),
+                            ng::Edge(topology.way_idx(e), navitia::seconds(topology.duration(e))), graph);
+        });
+    }
+    return graph;
+}
+
+template<typename G, typename WeightMap>
+void run_dijkstra(const G& graph, const WeightMap& weights, const ng::vertex_t start, const uint32_t radius,
+                  std::vector<uint32_t>& distances, std::vector<ng::vertex_t>& predecessors) {
+    boost::two_bit_color_map<> colors(distances.size());
+    distances[start] = 0;
+    predecessors[start] = start;
+    try {
+        boost::dijkstra_shortest_paths_no_init(graph, start, &predecessors[0], &distances[0], weights,
+                                               boost::identity_property_map(), std::less<uint32_t>(),
+                                               boost::closed_plus<uint32_t>(infinity), uint32_t(0),
+                                               RadiusVisitor(distances, radius), colors);
+    } catch (RadiusReached) {}
+}
+
+size_t nb_within(const std::vector<uint32_t>& distances, const uint32_t radius) {
+    return std::count_if(distances.begin(), distances.end(), [&](uint32_t d) { return d <= radius; });
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+    navitia::init_app();
+    po::options_description desc("Street graph benchmark");
+    std::string file, mode_str;
+    int iterations, radius;
+
+    desc.add_options()
+            ("help", "Show this message")
+            ("iterations,i", po::value<int>(&iterations)->default_value(1000),
+                     "Number of dijkstra run on each graph")
+            ("file,f", po::value<std::string>(&file)->default_value("data.nav.lz4"),
+                     "Path to data.nav.lz4")
+            ("radius,r", po::value<int>(&radius)->default_value(15 * 60),
+                     "Max duration of the searches in seconds")
+            ("mode,m", po::value<std::string>(&mode_str)->default_value("walking"),
+                     "Transportation mode (walking, bike, car or bss)");
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+    if (vm.count("help")) {
+        std::cout << "This is used to compare the memory and the dijkstra throughput of the street "
+                     "topology with the boost adjacency list" << std::endl;
+        std::cout << desc << std::endl;
+        return 1;
+    }
+    type::Mode_e mode = type::Mode_e::Walking;
+    if (mode_str == "bike") { mode = type::Mode_e::Bike; }
+    else if (mode_str == "car") { mode = type::Mode_e::Car; }
+    else if (mode_str == "bss") { mode = type::Mode_e::Bss; }
+
+    type::Data data;
+    {
+        Timer t("Chargement des données : " + file);
+        data.load(file);
+    }
+    const auto& geo_ref = *data.geo_ref;
+    const auto& topology = geo_ref.search_graph();
+    if (topology.nb_vertex_by_layer == 0) {
+        std::cout << "no street network in " << file << std::endl;
+        return 1;
+    }
+
+    const size_t memory_before = resident_memory();
+    const ng::Graph graph = build_adjacency_list(topology);
+    const size_t adjacency_list_memory = resident_memory() - memory_before;
+
+    const LayerFilter filter(topology.nb_vertex_by_layer, ng::allowed_layers(mode));
+    const boost::filtered_graph<ng::Graph, boost::keep_all, LayerFilter> filtered(graph, {}, filter);
+    const ng::LayeredStreetGraph layered(topology, ng::allowed_layers(mode));
+
+    std::mt19937 rng(31442);
+    std::uniform_int_distribution<ng::vertex_t> gen(0, topology.nb_vertex_by_layer - 1);
+    std::vector<ng::vertex_t> starts;
+    for (int i = 0; i < iterations; ++i) {
+        starts.push_back(gen(rng) + geo_ref.offsets[mode]);
+    }
+
+    std::vector<uint32_t> distances;
+    std::vector<ng::vertex_t> predecessors(topology.nb_vertices());
+    size_t nb_settled = 0, nb_diff = 0;
+    std::chrono::microseconds adjacency_list_time{0}, topology_time{0};
+    for (const auto start: starts) {
+        distances.assign(topology.nb_vertices(), infinity);
+        auto begin = std::chrono::steady_clock::now();
+        run_dijkstra(filtered, boost::get(&ng::Edge::duration, graph), start, radius, distances, predecessors);
+        adjacency_list_time += std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - begin);
+        const size_t adjacency_list_settled = nb_within(distances, radius);
+
+        distances.assign(topology.nb_vertices(), infinity);
+        begin = std::chrono::steady_clock::now();
+        run_dijkstra(layered, layered.durations(), start, radius, distances, predecessors);
+        topology_time += std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - begin);
+        const size_t topology_settled = nb_within(distances, radius);
+
+        nb_settled += topology_settled;
+        if (adjacency_list_settled != topology_settled) { ++nb_diff; }
+    }
+
+    const auto per_second = [&](const std::chrono::microseconds& time) {
+        return time.count() ? nb_settled * 1000000 / time.count() : 0;
+    };
+    std::cout << "adjacency list: " << adjacency_list_memory / 1024 << " kB resident, "
+              << adjacency_list_time.count() / 1000 << "ms, "
+              << per_second(adjacency_list_time) << " vertices settled by second" << std::endl
+              << "street topology: " << (topology.edges.is_mapped() ? "mapped from the flat file, " :
+                                         std::to_string(topology.memory_size() / 1024) + " kB, ")
+              << topology_time.count() / 1000 << "ms, "
+              << per_second(topology_time) << " vertices settled by second" << std::endl
+              << nb_settled << " vertices reached within " << radius << "s, "
+              << nb_diff << " searches with a different number of vertices" << std::endl;
+    return 0;
+}
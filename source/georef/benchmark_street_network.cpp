@@ -0,0 +1,134 @@
+/* Copyright © 2001-2016, Canal TP and/or its affiliates. All rights reserved.
+
+This file is part of Navitia,
+    the software to build cool stuff with public transport.
+
+Hope you'll enjoy and contribute to this project,
+    powered by Canal TP (www.canaltp.fr).
+Help us simplify mobility and open public transport:
+    a non ending quest to the responsive locomotion way of traveling!
+
+LICENCE: This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Affero General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+Stay tuned using
+twitter @navitia
+IRC #navitia on freenode
+https://groups.google.com/d/forum/navitia
+www.navitia.io
+*/
+
+#include "georef/street_network.h"
+#include "type/data.h"
+#include "utils/timer.h"
+#include "utils/init.h"
+#include <boost/program_options.hpp>
+#include <chrono>
+#include <iostream>
+#include <random>
+
+using namespace navitia;
+namespace po = boost::program_options;
+namespace ng = navitia::georef;
+
+// The street network fallback computed by the dijkstra kernel used by the
+// PathFinder (street_dijkstra), and by the boost dijkstra it replaces
+static void boost_distance_dijkstra(ng::PathFinder& finder, const time_duration radius) {
+    try {
+        finder.dijkstra(finder.starting_edge[ng::ProjectionData::Direction::Source],
+                        ng::distance_visitor(radius, finder.distances));
+    } catch(ng::DestinationFound) {}
+    try {
+        finder.dijkstra(finder.starting_edge[ng::ProjectionData::Direction::Target],
+                        ng::distance_visitor(radius, finder.distances));
+    } catch(ng::DestinationFound) {}
+}
+
+int main(int argc, char** argv) {
+    navitia::init_app();
+    po::options_description desc("Street network dijkstra benchmark");
+    std::string file, mode_str;
+    int iterations, radius;
+
+    desc.add_options()
+            ("help", "Show this message")
+            ("iterations,i", po::value<int>(&iterations)->default_value(1000),
+                     "Number of fallbacks computed")
+            ("file,f", po::value<std::string>(&file)->default_value("data.nav.lz4"),
+                     "Path to data.nav.lz4")
+            ("radius,r", po::value<int>(&radius)->default_value(15 * 60),
+                     "Max duration of the fallbacks in seconds")
+            ("mode,m", po::value<std::string>(&mode_str)->default_value("walking"),
+                     "Transportation mode (walking, bike, car or bss)");
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+    if (vm.count("help")) {
+        std::cout << "This is used to compare the street network dijkstra with the boost one" << std::endl;
+        std::cout << desc << std::endl;
+        return 1;
+    }
+    type::Mode_e mode = type::Mode_e::Walking;
+    if (mode_str == "bike") { mode = type::Mode_e::Bike; }
+    else if (mode_str == "car") { mode = type::Mode_e::Car; }
+    else if (mode_str == "bss") { mode = type::Mode_e::Bss; }
+
+    type::Data data;
+    {
+        Timer t("Chargement des données : " + file);
+        data.load(file);
+    }
+    const auto& geo_ref = *data.geo_ref;
+    if (geo_ref.nb_vertex_by_mode == 0) {
+        std::cout << "no street network in " << file << std::endl;
+        return 1;
+    }
+
+    std::mt19937 rng(31442);
+    std::uniform_int_distribution<ng::vertex_t> gen(0, geo_ref.nb_vertex_by_mode - 1);
+    std::vector<type::GeographicalCoord> starts;
+    for (int i = 0; i < iterations; ++i) {
+        starts.push_back(geo_ref.search_graph().coord(gen(rng)));
+    }
+
+    ng::PathFinder finder(geo_ref);
+    const auto max_dur = navitia::seconds(radius);
+    size_t nb_settled = 0, nb_diff = 0;
+    std::chrono::microseconds boost_time{0}, street_time{0};
+    for (const auto& start: starts) {
+        finder.init(start, mode, 1);
+        if (! finder.starting_edge.found) { continue; }
+        auto begin = std::chrono::steady_clock::now();
+        boost_distance_dijkstra(finder, max_dur);
+        boost_time += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin);
+        const auto boost_distances = finder.distances;
+
+        finder.init(start, mode, 1);
+        begin = std::chrono::steady_clock::now();
+        finder.start_distance_dijkstra(max_dur);
+        street_time += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin);
+
+        for (const auto v: finder.touched_vertices) {
+            if (finder.distances[v] > max_dur) { continue; }
+            ++nb_settled;
+            if (finder.distances[v] != boost_distances[v]) { ++nb_diff; }
+        }
+    }
+
+    std::cout << "boost dijkstra: " << boost_time.count() / 1000 << "ms" << std::endl
+              << "street dijkstra: " << street_time.count() / 1000 << "ms" << std::endl
+              << nb_settled << " vertices reached within " << radius << "s, "
+              << nb_diff << " with a different duration" << std::endl;
+    return 0;
+}
@@ -0,0 +1,304 @@
+/* Copyright © 2001-2016, Canal TP and/or its affiliates. All rights reserved.
+
+This file is part of Navitia,
+    the software to build cool stuff with public transport.
+
+Hope you'll enjoy and contribute to this project,
+    powered by Canal TP (www.canaltp.fr).
+Help us simplify mobility and open public transport:
+    a non ending quest to the responsive locomotion way of traveling!
+
+LICENCE: This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Affero General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+Stay tuned using
+twitter @navitia
+IRC #navitia on freenode
+https://groups.google.com/d/forum/navitia
+www.navitia.io
+*/
+
+#include "contraction_hierarchy.h"
+#include "utils/logger.h"
+#include <algorithm>
+#include <functional>
+#include <queue>
+
+namespace navitia { namespace georef {
+
+namespace {
+
+// maximum number of vertices settled by a witness search: a shortcut is
+// added if no witness is found before, which is correct but can add
+// useless shortcuts
+const size_t max_witness_settled = 500;
+// smaller limit used to simulate the contraction when computing the priorities
+const size_t max_simulation_settled = 50;
+
+struct BuildArc {
+    uint32_t other;
+    uint32_t duration;
+    uint32_t middle;
+};
+
+// The graph being contracted: the arcs are never removed, the arcs of the
+// contracted vertices are skipped
+struct Contractor {
+    std::vector<std::vector<BuildArc>> out_arcs, in_arcs;
+    std::vector<bool> contracted;
+    std::vector<uint32_t> nb_contracted_neighbors;
+    // state of the witness searches
+    std::vector<uint32_t> witness_distances;
+    std::vector<uint32_t> witness_touched;
+
+    explicit Contractor(size_t nb_vertices):
+        out_arcs(nb_vertices), in_arcs(nb_vertices), contracted(nb_vertices, false),
+        nb_contracted_neighbors(nb_vertices, 0),
+        witness_distances(nb_vertices, std::numeric_limits<uint32_t>::max()) {}
+
+    // add the arc, or decrease the duration of the existing one
+    void add_arc(uint32_t from, uint32_t to, uint32_t duration, uint32_t middle) {
+        auto out = std::find_if(out_arcs[from].begin(), out_arcs[from].end(),
+                                [&](const BuildArc& a) { return a.other == to; });
+        if (out == out_arcs[from].end()) {
+            out_arcs[from].push_back({to, duration, middle});
+            in_arcs[to].push_back({from, duration, middle});
+            return;
+        }
+        if (out->duration <= duration) { return; }
+        *out = {to, duration, middle};
+        auto in = std::find_if(in_arcs[to].begin(), in_arcs[to].end(),
+                               [&](const BuildArc& a) { return a.other == from; });
+        *in = {from, duration, middle};
+    }
+
+    // dijkstra from source among the vertices not contracted, except avoided
+    void witness_search(uint32_t source, uint32_t avoided, uint32_t max_duration, size_t max_settled) {
+        for (const auto v: witness_touched) {
+            witness_distances[v] = std::numeric_limits<uint32_t>::max();
+        }
+        witness_touched.clear();
+        typedef std::pair<uint32_t, uint32_t> elt; // duration, vertex
+        std::priority_queue<elt, std::vector<elt>, std::greater<elt>> queue;
+        witness_distances[source] = 0;
+        witness_touched.push_back(source);
+        queue.push({0, source});
+        size_t nb_settled = 0;
+        while (! queue.empty() && nb_settled < max_settled) {
+            const auto top = queue.top();
+            queue.pop();
+            if (top.first != witness_distances[top.second]) { continue; }
+            if (top.first > max_duration) { break; }
+            ++nb_settled;
+            for (const auto& arc: out_arcs[top.second]) {
+                if (contracted[arc.other] || arc.other == avoided) { continue; }
+                const uint32_t dist = top.first + arc.duration;
+                if (dist < witness_distances[arc.other]) {
+                    if (witness_distances[arc.other] == std::numeric_limits<uint32_t>::max()) {
+                        witness_touched.push_back(arc.other);
+                    }
+                    witness_distances[arc.other] = dist;
+                    queue.push({dist, arc.other});
+                }
+            }
+        }
+    }
+
+    // the shortcuts needed to contract v, added if add_shortcuts, returns their number
+    size_t contract(uint32_t v, bool add_shortcuts) {
+        size_t nb_shortcuts = 0;
+        std::vector<BuildArc> shortcuts;
+        for (const auto& in: in_arcs[v]) {
+            if (contracted[in.other]) { continue; }
+            uint32_t max_duration = 0;
+            for (const auto& out: out_arcs[v]) {
+                if (contracted[out.other] || out.other == in.other) { continue; }
+                max_duration = std::max(max_duration, in.duration + out.duration);
+            }
+            if (max_duration == 0) { continue; }
+            witness_search(in.other, v, max_duration,
+                           add_shortcuts ? max_witness_settled : max_simulation_settled);
+            for (const auto& out: out_arcs[v]) {
+                if (contracted[out.other] || out.other == in.other) { continue; }
+                const uint32_t via = in.duration + out.duration;
+                if (witness_distances[out.other] <= via) { continue; }
+                ++nb_shortcuts;
+                // the arcs of v can't be modified while they are iterated
+                if (add_shortcuts) { shortcuts.push_back({out.other, via, in.other}); }
+            }
+        }
+        for (const auto& shortcut: shortcuts) {
+            add_arc(shortcut.middle, shortcut.other, shortcut.duration, v);
+        }
+        return nb_shortcuts;
+    }
+
+    // the least important vertices are contracted first: the ones whose
+    // contraction removes more arcs than it adds, and whose neighbors have
+    // not been contracted (the contraction is spread over the graph)
+    int priority(uint32_t v) {
+        int degree = 0;
+        for (const auto& arc: in_arcs[v]) { if (! contracted[arc.other]) { ++degree; } }
+        for (const auto& arc: out_arcs[v]) { if (! contracted[arc.other]) { ++degree; } }
+        return 2 * int(contract(v, false)) - degree + int(nb_contracted_neighbors[v]);
+    }
+};
+
+} // anonymous namespace
+
+void ContractionHierarchy::build(const StreetTopology& topology, nt::Mode_e mode, uint8_t allowed_layers) {
+    auto logger = log4cplus::Logger::getInstance("log");
+    this->mode = mode;
+    nb_layered_vertices = topology.nb_layered_vertices;
+    nb_layered_edges = topology.nb_layered_edges;
+    const uint32_t nb_vertices = topology.nb_vertex_by_layer * StreetTopology::nb_layers;
+    std::vector<uint32_t> ranks(nb_vertices, std::numeric_limits<uint32_t>::max());
+
+    Contractor contractor(nb_vertices);
+    std::vector<uint32_t> vertices;
+    const LayeredStreetGraph graph(topology, allowed_layers);
+    for (uint8_t layer = 0; layer < StreetTopology::nb_layers; ++layer) {
+        if (! (allowed_layers & (1 << layer))) { continue; }
+        for (uint32_t v = layer * topology.nb_vertex_by_layer; v < (layer + 1) * topology.nb_vertex_by_layer; ++v) {
+            vertices.push_back(v);
+            const auto range = out_edges(v, graph);
+            for (auto it = range.first; it != range.second; ++it) {
+                const auto w = target(*it, graph);
+                if (w == v) { continue; }
+                contractor.add_arc(v, w, graph.duration(*it), no_middle);
+            }
+        }
+    }
+
+    typedef std::pair<int, uint32_t> elt; // priority, vertex
+    std::priority_queue<elt, std::vector<elt>, std::greater<elt>> queue;
+    for (const auto v: vertices) {
+        queue.push({contractor.priority(v), v});
+    }
+    uint32_t rank = 0;
+    while (! queue.empty()) {
+        const uint32_t v = queue.top().second;
+        queue.pop();
+        // the priorities are updated lazily
+        const int priority = contractor.priority(v);
+        if (! queue.empty() && priority > queue.top().first) {
+            queue.push({priority, v});
+            continue;
+        }
+        contractor.contract(v, true);
+        contractor.contracted[v] = true;
+        ranks[v] = rank++;
+        for (const auto& arc: contractor.in_arcs[v]) { ++contractor.nb_contracted_neighbors[arc.other]; }
+        for (const auto& arc: contractor.out_arcs[v]) { ++contractor.nb_contracted_neighbors[arc.other]; }
+    }
+
+    // each arc is an up arc of its source or a down arc of its target
+    std::vector<uint32_t> up_begin(nb_vertices + 1, 0);
+    std::vector<uint32_t> down_begin(nb_vertices + 1, 0);
+    for (const auto v: vertices) {
+        for (const auto& arc: contractor.out_arcs[v]) {
+            if (ranks[arc.other] > ranks[v]) { ++up_begin[v + 1]; } else { ++down_begin[arc.other + 1]; }
+        }
+    }
+    for (uint32_t v = 0; v < nb_vertices; ++v) {
+        up_begin[v + 1] += up_begin[v];
+        down_begin[v + 1] += down_begin[v];
+    }
+    std::vector<Arc> up_arcs(up_begin.back());
+    std::vector<Arc> down_arcs(down_begin.back());
+    std::vector<uint32_t> next_up(up_begin.begin(), up_begin.end() - 1);
+    std::vector<uint32_t> next_down(down_begin.begin(), down_begin.end() - 1);
+    size_t nb_shortcuts = 0;
+    for (const auto v: vertices) {
+        for (const auto& arc: contractor.out_arcs[v]) {
+            if (arc.middle != no_middle) { ++nb_shortcuts; }
+            if (ranks[arc.other] > ranks[v]) {
+                auto& up = up_arcs[next_up[v]++];
+                up.other = arc.other;
+                up.duration = arc.duration;
+                up.middle = arc.middle;
+            } else {
+                auto& down = down_arcs[next_down[arc.other]++];
+                down.other = v;
+                down.duration = arc.duration;
+                down.middle = arc.middle;
+            }
+        }
+    }
+    LOG4CPLUS_INFO(logger, "contraction hierarchy: " << vertices.size() << " vertices contracted, "
+                   << nb_shortcuts << " shortcuts added");
+    this->ranks = std::move(ranks);
+    this->up_begin = std::move(up_begin);
+    this->up_arcs = std::move(up_arcs);
+    this->down_begin = std::move(down_begin);
+    this->down_arcs = std::move(down_arcs);
+}
+
+void ContractionHierarchy::save(nt::FlatWriter& writer) const {
+    writer.write<uint8_t>(static_cast<uint8_t>(mode));
+    writer.write<uint64_t>(nb_layered_vertices);
+    writer.write<uint64_t>(nb_layered_edges);
+    writer.write_array(ranks);
+    writer.write_array(up_begin);
+    writer.write_array(up_arcs);
+    writer.write_array(down_begin);
+    writer.write_array(down_arcs);
+}
+
+void ContractionHierarchy::map(nt::FlatReader& reader) {
+    mode = static_cast<nt::Mode_e>(reader.read<uint8_t>());
+    nb_layered_vertices = reader.read<uint64_t>();
+    nb_layered_edges = reader.read<uint64_t>();
+    ranks = reader.read_array<uint32_t>();
+    up_begin = reader.read_array<uint32_t>();
+    up_arcs = reader.read_array<Arc>();
+    down_begin = reader.read_array<uint32_t>();
+    down_arcs = reader.read_array<Arc>();
+    if (up_begin.size() != ranks.size() + 1 || down_begin.size() != ranks.size() + 1
+            || up_begin.back() != up_arcs.size() || down_begin.back() != down_arcs.size()) {
+        throw nt::flat_file_error("invalid flat file: inconsistent contraction hierarchy");
+    }
+}
+
+std::pair<const ContractionHierarchy::Arc&, const ContractionHierarchy::Arc&>
+ContractionHierarchy::halves(uint32_t from, uint32_t to, const Arc& shortcut) const {
+    // the middle has been contracted before both ends: from -> middle is
+    // a down arc of middle, middle -> to is an up arc of middle
+    const uint32_t middle = shortcut.middle;
+    const auto first = std::find_if(down_arcs.begin() + down_begin[middle], down_arcs.begin() + down_begin[middle + 1],
+                                    [&](const Arc& a) { return a.other == from; });
+    const auto second = std::find_if(up_arcs.begin() + up_begin[middle], up_arcs.begin() + up_begin[middle + 1],
+                                     [&](const Arc& a) { return a.other == to; });
+    return {*first, *second};
+}
+
+void ContractionHierarchy::unpack(uint32_t from, uint32_t to, const Arc& arc,
+                                  std::vector<std::pair<uint32_t, uint32_t>>& path) const {
+    // the arcs to unpack, the next one on the top
+    struct ToUnpack { uint32_t from, to; Arc arc; };
+    std::vector<ToUnpack> stack = {{from, to, arc}};
+    while (! stack.empty()) {
+        const auto current = stack.back();
+        stack.pop_back();
+        if (current.arc.middle == no_middle) {
+            path.push_back({current.to, current.arc.duration});
+            continue;
+        }
+        const uint32_t middle = current.arc.middle;
+        const auto arcs = halves(current.from, current.to, current.arc);
+        stack.push_back({middle, current.to, arcs.second});
+        stack.push_back({current.from, middle, arcs.first});
+    }
+}
+
+}} // namespace navitia::georef
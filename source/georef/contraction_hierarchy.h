@@ -0,0 +1,124 @@
+/* Copyright © 2001-2016, Canal TP and/or its affiliates. All rights reserved.
+
+This file is part of Navitia,
+    the software to build cool stuff with public transport.
+
+Hope you'll enjoy and contribute to this project,
+    powered by Canal TP (www.canaltp.fr).
+Help us simplify mobility and open public transport:
+    a non ending quest to the responsive locomotion way of traveling!
+
+LICENCE: This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Affero General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+Stay tuned using
+twitter @navitia
+IRC #navitia on freenode
+https://groups.google.com/d/forum/navitia
+www.navitia.io
+*/
+
+#pragma once
+
+#include "georef/street_topology.h"
+#include "utils/serialization_vector.h"
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace navitia { namespace georef {
+
+/** Contraction hierarchy of the street network of a transportation mode
+ *
+ * The vertices of the layers allowed for the mode are contracted one by
+ * one, from the least important one: when v is contracted, a shortcut
+ * u -> w is added for each path u -> v -> w that is the only shortest
+ * path between u and w through the remaining vertices. The rank of a
+ * vertex is its order of contraction.
+ *
+ * A shortest path is then an upward path (to higher ranks) followed by a
+ * downward path, thus the queries only search the up arcs from the start
+ * and the down arcs backward from the destination, which explores a few
+ * hundred vertices instead of the whole area.
+ *
+ * The vertices are the ones of GeoRef::graph and the durations are the
+ * integer seconds of the edges, without speed factor. It is built by
+ * ed2nav on demand and serialized with the GeoRef.
+ */
+struct ContractionHierarchy {
+    static const uint32_t no_middle = std::numeric_limits<uint32_t>::max();
+
+    struct Arc {
+        uint32_t other; // target of an up arc, source of a down arc
+        uint32_t duration; // in seconds
+        uint32_t middle = no_middle; // contracted vertex of a shortcut, no_middle for an edge
+        template<class Archive> void serialize(Archive& ar, const unsigned int) {
+            ar & other & duration & middle;
+        }
+    };
+    static_assert(sizeof(Arc) == 12, "ContractionHierarchy::Arc must not have padding");
+
+    nt::Mode_e mode = nt::Mode_e::Car;
+    // size of the layered graph it has been built from
+    size_t nb_layered_vertices = 0;
+    size_t nb_layered_edges = 0;
+    nt::FlatArray<uint32_t> ranks;
+    // the up arcs from v are up_arcs[up_begin[v]] to up_arcs[up_begin[v + 1]] (excluded)
+    nt::FlatArray<uint32_t> up_begin;
+    nt::FlatArray<Arc> up_arcs;
+    // the down arcs reaching v are down_arcs[down_begin[v]] to down_arcs[down_begin[v + 1]] (excluded)
+    nt::FlatArray<uint32_t> down_begin;
+    nt::FlatArray<Arc> down_arcs;
+
+    /// contract the vertices of the layers allowed for the mode
+    void build(const StreetTopology& topology, nt::Mode_e mode, uint8_t allowed_layers);
+
+    /// the arcs a shortcut from `from` to `to` stands for: from -> middle (a
+    /// down arc of middle) and middle -> to (an up arc of middle)
+    std::pair<const Arc&, const Arc&> halves(uint32_t from, uint32_t to, const Arc& shortcut) const;
+
+    /** Append to path the edges of the graph of the arc from `from` to `to`,
+     *  as (target, duration) in the order of the path
+     */
+    void unpack(uint32_t from, uint32_t to, const Arc& arc,
+                std::vector<std::pair<uint32_t, uint32_t>>& path) const;
+
+    template<class Archive> void save(Archive& ar, const unsigned int) const {
+        const std::vector<uint32_t> ranks(this->ranks.begin(), this->ranks.end());
+        const std::vector<uint32_t> up_begin(this->up_begin.begin(), this->up_begin.end());
+        const std::vector<Arc> up_arcs(this->up_arcs.begin(), this->up_arcs.end());
+        const std::vector<uint32_t> down_begin(this->down_begin.begin(), this->down_begin.end());
+        const std::vector<Arc> down_arcs(this->down_arcs.begin(), this->down_arcs.end());
+        ar & mode & nb_layered_vertices & nb_layered_edges & ranks
+           & up_begin & up_arcs & down_begin & down_arcs;
+    }
+    template<class Archive> void load(Archive& ar, const unsigned int) {
+        std::vector<uint32_t> ranks, up_begin, down_begin;
+        std::vector<Arc> up_arcs, down_arcs;
+        ar & mode & nb_layered_vertices & nb_layered_edges & ranks
+           & up_begin & up_arcs & down_begin & down_arcs;
+        this->ranks = std::move(ranks);
+        this->up_begin = std::move(up_begin);
+        this->up_arcs = std::move(up_arcs);
+        this->down_begin = std::move(down_begin);
+        this->down_arcs = std::move(down_arcs);
+    }
+    BOOST_SERIALIZATION_SPLIT_MEMBER()
+
+    /// write the hierarchy in a flat file
+    void save(nt::FlatWriter& writer) const;
+    /// read the hierarchy in place from a flat file written by save()
+    void map(nt::FlatReader& reader);
+};
+
+}} // namespace navitia::georef
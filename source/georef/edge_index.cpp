@@ -0,0 +1,259 @@
+/* Copyright © 2001-2016, Canal TP and/or its affiliates. All rights reserved.
+
+This file is part of Navitia,
+    the software to build cool stuff with public transport.
+
+Hope you'll enjoy and contribute to this project,
+    powered by Canal TP (www.canaltp.fr).
+Help us simplify mobility and open public transport:
+    a non ending quest to the responsive locomotion way of traveling!
+
+LICENCE: This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Affero General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+Stay tuned using
+twitter @navitia
+IRC #navitia on freenode
+https://groups.google.com/d/forum/navitia
+www.navitia.io
+*/
+
+#include "edge_index.h"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+
+namespace navitia { namespace georef {
+
+namespace {
+
+const double meters_by_degree = 111320;
+const double deg_to_rad = 0.0174532925199432958;
+// the cells are at least of this size, in meters
+const double min_cell_size = 100;
+
+// coordinates where the longitude is scaled by the cosinus of the latitude,
+// thus the distances are about euclidean on a small area
+struct Point {
+    double x;
+    double y;
+};
+
+double sqr_distance_to_segment(const Point& p, const Point& a, const Point& b) {
+    const double dx = b.x - a.x;
+    const double dy = b.y - a.y;
+    const double length_sqr = dx * dx + dy * dy;
+    double u = 0;
+    if (length_sqr > 0) {
+        u = std::min(1., std::max(0., ((p.x - a.x) * dx + (p.y - a.y) * dy) / length_sqr));
+    }
+    const double px = a.x + u * dx - p.x;
+    const double py = a.y + u * dy - p.y;
+    return px * px + py * py;
+}
+
+} // anonymous namespace
+
+void EdgeIndex::build(const StreetTopology& topology) {
+    nb_vertices = topology.nb_layered_vertices;
+    nb_edges = topology.nb_layered_edges;
+    layer_size = topology.nb_vertex_by_layer;
+    grids.assign(layer_size ? StreetTopology::nb_layers : 0, Grid());
+    for (uint8_t layer = 0; layer < grids.size(); ++layer) {
+        build_grid(grids[layer], topology, layer);
+    }
+}
+
+void EdgeIndex::build_grid(Grid& grid, const StreetTopology& topology, uint8_t layer) {
+    const uint8_t mask = 1 << layer;
+    // calls f(source, edge) for each edge of the layer
+    const auto for_each_edge = [&](const std::function<void(uint32_t, uint32_t)>& f) {
+        for (uint32_t u = 0; u < topology.nb_vertex_by_layer; ++u) {
+            for (uint32_t idx = topology.out_edges_begin[u]; idx < topology.out_edges_begin[u + 1]; ++idx) {
+                if (topology.edges[idx].layers & mask) { f(u, idx); }
+            }
+        }
+    };
+    size_t nb_layer_edges = 0;
+    double min_lon = std::numeric_limits<double>::max(), max_lon = std::numeric_limits<double>::lowest();
+    double min_lat = min_lon, max_lat = max_lon;
+    for_each_edge([&](uint32_t u, uint32_t idx) {
+        ++nb_layer_edges;
+        for (const auto v: {u, topology.edges[idx].target}) {
+            const auto& coord = topology.coords[v];
+            min_lon = std::min(min_lon, coord.lon());
+            max_lon = std::max(max_lon, coord.lon());
+            min_lat = std::min(min_lat, coord.lat());
+            max_lat = std::max(max_lat, coord.lat());
+        }
+    });
+    if (nb_layer_edges == 0) { return; }
+
+    // about one edge by cell
+    const double coslat = std::max(0.01, std::cos((min_lat + max_lat) / 2 * deg_to_rad));
+    const double area = (max_lon - min_lon) * coslat * (max_lat - min_lat) * meters_by_degree * meters_by_degree;
+    const double cell_size = std::max(min_cell_size, std::sqrt(area / nb_layer_edges));
+    grid.min_lon = min_lon;
+    grid.min_lat = min_lat;
+    grid.cell_lat = cell_size / meters_by_degree;
+    grid.cell_lon = grid.cell_lat / coslat;
+    grid.nb_cols = uint32_t((max_lon - min_lon) / grid.cell_lon) + 1;
+    grid.nb_rows = uint32_t((max_lat - min_lat) / grid.cell_lat) + 1;
+
+    // calls f(cell) for each cell crossed by the edge
+    const auto for_each_cell = [&](uint32_t u, uint32_t v, const std::function<void(size_t)>& f) {
+        const auto& a = topology.coords[u];
+        const auto& b = topology.coords[v];
+        const uint32_t col_begin = uint32_t((std::min(a.lon(), b.lon()) - min_lon) / grid.cell_lon);
+        const uint32_t col_end = uint32_t((std::max(a.lon(), b.lon()) - min_lon) / grid.cell_lon);
+        const uint32_t row_begin = uint32_t((std::min(a.lat(), b.lat()) - min_lat) / grid.cell_lat);
+        const uint32_t row_end = uint32_t((std::max(a.lat(), b.lat()) - min_lat) / grid.cell_lat);
+        const bool small = col_end - col_begin < 2 && row_end - row_begin < 2;
+        // a cell is crossed if the edge is nearer from its center than its half diagonal
+        const Point pa{a.lon() * coslat, a.lat()}, pb{b.lon() * coslat, b.lat()};
+        const double half_diagonal_sqr = grid.cell_lat * grid.cell_lat / 2;
+        for (uint32_t row = row_begin; row <= row_end; ++row) {
+            for (uint32_t col = col_begin; col <= col_end; ++col) {
+                const Point center{(min_lon + (col + 0.5) * grid.cell_lon) * coslat,
+                                   min_lat + (row + 0.5) * grid.cell_lat};
+                if (small || sqr_distance_to_segment(center, pa, pb) <= half_diagonal_sqr) {
+                    f(size_t(row) * grid.nb_cols + col);
+                }
+            }
+        }
+    };
+
+    // the edges are counted by cell, then stored
+    std::vector<uint32_t> cell_begin(size_t(grid.nb_cols) * grid.nb_rows + 1, 0);
+    for_each_edge([&](uint32_t u, uint32_t idx) {
+        for_each_cell(u, topology.edges[idx].target, [&](size_t cell) { ++cell_begin[cell + 1]; });
+    });
+    for (size_t cell = 1; cell < cell_begin.size(); ++cell) {
+        cell_begin[cell] += cell_begin[cell - 1];
+    }
+    std::vector<uint32_t> edges(cell_begin.back());
+    std::vector<uint32_t> next(cell_begin.begin(), cell_begin.end() - 1);
+    for_each_edge([&](uint32_t u, uint32_t idx) {
+        for_each_cell(u, topology.edges[idx].target, [&](size_t cell) { edges[next[cell]++] = idx; });
+    });
+    grid.cell_begin = std::move(cell_begin);
+    grid.edges = std::move(edges);
+}
+
+void EdgeIndex::save(nt::FlatWriter& writer) const {
+    writer.write<uint64_t>(nb_vertices);
+    writer.write<uint64_t>(nb_edges);
+    writer.write<uint64_t>(layer_size);
+    writer.write<uint64_t>(grids.size());
+    for (const auto& grid: grids) {
+        writer.write(grid.min_lon);
+        writer.write(grid.min_lat);
+        writer.write(grid.cell_lon);
+        writer.write(grid.cell_lat);
+        writer.write(grid.nb_cols);
+        writer.write(grid.nb_rows);
+        writer.write_array(grid.cell_begin);
+        writer.write_array(grid.edges);
+    }
+}
+
+void EdgeIndex::map(nt::FlatReader& reader) {
+    nb_vertices = reader.read<uint64_t>();
+    nb_edges = reader.read<uint64_t>();
+    layer_size = reader.read<uint64_t>();
+    grids.assign(reader.read<uint64_t>(), Grid());
+    for (auto& grid: grids) {
+        grid.min_lon = reader.read<double>();
+        grid.min_lat = reader.read<double>();
+        grid.cell_lon = reader.read<double>();
+        grid.cell_lat = reader.read<double>();
+        grid.nb_cols = reader.read<uint32_t>();
+        grid.nb_rows = reader.read<uint32_t>();
+        grid.cell_begin = reader.read_array<uint32_t>();
+        grid.edges = reader.read_array<uint32_t>();
+        if (grid.cell_begin.size() != size_t(grid.nb_cols) * grid.nb_rows + 1
+                || grid.cell_begin.back() != grid.edges.size()) {
+            throw nt::flat_file_error("invalid flat file: inconsistent edge index");
+        }
+    }
+}
+
+uint32_t EdgeIndex::get_source(const StreetTopology& topology, uint32_t edge) const {
+    const auto& begin = topology.out_edges_begin;
+    return std::upper_bound(begin.begin(), begin.end(), edge) - begin.begin() - 1;
+}
+
+boost::optional<EdgeIndex::Projection>
+EdgeIndex::nearest(const StreetTopology& topology,
+                   const type::GeographicalCoord& coord,
+                   nt::idx_t offset,
+                   double max_distance) const {
+    boost::optional<Projection> result;
+    if (layer_size == 0 || offset / layer_size >= grids.size()) { return result; }
+    const uint32_t layer = offset / layer_size;
+    const Grid& grid = grids[layer];
+    if (grid.nb_cols == 0) { return result; }
+
+    // the cell of the coordinate, that can be outside of the grid
+    const int64_t col = std::floor((coord.lon() - grid.min_lon) / grid.cell_lon);
+    const int64_t row = std::floor((coord.lat() - grid.min_lat) / grid.cell_lat);
+    const double coslat = std::cos(coord.lat() * deg_to_rad);
+    const double cell_size = std::min(grid.cell_lat, grid.cell_lon * coslat) * meters_by_degree;
+
+    uint32_t best_edge = 0;
+    const auto is_better = [&](uint32_t edge, float distance) {
+        if (! result || distance < result->distance) { return true; }
+// we assume strict float comparison in that case
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wfloat-equal"
+        if (distance != result->distance || edge == best_edge) { return false; }
+#pragma GCC diagnostic pop
+        // like the search from the nearest vertex, the edge whose source
+        // is the nearest is kept, then the first one
+        const double dist = coord.distance_to(topology.coords[get_source(topology, edge)]);
+        const double best_dist = coord.distance_to(topology.coords[get_source(topology, best_edge)]);
+        return dist < best_dist || (! (best_dist < dist) && edge < best_edge);
+    };
+    const auto visit = [&](int64_t c, int64_t r) {
+        if (c < 0 || r < 0 || c >= grid.nb_cols || r >= grid.nb_rows) { return; }
+        const size_t cell = size_t(r) * grid.nb_cols + c;
+        for (uint32_t i = grid.cell_begin[cell]; i < grid.cell_begin[cell + 1]; ++i) {
+            const uint32_t edge = grid.edges[i];
+            const LayeredEdge e{get_source(topology, edge) + layer * layer_size, edge};
+            const auto projection = coord.project(topology.coord(e.source), topology.coord(topology.target(e)));
+            if (projection.second > max_distance || ! is_better(edge, projection.second)) { continue; }
+            result = Projection{e, projection.first, projection.second};
+            best_edge = edge;
+        }
+    };
+
+    // the cells of the ring r are at least at (r - 1) cells of the coordinate
+    for (int64_t r = 0; r < 2 || (r - 1) * cell_size <= (result ? result->distance : max_distance); ++r) {
+        if (r == 0) {
+            visit(col, row);
+            continue;
+        }
+        for (int64_t i = -r; i <= r; ++i) {
+            visit(col + i, row - r);
+            visit(col + i, row + r);
+        }
+        for (int64_t i = -r + 1; i < r; ++i) {
+            visit(col - r, row + i);
+            visit(col + r, row + i);
+        }
+    }
+    return result;
+}
+
+}} // namespace navitia::georef
@@ -0,0 +1,100 @@
+/* Copyright © 2001-2016, Canal TP and/or its affiliates. All rights reserved.
+
+This file is part of Navitia,
+    the software to build cool stuff with public transport.
+
+Hope you'll enjoy and contribute to this project,
+    powered by Canal TP (www.canaltp.fr).
+Help us simplify mobility and open public transport:
+    a non ending quest to the responsive locomotion way of traveling!
+
+LICENCE: This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Affero General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+Stay tuned using
+twitter @navitia
+IRC #navitia on freenode
+https://groups.google.com/d/forum/navitia
+www.navitia.io
+*/
+
+#pragma once
+
+#include "georef/georef.h"
+#include "type/flat_array.h"
+#include "type/flat_file.h"
+#include <boost/optional.hpp>
+#include <vector>
+
+namespace navitia { namespace georef {
+
+/** Spatial index of the edges of the street network, to project a
+ * coordinate on its nearest edge in one query.
+ *
+ * The edges of the street topology are indexed by layer (walking, bike and
+ * car, cf GeoRef::init()) in a grid: an edge is stored in every cell it
+ * crosses, in the grid of each layer where it exists. A query searches
+ * the cells ring by ring around the coordinate, and stops as soon as the
+ * next ring is farther than the nearest edge found.
+ *
+ * The size of the cells depends on the density of the edges, thus a big
+ * sparse area does not need a huge grid.
+ */
+struct EdgeIndex {
+    struct Projection {
+        LayeredEdge edge;
+        type::GeographicalCoord projected;
+        float distance;
+    };
+
+    // size of the layered graph of the topology it has been built from
+    size_t nb_vertices = 0;
+    size_t nb_edges = 0;
+
+    void build(const StreetTopology& topology);
+
+    /// the nearest edge whose source is in the layer of offset, within max_distance meters
+    boost::optional<Projection> nearest(const StreetTopology& topology,
+                                        const type::GeographicalCoord& coord,
+                                        nt::idx_t offset,
+                                        double max_distance = 500) const;
+
+    /// write the index in a flat file
+    void save(nt::FlatWriter& writer) const;
+    /// read the index in place from a flat file written by save()
+    void map(nt::FlatReader& reader);
+
+private:
+    struct Grid {
+        double min_lon = 0;
+        double min_lat = 0;
+        // size of a cell in degrees, the cells being about square
+        double cell_lon = 1;
+        double cell_lat = 1;
+        uint32_t nb_cols = 0;
+        uint32_t nb_rows = 0;
+        // the edges of the cell c are edges[cell_begin[c]] to edges[cell_begin[c + 1]] (excluded)
+        nt::FlatArray<uint32_t> cell_begin = {0};
+        nt::FlatArray<uint32_t> edges;
+    };
+
+    nt::idx_t layer_size = 0;
+    // by layer, the cells containing the indexes of the edges in
+    // StreetTopology::edges
+    std::vector<Grid> grids;
+
+    void build_grid(Grid& grid, const StreetTopology& topology, uint8_t layer);
+    uint32_t get_source(const StreetTopology& topology, uint32_t edge) const;
+};
+
+}} // namespace navitia::georef
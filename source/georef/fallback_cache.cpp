@@ -0,0 +1,80 @@
+/* Copyright © 2001-2016, Canal TP and/or its affiliates. All rights reserved.
+
+This file is part of Navitia,
+    the software to build cool stuff with public transport.
+
+Hope you'll enjoy and contribute to this project,
+    powered by Canal TP (www.canaltp.fr).
+Help us simplify mobility and open public transport:
+    a non ending quest to the responsive locomotion way of traveling!
+
+LICENCE: This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Affero General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+Stay tuned using
+twitter @navitia
+IRC #navitia on freenode
+https://groups.google.com/d/forum/navitia
+www.navitia.io
+*/
+
+#include "fallback_cache.h"
+#include <cmath>
+
+namespace navitia { namespace georef {
+
+constexpr double FallbackCache::offset_bucket;
+
+FallbackCache::Key::Key(const ProjectionData& projection,
+                        nt::Mode_e mode,
+                        float speed_factor,
+                        navitia::time_duration radius):
+    source(projection[ProjectionData::Direction::Source]),
+    target(projection[ProjectionData::Direction::Target]),
+    offset(std::lround(projection.distances[ProjectionData::Direction::Source] / offset_bucket)),
+    mode(mode),
+    speed_factor(speed_factor),
+    radius(radius.total_seconds())
+{}
+
+std::shared_ptr<const FallbackCache::Value> FallbackCache::get(const Key& key) {
+    ++nb_calls;
+    std::lock_guard<std::mutex> lock(mutex);
+    const auto it = index.find(key);
+    if (it == index.end()) {
+        ++nb_cache_miss;
+        return nullptr;
+    }
+    entries.splice(entries.begin(), entries, it->second);
+    return it->second->second;
+}
+
+void FallbackCache::add(const Key& key, Value value) {
+    auto ptr = std::make_shared<const Value>(std::move(value));
+    std::lock_guard<std::mutex> lock(mutex);
+    const auto it = index.find(key);
+    if (it != index.end()) {
+        // computed by another worker in the meantime
+        entries.splice(entries.begin(), entries, it->second);
+        it->second->second = std::move(ptr);
+        return;
+    }
+    entries.emplace_front(key, std::move(ptr));
+    index.emplace(key, entries.begin());
+    if (entries.size() > max_size) {
+        index.erase(entries.back().first);
+        entries.pop_back();
+    }
+}
+
+}} // namespace navitia::georef
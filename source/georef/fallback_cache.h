@@ -0,0 +1,102 @@
+/* Copyright © 2001-2016, Canal TP and/or its affiliates. All rights reserved.
+
+This file is part of Navitia,
+    the software to build cool stuff with public transport.
+
+Hope you'll enjoy and contribute to this project,
+    powered by Canal TP (www.canaltp.fr).
+Help us simplify mobility and open public transport:
+    a non ending quest to the responsive locomotion way of traveling!
+
+LICENCE: This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Affero General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+Stay tuned using
+twitter @navitia
+IRC #navitia on freenode
+https://groups.google.com/d/forum/navitia
+www.navitia.io
+*/
+
+#pragma once
+
+#include "georef/georef.h"
+#include "routing/raptor_utils.h"
+#include <atomic>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+
+namespace navitia { namespace georef {
+
+/** Cache of the stop points reachable from a starting point, shared by
+ * the workers.
+ *
+ * Most of the requests leave from a few places (stations, airports,
+ * popular addresses), thus the result of find_nearest_stop_points is
+ * kept, the least recently used entry being dropped when the cache is
+ * full. It is owned by the data, thus it is dropped with it.
+ *
+ * The key is the projection of the starting point on the street network,
+ * its position on the edge being rounded to offset_bucket meters, thus
+ * the durations can differ of the time to cross a bucket from the ones
+ * of an actual search.
+ *
+ * Unlike ConcurrentLru, the value is given by the caller as it is
+ * computed by the path finder of its worker, the lock being only held
+ * to read or update the cache.
+ */
+struct FallbackCache {
+    static constexpr double offset_bucket = 1; // in meters
+
+    struct Key {
+        vertex_t source;
+        vertex_t target;
+        long offset; // number of buckets from the source of the edge
+        nt::Mode_e mode;
+        float speed_factor;
+        long radius; // in seconds
+
+        Key(const ProjectionData& projection, nt::Mode_e mode, float speed_factor,
+            navitia::time_duration radius);
+
+        bool operator<(const Key& other) const {
+            return std::tie(source, target, offset, mode, speed_factor, radius)
+                < std::tie(other.source, other.target, other.offset, other.mode, other.speed_factor, other.radius);
+        }
+    };
+    using Value = routing::map_stop_point_duration;
+
+    explicit FallbackCache(size_t max_size = 1000): max_size(max_size) {}
+
+    /// the cached value, nullptr if the key is not in the cache
+    std::shared_ptr<const Value> get(const Key& key);
+    void add(const Key& key, Value value);
+
+    size_t get_nb_calls() const { return nb_calls; }
+    size_t get_nb_cache_miss() const { return nb_cache_miss; }
+
+private:
+    using Entries = std::list<std::pair<Key, std::shared_ptr<const Value>>>;
+
+    size_t max_size;
+    std::mutex mutex;
+    Entries entries; // the most recently used first
+    std::map<Key, Entries::iterator> index;
+    std::atomic<size_t> nb_calls{0};
+    std::atomic<size_t> nb_cache_miss{0};
+};
+
+}} // namespace navitia::georef
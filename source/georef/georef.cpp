@@ -29,6 +29,8 @@ www.navitia.io
 */
 
 #include "georef.h"
+#include "street_network.h"
+#include "edge_index.h"
 
 #include "utils/logger.h"
 #include "utils/functions.h"
@@ -74,7 +76,7 @@ std::string Way::get_label() const {
 /** Recherche des coordonnées les plus proches à un un numéro
     * les coordonnées par extrapolation
 */
-nt::GeographicalCoord Way::extrapol_geographical_coord(int number, const Graph& graph) const {
+nt::GeographicalCoord Way::extrapol_geographical_coord(int number, const StreetTopology& topology) const {
     HouseNumber hn_upper, hn_lower;
     nt::GeographicalCoord to_return;
 
@@ -108,7 +110,7 @@ nt::GeographicalCoord Way::extrapol_geographical_coord(int number, const Graph&
     double y_step = (hn_upper.coord.lat() - hn_lower.coord.lat()) /diff_house_number;
     to_return.set_lat(hn_lower.coord.lat() + y_step*diff_number);
 
-    const auto multiline = make_multiline(graph);
+    const auto multiline = make_multiline(topology);
     return project(multiline, to_return);
 }
 
@@ -119,7 +121,7 @@ nt::GeographicalCoord Way::extrapol_geographical_coord(int number, const Graph&
     * Sinon, les coordonnées par extrapolation
 */
 
-nt::GeographicalCoord Way::get_geographical_coord(const int number, const Graph& graph) const {
+nt::GeographicalCoord Way::get_geographical_coord(const int number, const StreetTopology& topology) const {
     const std::vector< HouseNumber>& house_number_list =
         number % 2 == 0 ? house_number_right : house_number_left;
 
@@ -142,7 +144,7 @@ nt::GeographicalCoord Way::get_geographical_coord(const int number, const Graph&
         }
 
         /// Dans le cas où le numéro recherché est dans la liste et <> à tous les numéros
-        return extrapol_geographical_coord(number, graph);
+        return extrapol_geographical_coord(number, topology);
     }
     nt::GeographicalCoord to_return;
     return to_return;
@@ -151,7 +153,7 @@ nt::GeographicalCoord Way::get_geographical_coord(const int number, const Graph&
 /** Recherche des coordonnées les plus proches à un numéro
     * Si la rue n'a pas de numéro, on renvoie son barycentre
 */
-nt::GeographicalCoord Way::nearest_coord(const int number, const Graph& graph) const {
+nt::GeographicalCoord Way::nearest_coord(const int number, const StreetTopology& topology) const {
     /// Attention la liste :
     /// "house_number_right" doit contenir les numéros pairs
     /// "house_number_left" doit contenir les numéros impairs
@@ -161,15 +163,15 @@ nt::GeographicalCoord Way::nearest_coord(const int number, const Graph& graph) c
             || (this->house_number_right.empty() && number % 2 == 0)
             || (this->house_number_left.empty() && number % 2 != 0)
             || number <= 0)
-        return projected_centroid(graph);
+        return projected_centroid(topology);
 
-    return get_geographical_coord(number, graph);
+    return get_geographical_coord(number, topology);
 }
 
-nt::MultiLineString Way::make_multiline(const Graph& graph) const {
+nt::MultiLineString Way::make_multiline(const StreetTopology& topology) const {
     nt::MultiLineString multiline;
     for (auto edge: this->edges) {
-        multiline.push_back({graph[edge.first].coord, graph[edge.second].coord});
+        multiline.push_back({topology.coord(edge.first), topology.coord(edge.second)});
         boost::range::sort(multiline.back());
     }
     auto cmp = [](const nt::LineString& a, const nt::LineString& b) -> bool {
@@ -181,8 +183,8 @@ nt::MultiLineString Way::make_multiline(const Graph& graph) const {
 
 
 // returns the centroid projected on the way
-nt::GeographicalCoord Way::projected_centroid(const Graph& graph) const {
-    const auto multiline = make_multiline(graph);
+nt::GeographicalCoord Way::projected_centroid(const StreetTopology& topology) const {
+    const auto multiline = make_multiline(topology);
 
     nt::GeographicalCoord centroid;
     try {
@@ -225,9 +227,9 @@ type::Mode_e GeoRef::get_mode(vertex_t vertex) const {
     return static_cast<type::Mode_e>(vertex / nb_vertex_by_mode);
 }
 
-PathItem::TransportCaracteristic GeoRef::get_caracteristic(edge_t edge) const {
-    auto source_mode = get_mode(boost::source(edge, graph));
-    auto target_mode = get_mode(boost::target(edge, graph));
+PathItem::TransportCaracteristic GeoRef::get_caracteristic(const LayeredEdge& edge) const {
+    auto source_mode = get_mode(edge.source);
+    auto target_mode = get_mode(topology.target(edge));
 
     if (source_mode == target_mode) {
         switch (source_mode) {
@@ -285,44 +287,24 @@ void GeoRef::add_way(const Way& w){
     ways.push_back(to_add);
 }
 
-ProjectionData::ProjectionData(const type::GeographicalCoord & coord, const GeoRef & sn, const proximitylist::ProximityList<vertex_t> &prox) {
-    edge_t edge;
-    found = true;
-    try {
-        edge = sn.nearest_edge(coord, prox);
-    } catch(proximitylist::NotFound) {
-        found = false;
-        vertices[Direction::Source] = std::numeric_limits<vertex_t>::max();
-        vertices[Direction::Target] = std::numeric_limits<vertex_t>::max();
-    }
-
-    if(found) {
-        init(coord, sn, edge);
-    }
-}
-
-ProjectionData::ProjectionData(const type::GeographicalCoord & coord, const GeoRef & sn, type::idx_t offset, const proximitylist::ProximityList<vertex_t> &prox){
-    edge_t edge;
-    found = true;
-    try {
-        edge = sn.nearest_edge(coord, prox, offset);
-    } catch(proximitylist::NotFound) {
-        found = false;
+ProjectionData::ProjectionData(const type::GeographicalCoord & coord, const GeoRef & sn, type::idx_t offset) {
+    const auto projection = sn.edge_index().nearest(sn.search_graph(), coord, offset);
+    found = bool(projection);
+    if (found) {
+        init(coord, sn, projection->edge);
+    } else {
         vertices[Direction::Source] = std::numeric_limits<vertex_t>::max();
         vertices[Direction::Target] = std::numeric_limits<vertex_t>::max();
     }
-
-    if(found) {
-        init(coord, sn, edge);
-    }
 }
 
-void ProjectionData::init(const type::GeographicalCoord & coord, const GeoRef & sn, edge_t nearest_edge) {
+void ProjectionData::init(const type::GeographicalCoord & coord, const GeoRef & sn, const LayeredEdge& nearest_edge) {
+    const StreetTopology& topology = sn.search_graph();
     // On cherche les coordonnées des extrémités de ce segment
-    vertices[Direction::Source] = boost::source(nearest_edge, sn.graph);
-    vertices[Direction::Target] = boost::target(nearest_edge, sn.graph);
-    const type::GeographicalCoord& vertex1_coord = sn.graph[vertices[Direction::Source]].coord;
-    const type::GeographicalCoord& vertex2_coord = sn.graph[vertices[Direction::Target]].coord;
+    vertices[Direction::Source] = nearest_edge.source;
+    vertices[Direction::Target] = topology.target(nearest_edge);
+    const type::GeographicalCoord& vertex1_coord = topology.coord(vertices[Direction::Source]);
+    const type::GeographicalCoord& vertex2_coord = topology.coord(vertices[Direction::Target]);
     // On projette le nœud sur le segment
     this->projected = coord.project(vertex1_coord, vertex2_coord).first;
     // On calcule la distance « initiale » déjà parcourue avant d'atteindre ces extrémité d'où on effectue le calcul d'itinéraire
@@ -358,6 +340,98 @@ void GeoRef::init() {
     }
 }
 
+void GeoRef::build_street_network_indexes() {
+    topology.build(graph, nb_vertex_by_mode);
+    build_edge_index();
+}
+
+void GeoRef::build_edge_index() {
+    auto index = std::make_unique<EdgeIndex>();
+    index->build(topology);
+    edges_index = std::move(index);
+}
+
+std::pair<size_t, size_t> GeoRef::layered_graph_size() const {
+    if (boost::num_vertices(graph) == 0) {
+        return {topology.nb_layered_vertices, topology.nb_layered_edges};
+    }
+    return {boost::num_vertices(graph), boost::num_edges(graph)};
+}
+
+const StreetTopology& GeoRef::search_graph() const {
+    if (std::make_pair(topology.nb_layered_vertices, topology.nb_layered_edges) != layered_graph_size()) {
+        throw navitia::exception("the street network has been modified since "
+                                 "build_street_network_indexes()");
+    }
+    return topology;
+}
+
+const EdgeIndex& GeoRef::edge_index() const {
+    if (std::make_pair(edges_index->nb_vertices, edges_index->nb_edges) != layered_graph_size()) {
+        throw navitia::exception("the street network has been modified since "
+                                 "build_street_network_indexes()");
+    }
+    return *edges_index;
+}
+
+void GeoRef::save_flat(nt::FlatWriter& writer) const {
+    search_graph().save(writer);
+    edge_index().save(writer);
+    pl.save(writer);
+    poi_proximity_list.save(writer);
+    writer.write<uint64_t>(contraction_hierarchies.size());
+    for (const auto& hierarchy: contraction_hierarchies) { hierarchy.save(writer); }
+}
+
+void GeoRef::load_flat(nt::FlatReader& reader) {
+    StreetTopology flat_topology;
+    flat_topology.map(reader);
+    auto index = std::make_unique<EdgeIndex>();
+    index->map(reader);
+    const auto size = layered_graph_size();
+    if (std::make_pair(flat_topology.nb_layered_vertices, flat_topology.nb_layered_edges) != size
+            || std::make_pair(index->nb_vertices, index->nb_edges) != size) {
+        throw nt::flat_file_error("the flat file does not match the street network");
+    }
+    proximitylist::ProximityList<vertex_t> flat_pl;
+    flat_pl.map(reader);
+    proximitylist::ProximityList<type::idx_t> flat_poi_proximity_list;
+    flat_poi_proximity_list.map(reader);
+    if (flat_pl.elements.size() != nb_vertex_by_mode || flat_poi_proximity_list.elements.size() != pois.size()) {
+        throw nt::flat_file_error("the flat file does not match the proximity lists");
+    }
+    const auto nb_hierarchies = reader.read<uint64_t>();
+    std::vector<ContractionHierarchy> flat_hierarchies;
+    for (uint64_t i = 0; i < nb_hierarchies; ++i) {
+        flat_hierarchies.emplace_back();
+        flat_hierarchies.back().map(reader);
+    }
+    topology = std::move(flat_topology);
+    edges_index = std::move(index);
+    pl = std::move(flat_pl);
+    poi_proximity_list = std::move(flat_poi_proximity_list);
+    contraction_hierarchies = std::move(flat_hierarchies);
+}
+
+void GeoRef::build_contraction_hierarchies() {
+    contraction_hierarchies.clear();
+    for (const auto mode: {nt::Mode_e::Car, nt::Mode_e::Bike}) {
+        contraction_hierarchies.emplace_back();
+        contraction_hierarchies.back().build(search_graph(), mode, allowed_layers(mode));
+    }
+}
+
+const ContractionHierarchy* GeoRef::contraction_hierarchy(nt::Mode_e mode) const {
+    for (const auto& hierarchy: contraction_hierarchies) {
+        if (hierarchy.mode != mode) { continue; }
+        if (std::make_pair(hierarchy.nb_layered_vertices, hierarchy.nb_layered_edges) != layered_graph_size()) {
+            return nullptr;
+        }
+        return &hierarchy;
+    }
+    return nullptr;
+}
+
 void GeoRef::build_proximity_list(){
     pl.clear();
 
@@ -493,7 +567,7 @@ std::vector<nf::Autocomplete<nt::idx_t>::fl_quality> GeoRef::find_ways(const std
     /// récupération des coordonnées du numéro recherché pour chaque rue
     for(auto &result_item  : to_return){
        Way * way = this->ways[result_item.idx];
-       result_item.coord = way->nearest_coord(search_number, this->graph);
+       result_item.coord = way->nearest_coord(search_number, search_graph());
        result_item.house_number = search_number;
     }
 
@@ -594,7 +668,7 @@ std::pair<GeoRef::ProjectionByMode, bool> GeoRef::project_stop_point(const type:
         nt::Mode_e mode = mode_layer.first;
         nt::idx_t offset = offsets[mode_layer.second];
 
-        ProjectionData proj(stop_point->coord, *this, offset, this->pl);
+        ProjectionData proj(stop_point->coord, *this, offset);
         projections[mode] = proj;
         if(proj.found)
             one_proj_found = true;
@@ -607,30 +681,11 @@ vertex_t GeoRef::nearest_vertex(const type::GeographicalCoord & coordinates, con
     return prox.find_nearest(coordinates);
 }
 
-edge_t GeoRef::nearest_edge(const type::GeographicalCoord & coordinates) const {
-    return this->nearest_edge(coordinates, this->pl);
-}
-
-/// Get the nearest_edge with at least one vertex in the graph corresponding to the offset (walking, bike, ...)
-edge_t GeoRef::nearest_edge(const type::GeographicalCoord & coordinates, const proximitylist::ProximityList<vertex_t>& prox, type::idx_t offset) const {
-    boost::optional<edge_t> res;
-    float min_dist = 0.;
-    for (const auto pair_coord : prox.find_within(coordinates)) {
-        //we increment the index to get the vertex in the other graph
-        const auto u = pair_coord.first + offset;
-
-        BOOST_FOREACH (edge_t e, boost::out_edges(u, graph)) {
-            const auto v = target(e, graph);
-            float cur_dist = coordinates.project(graph[u].coord, graph[v].coord).second;
-            if (!res || cur_dist < min_dist) {
-                min_dist = cur_dist;
-                res = e;
-            }
-        }
-    }
-    if (res) { return *res; }
+/// Get the nearest_edge in the graph corresponding to the offset (walking, bike, ...)
+LayeredEdge GeoRef::nearest_edge(const type::GeographicalCoord & coordinates, type::idx_t offset) const {
+    const auto projection = edge_index().nearest(search_graph(), coordinates, offset);
+    if (projection) { return projection->edge; }
     throw proximitylist::NotFound();
-
 }
 
 std::pair<int, const Way*> GeoRef::nearest_addr(const type::GeographicalCoord& coord) const {
@@ -643,14 +698,15 @@ std::pair<int, const Way*> GeoRef::nearest_addr(const type::GeographicalCoord& c
     const std::function<bool(const Way&)>& filter) const {
     // first, we collect each ways with its distance to the coord
     std::map<const Way*, double> way_dist;
+    const StreetTopology& topology = search_graph();
     for (const auto& pair_coord: pl.find_within(coord)) {
-        BOOST_FOREACH (edge_t e, boost::out_edges(pair_coord.first, graph)) {
-            const Way* w = ways[graph[e].way_idx];
-            if (filter(*w)) { continue; }
+        topology.for_each_out_edge(pair_coord.first, [&](const LayeredEdge& e) {
+            const Way* w = ways[topology.way_idx(e)];
+            if (filter(*w)) { return; }
             if (way_dist.count(w) == 0) {
-                way_dist[w] = coord.distance_to(w->projected_centroid(graph));
+                way_dist[w] = coord.distance_to(w->projected_centroid(topology));
             }
-        }
+        });
     }
     if (way_dist.empty()) { throw proximitylist::NotFound(); }
 
@@ -681,57 +737,67 @@ std::pair<int, const Way*> GeoRef::nearest_addr(const type::GeographicalCoord& c
 
 //get the minimum distance and the vertex to start from between 2 edges
 static std::tuple<float, vertex_t, vertex_t>
-get_min_distance(const GeoRef& geo_ref, const type::GeographicalCoord &coord, edge_t walking_e, edge_t biking_e) {
-    vertex_t source_a_idx = source(walking_e, geo_ref.graph);
-    Vertex source_a = geo_ref.graph[source_a_idx];
+get_min_distance(const StreetTopology& topology, const type::GeographicalCoord &coord,
+                 const LayeredEdge& walking_e, const LayeredEdge& biking_e) {
+    vertex_t source_a_idx = walking_e.source;
+    const auto& source_a = topology.coord(source_a_idx);
 
-    vertex_t target_a_idx = target(walking_e, geo_ref.graph);
-    Vertex target_a = geo_ref.graph[target_a_idx];
+    vertex_t target_a_idx = topology.target(walking_e);
+    const auto& target_a = topology.coord(target_a_idx);
 
-    vertex_t source_b_idx = source(biking_e, geo_ref.graph);
-    Vertex source_b = geo_ref.graph[source_b_idx];
+    vertex_t source_b_idx = biking_e.source;
+    const auto& source_b = topology.coord(source_b_idx);
 
-    vertex_t target_b_idx = target(biking_e, geo_ref.graph);
-    Vertex target_b = geo_ref.graph[target_b_idx];
+    vertex_t target_b_idx = topology.target(biking_e);
+    const auto& target_b = topology.coord(target_b_idx);
 
     const vertex_t min_a_idx =
-        coord.distance_to(source_a.coord) < coord.distance_to(target_a.coord) ? source_a_idx : target_a_idx;
+        coord.distance_to(source_a) < coord.distance_to(target_a) ? source_a_idx : target_a_idx;
     const vertex_t min_b_idx =
-        coord.distance_to(source_b.coord) < coord.distance_to(target_b.coord) ? source_b_idx : target_b_idx;
+        coord.distance_to(source_b) < coord.distance_to(target_b) ? source_b_idx : target_b_idx;
 
     return std::make_tuple(
-        geo_ref.graph[min_a_idx].coord.distance_to(geo_ref.graph[min_b_idx].coord),
+        topology.coord(min_a_idx).distance_to(topology.coord(min_b_idx)),
         min_a_idx,
         min_b_idx);
 }
 
+LayeredEdge GeoRef::nearest_street_edge(const type::GeographicalCoord& coord, type::Mode_e mode) const {
+    // the edges added between the layers are not looked for, thus the
+    // topology and the index built before the first station are still valid
+    // (but not search_graph() and edge_index())
+    const auto projection = edges_index->nearest(topology, coord, offsets[mode]);
+    if (projection) { return projection->edge; }
+    throw proximitylist::NotFound();
+}
+
 bool GeoRef::add_bss_edges(const type::GeographicalCoord& coord) {
     using navitia::type::Mode_e;
 
-    edge_t nearest_biking_edge, nearest_walking_edge;
+    LayeredEdge nearest_biking_edge, nearest_walking_edge;
     try {
         //we need to find the nearest edge in the walking graph and the nearest edge in the biking graph
-        nearest_biking_edge = nearest_edge(coord, Mode_e::Bike);
-        nearest_walking_edge = nearest_edge(coord, Mode_e::Walking);
+        nearest_biking_edge = nearest_street_edge(coord, Mode_e::Bike);
+        nearest_walking_edge = nearest_street_edge(coord, Mode_e::Walking);
     } catch(proximitylist::NotFound) {
         return false;
     }
 
     //we add a new edge linking those 2 edges, with the walking distance between the 2 edges + the time to take of hang the bike back
-    auto min_dist = get_min_distance(*this, coord, nearest_walking_edge, nearest_biking_edge);
+    auto min_dist = get_min_distance(topology, coord, nearest_walking_edge, nearest_biking_edge);
     vertex_t walking_v = std::get<1>(min_dist);
     vertex_t biking_v = std::get<2>(min_dist);
     time_duration dur_between_edges = seconds(std::get<0>(min_dist) / default_speed[Mode_e::Walking]);
 
     navitia::georef::Edge edge;
-    edge.way_idx = graph[nearest_walking_edge].way_idx; //arbitrarily we assume the way is the walking way
+    edge.way_idx = topology.way_idx(nearest_walking_edge); //arbitrarily we assume the way is the walking way
 
     // time needed to take the bike + time to walk between the edges
-    edge.duration = dur_between_edges + default_time_bss_pickup;
+    edge.duration = (dur_between_edges + default_time_bss_pickup).total_seconds();
     add_edge(walking_v, biking_v, edge, graph);
 
     // time needed to hang the bike back + time to walk between the edges
-    edge.duration = dur_between_edges + default_time_bss_putback;
+    edge.duration = (dur_between_edges + default_time_bss_putback).total_seconds();
     add_edge(biking_v, walking_v, edge, graph);
 
     return true;
@@ -740,18 +806,18 @@ bool GeoRef::add_bss_edges(const type::GeographicalCoord& coord) {
 bool GeoRef::add_parking_edges(const type::GeographicalCoord& coord) {
     using navitia::type::Mode_e;
 
-    edge_t nearest_car_edge, nearest_walking_edge;
+    LayeredEdge nearest_car_edge, nearest_walking_edge;
     try {
         //we need to find the nearest edge in the walking and car graph
-        nearest_car_edge = nearest_edge(coord, Mode_e::Car);
-        nearest_walking_edge = nearest_edge(coord, Mode_e::Walking);
+        nearest_car_edge = nearest_street_edge(coord, Mode_e::Car);
+        nearest_walking_edge = nearest_street_edge(coord, Mode_e::Walking);
     } catch(navitia::proximitylist::NotFound) {
         return false;
     }
 
     //we add a new edge linking those 2 edges, with the walking
     //distance between the 2 edges + the time to park (resp. leave)
-    auto min_dist = get_min_distance(*this, coord, nearest_walking_edge, nearest_car_edge);
+    auto min_dist = get_min_distance(topology, coord, nearest_walking_edge, nearest_car_edge);
     vertex_t walking_v = std::get<1>(min_dist);
     vertex_t car_v = std::get<2>(min_dist);
     time_duration dur_between_edges = seconds(std::get<0>(min_dist) / default_speed[Mode_e::Walking]);
@@ -759,19 +825,21 @@ bool GeoRef::add_parking_edges(const type::GeographicalCoord& coord) {
     Edge edge;
 
     //arbitrarily we assume the way is the walking way
-    edge.way_idx = graph[nearest_walking_edge].way_idx;
+    edge.way_idx = topology.way_idx(nearest_walking_edge);
 
     // time to walk between the edges + time needed to leave the parking
-    edge.duration = dur_between_edges + default_time_parking_leave;
+    edge.duration = (dur_between_edges + default_time_parking_leave).total_seconds();
     add_edge(walking_v, car_v, edge, graph);
 
     // time needed to park the car + time to walk between the edges
-    edge.duration = dur_between_edges + default_time_parking_park;
+    edge.duration = (dur_between_edges + default_time_parking_park).total_seconds();
     add_edge(car_v, walking_v, edge, graph);
 
     return true;
 }
 
+GeoRef::GeoRef(): edges_index(std::make_unique<EdgeIndex>()) {}
+
 GeoRef::~GeoRef() {
     for(POIType* poi_type : poitypes) {
         delete poi_type;
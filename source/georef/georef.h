@@ -32,10 +32,11 @@ www.navitia.io
 #include "autocomplete/autocomplete.h"
 #include "proximity_list/proximity_list.h"
 #include "adminref.h"
+#include "street_topology.h"
+#include "contraction_hierarchy.h"
 #include "utils/exception.h"
 #include "utils/flat_enum_map.h"
 #include <boost/graph/adjacency_list.hpp>
-#include <boost/graph/adj_list_serialize.hpp>
 #include <boost/serialization/serialization.hpp>
 #include "utils/serialization_vector.h"
 #include <boost/serialization/utility.hpp>
@@ -82,13 +83,15 @@ struct Vertex {
 
 struct Edge {
     nt::idx_t way_idx = nt::invalid_idx; //< indexe vers le nom de rue
-    navitia::time_duration duration = {}; // duration of the edge
+    uint32_t duration = 0; // duration of the edge in seconds
 
     template<class Archive> void serialize(Archive & ar, const unsigned int) {
         ar & way_idx & duration;
     }
-    Edge(nt::idx_t wid, navitia::time_duration dur) : way_idx(wid), duration(dur) {}
+    Edge(nt::idx_t wid, navitia::time_duration dur) : way_idx(wid), duration(dur.total_seconds()) {}
     Edge() {}
+
+    navitia::time_duration get_duration() const { return navitia::seconds(duration); }
 };
 
 // Plein de typedefs pour nous simpfilier un peu la vie
@@ -146,11 +149,11 @@ public:
     std::vector< std::pair<vertex_t, vertex_t> > edges;
 
     void add_house_number(const HouseNumber&);
-    nt::GeographicalCoord nearest_coord(const int, const Graph&) const;
+    nt::GeographicalCoord nearest_coord(const int, const StreetTopology&) const;
     // returns {house_number, distance}, return {-1, x} if not found
     std::pair<int, double> nearest_number(const nt::GeographicalCoord&) const;
-    nt::GeographicalCoord projected_centroid(const Graph&) const;
-    nt::MultiLineString make_multiline(const Graph&) const;
+    nt::GeographicalCoord projected_centroid(const StreetTopology&) const;
+    nt::MultiLineString make_multiline(const StreetTopology&) const;
     template<class Archive> void serialize(Archive & ar, const unsigned int) {
       ar & idx & name & comment & uri & way_type & admin_list & house_number_left & house_number_right & edges;
     }
@@ -159,18 +162,18 @@ public:
     void sort_house_numbers();
 
 #ifdef _DEBUG_DIJKSTRA_QUANTUM_
-    template <typename Stream, typename G>
-    void print(Stream& stream, const G& g){
+    template <typename Stream>
+    void print(Stream& stream, const StreetTopology& g){
         for(auto& edge: this->edges){
-            stream << std::setprecision(16) << "LINESTRING(" << g[edge.first].coord.lon() << " " << g[edge.first].coord.lat()
-                   << ", " << g[edge.second].coord.lon() << " " << g[edge.second].coord.lat() << ")" << std::endl;
+            stream << std::setprecision(16) << "LINESTRING(" << g.coord(edge.first).lon() << " " << g.coord(edge.first).lat()
+                   << ", " << g.coord(edge.second).lon() << " " << g.coord(edge.second).lat() << ")" << std::endl;
         }
     }
 #endif
 
 private:
-    nt::GeographicalCoord get_geographical_coord(const int, const Graph&) const;
-    nt::GeographicalCoord extrapol_geographical_coord(int, const Graph&) const;
+    nt::GeographicalCoord get_geographical_coord(const int, const StreetTopology&) const;
+    nt::GeographicalCoord extrapol_geographical_coord(int, const StreetTopology&) const;
 };
 
 
@@ -203,6 +206,7 @@ struct Path {
 };
 
 struct ProjectionData;
+struct EdgeIndex;
 
 struct POI;
 struct POIType;
@@ -241,7 +245,12 @@ struct GeoRef {
     typedef flat_enum_map<nt::Mode_e, ProjectionData> ProjectionByMode;
     std::vector<ProjectionByMode> projected_stop_points = {};
 
-    /// Graphe pour effectuer le calcul d'itinéraire
+    /** The layered graph the street network is built from
+     *
+     * It is only filled by ed and the tests, and is not serialized: the
+     * street topology (search_graph()) is built from it and is the
+     * representation read by the searches, the projections and the ways.
+     */
     Graph graph;
 
     /*
@@ -255,7 +264,7 @@ struct GeoRef {
     flat_enum_map<nt::Mode_e, nt::idx_t> offsets;
 
     /// number of vertex by transportation mode
-    nt::idx_t nb_vertex_by_mode;
+    nt::idx_t nb_vertex_by_mode = 0;
     navitia::autocomplete::autocomplete_map synonyms;
     std::set<std::string> ghostwords;
 
@@ -264,22 +273,81 @@ struct GeoRef {
 
     void init();
 
+    /** The street topology, the proximity lists and the contraction
+     * hierarchies are in the flat file next to the archive (ed2nav --flat)
+     * instead of the archive
+     *
+     * Only the size of the topology is serialized, Data::load maps the
+     * rest from the flat file and fails if it cannot.
+     */
+    bool flat_indexes = false;
+
     template<class Archive> void save(Archive & ar, const unsigned int) const {
-        ar & ways & way_map & graph & offsets & fl_admin & fl_way & pl & projected_stop_points
+        ar & ways & way_map & offsets & fl_admin & fl_way & projected_stop_points
                 & admins & admin_map &  pois & fl_poi & poitypes & poitype_map & poi_map & synonyms
-                & ghostwords & poi_proximity_list & nb_vertex_by_mode;
+                & ghostwords & nb_vertex_by_mode & flat_indexes;
+        const auto& topology = search_graph();
+        if (flat_indexes) {
+            ar & topology.nb_vertex_by_layer & topology.nb_layered_vertices & topology.nb_layered_edges;
+        } else {
+            ar & pl & poi_proximity_list & contraction_hierarchies & topology;
+        }
     }
 
     template<class Archive> void load(Archive & ar, const unsigned int) {
-        // La désérialisation d'une boost adjacency list ne vide pas le graphe
-        // On avait donc une fuite de mémoire
+        // the graph is not serialized, it is emptied in case the georef is reloaded
         graph.clear();
-        ar & ways & way_map & graph & offsets & fl_admin & fl_way & pl & projected_stop_points
+        ar & ways & way_map & offsets & fl_admin & fl_way & projected_stop_points
                 & admins & admin_map & pois & fl_poi & poitypes & poitype_map & poi_map & synonyms
-                & ghostwords & poi_proximity_list & nb_vertex_by_mode;
+                & ghostwords & nb_vertex_by_mode & flat_indexes;
+        if (flat_indexes) {
+            // the arrays are mapped by load_flat
+            topology = StreetTopology();
+            ar & topology.nb_vertex_by_layer & topology.nb_layered_vertices & topology.nb_layered_edges;
+            pl.clear();
+            poi_proximity_list.clear();
+            contraction_hierarchies.clear();
+        } else {
+            ar & pl & poi_proximity_list & contraction_hierarchies & topology;
+        }
+        // the edge index is mapped or built by Data::load
     }
     BOOST_SERIALIZATION_SPLIT_MEMBER()
 
+    /** Build the street topology used by the Dijkstra and the spatial index
+     * of the edges used by the projections from graph
+     *
+     * They are built once, when graph is final: at the end of ed's reading
+     * and by the tests after they have added their edges. They are never
+     * rebuilt behind the back of the readers, thus the const accessors
+     * below are safe from any thread.
+     */
+    void build_street_network_indexes();
+    /// Build only the edge index from the loaded street topology (graph is empty at load)
+    void build_edge_index();
+
+    /// throws if graph has been modified since build_street_network_indexes()
+    const StreetTopology& search_graph() const;
+    const EdgeIndex& edge_index() const;
+
+    /** Write the street topology, the edge index, the proximity lists and
+     * the contraction hierarchies in a flat file, memory mapped by
+     * load_flat instead of building or deserializing them at load
+     */
+    void save_flat(nt::FlatWriter& writer) const;
+    /// Map what save_flat has written, throws flat_file_error if the file
+    /// does not match the street network
+    void load_flat(nt::FlatReader& reader);
+
+    /// Contraction hierarchies of the car and bike street networks, built
+    /// by ed2nav only if asked (it takes a while on a big area)
+    std::vector<ContractionHierarchy> contraction_hierarchies;
+    void build_contraction_hierarchies();
+
+    /// the contraction hierarchy of the mode, nullptr if there is none or
+    /// if the street network has been modified since it has been built
+    const ContractionHierarchy* contraction_hierarchy(nt::Mode_e mode) const;
+
     /** Construit l'indexe spatial */
     void build_proximity_list();
 
@@ -313,18 +381,17 @@ struct GeoRef {
     */
     std::pair<ProjectionByMode, bool> project_stop_point(const type::StopPoint* stop_point) const;
 
-    /** Retourne l'arc (segment) le plus proche
+    vertex_t nearest_vertex(const type::GeographicalCoord & coordinates, const proximitylist::ProximityList<vertex_t> &prox) const;
+
+    /** Retourne l'arc (segment) le plus proche dans le graphe de l'offset
       *
-      * Pour le trouver, on cherche le nœud le plus proche, puis pour chaque arc adjacent, on garde le plus proche
-      * Ce n'est donc pas optimal, mais pour améliorer ça, il faudrait indexer des segments, ou ratisser plus large
+      * Il est cherché dans un rayon de 500m avec l'index spatial des arcs,
+      * proximitylist::NotFound est levée s'il n'y en a pas
      */
+    LayeredEdge nearest_edge(const type::GeographicalCoord &coordinates, type::idx_t offset = 0) const;
 
-    vertex_t nearest_vertex(const type::GeographicalCoord & coordinates, const proximitylist::ProximityList<vertex_t> &prox) const;
-    edge_t nearest_edge(const type::GeographicalCoord &coordinates) const;
-    edge_t nearest_edge(const type::GeographicalCoord &coordinates, const proximitylist::ProximityList<vertex_t>& prox, type::idx_t offset = 0) const;
-
-    edge_t nearest_edge(const type::GeographicalCoord & coordinates, type::Mode_e mode) const {
-        return nearest_edge(coordinates, pl, offsets[mode]);
+    LayeredEdge nearest_edge(const type::GeographicalCoord & coordinates, type::Mode_e mode) const {
+        return nearest_edge(coordinates, offsets[mode]);
     }
     std::pair<int, const Way*> nearest_addr(const type::GeographicalCoord&) const;
     std::pair<int, const Way*> nearest_addr(const type::GeographicalCoord& coord,
@@ -340,9 +407,19 @@ struct GeoRef {
 
     ///get the transportation mode of the vertex
     type::Mode_e get_mode(vertex_t vertex) const;
-    PathItem::TransportCaracteristic get_caracteristic(edge_t edge) const;
+    PathItem::TransportCaracteristic get_caracteristic(const LayeredEdge& edge) const;
     ~GeoRef();
-    GeoRef() = default;
+    GeoRef();
+
+private:
+    // built by build_street_network_indexes() or loaded, empty until then
+    StreetTopology topology;
+    std::unique_ptr<EdgeIndex> edges_index;
+    /// {vertices, edges} of the layered graph: the ones of graph when it is
+    /// built (ed and the tests), else the ones the topology has been built from
+    std::pair<size_t, size_t> layered_graph_size() const;
+    /// nearest_edge for add_bss_edges and add_parking_edges
+    LayeredEdge nearest_street_edge(const type::GeographicalCoord& coord, type::Mode_e mode) const;
     GeoRef(const GeoRef& other) = default;
 };
 
@@ -380,16 +457,14 @@ struct ProjectionData {
     flat_enum_map<Direction, double> distances {{{-1, -1}}};
 
     ProjectionData() {}
-    /// Project the coordinate on the graph
-    ProjectionData(const type::GeographicalCoord & coord, const GeoRef &sn, const proximitylist::ProximityList<vertex_t> &prox);
     /// Project the coordinate on the graph corresponding to the transportation mode of the offset
-    ProjectionData(const type::GeographicalCoord & coord, const GeoRef &sn, type::idx_t offset, const proximitylist::ProximityList<vertex_t> &prox);
+    ProjectionData(const type::GeographicalCoord & coord, const GeoRef &sn, type::idx_t offset = 0);
 
     template<class Archive> void serialize(Archive & ar, const unsigned int) {
         ar & vertices & projected & distances & found & real_coord;
     }
 
-    void init(const type::GeographicalCoord & coord, const GeoRef & sn, edge_t nearest_edge);
+    void init(const type::GeographicalCoord & coord, const GeoRef & sn, const LayeredEdge& nearest_edge);
 
     /// syntaxic sugar
     vertex_t operator[] (Direction d) const { return vertices[d]; }
@@ -0,0 +1,115 @@
+/* Copyright © 2001-2016, Canal TP and/or its affiliates. All rights reserved.
+
+This file is part of Navitia,
+    the software to build cool stuff with public transport.
+
+Hope you'll enjoy and contribute to this project,
+    powered by Canal TP (www.canaltp.fr).
+Help us simplify mobility and open public transport:
+    a non ending quest to the responsive locomotion way of traveling!
+
+LICENCE: This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Affero General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+Stay tuned using
+twitter @navitia
+IRC #navitia on freenode
+https://groups.google.com/d/forum/navitia
+www.navitia.io
+*/
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace navitia { namespace georef {
+
+/** Monotone priority queue on 32 bits unsigned keys
+ *
+ * The elements are stored in 33 buckets: the bucket i contains the keys
+ * whose highest bit differing from the last popped key is the bit i - 1
+ * (bucket 0 contains the keys equal to the last popped key). A pop only
+ * redistributes the smallest non empty bucket, thus each element moves at
+ * most 32 times, whatever the number of distinct keys.
+ *
+ * It is valid for the dijkstra since the keys pushed are never lower than
+ * the last popped key. A lower key is handled as if it was equal to the
+ * last popped key.
+ *
+ * There is no decrease key: the element is pushed again, and the caller
+ * has to skip the outdated elements when they are popped.
+ */
+template<typename T>
+class RadixHeap {
+public:
+    typedef std::pair<uint32_t, T> value_type;
+
+    bool empty() const { return size == 0; }
+
+    void clear() {
+        for (auto& bucket: buckets) { bucket.clear(); }
+        last = 0;
+        size = 0;
+    }
+
+    void push(const uint32_t key, const T& value) {
+        buckets[bucket_idx(key)].emplace_back(key, value);
+        ++size;
+    }
+
+    /// the lowest key, the queue must not be empty
+    uint32_t top_key() {
+        pull();
+        return last;
+    }
+
+    /// the element with the lowest key, the queue must not be empty
+    value_type pop() {
+        pull();
+        const value_type res = buckets[0].back();
+        buckets[0].pop_back();
+        --size;
+        return res;
+    }
+
+private:
+    std::array<std::vector<value_type>, 33> buckets;
+    uint32_t last = 0;
+    size_t size = 0;
+
+    // moves the elements with the lowest key to the bucket 0
+    void pull() {
+        if (! buckets[0].empty()) { return; }
+        size_t i = 1;
+        while (buckets[i].empty()) { ++i; }
+        auto& bucket = buckets[i];
+        last = bucket.front().first;
+        for (const auto& elt: bucket) {
+            if (elt.first < last) { last = elt.first; }
+        }
+        for (const auto& elt: bucket) {
+            buckets[bucket_idx(elt.first)].push_back(elt);
+        }
+        bucket.clear();
+    }
+
+    size_t bucket_idx(const uint32_t key) const {
+        if (key <= last) { return 0; }
+        return 32 - __builtin_clz(key ^ last);
+    }
+};
+
+}} // namespace navitia::georef
@@ -32,7 +32,11 @@ www.navitia.io
 #include "type/data.h"
 #include "georef.h"
 #include <boost/math/constants/constants.hpp>
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <future>
+#include <unordered_map>
 #ifdef _DEBUG_DIJKSTRA_QUANTUM_
 #include <boost/foreach.hpp>
 #endif
@@ -82,10 +86,11 @@ bool StreetNetwork::arrival_launched() const {return arrival_path_finder.computa
 routing::map_stop_point_duration
 StreetNetwork::find_nearest_stop_points(navitia::time_duration radius,
                                         const proximitylist::ProximityList<type::idx_t>& pl,
-                                        bool use_second) {
+                                        bool use_second,
+                                        FallbackCache* cache) {
     // delegate to the arrival or departure pathfinder
     // results are store to build the routing path after the transportation routing computation
-    return (use_second ? arrival_path_finder : departure_path_finder).find_nearest_stop_points(radius, pl);
+    return (use_second ? arrival_path_finder : departure_path_finder).find_nearest_stop_points(radius, pl, cache);
 }
 
 navitia::time_duration StreetNetwork::get_distance(type::idx_t target_idx, bool use_second) {
@@ -154,21 +159,56 @@ StreetNetwork::get_direct_path(const type::EntryPoint& origin, const type::Entry
     }
     const auto dest_edge = ProjectionData(destination.coordinates,
                                           geo_ref,
-                                          geo_ref.offsets[dest_mode],
-                                          geo_ref.pl);
+                                          geo_ref.offsets[dest_mode]);
     if (! dest_edge.found) { return Path(); }
     const auto max_dur = origin.streetnetwork_params.max_duration
         + destination.streetnetwork_params.max_duration;
     direct_path_finder.init(origin.coordinates,
                             origin.streetnetwork_params.mode,
                             origin.streetnetwork_params.speed_factor);
-    direct_path_finder.start_distance_dijkstra(max_dur);
-    const auto dest_vertex = direct_path_finder.find_nearest_vertex(dest_edge, true);
+    const auto dest_vertex = direct_path_finder.bidirectional_dijkstra(dest_edge, max_dur);
     const auto res = direct_path_finder.get_path(dest_edge, dest_vertex);
     if (res.duration > max_dur) { return Path(); }
     return res;
 }
 
+std::vector<std::vector<navitia::time_duration>>
+compute_duration_matrix(routing::ThreadPool& pool,
+                        const std::vector<PathFinder*>& path_finders,
+                        const std::vector<type::GeographicalCoord>& origins,
+                        const std::vector<ProjectionData>& destinations,
+                        const nt::Mode_e mode,
+                        const float speed_factor,
+                        const navitia::time_duration max_duration) {
+    std::vector<std::vector<navitia::time_duration>> matrix(origins.size());
+    // each path finder takes the next origin to do, the searches having
+    // very different sizes
+    std::atomic<size_t> next_origin(0);
+    const auto compute = [&](PathFinder& path_finder) {
+        for (size_t i = next_origin++; i < origins.size(); i = next_origin++) {
+            path_finder.init(origins[i], mode, speed_factor);
+            matrix[i] = path_finder.get_durations(destinations, max_duration);
+        }
+    };
+    const size_t nb_searches = std::min({path_finders.size(), pool.size() + 1, origins.size()});
+    std::vector<std::future<void>> tasks;
+    for (size_t i = 1; i < nb_searches; ++i) {
+        PathFinder* path_finder = path_finders[i];
+        tasks.push_back(pool.submit([&compute, path_finder]() { compute(*path_finder); }));
+    }
+    std::exception_ptr error;
+    try {
+        compute(*path_finders.front());
+    } catch (...) {
+        error = std::current_exception();
+    }
+    // the tasks use this stack frame, they must end before leaving it
+    for (auto& task: tasks) { task.wait(); }
+    if (error) { std::rethrow_exception(error); }
+    for (auto& task: tasks) { task.get(); }
+    return matrix;
+}
+
 PathFinder::PathFinder(const GeoRef& gref) : geo_ref(gref) {}
 
 void PathFinder::init(const type::GeographicalCoord& start_coord, nt::Mode_e mode, const float speed_factor) {
@@ -179,32 +219,52 @@ void PathFinder::init(const type::GeographicalCoord& start_coord, nt::Mode_e mod
     this->speed_factor = speed_factor; //the speed factor is the factor we have to multiply the edge cost with
     nt::idx_t offset = this->geo_ref.offsets[mode];
     this->start_coord = start_coord;
-    starting_edge = ProjectionData(start_coord, this->geo_ref, offset, this->geo_ref.pl);
+    starting_edge = ProjectionData(start_coord, this->geo_ref, offset);
+    hierarchy = geo_ref.contraction_hierarchy(mode);
 
     distance_to_entry_point.clear();
+    cached_radius = boost::none;
+    reset_search();
+}
+
+void PathFinder::reset_search() {
     //we initialize the distances to the maximum value
-    size_t n = boost::num_vertices(geo_ref.graph);
-    distances.assign(n, bt::pos_infin);
+    const size_t n = geo_ref.search_graph().nb_vertices();
+    if (distances.size() != n) {
+        distances.assign(n, bt::pos_infin);
+        colors = boost::two_bit_color_map<>(n);
+        colored_vertices.clear();
+    } else {
+        // only the vertices reached by the previous search have to be reset
+        LOG4CPLUS_DEBUG(log4cplus::Logger::getInstance("Logger"),
+                        "street network: " << touched_vertices.size() << " vertices visited and reset out of " << n);
+        for (const auto v: touched_vertices) {
+            distances[v] = bt::pos_infin;
+        }
+    }
+    touched_vertices.clear();
     //for the predecessors no need to clean the values, the important one will be updated during search
     predecessors.resize(n);
 
     if (starting_edge.found) {
         //durations initializations
-        distances[starting_edge[source_e]] = crow_fly_duration(starting_edge.distances[source_e]); //for the projection, we use the default walking speed.
-        distances[starting_edge[target_e]] = crow_fly_duration(starting_edge.distances[target_e]);
+        set_distance(starting_edge[source_e], crow_fly_duration(starting_edge.distances[source_e])); //for the projection, we use the default walking speed.
+        set_distance(starting_edge[target_e], crow_fly_duration(starting_edge.distances[target_e]));
         predecessors[starting_edge[source_e]] = starting_edge[source_e];
         predecessors[starting_edge[target_e]] = starting_edge[target_e];
 
         //small enchancement, if the projection is done on a node, we disable the crow fly
         if (starting_edge.distances[source_e] < 0.01) {
             predecessors[starting_edge[target_e]] = starting_edge[source_e];
-            auto e = boost::edge(starting_edge[source_e], starting_edge[target_e], geo_ref.graph).first;
-            distances[starting_edge[target_e]] = geo_ref.graph[e].duration;
+            const auto& topology = geo_ref.search_graph();
+            auto e = topology.edge(starting_edge[source_e], starting_edge[target_e]).first;
+            set_distance(starting_edge[target_e], navitia::seconds(topology.duration(e)));
         } else if (starting_edge.distances[target_e] < 0.01) {
             predecessors[starting_edge[source_e]] = starting_edge[target_e];
-            auto edge_pair = boost::edge(starting_edge[target_e], starting_edge[source_e], geo_ref.graph);
+            const auto& topology = geo_ref.search_graph();
+            auto edge_pair = topology.edge(starting_edge[target_e], starting_edge[source_e]);
             if (edge_pair.second) {
-                distances[starting_edge[source_e]] = geo_ref.graph[edge_pair.first].duration;
+                set_distance(starting_edge[source_e], navitia::seconds(topology.duration(edge_pair.first)));
             } else {
                 // since we reverse the edge (from target to source) the edge might not exists
                 // (for one way street for example). we thus forbid to start from the source
@@ -218,23 +278,344 @@ void PathFinder::start_distance_dijkstra(navitia::time_duration radius) {
     if (! starting_edge.found)
         return ;
     computation_launch = true;
-    // We start dijkstra from source and target nodes
-    try {
 #ifndef _DEBUG_DIJKSTRA_QUANTUM_
-        dijkstra(starting_edge[source_e], distance_visitor(radius, distances));
+    // We start dijkstra from source and target nodes, and stop when we
+    // can't find any vertex such that distances[v] <= radius
+    street_dijkstra([&](vertex_t v) { return distances[v] > radius; });
 #else
-        dijkstra(starting_edge[source_e], printer_distance_visitor(radius, distances, "source"));
-#endif
+    try {
+        dijkstra(starting_edge[source_e], printer_distance_visitor(radius, distances, "source", geo_ref.search_graph()));
     } catch(DestinationFound){}
 
     try {
-#ifndef _DEBUG_DIJKSTRA_QUANTUM_
-        dijkstra(starting_edge[target_e], distance_visitor(radius, distances));
-#else
-        dijkstra(starting_edge[target_e], printer_distance_visitor(radius, distances, "target"));
-#endif
+        dijkstra(starting_edge[target_e], printer_distance_visitor(radius, distances, "target", geo_ref.search_graph()));
     } catch(DestinationFound){}
+#endif
+}
+
+std::pair<navitia::time_duration, ProjectionData::Direction>
+PathFinder::bidirectional_dijkstra(const ProjectionData& destination, navitia::time_duration radius) {
+    constexpr auto max = bt::pos_infin;
+    if (! starting_edge.found || ! destination.found)
+        return {max, source_e};
+    computation_launch = true;
+    // the destination is reached like in find_nearest_vertex(destination, true)
+    std::vector<std::pair<vertex_t, navitia::time_duration>> destination_vertices;
+    if (destination.distances[source_e] < 0.01) {
+        destination_vertices.push_back({destination[source_e], navitia::seconds(0)});
+    } else if (destination.distances[target_e] < 0.01) {
+        destination_vertices.push_back({destination[target_e], navitia::seconds(0)});
+    } else {
+        destination_vertices.push_back({destination[source_e], crow_fly_duration(destination.distances[source_e])});
+        destination_vertices.push_back({destination[target_e], crow_fly_duration(destination.distances[target_e])});
+    }
+
+    if (hierarchy) {
+        const auto reached = hierarchy_path(destination_vertices, radius);
+        if (! reached)
+            return {max, source_e};
+        const auto seed = std::find_if(destination_vertices.begin(), destination_vertices.end(),
+                                       [&](const std::pair<vertex_t, navitia::time_duration>& d) {
+            return d.first == *reached;
+        });
+        return {distances[*reached] + seed->second, *reached == destination[source_e] ? source_e : target_e};
+    }
+
+    const LayeredStreetGraph graph(geo_ref.search_graph(), allowed_layers(mode));
+    const SpeedDistanceCombiner combine(speed_factor);
+
+    if (backward_distances.size() != distances.size()) {
+        backward_distances.assign(distances.size(), max);
+        successors.resize(distances.size());
+    } else {
+        for (const auto v: backward_touched_vertices) {
+            backward_distances[v] = max;
+        }
+    }
+    backward_touched_vertices.clear();
+    auto set_backward_distance = [&](vertex_t v, navitia::time_duration dur) {
+        if (backward_distances[v] == max) { backward_touched_vertices.push_back(v); }
+        backward_distances[v] = dur;
+    };
+
+    // best path found when the frontiers meet
+    navitia::time_duration best = max;
+    vertex_t meeting = starting_edge[source_e];
+    auto meet = [&](vertex_t v) {
+        if (distances[v] == max || backward_distances[v] == max) { return; }
+        if (distances[v] + backward_distances[v] < best) {
+            best = distances[v] + backward_distances[v];
+            meeting = v;
+        }
+    };
+
+    // both searches use lazy deletion: an element is outdated if its key is
+    // not the distance of its vertex anymore
+    queue.clear();
+    backward_queue.clear();
+    for (const auto v: {starting_edge[source_e], starting_edge[target_e]}) {
+        if (distances[v] != max) { queue.push(distances[v].ticks(), v); }
+    }
+    for (const auto& dest: destination_vertices) {
+        if (dest.second < backward_distances[dest.first]) {
+            set_backward_distance(dest.first, dest.second);
+            successors[dest.first] = dest.first;
+            backward_queue.push(dest.second.ticks(), dest.first);
+            meet(dest.first);
+        }
+    }
+
+    // the shortest path not found yet is longer than the sum of the smallest
+    // keys, we stop when it can't be better than the best one or than the radius
+    while (! queue.empty() && ! backward_queue.empty()) {
+        const auto forward_key = queue.top_key();
+        const auto backward_key = backward_queue.top_key();
+        const int64_t frontier = int64_t(forward_key) + backward_key;
+        if (frontier > radius.ticks() || (best != max && frontier >= best.ticks())) { break; }
+
+        if (forward_key <= backward_key) {
+            const auto elt = queue.pop();
+            const vertex_t u = elt.second;
+            if (elt.first != distances[u].ticks()) { continue; }
+            const auto range = out_edges(u, graph);
+            for (auto it = range.first; it != range.second; ++it) {
+                const vertex_t v = target(*it, graph);
+                const auto dist = combine(distances[u], graph.duration(*it));
+                if (dist < distances[v]) {
+                    set_distance(v, dist);
+                    predecessors[v] = u;
+                    queue.push(dist.ticks(), v);
+                    meet(v);
+                }
+            }
+        } else {
+            const auto elt = backward_queue.pop();
+            const vertex_t u = elt.second;
+            if (elt.first != backward_distances[u].ticks()) { continue; }
+            graph.for_each_in_edge(u, [&](vertex_t v, uint32_t duration) {
+                const auto dist = combine(backward_distances[u], duration);
+                if (dist < backward_distances[v]) {
+                    set_backward_distance(v, dist);
+                    successors[v] = u;
+                    backward_queue.push(dist.ticks(), v);
+                    meet(v);
+                }
+            });
+        }
+    }
+    if (best == max)
+        return {max, source_e};
+
+    // the backward part of the path is relaxed in the forward search data,
+    // thus get_path can build the path from the predecessors
+    vertex_t v = meeting;
+    while (successors[v] != v) {
+        const vertex_t next = successors[v];
+        const auto dist = distances[v] + (backward_distances[v] - backward_distances[next]);
+        if (dist < distances[next]) {
+            set_distance(next, dist);
+            predecessors[next] = v;
+        }
+        v = next;
+    }
+    return {distances[v] + backward_distances[v], v == destination[source_e] ? source_e : target_e};
+}
+
+void HierarchySearch::clear(size_t nb_vertices) {
+    if (distances.size() != nb_vertices) {
+        distances.assign(nb_vertices, bt::pos_infin);
+        parents.resize(nb_vertices);
+    } else {
+        for (const auto v: touched_vertices) {
+            distances[v] = bt::pos_infin;
+        }
+    }
+    touched_vertices.clear();
+    queue.clear();
+}
+
+// the largest key of the radix heaps that is within the radius
+static int64_t max_key(const navitia::time_duration radius) {
+    if (radius == bt::pos_infin) { return std::numeric_limits<int64_t>::max(); }
+    return radius.ticks();
+}
+
+navitia::time_duration
+PathFinder::hierarchy_arc_duration(vertex_t from, vertex_t to, bool up, uint32_t arc_idx) {
+    const auto& arc = (up ? hierarchy->up_arcs : hierarchy->down_arcs)[arc_idx];
+    if (arc.middle == ContractionHierarchy::no_middle) {
+        return navitia::seconds(arc.duration) / speed_factor;
+    }
+    const uint64_t key = uint64_t(arc_idx) << 1 | up;
+    const auto it = shortcut_durations.find(key);
+    if (it != shortcut_durations.end()) { return it->second; }
+    const auto halves = hierarchy->halves(from, to, arc);
+    const auto duration =
+        hierarchy_arc_duration(from, arc.middle, false, &halves.first - hierarchy->down_arcs.data())
+        + hierarchy_arc_duration(arc.middle, to, true, &halves.second - hierarchy->up_arcs.data());
+    shortcut_durations[key] = duration;
+    return duration;
+}
+
+// settles the next vertex of an upward search on the hierarchy, returns
+// false if the element popped was outdated
+template<typename ArcDuration>
+static bool settle_next(const ContractionHierarchy& hierarchy,
+                        HierarchySearch& search,
+                        const bool forward,
+                        const ArcDuration& arc_duration,
+                        vertex_t& settled) {
+    const auto elt = search.queue.pop();
+    const vertex_t u = elt.second;
+    if (elt.first != search.distances[u].ticks()) { return false; }
+    const auto& begin = forward ? hierarchy.up_begin : hierarchy.down_begin;
+    const auto& arcs = forward ? hierarchy.up_arcs : hierarchy.down_arcs;
+    for (uint32_t i = begin[u]; i < begin[u + 1]; ++i) {
+        const auto dist = search.distances[u] + (forward ? arc_duration(u, arcs[i].other, true, i)
+                                                         : arc_duration(arcs[i].other, u, false, i));
+        if (dist < search.distances[arcs[i].other]) {
+            search.set(arcs[i].other, dist, u, i);
+        }
+    }
+    settled = u;
+    return true;
+}
 
+void PathFinder::hierarchy_distances(const std::vector<vertex_t>& targets, navitia::time_duration radius) {
+    computation_launch = true;
+    shortcut_durations.clear();
+    const auto arc_duration = [&](vertex_t from, vertex_t to, bool up, uint32_t arc_idx) {
+        return hierarchy_arc_duration(from, to, up, arc_idx);
+    };
+    auto& forward = forward_hierarchy_search;
+    auto& backward = backward_hierarchy_search;
+
+    // the upward searches from the targets are stored in buckets: for each
+    // vertex reached, the targets and the durations to reach them
+    struct BucketEntry {
+        vertex_t vertex;
+        size_t target;
+        navitia::time_duration duration;
+        bool operator<(const BucketEntry& other) const { return vertex < other.vertex; }
+    };
+    std::vector<BucketEntry> buckets;
+    for (size_t i = 0; i < targets.size(); ++i) {
+        backward.clear(distances.size());
+        backward.set(targets[i], navitia::seconds(0), targets[i], HierarchySearch::no_arc);
+        while (! backward.queue.empty() && backward.queue.top_key() <= max_key(radius)) {
+            vertex_t u;
+            if (settle_next(*hierarchy, backward, false, arc_duration, u)) {
+                buckets.push_back({u, i, backward.distances[u]});
+            }
+        }
+    }
+    std::sort(buckets.begin(), buckets.end());
+
+    // the upward search from the start meets them
+    std::vector<navitia::time_duration> durations(targets.size(), bt::pos_infin);
+    forward.clear(distances.size());
+    for (const auto v: {starting_edge[source_e], starting_edge[target_e]}) {
+        if (distances[v] < forward.distances[v]) { forward.set(v, distances[v], v, HierarchySearch::no_arc); }
+    }
+    while (! forward.queue.empty() && forward.queue.top_key() <= max_key(radius)) {
+        vertex_t u;
+        if (! settle_next(*hierarchy, forward, true, arc_duration, u)) { continue; }
+        const auto range = std::equal_range(buckets.begin(), buckets.end(),
+                                            BucketEntry{u, 0, navitia::seconds(0)});
+        for (auto it = range.first; it != range.second; ++it) {
+            durations[it->target] = std::min(durations[it->target], forward.distances[u] + it->duration);
+        }
+    }
+    for (size_t i = 0; i < targets.size(); ++i) {
+        if (durations[i] < distances[targets[i]]) { set_distance(targets[i], durations[i]); }
+    }
+}
+
+boost::optional<vertex_t>
+PathFinder::hierarchy_path(const std::vector<std::pair<vertex_t, navitia::time_duration>>& destinations,
+                           navitia::time_duration radius) {
+    computation_launch = true;
+    shortcut_durations.clear();
+    const auto arc_duration = [&](vertex_t from, vertex_t to, bool up, uint32_t arc_idx) {
+        return hierarchy_arc_duration(from, to, up, arc_idx);
+    };
+    auto& forward = forward_hierarchy_search;
+    auto& backward = backward_hierarchy_search;
+    forward.clear(distances.size());
+    backward.clear(distances.size());
+    for (const auto v: {starting_edge[source_e], starting_edge[target_e]}) {
+        if (distances[v] < forward.distances[v]) { forward.set(v, distances[v], v, HierarchySearch::no_arc); }
+    }
+    for (const auto& dest: destinations) {
+        if (dest.second < backward.distances[dest.first]) {
+            backward.set(dest.first, dest.second, dest.first, HierarchySearch::no_arc);
+        }
+    }
+
+    // both upward searches are run until their smallest key can't improve
+    // the best meeting, the top of the shortest path being settled by both
+    navitia::time_duration best = bt::pos_infin;
+    vertex_t meeting = 0;
+    auto finished = [&](HierarchySearch& search) {
+        return search.queue.empty() || search.queue.top_key() > max_key(radius)
+            || (best != bt::pos_infin && search.queue.top_key() >= best.ticks());
+    };
+    while (true) {
+        const bool forward_finished = finished(forward);
+        const bool backward_finished = finished(backward);
+        if (forward_finished && backward_finished) { break; }
+        const bool is_forward = backward_finished
+            || (! forward_finished && forward.queue.top_key() <= backward.queue.top_key());
+        auto& search = is_forward ? forward : backward;
+        const auto& other = is_forward ? backward : forward;
+        vertex_t u;
+        if (! settle_next(*hierarchy, search, is_forward, arc_duration, u)) { continue; }
+        if (other.distances[u] != bt::pos_infin && search.distances[u] + other.distances[u] < best) {
+            best = search.distances[u] + other.distances[u];
+            meeting = u;
+        }
+    }
+    if (best == bt::pos_infin) { return boost::none; }
+
+    // the edges of the path: the up arcs to the meeting then the down arcs
+    std::vector<vertex_t> up_vertices;
+    vertex_t v = meeting;
+    for (; forward.parents[v].first != v; v = forward.parents[v].first) {
+        up_vertices.push_back(v);
+    }
+    const vertex_t start = v;
+    std::vector<std::pair<uint32_t, uint32_t>> edges;
+    for (auto it = up_vertices.rbegin(); it != up_vertices.rend(); ++it) {
+        const auto& parent = forward.parents[*it];
+        hierarchy->unpack(parent.first, *it, hierarchy->up_arcs[parent.second], edges);
+    }
+    for (v = meeting; backward.parents[v].first != v; v = backward.parents[v].first) {
+        const auto& parent = backward.parents[v];
+        hierarchy->unpack(v, parent.first, hierarchy->down_arcs[parent.second], edges);
+    }
+
+    // null duration edges can make a loop, it is removed, and the speed
+    // factor is applied by edge like in the search
+    const SpeedDistanceCombiner combine(speed_factor);
+    std::vector<std::pair<vertex_t, uint32_t>> path = {{start, 0}};
+    std::unordered_map<vertex_t, size_t> positions = {{start, 0}};
+    for (const auto& edge: edges) {
+        const auto it = positions.find(edge.first);
+        if (it == positions.end()) {
+            positions[edge.first] = path.size();
+            path.push_back(edge);
+            continue;
+        }
+        for (size_t i = it->second + 1; i < path.size(); ++i) {
+            positions.erase(path[i].first);
+        }
+        path.resize(it->second + 1);
+    }
+    for (size_t i = 1; i < path.size(); ++i) {
+        set_distance(path[i].first, combine(distances[path[i - 1].first], path[i].second));
+        predecessors[path[i].first] = path[i - 1].first;
+    }
+    return path.back().first;
 }
 
 std::vector<std::pair<type::idx_t, type::GeographicalCoord>>
@@ -248,7 +629,22 @@ PathFinder::crow_fly_find_nearest_stop_points(navitia::time_duration radius,
 
 routing::map_stop_point_duration
 PathFinder::find_nearest_stop_points(navitia::time_duration radius,
-                                     const proximitylist::ProximityList<type::idx_t>& pl) {
+                                     const proximitylist::ProximityList<type::idx_t>& pl,
+                                     FallbackCache* cache) {
+    // without projection, the result depends on the starting point and on
+    // distance_to_entry_point, thus it is not cached
+    if (cache && starting_edge.found) {
+        const FallbackCache::Key key(starting_edge, mode, speed_factor, radius);
+        if (const auto cached = cache->get(key)) {
+            computation_launch = true;
+            cached_radius = radius;
+            return *cached;
+        }
+        auto result = find_nearest_stop_points(radius, pl);
+        cache->add(key, result);
+        return result;
+    }
+
     auto elements = crow_fly_find_nearest_stop_points(radius, pl);
     routing::map_stop_point_duration result;
     if (! starting_edge.found){
@@ -278,48 +674,99 @@ PathFinder::find_nearest_stop_points(navitia::time_duration radius,
         return result;
     }
 
-    start_distance_dijkstra(radius);
+    if (hierarchy) {
+        std::vector<vertex_t> targets;
+        for (const auto& element: elements) {
+            const auto& projection = this->geo_ref.projected_stop_points[element.first][mode];
+            if (! projection.found) { continue; }
+            targets.push_back(projection[source_e]);
+            targets.push_back(projection[target_e]);
+        }
+        hierarchy_distances(targets, radius);
+    } else {
+        start_distance_dijkstra(radius);
 #ifdef _DEBUG_DIJKSTRA_QUANTUM_
-    dump_dijkstra_for_quantum(starting_edge);
+        dump_dijkstra_for_quantum(starting_edge);
 #endif
+    }
 
-    const auto max = bt::pos_infin;
     for (auto element: elements) {
         ProjectionData projection = this->geo_ref.projected_stop_points[element.first][mode];
         // the stop point has been projected on the graph?
         if(projection.found){
-            //if our two points are projected on the same edge the Dijkstra won't give us the correct value
-            // we need to handle this case separately
-            if(is_projected_on_same_edge(starting_edge, projection)){
-                //We calculate the duration for going to the edge, then to the projected destination on the edge
-                //and finally to the destination
-                auto duration = path_duration_on_same_edge(starting_edge, projection);
-                if(duration <= radius){
-                    result[routing::SpIdx(element.first)] = duration;
-                }
-            }else{
-                navitia::time_duration best_dist = max;
-                if (distances[projection[source_e]] < max) {
-                    best_dist = distances[projection[source_e]] + crow_fly_duration(projection.distances[source_e]);
-                }
-                if (distances[projection[target_e]] < max) {
-                    best_dist = std::min(best_dist, distances[projection[target_e]] + crow_fly_duration(projection.distances[target_e]));
-                }
-                if (best_dist <= radius) {
-                    result[routing::SpIdx(element.first)] = best_dist;
-                }
+            const auto duration = duration_to_projection(projection);
+            if (duration <= radius) {
+                result[routing::SpIdx(element.first)] = duration;
             }
         }
     }
     return result;
 }
 
+navitia::time_duration PathFinder::duration_to_projection(const ProjectionData& projection) {
+    constexpr auto max = bt::pos_infin;
+    //if our two points are projected on the same edge the Dijkstra won't give us the correct value
+    // we need to handle this case separately
+    if(is_projected_on_same_edge(starting_edge, projection)){
+        //We calculate the duration for going to the edge, then to the projected destination on the edge
+        //and finally to the destination
+        return path_duration_on_same_edge(starting_edge, projection);
+    }
+    navitia::time_duration best_dist = max;
+    if (distances[projection[source_e]] < max) {
+        best_dist = distances[projection[source_e]] + crow_fly_duration(projection.distances[source_e]);
+    }
+    if (distances[projection[target_e]] < max) {
+        best_dist = std::min(best_dist, distances[projection[target_e]] + crow_fly_duration(projection.distances[target_e]));
+    }
+    return best_dist;
+}
+
+std::vector<navitia::time_duration>
+PathFinder::get_durations(const std::vector<ProjectionData>& targets, navitia::time_duration radius) {
+    std::vector<navitia::time_duration> result(targets.size(), bt::pos_infin);
+    if (! starting_edge.found) { return result; }
+
+    std::vector<vertex_t> target_vertices;
+    for (const auto& target: targets) {
+        if (! target.found) { continue; }
+        target_vertices.push_back(target[source_e]);
+        target_vertices.push_back(target[target_e]);
+    }
+    std::sort(target_vertices.begin(), target_vertices.end());
+    target_vertices.erase(std::unique(target_vertices.begin(), target_vertices.end()), target_vertices.end());
+
+    if (hierarchy) {
+        hierarchy_distances(target_vertices, radius);
+    } else {
+        computation_launch = true;
+        // we stop at the radius, or when all the targets have been reached
+        size_t nb_found = 0;
+        street_dijkstra([&](vertex_t v) {
+            if (distances[v] > radius) { return true; }
+            if (std::binary_search(target_vertices.begin(), target_vertices.end(), v)) { ++nb_found; }
+            return nb_found == target_vertices.size();
+        });
+    }
+
+    for (size_t i = 0; i < targets.size(); ++i) {
+        if (! targets[i].found) { continue; }
+        const auto duration = duration_to_projection(targets[i]);
+        if (duration <= radius) { result[i] = duration; }
+    }
+    return result;
+}
+
 navitia::time_duration PathFinder::get_distance(type::idx_t target_idx) {
     constexpr auto max = bt::pos_infin;
 
     if (! starting_edge.found)
         return max;
-    assert(boost::edge(starting_edge[source_e], starting_edge[target_e], geo_ref.graph).second);
+    assert(geo_ref.search_graph().edge(starting_edge[source_e], starting_edge[target_e]).second);
+    if (cached_radius) {
+        // the search of a previous get_path can have stopped anywhere
+        reset_search();
+    }
 
     ProjectionData target = this->geo_ref.projected_stop_points[target_idx][mode];
 
@@ -359,8 +806,22 @@ Path PathFinder::get_path(type::idx_t idx) {
         return {};
     ProjectionData projection = this->geo_ref.projected_stop_points[idx][mode];
 
+    if (cached_radius) {
+        // the durations have been given by the fallback cache, thus the path
+        // to each stop point is searched on demand
+        if (is_projected_on_same_edge(starting_edge, projection)) {
+            return get_path(projection, {path_duration_on_same_edge(starting_edge, projection), source_e});
+        }
+        reset_search();
+        return get_path(projection, bidirectional_dijkstra(projection, *cached_radius));
+    }
+
     auto nearest_edge = find_nearest_vertex(projection);
 
+    if (hierarchy && nearest_edge.first != bt::pos_infin && ! is_projected_on_same_edge(starting_edge, projection)) {
+        // only the distances have been computed on the hierarchy
+        hierarchy_path({{projection[nearest_edge.second], navitia::seconds(0)}}, bt::pos_infin);
+    }
     return get_path(projection, nearest_edge);
 }
 
@@ -370,8 +831,8 @@ void PathFinder::add_custom_projections_to_path(Path& p, bool append_to_begin, c
         return (append_to_begin ? p.path_items.push_front(item) : p.path_items.push_back(item));
     };
 
-    edge_t start_e = boost::edge(projection[source_e], projection[target_e], geo_ref.graph).first;
-    Edge start_edge = geo_ref.graph[start_e];
+    const auto& topology = geo_ref.search_graph();
+    const nt::idx_t start_way_idx = topology.way_idx(topology.edge(projection[source_e], projection[target_e]).first);
 
     auto duration = crow_fly_duration(projection.distances[d]);
 
@@ -380,15 +841,15 @@ void PathFinder::add_custom_projections_to_path(Path& p, bool append_to_begin, c
 
     //we aither add the starting coordinate to the first path item or create a new path item if it was another way
     nt::idx_t first_way_idx = (p.path_items.empty() ? type::invalid_idx : item_to_update(p).way_idx);
-    if (start_edge.way_idx != first_way_idx || first_way_idx == type::invalid_idx) {
+    if (start_way_idx != first_way_idx || first_way_idx == type::invalid_idx) {
         //there can be an item with no way, so we will update this item
         if (! p.path_items.empty() && item_to_update(p).way_idx == type::invalid_idx) {
-            item_to_update(p).way_idx = start_edge.way_idx;
+            item_to_update(p).way_idx = start_way_idx;
             item_to_update(p).duration += duration;
         }
         else {
             PathItem item;
-            item.way_idx = start_edge.way_idx;
+            item.way_idx = start_way_idx;
             item.duration = duration;
 
             if (!p.path_items.empty()) {
@@ -453,12 +914,12 @@ Path PathFinder::get_path(const ProjectionData& target, std::pair<navitia::time_
         item.coordinates.push_back(starting_edge.projected);
         item.coordinates.push_back(target.projected);
 
-        auto edge_pair = boost::edge(starting_edge[source_e], starting_edge[target_e], geo_ref.graph);
+        const auto& topology = geo_ref.search_graph();
+        auto edge_pair = topology.edge(starting_edge[source_e], starting_edge[target_e]);
         if (! edge_pair.second) {
             throw navitia::exception("impossible to find an edge");
         }
-        Edge edge = geo_ref.graph[edge_pair.first];
-        item.way_idx = edge.way_idx;
+        item.way_idx = topology.way_idx(edge_pair.first);
         item.transportation = geo_ref.get_caracteristic(edge_pair.first);
         result.path_items.push_back(item);
         result.duration += item.duration;
@@ -482,9 +943,10 @@ void PathFinder::add_projections_to_path(Path& p, bool append_to_begin) const {
     const auto& coord_to_consider = append_to_begin ? path_item_to_consider.coordinates.front(): path_item_to_consider.coordinates.back();
 
     ProjectionData::Direction direction;
-    if (coord_to_consider == geo_ref.graph[starting_edge[source_e]].coord) {
+    const auto& topology = geo_ref.search_graph();
+    if (coord_to_consider == topology.coord(starting_edge[source_e])) {
         direction = source_e;
-    } else if (coord_to_consider == geo_ref.graph[starting_edge[target_e]].coord) {
+    } else if (coord_to_consider == topology.coord(starting_edge[target_e])) {
         direction = target_e;
     } else {
         throw navitia::exception("by construction, should never happen");
@@ -497,15 +959,24 @@ std::pair<navitia::time_duration, ProjectionData::Direction> PathFinder::update_
     constexpr auto max = bt::pos_infin;
     if (! target.found)
         return {max, source_e};
-    assert(boost::edge(target[source_e], target[target_e], geo_ref.graph).second );
+    assert(geo_ref.search_graph().edge(target[source_e], target[target_e]).second);
 
     computation_launch = true;
 
     if (distances[target[source_e]] == max || distances[target[target_e]] == max) {
         bool found = false;
-        try {
-            dijkstra(starting_edge[source_e], target_all_visitor({target[source_e], target[target_e]}));
-        } catch(DestinationFound) { found = true; }
+        if (hierarchy) {
+            hierarchy_distances({target[source_e], target[target_e]}, max);
+            found = distances[target[source_e]] != max && distances[target[target_e]] != max;
+        } else {
+            // we stop when the two vertices of the target edge have been reached
+            const size_t nb_targets = target[source_e] == target[target_e] ? 1 : 2;
+            size_t nb_found = 0;
+            found = street_dijkstra([&](vertex_t v) {
+                if (v == target[source_e] || v == target[target_e]) { ++nb_found; }
+                return nb_found == nb_targets;
+            });
+        }
 
         //if no way has been found, we can stop the search
         if ( ! found ) {
@@ -519,12 +990,8 @@ std::pair<navitia::time_duration, ProjectionData::Direction> PathFinder::update_
 
             return {max, source_e};
         }
-        try {
-            dijkstra(starting_edge[target_e], target_all_visitor({target[source_e], target[target_e]}));
-        } catch(DestinationFound) { found = true; }
-
     }
-    //if we succeded in the first search, we must have found one of the other distances
+    //if we succeded in the search, we must have found both distances
     assert(distances[target[source_e]] != max && distances[target[target_e]] != max);
 
     return find_nearest_vertex(target);
@@ -552,36 +1019,38 @@ Path create_path(const GeoRef& geo_ref,
     nt::idx_t last_way = type::invalid_idx;
     boost::optional<PathItem::TransportCaracteristic> last_transport_carac{};
     PathItem path_item;
-    path_item.coordinates.push_back(geo_ref.graph[reverse_path.back()].coord);
+    const StreetTopology& topology = geo_ref.search_graph();
+    path_item.coordinates.push_back(topology.coord(reverse_path.back()));
 
     for (size_t i = reverse_path.size(); i > 1; --i) {
         bool path_item_changed = false;
         vertex_t v = reverse_path[i-2];
         vertex_t u = reverse_path[i-1];
 
-        auto edge_pair = boost::edge(u, v, geo_ref.graph);
+        auto edge_pair = topology.edge(u, v);
         //patch temporaire, A VIRER en refactorant toute la notion de direct_path!
         if (! edge_pair.second) {
             throw navitia::exception("impossible to find an edge");
         }
-        edge_t e = edge_pair.first;
+        const LayeredEdge& e = edge_pair.first;
 
-        Edge edge = geo_ref.graph[e];
+        const nt::idx_t way_idx = topology.way_idx(e);
+        const navitia::time_duration duration = navitia::seconds(topology.duration(e));
         PathItem::TransportCaracteristic transport_carac = geo_ref.get_caracteristic(e);
-        if ((edge.way_idx != last_way && last_way != type::invalid_idx) || (last_transport_carac && transport_carac != *last_transport_carac)) {
+        if ((way_idx != last_way && last_way != type::invalid_idx) || (last_transport_carac && transport_carac != *last_transport_carac)) {
             p.path_items.push_back(path_item);
             path_item = PathItem();
             path_item_changed = true;
         }
 
-        nt::GeographicalCoord coord = geo_ref.graph[v].coord;
+        nt::GeographicalCoord coord = topology.coord(v);
         path_item.coordinates.push_back(coord);
-        last_way = edge.way_idx;
+        last_way = way_idx;
         last_transport_carac = transport_carac;
-        path_item.way_idx = edge.way_idx;
+        path_item.way_idx = way_idx;
         path_item.transportation = transport_carac;
-        path_item.duration += edge.duration / speed_factor;
-        p.duration += edge.duration / speed_factor;
+        path_item.duration += duration / speed_factor;
+        p.duration += duration / speed_factor;
         if (path_item_changed) {
             //we update the last path item
             path_item.angle = compute_directions(p, coord);
@@ -672,6 +1141,7 @@ int compute_directions(const navitia::georef::Path& path, const nt::Geographical
  * Visitor to dump the visited edges and vertexes
  */
 struct printer_all_visitor : public target_all_visitor {
+    const StreetTopology& topology;
     std::ofstream file_vertex, file_edge;
     size_t cpt_v = 0, cpt_e = 0;
 
@@ -682,8 +1152,8 @@ struct printer_all_visitor : public target_all_visitor {
         file_edge << "idx; lat from; lon from; lat to; long to" << std::endl;
     }
 
-    printer_all_visitor(std::vector<vertex_t> destinations) :
-        target_all_visitor(destinations) {
+    printer_all_visitor(std::vector<vertex_t> destinations, const StreetTopology& topology) :
+        target_all_visitor(destinations), topology(topology) {
         init_files();
     }
 
@@ -692,22 +1162,24 @@ struct printer_all_visitor : public target_all_visitor {
         file_edge.close();
     }
 
-    printer_all_visitor(const printer_all_visitor& o) : target_all_visitor(o) {
+    printer_all_visitor(const printer_all_visitor& o) : target_all_visitor(o), topology(o.topology) {
         init_files();
     }
 
     template <typename graph_type>
     void finish_vertex(vertex_t u, const graph_type& g) {
-        file_vertex << cpt_v++ << ";" << g[u].coord << ";" << u << std::endl;
+        file_vertex << cpt_v++ << ";" << topology.coord(u) << ";" << u << std::endl;
         target_all_visitor::finish_vertex(u, g);
     }
 
     template <typename graph_type>
-    void examine_edge(edge_t e, graph_type& g) {
-        file_edge << cpt_e++ << ";" << g[boost::source(e, g)].coord << ";" << g[boost::target(e, g)].coord
-                  << "; LINESTRING(" << g[boost::source(e, g)].coord.lon() << " " << g[boost::source(e, g)].coord.lat()
-                  << ", " << g[boost::target(e, g)].coord.lon() << " " << g[boost::target(e, g)].coord.lat() << ")"
-                     << ";" << e
+    void examine_edge(typename boost::graph_traits<graph_type>::edge_descriptor e, graph_type& g) {
+        const auto& source = topology.coord(boost::source(e, g));
+        const auto& target = topology.coord(boost::target(e, g));
+        file_edge << cpt_e++ << ";" << source << ";" << target
+                  << "; LINESTRING(" << source.lon() << " " << source.lat()
+                  << ", " << target.lon() << " " << target.lat() << ")"
+                     << ";" << e.source << "-" << e.idx
                   << std::endl;
         target_all_visitor::examine_edge(e, g);
     }
@@ -727,23 +1199,24 @@ void PathFinder::dump_dijkstra_for_quantum(const ProjectionData& target) {
     LOG4CPLUS_DEBUG(log4cplus::Logger::getInstance("log"), "genrating debug trace for streetnetwork");
     start.open("start.csv");
     destination.open("destination.csv");
+    const auto& topology = geo_ref.search_graph();
     start << "x;y;mode transport" << std::endl
-          << geo_ref.graph[starting_edge[source_e]].coord << ";" << (int)(mode) << std::endl
-          << geo_ref.graph[starting_edge[target_e]].coord << ";" << (int)(mode) << std::endl;
+          << topology.coord(starting_edge[source_e]) << ";" << (int)(mode) << std::endl
+          << topology.coord(starting_edge[target_e]) << ";" << (int)(mode) << std::endl;
     destination << "x;y;" << std::endl
-          << geo_ref.graph[target[source_e]].coord << std::endl
-          << geo_ref.graph[target[target_e]].coord << std::endl;
+          << topology.coord(target[source_e]) << std::endl
+          << topology.coord(target[target_e]) << std::endl;
 
     out_edge.open("out_edges.csv");
     out_edge << "target;x;y;" << std::endl;
-    BOOST_FOREACH(edge_t e, boost::out_edges(target[source_e], geo_ref.graph)) {
-        out_edge << "source;" << geo_ref.graph[boost::target(e, geo_ref.graph)].coord << std::endl;
-    }
-    BOOST_FOREACH(edge_t e, boost::out_edges(target[target_e], geo_ref.graph)) {
-        out_edge << "target;" << geo_ref.graph[boost::target(e, geo_ref.graph)].coord << std::endl;
-    }
+    topology.for_each_out_edge(target[source_e], [&](const LayeredEdge& e) {
+        out_edge << "source;" << topology.coord(topology.target(e)) << std::endl;
+    });
+    topology.for_each_out_edge(target[target_e], [&](const LayeredEdge& e) {
+        out_edge << "target;" << topology.coord(topology.target(e)) << std::endl;
+    });
     try {
-        dijkstra(starting_edge[source_e], printer_all_visitor({target[source_e], target[target_e]}));
+        dijkstra(starting_edge[source_e], printer_all_visitor({target[source_e], target[target_e]}, topology));
     } catch(DestinationFound) { }
 }
 #endif
@@ -30,26 +30,31 @@ www.navitia.io
 
 #pragma once
 #include "georef.h"
+#include "fallback_cache.h"
+#include "radix_heap.h"
 #include "routing/raptor_utils.h"
+#include "routing/thread_pool.h"
 #include "type/time_duration.h"
 #include <boost/graph/filtered_graph.hpp>
 #include <boost/graph/two_bit_color_map.hpp>
 #include <boost/graph/dijkstra_shortest_paths.hpp>
 #include <boost/format.hpp>
+#include <unordered_map>
 
 namespace bt = boost::posix_time;
 
 namespace navitia { namespace georef {
 
-struct SpeedDistanceCombiner : public std::binary_function<navitia::time_duration, navitia::time_duration, navitia::time_duration> {
+struct SpeedDistanceCombiner : public std::binary_function<navitia::time_duration, uint32_t, navitia::time_duration> {
     /// speed factor compared to the default speed of the transportation mode
     /// speed_factor = 2 means the speed is twice the default speed of the given transportation mode
     float speed_factor;
     SpeedDistanceCombiner(float speed_) : speed_factor(speed_) {}
-    inline navitia::time_duration operator()(navitia::time_duration a, navitia::time_duration b) const {
-        if (a == bt::pos_infin || b == bt::pos_infin)
+    // b is the duration of the edge in seconds
+    inline navitia::time_duration operator()(navitia::time_duration a, uint32_t b) const {
+        if (a == bt::pos_infin)
             return bt::pos_infin;
-        return a + b / speed_factor;
+        return a + navitia::seconds(b) / speed_factor;
     }
 };
 template <typename T>
@@ -76,23 +81,71 @@ const auto allowed_transportation_mode = create_from_allowedlist({{{
                                                                 {type::Mode_e::Walking, type::Mode_e::Bike} //for vls, walking and bike is allowed
                                                           }}});
 
-struct TransportationModeFilter {
-    flat_enum_map<type::Mode_e, bool> acceptable_modes; //map associating a boolean to a mode,
-    type::idx_t nb_vertex_by_mode;
-    TransportationModeFilter() = default;
-    TransportationModeFilter(type::Mode_e mode, const georef::GeoRef& geo_ref) :
-        acceptable_modes(allowed_transportation_mode[mode]),
-        nb_vertex_by_mode(geo_ref.nb_vertex_by_mode) //the second elt in the offset array is the number of edge by mode
-    {
-        BOOST_ASSERT_MSG(nb_vertex_by_mode != 0, "there should be vertexes in the graph");
+/// mask of the layers of the street topology that can be used by a transportation mode
+inline uint8_t allowed_layers(type::Mode_e mode) {
+    uint8_t mask = 0;
+    for (const auto& allowed: allowed_transportation_mode[mode]) {
+        if (allowed.second) { mask |= StreetTopology::layer_mask(allowed.first); }
     }
+    return mask;
+}
+
+/** Distance map of the dijkstra that records the vertices reached for the
+ * first time, so that they can be reset without scanning the whole graph
+ */
+struct TouchedDistanceMap {
+    typedef vertex_t key_type;
+    typedef navitia::time_duration value_type;
+    typedef const navitia::time_duration& reference;
+    typedef boost::read_write_property_map_tag category;
+
+    std::vector<navitia::time_duration>* distances;
+    std::vector<vertex_t>* touched;
+};
+inline const navitia::time_duration& get(const TouchedDistanceMap& map, const vertex_t v) {
+    return (*map.distances)[v];
+}
+inline void put(const TouchedDistanceMap& map, const vertex_t v, const navitia::time_duration& dur) {
+    auto& distance = (*map.distances)[v];
+    if (distance == bt::pos_infin) { map.touched->push_back(v); }
+    distance = dur;
+}
 
-    template <typename vertex_t>
-    bool operator()(const vertex_t& e) const {
-        int graph_number = e / nb_vertex_by_mode;
+/// Color map of the dijkstra that records the colored vertices, for the same reason
+struct TouchedColorMap {
+    typedef vertex_t key_type;
+    typedef boost::two_bit_color_type value_type;
+    typedef boost::two_bit_color_type reference;
+    typedef boost::read_write_property_map_tag category;
 
-//        std::cout << "for node " << e << " in graph " << graph_number << " we can " << (acceptable_modes[graph_number] ? " " : "not ") << "go" << std::endl;
-        return acceptable_modes[graph_number];
+    boost::two_bit_color_map<>* colors;
+    std::vector<vertex_t>* colored;
+};
+inline boost::two_bit_color_type get(const TouchedColorMap& map, const vertex_t v) {
+    return get(*map.colors, v);
+}
+inline void put(const TouchedColorMap& map, const vertex_t v, const boost::two_bit_color_type color) {
+    if (get(*map.colors, v) == boost::two_bit_white) { map.colored->push_back(v); }
+    put(*map.colors, v, color);
+}
+
+/// State of a search on a contraction hierarchy, kept to reuse its buffers
+struct HierarchySearch {
+    static const uint32_t no_arc = std::numeric_limits<uint32_t>::max();
+
+    std::vector<navitia::time_duration> distances;
+    // previous vertex and arc (up arc for a forward search, down arc for a
+    // backward one), the starting vertices being their own parent
+    std::vector<std::pair<vertex_t, uint32_t>> parents;
+    std::vector<vertex_t> touched_vertices;
+    RadixHeap<vertex_t> queue;
+
+    void clear(size_t nb_vertices);
+    void set(vertex_t v, navitia::time_duration dur, vertex_t parent, uint32_t arc) {
+        if (distances[v] == bt::pos_infin) { touched_vertices.push_back(v); }
+        distances[v] = dur;
+        parents[v] = {parent, arc};
+        queue.push(dur.ticks(), v);
     }
 };
 
@@ -112,12 +165,44 @@ struct PathFinder {
     /// Distance map between entry point and stop point
     std::map<routing::SpIdx, navitia::time_duration> distance_to_entry_point;
 
+    /// Set when the stop points have been given by the fallback cache: no
+    /// search has been run, thus the paths are searched by get_path
+    boost::optional<navitia::time_duration> cached_radius;
+
     /// Distance array for the Dijkstra
     std::vector<navitia::time_duration> distances;
 
     /// Predecessors array for the Dijkstra
     std::vector<vertex_t> predecessors;
 
+    /// The vertices whose distance has been set since the last init: only
+    /// them are reset by the next init, instead of the whole graph
+    std::vector<vertex_t> touched_vertices;
+
+    /// Color map of the Dijkstra, the colored vertices are reset before each Dijkstra
+    boost::two_bit_color_map<> colors{0};
+    std::vector<vertex_t> colored_vertices;
+
+    /// Priority queue of street_dijkstra, kept to reuse its buckets
+    RadixHeap<vertex_t> queue;
+
+    /// State of the backward search of bidirectional_dijkstra: the
+    /// distances to the destination and the next vertex on the way to it.
+    /// Sized by the first bidirectional_dijkstra
+    std::vector<navitia::time_duration> backward_distances;
+    std::vector<vertex_t> successors;
+    std::vector<vertex_t> backward_touched_vertices;
+    RadixHeap<vertex_t> backward_queue;
+
+    /// Contraction hierarchy of the mode, used instead of the dijkstra by
+    /// the fallbacks and the direct paths if it has been built
+    const ContractionHierarchy* hierarchy = nullptr;
+    HierarchySearch forward_hierarchy_search;
+    HierarchySearch backward_hierarchy_search;
+    // durations of the shortcuts of the current search with the speed factor,
+    // by (arc index << 1 | is an up arc)
+    std::unordered_map<uint64_t, navitia::time_duration> shortcut_durations;
+
     PathFinder(const GeoRef& geo_ref);
 
     /**
@@ -128,10 +213,37 @@ struct PathFinder {
 
     void start_distance_dijkstra(navitia::time_duration radius);
 
-    /// compute the reachable stop points within the radius
+    /**
+     * Point to point search between the starting point and destination, used by
+     * the direct paths instead of the search within the radius.
+     *
+     * A backward search is run from the destination at the same time than the
+     * forward one, and it stops as soon as no path shorter than the best
+     * one found when the frontiers meet can exist. Only the distances and
+     * the predecessors on the way to the destination are set, thus the result
+     * has to be given to get_path instead of calling find_nearest_vertex.
+     *
+     * It has to be called right after init. Returns the distance to the
+     * destination and its nearest vertex like find_nearest_vertex(destination, true),
+     * the distance being infinite if no path has been found, the paths
+     * longer than the radius being not searched.
+     **/
+    std::pair<navitia::time_duration, ProjectionData::Direction>
+    bidirectional_dijkstra(const ProjectionData& destination, navitia::time_duration radius);
+
+    /// compute the reachable stop points within the radius, reading and
+    /// feeding the cache if given
     routing::map_stop_point_duration
     find_nearest_stop_points(navitia::time_duration radius,
-                             const proximitylist::ProximityList<type::idx_t>& pl);
+                             const proximitylist::ProximityList<type::idx_t>& pl,
+                             FallbackCache* cache = nullptr);
+
+    /** compute the durations from the starting point to the targets, the
+     *  search stopping once all of them have been reached.
+     *  The duration of a target that can't be reached within the radius is infinite
+     */
+    std::vector<navitia::time_duration>
+    get_durations(const std::vector<ProjectionData>& targets, navitia::time_duration radius);
 
     /// compute the distance from the starting point to the target stop point
     navitia::time_duration get_distance(type::idx_t target_idx);
@@ -143,25 +255,45 @@ struct PathFinder {
     void add_projections_to_path(Path& p, bool append_to_begin) const;
 
     /**
-     * Launch a dijkstra without initializing the data structure
+     * Launch a dijkstra from the two vertices of the starting edge, with the
+     * distances set by init, without initializing the data structure.
+     *
+     * is_finished(v) is called when v is settled, before the relaxation of
+     * its out edges, and the search stops when it returns true. Returns
+     * false if all the reachable vertices have been settled before.
+     *
+     * The durations are integer seconds and the queue is a radix heap
+     * keyed on the distances.
+     * Warning, it modifies the distances and the predecessors
+     **/
+    template<typename IsFinished>
+    bool street_dijkstra(const IsFinished& is_finished);
+
+    /**
+     * Launch a boost dijkstra without initializing the data structure
+     * Only used for the debug dumps and the benchmarks, street_dijkstra is faster
      * Warning, it modifies the distances and the predecessors
      **/
     template<class Visitor>
     void dijkstra(vertex_t start, Visitor visitor) {
         // Note: the predecessors have been updated in init
-        boost::two_bit_color_map<> color(boost::num_vertices(geo_ref.graph));
+        const LayeredStreetGraph graph(geo_ref.search_graph(), allowed_layers(mode));
+        for (const auto v: colored_vertices) {
+            put(colors, v, boost::two_bit_white);
+        }
+        colored_vertices.clear();
 
-        //we filter the graph to only use certain mean of transport
-        using filtered_graph = boost::filtered_graph<georef::Graph, boost::keep_all, TransportationModeFilter>;
-        boost::dijkstra_shortest_paths_no_init(filtered_graph(geo_ref.graph, {}, TransportationModeFilter(mode, geo_ref)),
-                                               start, &predecessors[0], &distances[0],
-                                               boost::get(&Edge::duration, geo_ref.graph), // weigth map
+        //the graph only contains the layers of the allowed transportation modes
+        boost::dijkstra_shortest_paths_no_init(graph,
+                                               start, &predecessors[0],
+                                               TouchedDistanceMap{&distances, &touched_vertices},
+                                               graph.durations(), // weigth map
                                                boost::identity_property_map(),
                                                std::less<navitia::time_duration>(),
                                                SpeedDistanceCombiner(speed_factor), //we multiply the edge duration by a speed factor
                                                navitia::seconds(0),
                                                visitor,
-                                               color
+                                               TouchedColorMap{&colors, &colored_vertices}
                                                );
     }
 
@@ -181,6 +313,39 @@ struct PathFinder {
     navitia::time_duration path_duration_on_same_edge(const ProjectionData& p1, const ProjectionData& p2);
 
 private:
+    /// reset the distances of the previous search and set the ones of the
+    /// starting edge, the starting point being kept
+    void reset_search();
+
+    /// set the distance of a vertex outside of the Dijkstra
+    void set_distance(vertex_t v, navitia::time_duration dur) {
+        put(TouchedDistanceMap{&distances, &touched_vertices}, v, dur);
+    }
+
+    /** Duration of an arc of the hierarchy from `from` to `to`
+     *
+     * The speed factor is applied on each edge of the graph a shortcut
+     * stands for, like the dijkstra does with SpeedDistanceCombiner, thus
+     * both give the same durations (the rounding is done by edge).
+     */
+    navitia::time_duration hierarchy_arc_duration(vertex_t from, vertex_t to, bool up, uint32_t arc_idx);
+
+    /// set the distances of the targets with the contraction hierarchy (only
+    /// the distances, the paths are unpacked by hierarchy_path)
+    void hierarchy_distances(const std::vector<vertex_t>& targets, navitia::time_duration radius);
+
+    /** Point to point search on the contraction hierarchy, from the
+     *  starting edge to the destination vertices (with their initial durations).
+     *  The path is unpacked in the distances and the predecessors.
+     *  Returns the vertex of the destination reached, if any
+     */
+    boost::optional<vertex_t>
+    hierarchy_path(const std::vector<std::pair<vertex_t, navitia::time_duration>>& destinations,
+                   navitia::time_duration radius);
+
+    /// duration to the projection from the distances computed by the last search
+    navitia::time_duration duration_to_projection(const ProjectionData& projection);
+
     ///return the time the travel the distance at the current speed (used for projections)
     navitia::time_duration crow_fly_duration(const double val) const;
 
@@ -200,6 +365,55 @@ private:
 };
 
 /** Structure managing the computation on the streetnetwork */
+template<typename IsFinished>
+bool PathFinder::street_dijkstra(const IsFinished& is_finished) {
+    const LayeredStreetGraph graph(geo_ref.search_graph(), allowed_layers(mode));
+    const TouchedDistanceMap distance_map{&distances, &touched_vertices};
+    const TouchedColorMap color_map{&colors, &colored_vertices};
+    const SpeedDistanceCombiner combine(speed_factor);
+    for (const auto v: colored_vertices) {
+        put(colors, v, boost::two_bit_white);
+    }
+    colored_vertices.clear();
+    queue.clear();
+
+    for (const auto start: {starting_edge[ProjectionData::Direction::Source],
+                            starting_edge[ProjectionData::Direction::Target]}) {
+        if (distances[start] == bt::pos_infin || get(color_map, start) != boost::two_bit_white) {
+            continue;
+        }
+        put(color_map, start, boost::two_bit_gray);
+        queue.push(distances[start].ticks(), start);
+    }
+
+    while (! queue.empty()) {
+        const vertex_t u = queue.pop().second;
+        // a vertex is pushed again when its distance decreases, the first pop is the good one
+        if (get(color_map, u) == boost::two_bit_black) { continue; }
+        put(color_map, u, boost::two_bit_black);
+        if (is_finished(u)) { return true; }
+
+        const auto range = out_edges(u, graph);
+        for (auto it = range.first; it != range.second; ++it) {
+            const vertex_t v = target(*it, graph);
+            const auto color = get(color_map, v);
+            if (color == boost::two_bit_black) { continue; }
+            const auto dist = combine(distances[u], graph.duration(*it));
+            if (dist < distances[v]) {
+                put(distance_map, v, dist);
+                predecessors[v] = u;
+            } else if (color == boost::two_bit_gray) {
+                continue;
+            }
+            // like boost, a white vertex is queued even if its distance (set by a
+            // previous search) is not improved
+            if (color == boost::two_bit_white) { put(color_map, v, boost::two_bit_gray); }
+            queue.push(distances[v].ticks(), v);
+        }
+    }
+    return false;
+}
+
 struct StreetNetwork {
     StreetNetwork(const GeoRef& geo_ref);
 
@@ -210,7 +424,8 @@ struct StreetNetwork {
 
     routing::map_stop_point_duration
     find_nearest_stop_points(navitia::time_duration radius,
-                             const proximitylist::ProximityList<type::idx_t>& pl, bool use_second);
+                             const proximitylist::ProximityList<type::idx_t>& pl, bool use_second,
+                             FallbackCache* cache = nullptr);
 
     navitia::time_duration get_distance(type::idx_t target_idx, bool use_second = false);
 
@@ -228,6 +443,21 @@ struct StreetNetwork {
     PathFinder direct_path_finder;
 };
 
+/** Durations from each origin to each destination (infinite if more than
+ *  max_duration), a search being done by origin.
+ *  The searches are spread over the path finders: the first one runs on
+ *  the calling thread, the others on the pool (at most one by thread of
+ *  the pool)
+ */
+std::vector<std::vector<navitia::time_duration>>
+compute_duration_matrix(routing::ThreadPool& pool,
+                        const std::vector<PathFinder*>& path_finders,
+                        const std::vector<type::GeographicalCoord>& origins,
+                        const std::vector<ProjectionData>& destinations,
+                        const nt::Mode_e mode,
+                        const float speed_factor,
+                        const navitia::time_duration max_duration);
+
 /// Build a path from a reverse path list
 Path create_path(const GeoRef& georef,
                  const std::vector<vertex_t>& reverse_path,
@@ -273,6 +503,7 @@ struct distance_visitor : public boost::dijkstra_visitor<> {
 #ifdef _DEBUG_DIJKSTRA_QUANTUM_
 
 struct printer_distance_visitor : public distance_visitor {
+    const StreetTopology& topology;
     std::ofstream file_vertex, file_edge;
     size_t cpt_v = 0, cpt_e = 0;
     std::string name;
@@ -284,8 +515,9 @@ struct printer_distance_visitor : public distance_visitor {
         file_edge << std::setprecision(16) << "idx; lat from; lon from; lat to; long to; wkt; duration; edge" << std::endl;
     }
 
-    printer_distance_visitor(time_duration max_dur, const std::vector<time_duration>& dur, const std::string& name) :
-        distance_visitor(max_dur, dur), name(name) {
+    printer_distance_visitor(time_duration max_dur, const std::vector<time_duration>& dur, const std::string& name,
+                             const StreetTopology& topology) :
+        distance_visitor(max_dur, dur), topology(topology), name(name) {
         init_files();
     }
 
@@ -294,23 +526,25 @@ struct printer_distance_visitor : public distance_visitor {
         file_edge.close();
     }
 
-    printer_distance_visitor(const printer_distance_visitor& o) : distance_visitor(o), name(o.name) {
+    printer_distance_visitor(const printer_distance_visitor& o) : distance_visitor(o), topology(o.topology), name(o.name) {
         init_files();
     }
 
     template <typename graph_type>
     void finish_vertex(vertex_t u, const graph_type& g) {
-        file_vertex << cpt_v++ << ";" << g[u].coord << ";" << u << std::endl;
+        file_vertex << cpt_v++ << ";" << topology.coord(u) << ";" << u << std::endl;
         distance_visitor::finish_vertex(u, g);
     }
 
     template <typename graph_type>
-    void examine_edge(edge_t e, graph_type& g) {
+    void examine_edge(typename boost::graph_traits<graph_type>::edge_descriptor e, graph_type& g) {
         distance_visitor::examine_edge(e, g);
-        file_edge << cpt_e++ << ";" << g[boost::source(e, g)].coord << ";" << g[boost::target(e, g)].coord
-                  << "; LINESTRING(" << g[boost::source(e, g)].coord.lon() << " " << g[boost::source(e, g)].coord.lat()
-                  << ", " << g[boost::target(e, g)].coord.lon() << " " << g[boost::target(e, g)].coord.lat() << ")"
-                  << ";" << this->durations[boost::source(e, g)].total_seconds() << ";" << e
+        const auto& source = topology.coord(boost::source(e, g));
+        const auto& target = topology.coord(boost::target(e, g));
+        file_edge << cpt_e++ << ";" << source << ";" << target
+                  << "; LINESTRING(" << source.lon() << " " << source.lat()
+                  << ", " << target.lon() << " " << target.lat() << ")"
+                  << ";" << this->durations[boost::source(e, g)].total_seconds() << ";" << e.source << "-" << e.idx
                   << std::endl;
     }
 };
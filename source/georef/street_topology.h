@@ -0,0 +1,438 @@
+/* Copyright © 2001-2016, Canal TP and/or its affiliates. All rights reserved.
+
+This file is part of Navitia,
+    the software to build cool stuff with public transport.
+
+Hope you'll enjoy and contribute to this project,
+    powered by Canal TP (www.canaltp.fr).
+Help us simplify mobility and open public transport:
+    a non ending quest to the responsive locomotion way of traveling!
+
+LICENCE: This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Affero General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+Stay tuned using
+twitter @navitia
+IRC #navitia on freenode
+https://groups.google.com/d/forum/navitia
+www.navitia.io
+*/
+
+#pragma once
+
+#include "type/geographical_coord.h"
+#include "type/type_interfaces.h"
+#include "type/flat_array.h"
+#include "type/flat_file.h"
+#include "utils/serialization_vector.h"
+#include <boost/graph/graph_traits.hpp>
+#include <boost/iterator/iterator_facade.hpp>
+#include <boost/property_map/property_map.hpp>
+#include <boost/serialization/split_member.hpp>
+#include <array>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace nt = navitia::type;
+
+namespace navitia { namespace georef {
+
+/** An edge of the layered graph: its source (a vertex of a layer, as
+ * layer * nb_vertex_by_layer + vertex) and its index in StreetTopology::edges
+ */
+struct LayeredEdge {
+    uint32_t source;
+    uint32_t idx;
+    bool operator==(const LayeredEdge& other) const {
+        return source == other.source && idx == other.idx;
+    }
+    bool operator!=(const LayeredEdge& other) const { return ! (*this == other); }
+};
+
+// target of an edge of a boost graph, found by ADL (the member
+// StreetTopology::target hides it)
+template<typename Graph, typename E>
+auto graph_target(const E& e, const Graph& graph) -> decltype(target(e, graph)) {
+    return target(e, graph);
+}
+
+/** The street network, shared by the transportation modes
+ *
+ * It is the serialized and loaded representation of the street network:
+ * the dijkstra, the projections, the ways and the paths read it.
+ * GeoRef::graph is only used to build it (by ed and the tests) and is not
+ * serialized.
+ *
+ * The street network has one layer by mode (walking, bike and car, cf
+ * GeoRef::init()). The vertices and their coordinates are stored once,
+ * each edge having the mask of the layers where it exists and a duration
+ * by layer. The transitions between the layers (bss stations and car
+ * parkings) are edges changing the layer of the target.
+ *
+ * The vertices seen by the dijkstra and the projections are the ones of
+ * the layers (layer * nb_vertex_by_layer + vertex), thus the distances,
+ * the predecessors and the projections don't depend on the storage.
+ */
+struct StreetTopology {
+    // walking, bike and car, the bss uses the walking and bike layers
+    static const uint8_t nb_layers = 3;
+    static const uint8_t same_layer = std::numeric_limits<uint8_t>::max();
+
+    struct Edge {
+        uint32_t target; // vertex in the layer of the target
+        std::array<uint32_t, nb_layers> durations; // in seconds, by layer of the source
+        nt::idx_t way_idx = nt::invalid_idx; // the same in every layer
+        uint8_t layers = 0; // mask of the layers of the source where the edge exists
+        uint8_t target_layer = same_layer; // layer of the target, for the transitions
+        // explicit padding: the edges are written as they are in the flat file
+        uint16_t unused = 0;
+
+        template<class Archive> void serialize(Archive& ar, const unsigned int) {
+            ar & target & durations[0] & durations[1] & durations[2] & way_idx & layers & target_layer;
+        }
+    };
+    static_assert(sizeof(Edge) == 24, "StreetTopology::Edge must not have implicit padding");
+
+    nt::idx_t nb_vertex_by_layer = 0;
+    nt::FlatArray<nt::GeographicalCoord> coords;
+    // the out edges of the vertex v are edges[out_edges_begin[v]] to
+    // edges[out_edges_begin[v + 1]] (excluded)
+    nt::FlatArray<uint32_t> out_edges_begin = {0};
+    nt::FlatArray<Edge> edges;
+    // the edges reaching the vertex v, for the backward searches, are
+    // in_edges[in_edges_begin[v]] to in_edges[in_edges_begin[v + 1]] (excluded)
+    struct InEdge {
+        uint32_t source;
+        uint32_t idx; // index in edges
+    };
+    static_assert(sizeof(InEdge) == 8, "StreetTopology::InEdge must not have padding");
+    nt::FlatArray<uint32_t> in_edges_begin = {0};
+    nt::FlatArray<InEdge> in_edges;
+    // size of the layered graph it has been built from
+    size_t nb_layered_vertices = 0;
+    size_t nb_layered_edges = 0;
+
+    static uint8_t layer_mask(nt::Mode_e mode) { return 1 << static_cast<uint8_t>(mode); }
+
+    /// number of vertices of all the layers
+    uint32_t nb_vertices() const { return nb_vertex_by_layer * nb_layers; }
+    uint8_t layer(const uint32_t v) const { return v / nb_vertex_by_layer; }
+    const nt::GeographicalCoord& coord(const uint32_t v) const { return coords[v % nb_vertex_by_layer]; }
+
+    uint32_t target(const LayeredEdge& e) const {
+        const auto& edge = edges[e.idx];
+        const uint32_t target_layer = edge.target_layer == same_layer ? layer(e.source) : edge.target_layer;
+        return edge.target + target_layer * nb_vertex_by_layer;
+    }
+    /// in seconds
+    uint32_t duration(const LayeredEdge& e) const { return edges[e.idx].durations[layer(e.source)]; }
+    nt::idx_t way_idx(const LayeredEdge& e) const { return edges[e.idx].way_idx; }
+
+    /// call f(e) for each edge from v, in the order of the layered graph
+    template<typename F>
+    void for_each_out_edge(const uint32_t v, const F& f) const {
+        const uint32_t vertex = v % nb_vertex_by_layer;
+        const uint8_t mask = 1 << layer(v);
+        for (uint32_t idx = out_edges_begin[vertex]; idx < out_edges_begin[vertex + 1]; ++idx) {
+            if (edges[idx].layers & mask) { f(LayeredEdge{v, idx}); }
+        }
+    }
+
+    /// the first edge from u to v, like boost::edge
+    std::pair<LayeredEdge, bool> edge(const uint32_t u, const uint32_t v) const {
+        const uint32_t vertex = u % nb_vertex_by_layer;
+        const uint8_t mask = 1 << layer(u);
+        for (uint32_t idx = out_edges_begin[vertex]; idx < out_edges_begin[vertex + 1]; ++idx) {
+            const LayeredEdge e{u, idx};
+            if ((edges[idx].layers & mask) && target(e) == v) { return {e, true}; }
+        }
+        return {LayeredEdge{0, 0}, false};
+    }
+
+    /** Build the topology from the layered graph
+     *
+     * The edges of a vertex are merged between the layers only if they
+     * have the same way and if it keeps their order in each layer, thus the
+     * dijkstra relaxes them in the same order than on the layered graph.
+     */
+    template<typename LayeredGraph>
+    void build(const LayeredGraph& graph, const nt::idx_t nb_vertex) {
+        nb_vertex_by_layer = nb_vertex;
+        nb_layered_vertices = num_vertices(graph);
+        nb_layered_edges = num_edges(graph);
+        std::vector<nt::GeographicalCoord> coords;
+        std::vector<uint32_t> out_edges_begin = {0};
+        std::vector<Edge> edges;
+        if (nb_layered_vertices != size_t(nb_vertex_by_layer) * nb_layers) {
+            // the layers have not been built (GeoRef::init() not called),
+            // the topology is left empty
+            nb_vertex_by_layer = 0;
+        }
+        coords.reserve(nb_vertex_by_layer);
+        out_edges_begin.reserve(nb_vertex_by_layer + 1);
+        for (uint32_t v = 0; v < nb_vertex_by_layer; ++v) {
+            coords.push_back(graph[v].coord);
+            const size_t begin = edges.size();
+            for (uint8_t layer = 0; layer < nb_layers; ++layer) {
+                // position of the last edge of the layer, the merge is done after it
+                size_t last = begin;
+                auto range = out_edges(v + layer * nb_vertex_by_layer, graph);
+                for (auto it = range.first; it != range.second; ++it) {
+                    const auto layered_target = graph_target(*it, graph);
+                    const uint32_t target = layered_target % nb_vertex_by_layer;
+                    const uint8_t target_layer = layered_target / nb_vertex_by_layer == layer ?
+                                same_layer : layered_target / nb_vertex_by_layer;
+                    auto merged = edges.begin() + last;
+                    for (; merged != edges.end(); ++merged) {
+                        if (merged->target == target && merged->target_layer == target_layer
+                                && merged->way_idx == graph[*it].way_idx
+                                && ! (merged->layers & (1 << layer))) { break; }
+                    }
+                    if (merged == edges.end()) {
+                        edges.emplace_back();
+                        merged = edges.end() - 1;
+                        merged->target = target;
+                        merged->target_layer = target_layer;
+                        merged->way_idx = graph[*it].way_idx;
+                    }
+                    merged->layers |= 1 << layer;
+                    merged->durations[layer] = graph[*it].duration;
+                    last = merged - edges.begin() + 1;
+                }
+            }
+            out_edges_begin.push_back(edges.size());
+        }
+        build_in_edges(out_edges_begin, edges);
+        this->coords = std::move(coords);
+        this->out_edges_begin = std::move(out_edges_begin);
+        this->edges = std::move(edges);
+    }
+
+    /// memory used by the arrays, in bytes, 0 if they are mapped from a flat file
+    size_t memory_size() const {
+        if (edges.is_mapped()) { return 0; }
+        return coords.size() * sizeof(nt::GeographicalCoord)
+                + (out_edges_begin.size() + in_edges_begin.size()) * sizeof(uint32_t)
+                + edges.size() * sizeof(Edge)
+                + in_edges.size() * sizeof(InEdge);
+    }
+
+    template<class Archive> void save(Archive& ar, const unsigned int) const {
+        const std::vector<nt::GeographicalCoord> coords(this->coords.begin(), this->coords.end());
+        const std::vector<uint32_t> out_edges_begin(this->out_edges_begin.begin(), this->out_edges_begin.end());
+        const std::vector<Edge> edges(this->edges.begin(), this->edges.end());
+        ar & nb_vertex_by_layer & nb_layered_vertices & nb_layered_edges & coords & out_edges_begin & edges;
+    }
+    template<class Archive> void load(Archive& ar, const unsigned int) {
+        std::vector<nt::GeographicalCoord> coords;
+        std::vector<uint32_t> out_edges_begin;
+        std::vector<Edge> edges;
+        ar & nb_vertex_by_layer & nb_layered_vertices & nb_layered_edges & coords & out_edges_begin & edges;
+        // the in edges are deduced from the out edges
+        build_in_edges(out_edges_begin, edges);
+        this->coords = std::move(coords);
+        this->out_edges_begin = std::move(out_edges_begin);
+        this->edges = std::move(edges);
+    }
+    BOOST_SERIALIZATION_SPLIT_MEMBER()
+
+    /// write the topology in a flat file
+    void save(nt::FlatWriter& writer) const {
+        writer.write<uint64_t>(nb_vertex_by_layer);
+        writer.write<uint64_t>(nb_layered_vertices);
+        writer.write<uint64_t>(nb_layered_edges);
+        writer.write_array(coords);
+        writer.write_array(out_edges_begin);
+        writer.write_array(edges);
+        writer.write_array(in_edges_begin);
+        writer.write_array(in_edges);
+    }
+
+    /// read the topology in place from a flat file written by save()
+    void map(nt::FlatReader& reader) {
+        nb_vertex_by_layer = reader.read<uint64_t>();
+        nb_layered_vertices = reader.read<uint64_t>();
+        nb_layered_edges = reader.read<uint64_t>();
+        coords = reader.read_array<nt::GeographicalCoord>();
+        out_edges_begin = reader.read_array<uint32_t>();
+        edges = reader.read_array<Edge>();
+        in_edges_begin = reader.read_array<uint32_t>();
+        in_edges = reader.read_array<InEdge>();
+        if (coords.size() != nb_vertex_by_layer
+                || out_edges_begin.size() != size_t(nb_vertex_by_layer) + 1
+                || in_edges_begin.size() != size_t(nb_vertex_by_layer) + 1
+                || out_edges_begin.back() != edges.size()
+                || in_edges.size() != edges.size()) {
+            throw nt::flat_file_error("invalid flat file: inconsistent street topology");
+        }
+    }
+
+private:
+    void build_in_edges(const std::vector<uint32_t>& out_edges_begin, const std::vector<Edge>& edges) {
+        std::vector<uint32_t> in_edges_begin(nb_vertex_by_layer + 1, 0);
+        for (const auto& edge: edges) { ++in_edges_begin[edge.target + 1]; }
+        for (uint32_t v = 0; v < nb_vertex_by_layer; ++v) {
+            in_edges_begin[v + 1] += in_edges_begin[v];
+        }
+        std::vector<InEdge> in_edges(edges.size());
+        std::vector<uint32_t> next(in_edges_begin.begin(), in_edges_begin.end() - 1);
+        for (uint32_t source = 0; source < nb_vertex_by_layer; ++source) {
+            for (uint32_t idx = out_edges_begin[source]; idx < out_edges_begin[source + 1]; ++idx) {
+                in_edges[next[edges[idx].target]++] = {source, idx};
+            }
+        }
+        this->in_edges_begin = std::move(in_edges_begin);
+        this->in_edges = std::move(in_edges);
+    }
+};
+
+/** The layered graph seen by the dijkstra on a StreetTopology
+ *
+ * Only the vertices of the allowed layers are reachable (it replaces the
+ * filtered_graph on the transportation modes). It models the boost
+ * IncidenceGraph concept.
+ */
+struct LayeredStreetGraph {
+    typedef uint32_t vertex_descriptor;
+    typedef LayeredEdge edge_descriptor;
+
+    class out_edge_iterator: public boost::iterator_facade<out_edge_iterator,
+                                                           edge_descriptor,
+                                                           boost::forward_traversal_tag,
+                                                           edge_descriptor> {
+    public:
+        out_edge_iterator() = default;
+        out_edge_iterator(const LayeredStreetGraph& graph, uint32_t source, uint32_t idx, uint32_t end):
+            g(&graph), source(source), idx(idx), end(end), layer(graph.layer(source)) {
+            skip();
+        }
+    private:
+        friend class boost::iterator_core_access;
+        const LayeredStreetGraph* g = nullptr;
+        uint32_t source = 0;
+        uint32_t idx = 0;
+        uint32_t end = 0;
+        uint8_t layer = 0;
+
+        void skip() {
+            while (idx != end && ! g->is_allowed(layer, g->topology.edges[idx])) { ++idx; }
+        }
+        void increment() { ++idx; skip(); }
+        bool equal(const out_edge_iterator& other) const { return idx == other.idx; }
+        edge_descriptor dereference() const { return {source, idx}; }
+    };
+
+    typedef void adjacency_iterator;
+    typedef void in_edge_iterator;
+    typedef void vertex_iterator;
+    typedef void edge_iterator;
+    typedef boost::directed_tag directed_category;
+    typedef boost::allow_parallel_edge_tag edge_parallel_category;
+    typedef boost::incidence_graph_tag traversal_category;
+    typedef uint32_t vertices_size_type;
+    typedef uint32_t edges_size_type;
+    typedef uint32_t degree_size_type;
+    static vertex_descriptor null_vertex() { return std::numeric_limits<vertex_descriptor>::max(); }
+
+    /// the durations of the edges, in seconds
+    struct DurationMap {
+        typedef edge_descriptor key_type;
+        typedef uint32_t value_type;
+        typedef uint32_t reference;
+        typedef boost::readable_property_map_tag category;
+        const LayeredStreetGraph* g;
+    };
+
+    const StreetTopology& topology;
+    uint8_t allowed_layers; // mask of the layers that can be reached
+
+    LayeredStreetGraph(const StreetTopology& topology, uint8_t allowed_layers):
+        topology(topology), allowed_layers(allowed_layers) {}
+
+    uint8_t layer(const vertex_descriptor v) const { return topology.layer(v); }
+
+    bool is_allowed(const uint8_t source_layer, const StreetTopology::Edge& e) const {
+        const uint8_t target_layer = e.target_layer == StreetTopology::same_layer ? source_layer : e.target_layer;
+        return (e.layers & (1 << source_layer)) && (allowed_layers & (1 << target_layer));
+    }
+
+    vertex_descriptor target(const edge_descriptor& e) const { return topology.target(e); }
+
+    uint32_t duration(const edge_descriptor& e) const { return topology.duration(e); }
+
+    /** Call f(source, duration) for each edge reaching v (in the backward searches)
+     *
+     * A transition reaching the layer of v can come from each layer of its
+     * mask, thus an edge of the topology can give several edges.
+     */
+    template<typename F>
+    void for_each_in_edge(const vertex_descriptor v, const F& f) const {
+        const uint32_t vertex = v % topology.nb_vertex_by_layer;
+        const uint8_t target_layer = layer(v);
+        for (uint32_t i = topology.in_edges_begin[vertex]; i < topology.in_edges_begin[vertex + 1]; ++i) {
+            const auto& in_edge = topology.in_edges[i];
+            const auto& edge = topology.edges[in_edge.idx];
+            if (edge.target_layer == StreetTopology::same_layer) {
+                if (edge.layers & (1 << target_layer)) {
+                    f(in_edge.source + target_layer * topology.nb_vertex_by_layer, edge.durations[target_layer]);
+                }
+                continue;
+            }
+            if (edge.target_layer != target_layer) { continue; }
+            for (uint8_t l = 0; l < StreetTopology::nb_layers; ++l) {
+                if ((edge.layers & (1 << l)) && (allowed_layers & (1 << l))) {
+                    f(in_edge.source + l * topology.nb_vertex_by_layer, edge.durations[l]);
+                }
+            }
+        }
+    }
+
+    std::pair<out_edge_iterator, out_edge_iterator> out_edges(const vertex_descriptor v) const {
+        const uint32_t vertex = v % topology.nb_vertex_by_layer;
+        const uint32_t begin = topology.out_edges_begin[vertex];
+        const uint32_t end = topology.out_edges_begin[vertex + 1];
+        return {out_edge_iterator(*this, v, begin, end), out_edge_iterator(*this, v, end, end)};
+    }
+
+    DurationMap durations() const { return {this}; }
+};
+
+// the free functions of the boost graph concepts, found by ADL
+
+inline std::pair<LayeredStreetGraph::out_edge_iterator, LayeredStreetGraph::out_edge_iterator>
+out_edges(const LayeredStreetGraph::vertex_descriptor v, const LayeredStreetGraph& g) {
+    return g.out_edges(v);
+}
+
+inline LayeredStreetGraph::degree_size_type
+out_degree(const LayeredStreetGraph::vertex_descriptor v, const LayeredStreetGraph& g) {
+    const auto range = g.out_edges(v);
+    return std::distance(range.first, range.second);
+}
+
+inline LayeredStreetGraph::vertex_descriptor
+source(const LayeredStreetGraph::edge_descriptor& e, const LayeredStreetGraph&) {
+    return e.source;
+}
+
+inline LayeredStreetGraph::vertex_descriptor
+target(const LayeredStreetGraph::edge_descriptor& e, const LayeredStreetGraph& g) {
+    return g.target(e);
+}
+
+inline uint32_t get(const LayeredStreetGraph::DurationMap& map, const LayeredStreetGraph::edge_descriptor& e) {
+    return map.g->duration(e);
+}
+
+}} // namespace navitia::georef
@@ -63,7 +63,7 @@ GraphBuilder & GraphBuilder::add_edge(std::string source_name, std::string targe
     target= this->vertex_map[target_name];
 
     Edge edge;
-    edge.duration = dur.is_negative() ? navitia::seconds(0) : dur;
+    edge.duration = dur.is_negative() ? 0 : dur.total_seconds();
 
     boost::add_edge(source, target, edge, this->geo_ref.graph);
     if(bidirectionnal)
@@ -86,4 +86,10 @@ edge_t GraphBuilder::get(const std::string &source_name, const std::string &targ
     else return e;
 }
 
+LayeredEdge GraphBuilder::get_layered(const std::string &source_name, const std::string &target_name){
+    const auto edge = this->geo_ref.search_graph().edge(this->get(source_name), this->get(target_name));
+    if(!edge.second) throw proximitylist::NotFound();
+    return edge.first;
+}
+
 }}
@@ -59,6 +59,8 @@ struct GraphBuilder{
 
     vertex_t get(const std::string & node_name);
     edge_t get(const std::string & source_name, const std::string & target_name);
+    /// the edge in the street topology, once built
+    LayeredEdge get_layered(const std::string & source_name, const std::string & target_name);
 };
 
 }}
@@ -41,6 +41,11 @@ www.navitia.io
 #include "ed/build_helper.h"
 #include "georef/street_network.h"
 #include <boost/graph/detail/adjacency_list.hpp>
+#include <boost/foreach.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/archive/text_iarchive.hpp>
+#include <boost/archive/text_oarchive.hpp>
+#include <sstream>
 
 struct logger_initialized {
     logger_initialized() { init_logger(); }
@@ -120,7 +125,7 @@ BOOST_AUTO_TEST_CASE(outil_de_graph) {
     BOOST_CHECK_EQUAL(g[b].coord, expected);
 
     edge_t e = edge(a, b, g).first;
-    BOOST_CHECK_EQUAL(g[e].duration, navitia::seconds(10));
+    BOOST_CHECK_EQUAL(g[e].get_duration(), navitia::seconds(10));
 
     // Construction implicite de nœuds
     builder("c", "d", navitia::seconds(42));
@@ -132,6 +137,61 @@ BOOST_AUTO_TEST_CASE(outil_de_graph) {
     BOOST_CHECK_EQUAL(num_edges(g), 3);
 }
 
+// the street topology used by the dijkstra stores the layers once, but
+// gives the same out edges than the layered graph, and has to be rebuilt
+// when the graph is modified
+BOOST_AUTO_TEST_CASE(search_graph) {
+    using navitia::type::Mode_e;
+    GraphBuilder builder;
+    const Graph& g = builder.geo_ref.graph;
+    builder("a", 0, 0)("b", 1, 2)("c", 3, 4);
+    builder.geo_ref.init();
+    const auto n = builder.geo_ref.nb_vertex_by_mode;
+    const auto bike = builder.geo_ref.offsets[Mode_e::Bike];
+    const auto car = builder.geo_ref.offsets[Mode_e::Car];
+    const auto a = builder.get("a"), b = builder.get("b"), c = builder.get("c");
+    add_edge(a, b, Edge(0, 10_s), builder.geo_ref.graph);
+    add_edge(a, c, Edge(0, 12_s), builder.geo_ref.graph);
+    add_edge(bike + a, bike + c, Edge(0, 4_s), builder.geo_ref.graph);
+    add_edge(bike + a, bike + b, Edge(0, 3_s), builder.geo_ref.graph);
+    add_edge(car + a, car + b, Edge(0, 1_s), builder.geo_ref.graph);
+    add_edge(c, bike + c, Edge(0, 30_s), builder.geo_ref.graph); // a bss transition
+    builder.geo_ref.build_street_network_indexes();
+
+    const auto check_same_out_edges = [&](const StreetTopology& topology) {
+        const LayeredStreetGraph layered(topology, 0xff);
+        for (vertex_t v = 0; v < num_vertices(g); ++v) {
+            std::vector<std::pair<vertex_t, uint32_t>> expected, result;
+            BOOST_FOREACH(edge_t e, out_edges(v, g)) {
+                expected.push_back({target(e, g), g[e].duration});
+            }
+            const auto range = out_edges(uint32_t(v), layered);
+            for (auto it = range.first; it != range.second; ++it) {
+                result.push_back({target(*it, layered), get(layered.durations(), *it)});
+            }
+            BOOST_CHECK_EQUAL_COLLECTIONS(result.begin(), result.end(), expected.begin(), expected.end());
+        }
+    };
+
+    const StreetTopology& topology = builder.geo_ref.search_graph();
+    BOOST_CHECK_EQUAL(topology.coords.size(), n);
+    // a->b is shared by walking and car, a->c by walking and bike, the bike
+    // a->b is not merged since it is after a->c in the bike layer, and
+    // c->bike c is a transition
+    BOOST_CHECK_EQUAL(topology.edges.size(), 4);
+    check_same_out_edges(topology);
+
+    // the walking only graph does not see the transition
+    const LayeredStreetGraph walking(topology, StreetTopology::layer_mask(Mode_e::Walking));
+    const auto range = out_edges(uint32_t(c), walking);
+    BOOST_CHECK(range.first == range.second);
+
+    add_edge(b, a, Edge(0, 7_s), builder.geo_ref.graph);
+    BOOST_CHECK_THROW(builder.geo_ref.search_graph(), navitia::exception);
+    builder.geo_ref.build_street_network_indexes();
+    check_same_out_edges(builder.geo_ref.search_graph());
+}
+
 BOOST_AUTO_TEST_CASE(nearest_segment){
     GraphBuilder b;
 
@@ -143,19 +203,21 @@ BOOST_AUTO_TEST_CASE(nearest_segment){
 
     b("a", 0,10)("b", -10, 0)("c",10,0)("d",0,-10)("o",0,0)("e", 50,10);
     b("o", "a")("o","b")("o","c")("o","d")("b","o");
+    b.geo_ref.init();
+    b.geo_ref.build_street_network_indexes();
 
     navitia::type::GeographicalCoord c(1,2, false);
-    BOOST_CHECK(b.geo_ref.nearest_edge(c) == b.get("o", "a"));
+    BOOST_CHECK(b.geo_ref.nearest_edge(c) == b.get_layered("o", "a"));
     c.set_xy(2, 1);
-    BOOST_CHECK(b.geo_ref.nearest_edge(c) == b.get("o", "c"));
+    BOOST_CHECK(b.geo_ref.nearest_edge(c) == b.get_layered("o", "c"));
     c.set_xy(2, -1);
-    BOOST_CHECK(b.geo_ref.nearest_edge(c) == b.get("o", "c"));
+    BOOST_CHECK(b.geo_ref.nearest_edge(c) == b.get_layered("o", "c"));
     c.set_xy(2, -3);
-    BOOST_CHECK(b.geo_ref.nearest_edge(c) == b.get("o", "d"));
+    BOOST_CHECK(b.geo_ref.nearest_edge(c) == b.get_layered("o", "d"));
     c.set_xy(-10, 1);
-    BOOST_CHECK(b.geo_ref.nearest_edge(c) == b.get("b", "o"));
+    BOOST_CHECK(b.geo_ref.nearest_edge(c) == b.get_layered("b", "o"));
     c.set_xy(50, 10);
-    BOOST_CHECK_EQUAL(b.geo_ref.nearest_edge(c), b.get("o", "c"));
+    BOOST_CHECK(b.geo_ref.nearest_edge(c) == b.get_layered("o", "c"));
 }
 
 BOOST_AUTO_TEST_CASE(real_nearest_edge){
@@ -167,19 +229,126 @@ BOOST_AUTO_TEST_CASE(real_nearest_edge){
     */
     b("a", 0, -100)("b", 0, 100)("c", 10, 0)("d", 10, 10);
     b("a", "b")("c", "d");
+    b.geo_ref.init();
+    b.geo_ref.build_street_network_indexes();
     navitia::type::GeographicalCoord s(-10, 0, false);
-    BOOST_CHECK(b.geo_ref.nearest_edge(s) == b.get("a", "b"));
+    BOOST_CHECK(b.geo_ref.nearest_edge(s) == b.get_layered("a", "b"));
+}
+
+// the edges are indexed, thus an edge is found even if its vertices are far
+BOOST_AUTO_TEST_CASE(nearest_edge_with_far_vertices) {
+    GraphBuilder b;
+
+    /*                s
+       a---------------------------------b
+                          c-d
+    */
+    b("a", -1000, 0)("b", 1000, 0)("c", 0, -30)("d", 10, -30);
+    b("a", "b")("c", "d");
+    b.geo_ref.init();
+    b.geo_ref.build_street_network_indexes();
+
+    navitia::type::GeographicalCoord s(5, 10, false);
+    BOOST_CHECK(b.geo_ref.nearest_edge(s) == b.get_layered("a", "b"));
+    const ProjectionData projection(s, b.geo_ref, b.geo_ref.offsets[navitia::type::Mode_e::Walking]);
+    BOOST_REQUIRE(projection.found);
+    BOOST_CHECK_CLOSE(projection.distances[ProjectionData::Direction::Source], 1005, 1);
+
+    // only the edges of the layer of the offset are looked for
+    BOOST_CHECK_THROW(b.geo_ref.nearest_edge(s, navitia::type::Mode_e::Car), navitia::proximitylist::NotFound);
+
+    // nothing within 500 meters
+    s.set_xy(0, 600);
+    BOOST_CHECK_THROW(b.geo_ref.nearest_edge(s), navitia::proximitylist::NotFound);
+}
+
+BOOST_AUTO_TEST_CASE(flat_street_network_indexes) {
+    const auto build = [](GraphBuilder& b) {
+        b("a", 0, 0)("b", 100, 0)("c", 100, 100)("d", 0, 100);
+        b("a", "b")("b", "c")("c", "d")("d", "a");
+        b.geo_ref.init();
+    };
+    GraphBuilder b;
+    build(b);
+    b.geo_ref.build_street_network_indexes();
+    b.geo_ref.build_proximity_list();
+    const auto filename = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()).string();
+    {
+        navitia::type::FlatWriter writer(filename, 42, 1234);
+        b.geo_ref.save_flat(writer);
+        writer.close();
+    }
+    const auto load = [&](GraphBuilder& g, uint32_t version, uint64_t archive_id) {
+        navitia::type::FlatReader reader(filename, version, archive_id);
+        g.geo_ref.load_flat(reader);
+    };
+
+    // the indexes of the same graph are read in place from the file
+    GraphBuilder mapped;
+    build(mapped);
+    load(mapped, 42, 1234);
+    const auto& topology = mapped.geo_ref.search_graph();
+    BOOST_CHECK(topology.edges.is_mapped());
+    BOOST_CHECK_EQUAL(topology.edges.size(), b.geo_ref.search_graph().edges.size());
+    BOOST_CHECK_EQUAL(topology.coords.size(), 4);
+    navitia::type::GeographicalCoord s(50, 10, false);
+    BOOST_CHECK(mapped.geo_ref.nearest_edge(s) == mapped.get_layered("a", "b"));
+    BOOST_CHECK_THROW(mapped.geo_ref.nearest_edge(s, navitia::type::Mode_e::Car), navitia::proximitylist::NotFound);
+    BOOST_CHECK(mapped.geo_ref.pl.elements.is_mapped());
+    BOOST_CHECK_EQUAL(mapped.geo_ref.pl.find_nearest(navitia::type::GeographicalCoord(90, 95, false)),
+                      mapped.vertex_map["c"]);
+
+    // the file is refused for another version, another archive or another graph
+    BOOST_CHECK_THROW(load(mapped, 43, 1234), navitia::type::flat_file_error);
+    BOOST_CHECK_THROW(load(mapped, 42, 1235), navitia::type::flat_file_error);
+    b("a", "c");
+    BOOST_CHECK_THROW(load(b, 42, 1234), navitia::type::flat_file_error);
+    boost::filesystem::remove(filename);
 }
 
 /// Compute the path from the starting point to the the target geographical coord
 static Path compute_path(PathFinder& finder, const navitia::type::GeographicalCoord& target_coord) {
-    ProjectionData dest(target_coord, finder.geo_ref, finder.geo_ref.pl);
+    ProjectionData dest(target_coord, finder.geo_ref);
 
     auto best_pair = finder.update_path(dest);
 
     return finder.get_path(dest, best_pair);
 }
 
+// the street network is serialized as its topology, thus the searches and
+// the paths work without the graph once loaded
+BOOST_AUTO_TEST_CASE(serialized_street_topology) {
+    using navitia::type::GeographicalCoord;
+    GraphBuilder b;
+    b("a", 0, 0)("b", 100, 0)("c", 100, 100);
+    b("a", "b", 10_s, true)("b", "c", 20_s, true);
+    b.geo_ref.init();
+    b.geo_ref.build_street_network_indexes();
+
+    std::stringstream stream;
+    {
+        boost::archive::text_oarchive oa(stream);
+        const GeoRef& saved = b.geo_ref;
+        oa << saved;
+    }
+    GeoRef loaded;
+    {
+        boost::archive::text_iarchive ia(stream);
+        ia >> loaded;
+    }
+    loaded.build_edge_index();
+    BOOST_CHECK_EQUAL(num_vertices(loaded.graph), 0);
+    BOOST_CHECK_EQUAL(loaded.search_graph().edges.size(), b.geo_ref.search_graph().edges.size());
+
+    PathFinder finder(loaded);
+    finder.init(GeographicalCoord(10, 1, false), navitia::type::Mode_e::Walking, 1);
+    const auto coords = get_coords_from_path(compute_path(finder, GeographicalCoord(99, 50, false)));
+    BOOST_REQUIRE_EQUAL(coords.size(), 3);
+    BOOST_CHECK_EQUAL(coords[0], GeographicalCoord(10, 0, false));
+    BOOST_CHECK_EQUAL(coords[1], GeographicalCoord(100, 0, false));
+    BOOST_CHECK_EQUAL(coords[2], GeographicalCoord(100, 50, false));
+}
+
 //not used for the moment so it is not possible anymore (but it would not be difficult to do again)
 // Est-ce que le calcul de plusieurs nœuds vers plusieurs nœuds fonctionne
 //BOOST_AUTO_TEST_CASE(compute_route_n_n){
@@ -272,6 +441,7 @@ BOOST_AUTO_TEST_CASE(compute_directions_test) {
     b.geo_ref.graph[b.get("e","d")].way_idx = 1;
 
     b.geo_ref.init();
+    b.geo_ref.build_street_network_indexes();
 
     PathFinder path_finder(b.geo_ref);
     path_finder.init({0, 0, true}, Mode_e::Walking, 1); //starting from a
@@ -290,6 +460,262 @@ BOOST_AUTO_TEST_CASE(compute_directions_test) {
     BOOST_CHECK_EQUAL(p.path_items[0].way_idx, 1);
 }
 
+// a path finder reused for another search only resets the vertices it has
+// visited, it must give the same distances than a new one
+BOOST_AUTO_TEST_CASE(path_finder_sparse_reset) {
+    using namespace navitia::type;
+    GraphBuilder b;
+
+    /*           a+------+b
+     *            |      |
+     *            |      |
+     *           c+------+d
+     */
+    b("a",0,0)("b",10,0)("c",0,10)("d",10,10);
+    b("a","b", 10_s)("b","a",10_s)("a","c",10_s)("c","a",10_s)("b","d",10_s)("d","b",10_s)("c","d",10_s)("d","c",10_s);
+    b.geo_ref.init();
+    b.geo_ref.build_street_network_indexes();
+
+    GeographicalCoord start, other_start;
+    start.set_xy(3, -1);
+    other_start.set_xy(11, 8);
+
+    PathFinder reused(b.geo_ref);
+    reused.init(start, Mode_e::Walking, 1);
+    reused.start_distance_dijkstra(100_s);
+    BOOST_CHECK(! reused.touched_vertices.empty());
+    BOOST_CHECK(reused.touched_vertices.size() < num_vertices(b.geo_ref.graph));
+
+    // a smaller radius, some vertices reached by the first search are not reached anymore
+    reused.init(other_start, Mode_e::Walking, 1);
+    reused.start_distance_dijkstra(5_s);
+
+    PathFinder fresh(b.geo_ref);
+    fresh.init(other_start, Mode_e::Walking, 1);
+    fresh.start_distance_dijkstra(5_s);
+
+    BOOST_CHECK_EQUAL_COLLECTIONS(reused.distances.begin(), reused.distances.end(),
+                                  fresh.distances.begin(), fresh.distances.end());
+}
+
+BOOST_AUTO_TEST_CASE(radix_heap) {
+    RadixHeap<char> heap;
+    heap.push(10, 'a');
+    heap.push(3, 'b');
+    heap.push(7, 'c');
+    heap.push(3, 'd');
+    BOOST_CHECK_EQUAL(heap.pop().first, 3);
+    BOOST_CHECK_EQUAL(heap.pop().first, 3);
+    // the keys pushed must not be lower than the last popped
+    heap.push(5, 'e');
+    BOOST_CHECK(heap.pop() == std::make_pair(5u, 'e'));
+    BOOST_CHECK(heap.pop() == std::make_pair(7u, 'c'));
+    BOOST_CHECK(heap.pop() == std::make_pair(10u, 'a'));
+    BOOST_CHECK(heap.empty());
+}
+
+// the fallbacks computed by start_distance_dijkstra must be the ones of the boost dijkstra
+BOOST_AUTO_TEST_CASE(street_dijkstra_like_boost) {
+    using namespace navitia::type;
+    GraphBuilder b;
+
+    /*           a+------+b------+e
+     *            |      |
+     *            |      |
+     *           c+------+d
+     */
+    b("a",0,0)("b",10,0)("c",0,10)("d",10,10)("e",20,0);
+    b("a","b", 10_s)("b","a",10_s)("a","c",10_s)("c","a",10_s)("b","d",10_s)("d","b",10_s)("c","d",10_s)("d","c",10_s);
+    b("b","e", 10_s)("e","b",10_s);
+    b.geo_ref.init();
+    b.geo_ref.build_street_network_indexes();
+
+    GeographicalCoord start;
+    start.set_xy(3, -1);
+    for (const auto radius: {5_s, 15_s, 100_s}) {
+        PathFinder street(b.geo_ref);
+        street.init(start, Mode_e::Walking, 1);
+        street.start_distance_dijkstra(radius);
+
+        PathFinder boost_finder(b.geo_ref);
+        boost_finder.init(start, Mode_e::Walking, 1);
+        for (const auto dir: {ProjectionData::Direction::Source, ProjectionData::Direction::Target}) {
+            try {
+                boost_finder.dijkstra(boost_finder.starting_edge[dir],
+                                      distance_visitor(radius, boost_finder.distances));
+            } catch(DestinationFound) {}
+        }
+
+        for (vertex_t v = 0; v < b.geo_ref.nb_vertex_by_mode; ++v) {
+            if (boost_finder.distances[v] > radius) { continue; }
+            BOOST_CHECK_EQUAL(street.distances[v], boost_finder.distances[v]);
+        }
+    }
+}
+
+// the direct path found by the bidirectional search must be the one of the search within the radius
+BOOST_AUTO_TEST_CASE(bidirectional_dijkstra_like_radius_search) {
+    using namespace navitia::type;
+    GraphBuilder b;
+
+    /*           a+------+b------+e
+     *            |      |
+     *            |      |
+     *           c+------+d
+     */
+    b("a",0,0)("b",10,0)("c",0,10)("d",10,10)("e",20,0);
+    b("a","b", 10_s)("b","a",10_s)("a","c",10_s)("c","a",10_s)("b","d",10_s)("d","b",10_s)("c","d",10_s)("d","c",10_s);
+    b("b","e", 10_s)("e","b",10_s);
+    b.geo_ref.init();
+    b.geo_ref.build_street_network_indexes();
+
+    GeographicalCoord start, same_edge, far, on_node;
+    start.set_xy(3, -1);
+    same_edge.set_xy(7, 1);
+    far.set_xy(1, 7);
+    on_node.set_xy(20, 0);
+    for (const auto& dest: {same_edge, far, on_node}) {
+        const ProjectionData dest_edge(dest, b.geo_ref, b.geo_ref.offsets[Mode_e::Walking]);
+
+        PathFinder radius_search(b.geo_ref);
+        radius_search.init(start, Mode_e::Walking, 1);
+        radius_search.start_distance_dijkstra(100_s);
+        const auto expected = radius_search.find_nearest_vertex(dest_edge, true);
+
+        PathFinder bidirectional(b.geo_ref);
+        bidirectional.init(start, Mode_e::Walking, 1);
+        const auto nearest = bidirectional.bidirectional_dijkstra(dest_edge, 100_s);
+        BOOST_CHECK_EQUAL(nearest.first, expected.first);
+
+        const auto expected_path = radius_search.get_path(dest_edge, expected);
+        const auto path = bidirectional.get_path(dest_edge, nearest);
+        BOOST_CHECK_EQUAL(path.duration, expected_path.duration);
+        BOOST_REQUIRE_EQUAL(path.path_items.size(), expected_path.path_items.size());
+        for (size_t i = 0; i < path.path_items.size(); ++i) {
+            BOOST_CHECK_EQUAL_COLLECTIONS(path.path_items[i].coordinates.begin(), path.path_items[i].coordinates.end(),
+                                          expected_path.path_items[i].coordinates.begin(),
+                                          expected_path.path_items[i].coordinates.end());
+        }
+    }
+
+    // no path within the radius, the path found by the projections (if any) is longer
+    PathFinder bidirectional(b.geo_ref);
+    bidirectional.init(start, Mode_e::Walking, 1);
+    const ProjectionData far_edge(far, b.geo_ref, b.geo_ref.offsets[Mode_e::Walking]);
+    BOOST_CHECK(bidirectional.bidirectional_dijkstra(far_edge, 5_s).first > 5_s);
+}
+
+// the paths found on the contraction hierarchy must be the ones of the dijkstra
+BOOST_AUTO_TEST_CASE(contraction_hierarchy_like_dijkstra) {
+    using namespace navitia::type;
+    GraphBuilder b;
+
+    /*           a+------+b------+e
+     *            |      |       |
+     *            |      |       |
+     *           c+------+d------+f
+     */
+    b("a",0,0)("b",10,0)("c",0,10)("d",10,10)("e",20,0)("f",20,10);
+    b("a","b", 10_s)("b","a",10_s)("a","c",10_s)("c","a",10_s)("b","d",10_s)("d","b",10_s)("c","d",10_s)("d","c",10_s);
+    b("b","e", 10_s)("e","b",10_s)("d","f",20_s)("f","d",20_s)("e","f",10_s)("f","e",10_s);
+    b.geo_ref.init();
+    b.geo_ref.build_street_network_indexes();
+    b.geo_ref.build_contraction_hierarchies();
+    BOOST_REQUIRE(b.geo_ref.contraction_hierarchy(Mode_e::Bike));
+    BOOST_CHECK(! b.geo_ref.contraction_hierarchy(Mode_e::Walking));
+
+    GeographicalCoord start;
+    start.set_xy(3, -1);
+    GeographicalCoord dest1, dest2, dest3;
+    dest1.set_xy(1, 7);
+    dest2.set_xy(19, 9);
+    dest3.set_xy(20, 10);
+    // the speed factor is applied by edge of the shortcuts, like the dijkstra
+    for (const float speed_factor: {1.f, 0.3f, 1.7f}) {
+        for (const auto& dest: {dest1, dest2, dest3}) {
+            const ProjectionData dest_edge(dest, b.geo_ref, b.geo_ref.offsets[Mode_e::Bike]);
+
+            PathFinder dijkstra(b.geo_ref);
+            dijkstra.init(start, Mode_e::Bike, speed_factor);
+            dijkstra.hierarchy = nullptr;
+            const auto expected = dijkstra.bidirectional_dijkstra(dest_edge, 100_s / speed_factor);
+            const auto expected_path = dijkstra.get_path(dest_edge, expected);
+
+            PathFinder hierarchy(b.geo_ref);
+            hierarchy.init(start, Mode_e::Bike, speed_factor);
+            BOOST_REQUIRE(hierarchy.hierarchy);
+            const auto nearest = hierarchy.bidirectional_dijkstra(dest_edge, 100_s / speed_factor);
+            BOOST_CHECK_EQUAL(nearest.first, expected.first);
+            const auto path = hierarchy.get_path(dest_edge, nearest);
+            BOOST_CHECK_EQUAL(path.duration, expected_path.duration);
+            BOOST_REQUIRE_EQUAL(path.path_items.size(), expected_path.path_items.size());
+            for (size_t i = 0; i < path.path_items.size(); ++i) {
+                BOOST_CHECK_EQUAL_COLLECTIONS(path.path_items[i].coordinates.begin(), path.path_items[i].coordinates.end(),
+                                              expected_path.path_items[i].coordinates.begin(),
+                                              expected_path.path_items[i].coordinates.end());
+            }
+
+            // the distances to both ends of the edge, like for the stop points
+            PathFinder fallback(b.geo_ref);
+            fallback.init(start, Mode_e::Bike, speed_factor);
+            const auto distance = fallback.update_path(dest_edge);
+            BOOST_CHECK_EQUAL(distance.first, expected.first);
+        }
+    }
+
+    // the hierarchy is not used anymore once the graph is modified
+    b("a","f", 10_s);
+    BOOST_CHECK(! b.geo_ref.contraction_hierarchy(Mode_e::Bike));
+}
+
+// the matrix must give the durations of a search by origin
+BOOST_AUTO_TEST_CASE(duration_matrix) {
+    using namespace navitia::type;
+    GraphBuilder b;
+
+    /*           a+------+b------+e
+     *            |      |
+     *            |      |
+     *           c+------+d
+     */
+    b("a",0,0)("b",10,0)("c",0,10)("d",10,10)("e",20,0);
+    b("a","b", 10_s)("b","a",10_s)("a","c",10_s)("c","a",10_s)("b","d",10_s)("d","b",10_s)("c","d",10_s)("d","c",10_s);
+    b("b","e", 10_s)("e","b",10_s);
+    b.geo_ref.init();
+    b.geo_ref.build_street_network_indexes();
+
+    std::vector<GeographicalCoord> origins(3);
+    origins[0].set_xy(3, -1);
+    origins[1].set_xy(11, 7);
+    origins[2].set_xy(18, 1);
+    std::vector<GeographicalCoord> dest_coords(2);
+    dest_coords[0].set_xy(1, 7);
+    dest_coords[1].set_xy(7, 11);
+    std::vector<ProjectionData> destinations;
+    for (const auto& coord: dest_coords) {
+        destinations.emplace_back(coord, b.geo_ref, b.geo_ref.offsets[Mode_e::Walking]);
+    }
+
+    PathFinder first(b.geo_ref), second(b.geo_ref);
+    navitia::routing::ThreadPool pool(1);
+    const auto matrix = compute_duration_matrix(pool, {&first, &second}, origins, destinations,
+                                                Mode_e::Walking, 1, 30_s);
+    BOOST_REQUIRE_EQUAL(matrix.size(), origins.size());
+    for (size_t i = 0; i < origins.size(); ++i) {
+        BOOST_REQUIRE_EQUAL(matrix[i].size(), destinations.size());
+        PathFinder path_finder(b.geo_ref);
+        path_finder.init(origins[i], Mode_e::Walking, 1);
+        path_finder.start_distance_dijkstra(30_s);
+        for (size_t j = 0; j < destinations.size(); ++j) {
+            auto expected = path_finder.find_nearest_vertex(destinations[j]).first;
+            if (expected > 30_s) { expected = bt::pos_infin; }
+            BOOST_CHECK_EQUAL(matrix[i][j], expected);
+        }
+    }
+    // the last origin is too far
+    BOOST_CHECK(matrix[2][0] == bt::pos_infin);
+}
+
 // On teste le calcul d'itinéraire de coordonnées à coordonnées
 BOOST_AUTO_TEST_CASE(compute_coord){
     using namespace navitia::type;
@@ -324,6 +750,7 @@ BOOST_AUTO_TEST_CASE(compute_coord){
     GeographicalCoord destination;
     destination.set_xy(4, 11);
     b.geo_ref.init();
+    b.geo_ref.build_street_network_indexes();
     path_finder.init(start, Mode_e::Walking, 1);
     Path p = compute_path(path_finder, destination);
     auto coords = get_coords_from_path(p);
@@ -375,6 +802,7 @@ BOOST_AUTO_TEST_CASE(compute_nearest){
     pl.add(c2, 1);
     pl.build();
     b.geo_ref.init();
+    b.geo_ref.build_street_network_indexes();
 
     StopPoint* sp1 = new StopPoint();
     sp1->idx = 0;
@@ -415,11 +843,74 @@ BOOST_AUTO_TEST_CASE(compute_nearest){
     BOOST_CHECK_EQUAL_COLLECTIONS(res.cbegin(), res.cend(), tested_map.cbegin(), tested_map.cend());
 }
 
+// the stop points of an already searched starting point are given by the cache
+BOOST_AUTO_TEST_CASE(fallback_cache) {
+    using namespace navitia::type;
+
+    GraphBuilder b;
+
+    /*       1                    2
+     *       +                    +
+     *    o------o------o------o------o
+     *    a      b      c      d      e
+     */
+
+    b("a",0,0)("b",100,0)("c",200,0)("d",300,0)("e",400,0);
+    b("a","b",100_s)("b","a",100_s)("b","c",100_s)("c","b",100_s)("c","d",100_s)("d","c",100_s)("d","e",100_s)("e","d",100_s);
+
+    GeographicalCoord c1(50,10, false);
+    GeographicalCoord c2(350,20, false);
+    navitia::proximitylist::ProximityList<idx_t> pl;
+    pl.add(c1, 0);
+    pl.add(c2, 1);
+    pl.build();
+    b.geo_ref.init();
+    b.geo_ref.build_street_network_indexes();
+
+    StopPoint sp1, sp2;
+    sp1.idx = 0;
+    sp1.coord = c1;
+    sp2.idx = 1;
+    sp2.coord = c2;
+    b.geo_ref.project_stop_points({&sp1, &sp2});
+
+    EntryPoint starting_point;
+    starting_point.coordinates = GeographicalCoord(120, 0, false);
+    starting_point.streetnetwork_params.mode = Mode_e::Walking;
+    starting_point.streetnetwork_params.speed_factor = 1;
+
+    FallbackCache cache;
+    StreetNetwork w(b.geo_ref);
+    w.init(starting_point);
+    const auto searched = w.find_nearest_stop_points(1000_s, pl, false, &cache);
+    BOOST_CHECK_EQUAL(searched.size(), 2);
+    const auto searched_path = w.get_path(1);
+    BOOST_CHECK_EQUAL(cache.get_nb_calls(), 1);
+    BOOST_CHECK_EQUAL(cache.get_nb_cache_miss(), 1);
+
+    w.init(starting_point);
+    const auto cached = w.find_nearest_stop_points(1000_s, pl, false, &cache);
+    BOOST_CHECK_EQUAL(cache.get_nb_calls(), 2);
+    BOOST_CHECK_EQUAL(cache.get_nb_cache_miss(), 1);
+    BOOST_CHECK_EQUAL_COLLECTIONS(cached.cbegin(), cached.cend(), searched.cbegin(), searched.cend());
+    // the path is searched on demand
+    const auto cached_path = w.get_path(1);
+    BOOST_CHECK_EQUAL(cached_path.duration, searched_path.duration);
+    BOOST_CHECK_EQUAL(cached_path.path_items.size(), searched_path.path_items.size());
+
+    // another radius is another entry
+    w.init(starting_point);
+    w.find_nearest_stop_points(100_s, pl, false, &cache);
+    BOOST_CHECK_EQUAL(cache.get_nb_calls(), 3);
+    BOOST_CHECK_EQUAL(cache.get_nb_cache_miss(), 2);
+}
+
 // Récupérer les cordonnées d'un numéro impair :
 BOOST_AUTO_TEST_CASE(numero_impair){
     navitia::georef::Way way;
     navitia::georef::HouseNumber hn;
-    navitia::georef::Graph graph;
+    navitia::georef::GeoRef geo_ref;
+    navitia::georef::Graph& graph = geo_ref.graph;
     vertex_t debut, fin;
     Vertex v;
     navitia::georef::Edge e1;
@@ -477,31 +968,35 @@ BOOST_AUTO_TEST_CASE(numero_impair){
     way.edges.push_back(std::make_pair(debut, fin));
     way.edges.push_back(std::make_pair(fin,debut));
 
+    geo_ref.init();
+    geo_ref.build_street_network_indexes();
+    const auto& topology = geo_ref.search_graph();
+
 // Numéro recherché est > au plus grand numéro dans la rue
-    nt::GeographicalCoord result = way.nearest_coord(55, graph);
+    nt::GeographicalCoord result = way.nearest_coord(55, topology);
     BOOST_CHECK_EQUAL(result, upper);
 
 // Numéro recherché est < au plus petit numéro dans la rue
-    result = way.nearest_coord(1, graph);
+    result = way.nearest_coord(1, topology);
     BOOST_CHECK_EQUAL(result, lower);
 
 // Numéro recherché est = à numéro dans la rue
-    result = way.nearest_coord(17, graph);
+    result = way.nearest_coord(17, topology);
     BOOST_CHECK_EQUAL(result, nt::GeographicalCoord(1.0,17.0));
 
 // Numéro recherché est n'existe pas mais il est inclus entre le plus petit et grand numéro de la rue
     // ==>  Extrapolation des coordonnées
-   result = way.nearest_coord(43, graph);
+   result = way.nearest_coord(43, topology);
    BOOST_CHECK_EQUAL(result, nt::GeographicalCoord(1.0,43.0));
 
 
 
 // liste des numéros pair est vide ==> Calcul du barycentre de la rue
-   result = way.nearest_coord(40, graph);
+   result = way.nearest_coord(40, topology);
    BOOST_CHECK_EQUAL(result, nt::GeographicalCoord(1,28)); // 3 + 25
 // les deux listes des numéros pair et impair sont vides ==> Calcul du barycentre de la rue
    way.house_number_left.clear();
-   result = way.nearest_coord(9, graph);
+   result = way.nearest_coord(9, topology);
    BOOST_CHECK_EQUAL(result, nt::GeographicalCoord(1,28));
 
 }
@@ -510,7 +1005,8 @@ BOOST_AUTO_TEST_CASE(numero_impair){
 BOOST_AUTO_TEST_CASE(numero_pair){
     navitia::georef::Way way;
     navitia::georef::HouseNumber hn;
-    navitia::georef::Graph graph;
+    navitia::georef::GeoRef geo_ref;
+    navitia::georef::Graph& graph = geo_ref.graph;
     vertex_t debut, fin;
     Vertex v;
     navitia::georef::Edge e1;
@@ -568,30 +1064,34 @@ BOOST_AUTO_TEST_CASE(numero_pair){
     way.edges.push_back(std::make_pair(fin,debut));
 
 
+    geo_ref.init();
+    geo_ref.build_street_network_indexes();
+    const auto& topology = geo_ref.search_graph();
+
 // Numéro recherché est > au plus grand numéro dans la rue
-    nt::GeographicalCoord result = way.nearest_coord(56, graph);
+    nt::GeographicalCoord result = way.nearest_coord(56, topology);
     BOOST_CHECK_EQUAL(result, upper);
 
 // Numéro recherché est < au plus petit numéro dans la rue
-    result = way.nearest_coord(2, graph);
+    result = way.nearest_coord(2, topology);
     BOOST_CHECK_EQUAL(result, lower);
 
 // Numéro recherché est = à numéro dans la rue
-    result = way.nearest_coord(18, graph);
+    result = way.nearest_coord(18, topology);
     BOOST_CHECK_EQUAL(result, nt::GeographicalCoord(2.0,18.0));
 
 // Numéro recherché est n'existe pas mais il est inclus entre le plus petit et grand numéro de la rue
     // ==>  Extrapolation des coordonnées
-   result = way.nearest_coord(44, graph);
+   result = way.nearest_coord(44, topology);
    BOOST_CHECK_EQUAL(result, nt::GeographicalCoord(2.0,44.0));
 
 // liste des numéros impair est vide ==> Calcul du barycentre de la rue
-   result = way.nearest_coord(41, graph);
+   result = way.nearest_coord(41, topology);
    BOOST_CHECK_EQUAL(result, nt::GeographicalCoord(2,29)); // 4+25
 
 // les deux listes des numéros pair et impair sont vides ==> Calcul du barycentre de la rue
    way.house_number_right.clear();
-   result = way.nearest_coord(10, graph);
+   result = way.nearest_coord(10, topology);
    BOOST_CHECK_EQUAL(result, nt::GeographicalCoord(2,29));
 }
 
@@ -784,6 +1284,7 @@ BOOST_AUTO_TEST_CASE(two_scc) {
     pl.add(c2, 1);
     pl.build();
     b.geo_ref.init();
+    b.geo_ref.build_street_network_indexes();
 
     StopPoint* sp1 = new StopPoint();
     sp1->coord = c1;
@@ -872,7 +1373,7 @@ BOOST_AUTO_TEST_CASE(SpeedDistanceCombiner_test) {
 
     BOOST_CHECK_EQUAL(dur / 2, 5_s);
 
-    navitia::time_duration dur2 = 60_s;
+    uint32_t dur2 = 60; // the edges durations are in seconds
     BOOST_CHECK_EQUAL(comb(dur, dur2), navitia::seconds(10+60/2));
 }
 
@@ -883,7 +1384,7 @@ BOOST_AUTO_TEST_CASE(SpeedDistanceCombiner_test2) {
 
     BOOST_CHECK_EQUAL(dur / 0.5, 20_s);
 
-    navitia::time_duration dur2 = 60_s;
+    uint32_t dur2 = 60; // the edges durations are in seconds
     BOOST_CHECK_EQUAL(comb(dur, dur2), 130_s);
 }
 
@@ -979,6 +1480,7 @@ BOOST_AUTO_TEST_CASE(geolocalization) {
     b.data->build_raptor();
     */
     b.data->build_uri();
+    b.data->geo_ref->build_street_network_indexes();
     b.data->build_proximity_list();
 
     const Way *const_ab = ab, *const_ac = ac;
@@ -1050,6 +1552,7 @@ BOOST_AUTO_TEST_CASE(find_nearest_on_same_edge){
     pl.add(c3, 3);
     pl.build();
     b.geo_ref.init();
+    b.geo_ref.build_street_network_indexes();
 
     StopPoint* sp0 = new StopPoint();
     sp0->coord = c0;
@@ -111,6 +111,7 @@ BOOST_AUTO_TEST_CASE(idempotence) {
     sp->idx = 0;
     data.pt_data->stop_points.push_back(sp);
     b.geo_ref.init();
+    b.geo_ref.build_street_network_indexes();
     b.geo_ref.project_stop_points(data.pt_data->stop_points);
 
     const GeoRef::ProjectionByMode& projections = b.geo_ref.projected_stop_points[sp->idx];
@@ -64,6 +64,25 @@ po::options_description get_options_description(const boost::optional<std::strin
              po::value<bool>()->default_value(*display_contributors) : po::value<bool>()->default_value(false),
          "display all contributors in feed publishers")
         ("GENERAL.raptor_cache_size", po::value<int>()->default_value(10), "maximum number of stored raptor caches")
+        ("GENERAL.raptor_snd_pass_threads", po::value<int>()->default_value(1),
+                                            "number of raptor second passes run in parallel for a journey")
+        ("GENERAL.street_network_matrix_threads", po::value<int>()->default_value(1),
+                                                  "number of street network searches run in parallel for a matrix (n - 1 more threads by worker)")
+        ("GENERAL.trip_based_engine", po::value<bool>()->default_value(false),
+                                      "build the transfers of the trip based engine, used for the first pass and the profiles of raptor when possible")
+        ("GENERAL.concurrent_street_network", po::value<bool>()->default_value(false),
+                                              "search the departure, arrival and direct path of a journey at the same time (2 more threads by worker)")
+        ("GENERAL.raptor_cache_warm_up_days", po::value<int>()->default_value(0),
+                                              "number of days of raptor cache built before using a new data")
+        ("GENERAL.raptor_cache_warm_up_rt_levels",
+         po::value<std::vector<std::string>>()->default_value({"theoric"}, "theoric")->composing(),
+         "realtime levels of the raptor cache warm up (theoric, adapted or realtime)")
+        ("GENERAL.raptor_cache_warm_up_wheelchair", po::value<bool>()->default_value(false),
+                                                   "also warm up the raptor cache of the wheelchair requests")
+        ("GENERAL.raptor_cache_warm_up_threads", po::value<int>()->default_value(1),
+                                                 "number of long lived threads of the raptor cache warm up, each one building an entry at a time")
+        ("GENERAL.metrics_file", po::value<std::string>(),
+                                 "file where the request metrics are written on SIGUSR1 (logged if not set)")
 
         ("BROKER.host", po::value<std::string>()->default_value("localhost"), "host of rabbitmq")
         ("BROKER.port", po::value<int>()->default_value(5672), "port of rabbitmq")
@@ -119,6 +138,13 @@ boost::optional<std::string> Configuration::chaos_database() const{
     }
     return result;
 }
+boost::optional<std::string> Configuration::metrics_file() const{
+    boost::optional<std::string> result;
+    if (this->vm.count("GENERAL.metrics_file") > 0) {
+        result = this->vm["GENERAL.metrics_file"].as<std::string>();
+    }
+    return result;
+}
 int Configuration::nb_threads() const{
     int nb_threads = vm["GENERAL.nb_threads"].as<int>();
     if (nb_threads < 0) {
@@ -190,4 +216,76 @@ size_t Configuration::raptor_cache_size() const{
     }
     return size_t(raptor_cache_size);
 }
+
+size_t Configuration::raptor_snd_pass_threads() const{
+    if (! vm.count("GENERAL.raptor_snd_pass_threads")) {
+        return 1;
+    }
+    int nb_threads = vm["GENERAL.raptor_snd_pass_threads"].as<int>();
+    if (nb_threads < 1) {
+        throw std::invalid_argument("raptor_snd_pass_threads must be strictly positive");
+    }
+    return size_t(nb_threads);
+}
+
+size_t Configuration::street_network_matrix_threads() const{
+    if (! vm.count("GENERAL.street_network_matrix_threads")) {
+        return 1;
+    }
+    int nb_threads = vm["GENERAL.street_network_matrix_threads"].as<int>();
+    if (nb_threads < 1) {
+        throw std::invalid_argument("street_network_matrix_threads must be strictly positive");
+    }
+    return size_t(nb_threads);
+}
+
+size_t Configuration::raptor_cache_warm_up_days() const{
+    if (! vm.count("GENERAL.raptor_cache_warm_up_days")) {
+        return 0;
+    }
+    int nb_days = vm["GENERAL.raptor_cache_warm_up_days"].as<int>();
+    if (nb_days < 0) {
+        throw std::invalid_argument("raptor_cache_warm_up_days cannot be negative");
+    }
+    return size_t(nb_days);
+}
+
+std::vector<std::string> Configuration::raptor_cache_warm_up_rt_levels() const{
+    if (! vm.count("GENERAL.raptor_cache_warm_up_rt_levels")) {
+        return {"theoric"};
+    }
+    return vm["GENERAL.raptor_cache_warm_up_rt_levels"].as<std::vector<std::string>>();
+}
+
+bool Configuration::raptor_cache_warm_up_wheelchair() const{
+    if (! vm.count("GENERAL.raptor_cache_warm_up_wheelchair")) {
+        return false;
+    }
+    return vm["GENERAL.raptor_cache_warm_up_wheelchair"].as<bool>();
+}
+
+size_t Configuration::raptor_cache_warm_up_threads() const{
+    if (! vm.count("GENERAL.raptor_cache_warm_up_threads")) {
+        return 1;
+    }
+    int nb_threads = vm["GENERAL.raptor_cache_warm_up_threads"].as<int>();
+    if (nb_threads < 1) {
+        throw std::invalid_argument("raptor_cache_warm_up_threads must be strictly positive");
+    }
+    return size_t(nb_threads);
+}
+
+bool Configuration::trip_based_engine() const{
+    if (! vm.count("GENERAL.trip_based_engine")) {
+        return false;
+    }
+    return vm["GENERAL.trip_based_engine"].as<bool>();
+}
+
+bool Configuration::concurrent_street_network() const{
+    if (! vm.count("GENERAL.concurrent_street_network")) {
+        return false;
+    }
+    return vm["GENERAL.concurrent_street_network"].as<bool>();
+}
 }}//namespace
@@ -45,6 +45,7 @@ namespace navitia { namespace kraken{
             std::string zmq_socket_path() const;
             std::string instance_name() const;
             boost::optional<std::string> chaos_database() const;
+            boost::optional<std::string> metrics_file() const;
             int nb_threads() const;
 
             std::string broker_host() const;
@@ -60,6 +61,14 @@ namespace navitia { namespace kraken{
             int kirin_retry_timeout() const;
             bool display_contributors() const;
             size_t raptor_cache_size() const;
+            size_t raptor_snd_pass_threads() const;
+            size_t street_network_matrix_threads() const;
+            bool trip_based_engine() const;
+            bool concurrent_street_network() const;
+            size_t raptor_cache_warm_up_days() const;
+            std::vector<std::string> raptor_cache_warm_up_rt_levels() const;
+            bool raptor_cache_warm_up_wheelchair() const;
+            size_t raptor_cache_warm_up_threads() const;
 
             std::vector<std::string> rt_topics() const;
     };
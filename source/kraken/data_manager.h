@@ -40,6 +40,8 @@ www.navitia.io
 #include <memory>
 #include <iostream>
 #include <atomic>
+#include <chrono>
+#include <functional>
 #include <boost/make_shared.hpp>
 #include <boost/optional.hpp>
 
@@ -88,14 +90,21 @@ public:
         return std::move(data);
     }
 
+    // prepare is called on the loaded data before it is used, for
+    // example to build the optional data or to warm up the caches.  It
+    // adds the phases it times to the load timings of the data.
     bool load(const std::string& database,
               const boost::optional<std::string>& chaos_database = boost::none,
-              const std::vector<std::string>& contributors = {}){
+              const std::vector<std::string>& contributors = {},
+              const std::function<void(Data&)>& prepare = {}){
         bool success;
         ++ data_identifier;
         auto data = create_data(data_identifier.load());
         success = data->load(database, chaos_database, contributors);
         if (success) {
+            if (prepare) { prepare(*data); }
+            // the timings of the previous loads are kept
+            data->keep_load_timings(*current_data);
             set_data(std::move(data));
         }
         return success;
@@ -33,15 +33,60 @@ www.navitia.io
 #include <google/protobuf/descriptor.h>
 
 #include <boost/thread.hpp>
+#include <csignal>
+#include <cstdio>
+#include <fstream>
 #include <functional>
+#include <sstream>
 #include <string>
 #include <iostream>
+#include <pthread.h>
 #include "utils/init.h"
 #include "kraken_zmq.h"
 #include "utils/zmq.h"
 
+// Writes the metrics each time SIGUSR1 is received, SIGUSR1 must be
+// blocked in all the threads.
+static void dump_metrics_on_signal(const navitia::kraken::Metrics& metrics,
+                                   const boost::optional<std::string>& metrics_file) {
+    auto logger = log4cplus::Logger::getInstance("metrics");
+    sigset_t sigset;
+    sigemptyset(&sigset);
+    sigaddset(&sigset, SIGUSR1);
+    const auto api_name = [](size_t api) { return API_Name(pbnavitia::API(api)); };
+    while (true) {
+        int sig;
+        if (sigwait(&sigset, &sig) != 0) { continue; }
+        if (! metrics_file) {
+            std::stringstream ss;
+            metrics.dump(ss, api_name);
+            LOG4CPLUS_INFO(logger, "request metrics:\n" << ss.str());
+            continue;
+        }
+        // written aside then renamed, a reader never sees a partial file
+        const auto tmp_file = *metrics_file + ".tmp";
+        {
+            std::ofstream os(tmp_file);
+            metrics.dump(os, api_name);
+            if (! os) {
+                LOG4CPLUS_ERROR(logger, "impossible to write the metrics in " << tmp_file);
+                continue;
+            }
+        }
+        if (std::rename(tmp_file.c_str(), metrics_file->c_str()) != 0) {
+            LOG4CPLUS_ERROR(logger, "impossible to write the metrics in " << *metrics_file);
+        }
+    }
+}
 
 int main(int argn, char** argv){
+    // SIGUSR1 is handled by the thread dumping the metrics, it is blocked
+    // before any thread is created to be inherited by all of them
+    sigset_t sigset;
+    sigemptyset(&sigset);
+    sigaddset(&sigset, SIGUSR1);
+    pthread_sigmask(SIG_BLOCK, &sigset, nullptr);
+
     navitia::init_app();
     navitia::kraken::Configuration conf;
 
@@ -66,6 +111,7 @@ int main(int argn, char** argv){
     init_logger(conf_file);
 
     DataManager<navitia::type::Data> data_manager;
+    navitia::kraken::Metrics metrics(pbnavitia::API_ARRAYSIZE);
 
     auto logger = log4cplus::Logger::getInstance("startup");
     LOG4CPLUS_INFO(logger, "starting kraken: " << navitia::config::project_version);
@@ -84,12 +130,13 @@ int main(int argn, char** argv){
     }
 
     threads.create_thread(navitia::MaintenanceWorker(data_manager, conf));
+    threads.create_thread(std::bind(&dump_metrics_on_signal, std::cref(metrics), conf.metrics_file()));
 
     int nb_threads = conf.nb_threads();
     // Launch pool of worker threads
     LOG4CPLUS_INFO(logger, "starting workers threads");
     for(int thread_nbr = 0; thread_nbr < nb_threads; ++thread_nbr) {
-        threads.create_thread(std::bind(&doWork, std::ref(context), std::ref(data_manager), conf));
+        threads.create_thread(std::bind(&doWork, std::ref(context), std::ref(data_manager), conf, std::ref(metrics)));
     }
 
     // Connect worker threads to client threads via a queue
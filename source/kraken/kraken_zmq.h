@@ -36,8 +36,10 @@ www.navitia.io
 #include <utils/zmq.h>
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include "kraken/configuration.h"
+#include "kraken/metrics.h"
 #include "type/meta_data.h"
 #include <log4cplus/ndc.h>
+#include <chrono>
 
 inline pbnavitia::Response make_internal_error(const std::exception& e) {
     pbnavitia::Response response;
@@ -51,13 +53,15 @@ inline pbnavitia::Response make_internal_error(const std::exception& e) {
 namespace pt = boost::posix_time;
 inline void doWork(zmq::context_t& context,
                    DataManager<navitia::type::Data>& data_manager,
-                   navitia::kraken::Configuration conf) {
+                   navitia::kraken::Configuration conf,
+                   navitia::kraken::Metrics& metrics) {
     auto logger = log4cplus::Logger::getInstance("worker");
+    auto& thread_metrics = metrics.register_thread();
 
     zmq::socket_t socket (context, ZMQ_REQ);
     socket.connect("inproc://workers");
     bool run = true;
-    navitia::Worker w(data_manager, conf);
+    navitia::Worker w(data_manager, conf, &metrics);
     z_send(socket, "READY");
     while(run) {
         std::string address = z_recv(socket);
@@ -76,7 +80,7 @@ inline void doWork(zmq::context_t& context,
 
         pbnavitia::Request pb_req;
         pbnavitia::Response result;
-        pt::ptime start = pt::microsec_clock::universal_time();
+        const auto start = std::chrono::steady_clock::now();
         pbnavitia::API api = pbnavitia::UNKNOWN_API;
         if(!pb_req.ParseFromArray(request.data(), request.size())){
             LOG4CPLUS_WARN(logger, "receive invalid protobuf");
@@ -115,13 +119,17 @@ inline void doWork(zmq::context_t& context,
             result.SerializeToArray(reply.data(), result.ByteSize());
 
         }
+        // the message is emptied by the send
+        const size_t response_bytes = reply.size();
         z_send(socket, address, ZMQ_SNDMORE);
         z_send(socket, "", ZMQ_SNDMORE);
         socket.send(reply);
 
+        const auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - start);
+        thread_metrics.record(api, duration, result.has_error(), response_bytes);
         if(api != pbnavitia::METADATAS){
-            LOG4CPLUS_DEBUG(logger, "processing time : "
-                            << (pt::microsec_clock::universal_time() - start).total_milliseconds());
+            LOG4CPLUS_DEBUG(logger, "processing time : " << duration.count() / 1000);
         }
     }
 }
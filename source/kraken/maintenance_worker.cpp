@@ -35,12 +35,15 @@ www.navitia.io
 #include "realtime.h"
 #include "type/task.pb.h"
 #include "type/pt_data.h"
+#include "type/meta_data.h"
+#include "routing/dataraptor.h"
 #include <boost/algorithm/string/join.hpp>
 #include <boost/optional.hpp>
 #include <sys/stat.h>
 #include <signal.h>
 #include <SimpleAmqpClient/Envelope.h>
 #include <chrono>
+#include <memory>
 #include <thread>
 #include "utils/get_hostname.h"
 
@@ -52,15 +55,88 @@ namespace bg = boost::gregorian;
 namespace navitia {
 
 
+// The next stop time caches of the first days, from today.  Returns
+// false if there is nothing to warm up.
+static bool make_warm_up_policy(const kraken::Configuration& conf,
+                                const type::Data& data,
+                                routing::NextStopTimeWarmUp& policy,
+                                DateTime& from) {
+    if (! data.loaded || conf.raptor_cache_warm_up_days() == 0) { return false; }
+    const auto today = boost::gregorian::day_clock::universal_day();
+    if (! data.meta->production_date.contains(today)) { return false; }
+
+    policy.nb_days = conf.raptor_cache_warm_up_days();
+    policy.rt_levels.clear();
+    for (const auto& level: conf.raptor_cache_warm_up_rt_levels()) {
+        policy.rt_levels.push_back(type::get_rt_level_from_string(level));
+    }
+    if (conf.raptor_cache_warm_up_wheelchair()) {
+        type::AccessibiliteParams wheelchair;
+        wheelchair.properties.set(type::hasProperties::WHEELCHAIR_BOARDING, true);
+        wheelchair.vehicle_properties.set(type::hasVehicleProperties::WHEELCHAIR_ACCESSIBLE, true);
+        policy.accessibilities.push_back(wheelchair);
+    }
+    const auto day = (today - data.meta->production_date.begin()).days();
+    from = DateTimeUtils::set(day, 0);
+    return true;
+}
+
+// The caches are warmed up once the data is used, thus the workers
+// don't wait for the warm up.  The first requests may build the same
+// entries meanwhile, the cache building each entry only once.
+void MaintenanceWorker::warm_up_caches(const boost::shared_ptr<const type::Data>& data) {
+    // the warm up of the previous data is useless
+    if (! warm_up_tasks.empty()) {
+        *warm_up_cancelled = true;
+        for (auto& task: warm_up_tasks) { task.wait(); }
+        warm_up_tasks.clear();
+    }
+    routing::NextStopTimeWarmUp policy;
+    DateTime from;
+    if (! make_warm_up_policy(conf, *data, policy, from)) { return; }
+
+    warm_up_cancelled = std::make_shared<std::atomic<bool>>(false);
+    policy.cancelled = warm_up_cancelled;
+    const auto logger = this->logger;
+    // each thread of the pool builds the entries not taken by the others
+    for (size_t i = 0; i < warm_up_pool->size(); ++i) {
+        warm_up_tasks.push_back(warm_up_pool->submit([data, policy, from, logger] {
+            try {
+                data->dataRaptor->cached_next_st_manager->warm_up(from, policy);
+            } catch (const std::exception& e) {
+                LOG4CPLUS_WARN(logger, "raptor cache warm up failed: " << e.what());
+            }
+        }));
+    }
+}
+
+// The transfers of the trip based engine, only if it is enabled
+static void build_trip_transfers(const kraken::Configuration& conf, type::Data& data) {
+    if (! data.loaded || ! conf.trip_based_engine()) { return; }
+    data.dataRaptor->load_trip_transfers(*data.pt_data);
+}
+
+// f timed as the load phase of data
+template<typename F>
+static void time_load_phase(type::Data& data, const std::string& phase, const F& f) {
+    const auto start = std::chrono::steady_clock::now();
+    f();
+    data.add_load_phase(phase, std::chrono::steady_clock::now() - start);
+}
+
 void MaintenanceWorker::load(){
     const std::string database = conf.databases_path();
     auto chaos_database = conf.chaos_database();
     auto contributors = conf.rt_topics();
     LOG4CPLUS_INFO(logger, "Loading database from file: " + database);
-    if(this->data_manager.load(database, chaos_database, contributors)){
+    const auto prepare = [&](type::Data& data) {
+        time_load_phase(data, "raptor.trip_transfers", [&] { build_trip_transfers(conf, data); });
+    };
+    if(this->data_manager.load(database, chaos_database, contributors, prepare)){
         auto data = data_manager.get_data();
         data->is_realtime_loaded = false;
         data->meta->instance_name = conf.instance_name();
+        warm_up_caches(data);
     }
     load_realtime();
 }
@@ -158,6 +234,9 @@ void MaintenanceWorker::handle_task_in_batch(const std::vector<AmqpClient::Envel
 
 void MaintenanceWorker::handle_rt_in_batch(const std::vector<AmqpClient::Envelope::ptr_t>& envelopes){
     boost::shared_ptr<nt::Data> data{};
+    // the data cloned, its raptor data is updated instead of built again
+    boost::shared_ptr<const nt::Data> previous_data{};
+    std::unique_ptr<nt::LoadTimer> timer;
     for (auto& envelope: envelopes) {
         LOG4CPLUS_DEBUG(logger, "realtime info received!");
         assert(envelope);
@@ -169,9 +248,12 @@ void MaintenanceWorker::handle_rt_in_batch(const std::vector<AmqpClient::Envelop
         LOG4CPLUS_TRACE(logger, "received entity: " << feed_message.DebugString());
         for(const auto& entity: feed_message.entity()){
             if (!data) {
-                data = data_manager.get_data_clone();
+                timer = std::make_unique<nt::LoadTimer>("realtime");
+                previous_data = data_manager.get_data();
+                data = timer->time("clone", [&] { return data_manager.get_data_clone(); });
                 data->last_rt_data_loaded = pt::microsec_clock::universal_time();
             }
+            const auto start = std::chrono::steady_clock::now();
             if (entity.is_deleted()) {
                 LOG4CPLUS_DEBUG(logger, "deletion of disruption " << entity.id());
                 delete_disruption(entity.id(), *data->pt_data, *data->meta);
@@ -187,12 +269,17 @@ void MaintenanceWorker::handle_rt_in_batch(const std::vector<AmqpClient::Envelop
             } else {
                 LOG4CPLUS_WARN(logger, "unsupported gtfs rt feed");
             }
+            timer->add("apply_entities", std::chrono::steady_clock::now() - start);
         }
     }
     if (data) {
         LOG4CPLUS_INFO(logger, "rebuilding data raptor");
-        data->build_raptor(conf.raptor_cache_size());
+        data->build_raptor_from(*previous_data, conf.raptor_cache_size(), timer.get());
+        // shared with previous_data while the base level is not modified
+        timer->time("raptor.trip_transfers", [&] { build_trip_transfers(conf, *data); });
+        data->add_load_timings(timer->finish());
         data_manager.set_data(std::move(data));
+        warm_up_caches(data_manager.get_data());
         LOG4CPLUS_INFO(logger, "data updated");
     }
 }
@@ -313,7 +400,8 @@ MaintenanceWorker::MaintenanceWorker(DataManager<type::Data>& data_manager, krak
         data_manager(data_manager),
         logger(log4cplus::Logger::getInstance(LOG4CPLUS_TEXT("background"))),
         conf(conf),
-        next_try_realtime_loading(pt::microsec_clock::universal_time()){
+        next_try_realtime_loading(pt::microsec_clock::universal_time()),
+        warm_up_pool(std::make_unique<routing::ThreadPool>(conf.raptor_cache_warm_up_threads())){
     try{
         this->init_rabbitmq();
     }catch(const std::runtime_error& ex){
@@ -34,7 +34,10 @@ www.navitia.io
 #include "type/data.h"
 #include "kraken/data_manager.h"
 #include "kraken/configuration.h"
+#include "routing/thread_pool.h"
 
+#include <atomic>
+#include <future>
 #include <memory>
 
 
@@ -53,6 +56,13 @@ class MaintenanceWorker{
 
         boost::posix_time::ptime next_try_realtime_loading;
 
+        // the warm up of the caches of the current data, run in background
+        // by the threads of warm_up_pool
+        std::unique_ptr<routing::ThreadPool> warm_up_pool;
+        std::vector<std::future<void>> warm_up_tasks;
+        std::shared_ptr<std::atomic<bool>> warm_up_cancelled;
+        void warm_up_caches(const boost::shared_ptr<const type::Data>& data);
+
         void init_rabbitmq();
         void listen_rabbitmq();
 
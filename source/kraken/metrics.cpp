@@ -0,0 +1,182 @@
+/* Copyright © 2001-2016, Canal TP and/or its affiliates. All rights reserved.
+
+This file is part of Navitia,
+    the software to build cool stuff with public transport.
+
+Hope you'll enjoy and contribute to this project,
+    powered by Canal TP (www.canaltp.fr).
+Help us simplify mobility and open public transport:
+    a non ending quest to the responsive locomotion way of traveling!
+
+LICENCE: This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Affero General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+Stay tuned using
+twitter @navitia
+IRC #navitia on freenode
+https://groups.google.com/d/forum/navitia
+www.navitia.io
+*/
+
+#include "kraken/metrics.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace navitia { namespace kraken {
+
+size_t Histogram::bucket_of(uint64_t value) {
+    value = std::min(value, (uint64_t(1) << 40) - 1);
+    if (value < sub_buckets) {
+        return value;
+    }
+    // the 4 bits after the most significant one select the sub bucket
+    const size_t shift = 63 - __builtin_clzll(value) - 4;
+    return shift * sub_buckets + (value >> shift);
+}
+
+uint64_t Histogram::lowest_of(size_t bucket) {
+    if (bucket < sub_buckets) {
+        return bucket;
+    }
+    const size_t shift = bucket / sub_buckets - 1;
+    return (bucket % sub_buckets + sub_buckets) << shift;
+}
+
+uint64_t Histogram::highest_of(size_t bucket) {
+    if (bucket < sub_buckets) {
+        return bucket;
+    }
+    const size_t shift = bucket / sub_buckets - 1;
+    return ((bucket % sub_buckets + sub_buckets + 1) << shift) - 1;
+}
+
+void Histogram::record(uint64_t value) {
+    // only one writer: no need of a read-modify-write
+    auto& count = counts[bucket_of(value)];
+    count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    sum.store(sum.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    if (value > max.load(std::memory_order_relaxed)) {
+        max.store(value, std::memory_order_relaxed);
+    }
+}
+
+void HistogramSnapshot::merge(const Histogram& histogram) {
+    for (size_t i = 0; i < Histogram::nb_buckets; ++i) {
+        const auto c = histogram.counts[i].load(std::memory_order_relaxed);
+        counts[i] += c;
+        count += c;
+    }
+    sum += histogram.sum.load(std::memory_order_relaxed);
+    max = std::max(max, histogram.max.load(std::memory_order_relaxed));
+}
+
+uint64_t HistogramSnapshot::percentile(double q) const {
+    if (count == 0) {
+        return 0;
+    }
+    const auto rank = std::max(uint64_t(1), uint64_t(std::ceil(q * count)));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < counts.size(); ++i) {
+        seen += counts[i];
+        if (seen >= rank) {
+            return std::min(Histogram::highest_of(i), max);
+        }
+    }
+    return max;
+}
+
+ThreadMetrics::ThreadMetrics(size_t nb_apis) {
+    for (size_t i = 0; i < nb_apis; ++i) {
+        apis.push_back(std::make_unique<ApiMetrics>());
+    }
+}
+
+void ThreadMetrics::record(size_t api, std::chrono::microseconds latency, bool error, size_t response_bytes) {
+    if (api >= apis.size()) {
+        return;
+    }
+    auto& m = *apis[api];
+    const auto incr = [](std::atomic<uint64_t>& counter, uint64_t value) {
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    };
+    m.latency.record(std::max(latency.count(), std::chrono::microseconds::rep(0)));
+    incr(m.nb_requests, 1);
+    if (error) {
+        incr(m.nb_errors, 1);
+    }
+    incr(m.response_bytes, response_bytes);
+}
+
+Metrics::Metrics(size_t nb_apis): nb_apis(nb_apis) {}
+
+ThreadMetrics& Metrics::register_thread() {
+    std::lock_guard<std::mutex> lock(mutex);
+    threads.push_back(std::make_unique<ThreadMetrics>(nb_apis));
+    return *threads.back();
+}
+
+std::vector<Metrics::Api> Metrics::snapshot() const {
+    std::vector<Api> res;
+    std::lock_guard<std::mutex> lock(mutex);
+    for (size_t api = 0; api < nb_apis; ++api) {
+        Api merged;
+        merged.api = api;
+        for (const auto& thread: threads) {
+            const auto& m = *thread->apis[api];
+            merged.latency.merge(m.latency);
+            merged.nb_requests += m.nb_requests.load(std::memory_order_relaxed);
+            merged.nb_errors += m.nb_errors.load(std::memory_order_relaxed);
+            merged.response_bytes += m.response_bytes.load(std::memory_order_relaxed);
+        }
+        if (merged.nb_requests != 0) {
+            res.push_back(std::move(merged));
+        }
+    }
+    return res;
+}
+
+void Metrics::dump(std::ostream& os, const std::function<std::string(size_t)>& api_name) const {
+    const auto apis = snapshot();
+    const auto uptime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start);
+
+    os << "# HELP kraken_uptime_seconds time since the start of the workers\n"
+       << "# TYPE kraken_uptime_seconds gauge\n"
+       << "kraken_uptime_seconds " << uptime.count() << "\n";
+
+    const auto counter = [&](const std::string& name, const std::string& help,
+                             uint64_t Api::* field) {
+        os << "# HELP " << name << " " << help << "\n"
+           << "# TYPE " << name << " counter\n";
+        for (const auto& a: apis) {
+            os << name << "{api=\"" << api_name(a.api) << "\"} " << a.*field << "\n";
+        }
+    };
+    counter("kraken_requests_total", "number of handled requests", &Api::nb_requests);
+    counter("kraken_request_errors_total", "number of responses with an error", &Api::nb_errors);
+    counter("kraken_response_bytes_total", "size of the serialized responses", &Api::response_bytes);
+
+    os << "# HELP kraken_request_duration_seconds processing time of the requests\n"
+       << "# TYPE kraken_request_duration_seconds summary\n";
+    for (const auto& a: apis) {
+        const auto name = api_name(a.api);
+        for (const double q: {0.5, 0.9, 0.99, 1.}) {
+            os << "kraken_request_duration_seconds{api=\"" << name << "\",quantile=\"" << q << "\"} "
+               << a.latency.percentile(q) / 1e6 << "\n";
+        }
+        os << "kraken_request_duration_seconds_sum{api=\"" << name << "\"} " << a.latency.sum / 1e6 << "\n"
+           << "kraken_request_duration_seconds_count{api=\"" << name << "\"} " << a.latency.count << "\n";
+    }
+}
+
+}} // namespace navitia::kraken
@@ -0,0 +1,143 @@
+/* Copyright © 2001-2016, Canal TP and/or its affiliates. All rights reserved.
+
+This file is part of Navitia,
+    the software to build cool stuff with public transport.
+
+Hope you'll enjoy and contribute to this project,
+    powered by Canal TP (www.canaltp.fr).
+Help us simplify mobility and open public transport:
+    a non ending quest to the responsive locomotion way of traveling!
+
+LICENCE: This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Affero General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+Stay tuned using
+twitter @navitia
+IRC #navitia on freenode
+https://groups.google.com/d/forum/navitia
+www.navitia.io
+*/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace navitia { namespace kraken {
+
+/** Histogram of durations in microseconds, with a bounded relative error
+ *
+ * As in a HDR histogram, each power of two is split in 16 buckets, thus
+ * a value is known with a precision of 1/16 whatever its magnitude.
+ * The values below 16µs are exact and the values above ~12 days are
+ * counted in the last bucket.
+ *
+ * There must be only one writer (the thread owning the histogram), but
+ * it can be read at any time from another thread without lock.
+ */
+class Histogram {
+public:
+    static const size_t sub_buckets = 16;
+    static const size_t nb_buckets = 37 * sub_buckets; // up to 2^40µs
+
+    static size_t bucket_of(uint64_t value);
+    /// the smallest and the greatest value counted in the bucket
+    static uint64_t lowest_of(size_t bucket);
+    static uint64_t highest_of(size_t bucket);
+
+    void record(uint64_t value);
+
+private:
+    friend struct HistogramSnapshot;
+    std::array<std::atomic<uint64_t>, nb_buckets> counts = {};
+    std::atomic<uint64_t> sum{0};
+    std::atomic<uint64_t> max{0};
+};
+
+/// A copy of one or several merged histograms
+struct HistogramSnapshot {
+    std::vector<uint64_t> counts = std::vector<uint64_t>(Histogram::nb_buckets, 0);
+    uint64_t count = 0;
+    uint64_t sum = 0;
+    uint64_t max = 0;
+
+    void merge(const Histogram&);
+    /// the value under which are the proportion q of the recorded
+    /// values, rounded up to the end of its bucket
+    uint64_t percentile(double q) const;
+};
+
+/// The counters of one API
+struct ApiMetrics {
+    Histogram latency; // in µs, from the reception to the send of the response
+    std::atomic<uint64_t> nb_requests{0};
+    std::atomic<uint64_t> nb_errors{0};
+    std::atomic<uint64_t> response_bytes{0};
+};
+
+/// The counters of the requests handled by one worker thread
+class ThreadMetrics {
+public:
+    explicit ThreadMetrics(size_t nb_apis);
+
+    /// to be called only by the thread owning these metrics
+    void record(size_t api, std::chrono::microseconds latency, bool error, size_t response_bytes);
+
+private:
+    friend class Metrics;
+    std::vector<std::unique_ptr<ApiMetrics>> apis;
+};
+
+/** Metrics of the requests handled by kraken, by API
+ *
+ * Each worker thread records its requests in its own ThreadMetrics,
+ * without contention; they are merged only when the metrics are read.
+ */
+class Metrics {
+public:
+    struct Api {
+        size_t api;
+        HistogramSnapshot latency;
+        uint64_t nb_requests = 0;
+        uint64_t nb_errors = 0;
+        uint64_t response_bytes = 0;
+    };
+
+    /// nb_apis: the requested apis are in [0, nb_apis)
+    explicit Metrics(size_t nb_apis);
+
+    /// the metrics of a new worker thread, valid as long as this object
+    ThreadMetrics& register_thread();
+
+    /// the merged metrics of the apis having received requests
+    std::vector<Api> snapshot() const;
+
+    /// text exposition of the metrics, in the prometheus format
+    void dump(std::ostream& os, const std::function<std::string(size_t)>& api_name) const;
+
+private:
+    const size_t nb_apis;
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::vector<std::unique_ptr<ThreadMetrics>> threads;
+    mutable std::mutex mutex;
+};
+
+}} // namespace navitia::kraken
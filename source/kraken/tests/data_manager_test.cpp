@@ -35,6 +35,8 @@ www.navitia.io
 
 #include "kraken/data_manager.h"
 #include <atomic>
+#include <chrono>
+#include <vector>
 
 //mock of navitia::type::Data class
 class Data{
@@ -42,8 +44,14 @@ class Data{
         bool load(const std::string&,
                   const boost::optional<std::string>&,
                   const std::vector<std::string>&) {
+            if (load_status) { load_timings.push_back(data_identifier); }
             return load_status;
         }
+        std::vector<size_t> load_timings;
+        void add_load_phase(const std::string&, std::chrono::steady_clock::duration) {}
+        void keep_load_timings(const Data& previous) {
+            load_timings.insert(load_timings.begin(), previous.load_timings.begin(), previous.load_timings.end());
+        }
         mutable std::atomic<bool> is_connected_to_rabbitmq;
         static bool load_status;
         static bool destructor_called;
@@ -95,6 +103,18 @@ BOOST_AUTO_TEST_CASE(load_fail){
     BOOST_CHECK_EQUAL(first_data, second_data);
 }
 
+BOOST_AUTO_TEST_CASE(load_timings_kept){
+    DataManager<Data> data_manager;
+    BOOST_CHECK(data_manager.load(""));
+    BOOST_CHECK(data_manager.load(""));
+    Data::load_status = false;
+    BOOST_CHECK(! data_manager.load(""));
+    const auto data = data_manager.get_data();
+    const std::vector<size_t> expected = {1, 2};
+    BOOST_CHECK_EQUAL_COLLECTIONS(data->load_timings.begin(), data->load_timings.end(),
+                                  expected.begin(), expected.end());
+}
+
 BOOST_AUTO_TEST_CASE(destructor_called){
     DataManager<Data> data_manager;
     {
@@ -0,0 +1,119 @@
+/* Copyright © 2001-2016, Canal TP and/or its affiliates. All rights reserved.
+
+This file is part of Navitia,
+    the software to build cool stuff with public transport.
+
+Hope you'll enjoy and contribute to this project,
+    powered by Canal TP (www.canaltp.fr).
+Help us simplify mobility and open public transport:
+    a non ending quest to the responsive locomotion way of traveling!
+
+LICENCE: This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Affero General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+Stay tuned using
+twitter @navitia
+IRC #navitia on freenode
+https://groups.google.com/d/forum/navitia
+www.navitia.io
+*/
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE metrics_test
+#include <boost/test/unit_test.hpp>
+
+#include "kraken/metrics.h"
+#include <sstream>
+#include <thread>
+
+using navitia::kraken::Histogram;
+using navitia::kraken::HistogramSnapshot;
+using navitia::kraken::Metrics;
+using std::chrono::microseconds;
+
+BOOST_AUTO_TEST_CASE(histogram_buckets) {
+    // exact under 16µs, then 16 buckets by power of two
+    BOOST_CHECK_EQUAL(Histogram::bucket_of(0), 0);
+    BOOST_CHECK_EQUAL(Histogram::bucket_of(15), 15);
+    BOOST_CHECK_EQUAL(Histogram::bucket_of(16), 16);
+    BOOST_CHECK_EQUAL(Histogram::bucket_of(31), 31);
+    BOOST_CHECK_EQUAL(Histogram::bucket_of(32), 32);
+    BOOST_CHECK_EQUAL(Histogram::bucket_of(33), 32);
+    BOOST_CHECK_EQUAL(Histogram::bucket_of(uint64_t(-1)), Histogram::nb_buckets - 1);
+
+    for (size_t b = 0; b < Histogram::nb_buckets; ++b) {
+        BOOST_CHECK_EQUAL(Histogram::bucket_of(Histogram::lowest_of(b)), b);
+        BOOST_CHECK_EQUAL(Histogram::bucket_of(Histogram::highest_of(b)), b);
+        if (b + 1 < Histogram::nb_buckets) {
+            BOOST_CHECK_EQUAL(Histogram::highest_of(b) + 1, Histogram::lowest_of(b + 1));
+        }
+        // relative precision of 1/16
+        BOOST_CHECK_LE(Histogram::highest_of(b) - Histogram::lowest_of(b), Histogram::lowest_of(b) / 16);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(histogram_percentiles) {
+    Histogram h;
+    for (uint64_t v = 1; v <= 1000; ++v) {
+        h.record(v * 1000);
+    }
+    HistogramSnapshot s;
+    s.merge(h);
+    BOOST_CHECK_EQUAL(s.count, 1000);
+    BOOST_CHECK_EQUAL(s.max, 1000000);
+    BOOST_CHECK_EQUAL(s.sum, 500500000);
+    for (const double q: {0.01, 0.5, 0.9, 0.99}) {
+        const auto p = s.percentile(q);
+        BOOST_CHECK_GE(p, q * 1000000);
+        BOOST_CHECK_LE(p, q * 1000000 * 17 / 16);
+    }
+    BOOST_CHECK_EQUAL(s.percentile(1), 1000000);
+    BOOST_CHECK_EQUAL(HistogramSnapshot().percentile(0.5), 0);
+}
+
+BOOST_AUTO_TEST_CASE(metrics_merged_by_api) {
+    Metrics metrics(3);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < 4; ++i) {
+        auto& thread_metrics = metrics.register_thread();
+        threads.emplace_back([&thread_metrics]() {
+            for (size_t n = 0; n < 1000; ++n) {
+                thread_metrics.record(1, microseconds(100), n % 10 == 0, 50);
+                thread_metrics.record(2, microseconds(2000), false, 10);
+            }
+            thread_metrics.record(42, microseconds(1), false, 1); // unknown api: ignored
+        });
+    }
+    for (auto& t: threads) { t.join(); }
+
+    const auto apis = metrics.snapshot();
+    BOOST_REQUIRE_EQUAL(apis.size(), 2);
+    BOOST_CHECK_EQUAL(apis[0].api, 1);
+    BOOST_CHECK_EQUAL(apis[0].nb_requests, 4000);
+    BOOST_CHECK_EQUAL(apis[0].nb_errors, 400);
+    BOOST_CHECK_EQUAL(apis[0].response_bytes, 200000);
+    BOOST_CHECK_EQUAL(apis[0].latency.count, 4000);
+    BOOST_CHECK_EQUAL(apis[0].latency.percentile(0.5), 100);
+    BOOST_CHECK_EQUAL(apis[1].api, 2);
+    BOOST_CHECK_EQUAL(apis[1].nb_errors, 0);
+    BOOST_CHECK_EQUAL(apis[1].latency.max, 2000);
+
+    std::stringstream ss;
+    metrics.dump(ss, [](size_t api) { return "api_" + std::to_string(api); });
+    const auto dump = ss.str();
+    BOOST_CHECK(dump.find("kraken_requests_total{api=\"api_1\"} 4000\n") != std::string::npos);
+    BOOST_CHECK(dump.find("kraken_request_errors_total{api=\"api_1\"} 400\n") != std::string::npos);
+    BOOST_CHECK(dump.find("kraken_request_duration_seconds{api=\"api_2\",quantile=\"0.99\"} 0.002\n")
+                != std::string::npos);
+    BOOST_CHECK(dump.find("api_0") == std::string::npos);
+}
@@ -1566,3 +1566,71 @@ BOOST_AUTO_TEST_CASE(unknown_stop_point) {
 
 }
 
+
+/*
+ * The raptor data updated from the one of the data before the realtime
+ * messages must give the same journeys as the one built from scratch.
+ */
+BOOST_AUTO_TEST_CASE(incremental_raptor_update) {
+    ed::builder b("20150928");
+    b.vj("A", "111111", "", true, "vj:A:1")("stop1", "08:00"_t)("stop2", "09:00"_t)("stop3", "10:00"_t);
+    b.vj("A", "111111", "", true, "vj:A:2")("stop1", "09:00"_t)("stop2", "10:00"_t)("stop3", "11:00"_t);
+    b.vj("B", "111111", "", true, "vj:B:1")("stop2", "09:30"_t)("stop4", "10:30"_t);
+    b.vj("C", "111111", "", true, "vj:C:1")("stop1", "08:30"_t)("stop4", "11:30"_t);
+    b.data->pt_data->index();
+    b.finish();
+    b.data->build_raptor();
+    b.data->build_uri();
+
+    // the same realtime messages are applied on two snapshots of the data
+    auto full = std::make_unique<nt::Data>();
+    auto incremental = std::make_unique<nt::Data>();
+    full->clone_from(*b.data);
+    incremental->clone_from(*b.data);
+    for (const auto* data: {full.get(), incremental.get()}) {
+        navitia::handle_realtime(feed_id, timestamp,
+                                 ntest::make_delay_message("vj:A:1", "20150928", {
+                                     std::make_tuple("stop1", "20150928T0810"_pts, "20150928T0810"_pts),
+                                     std::make_tuple("stop2", "20150928T0940"_pts, "20150928T0940"_pts),
+                                     std::make_tuple("stop3", "20150928T1040"_pts, "20150928T1040"_pts)
+                                 }),
+                                 *data);
+        navitia::handle_realtime(feed_id_1, timestamp, make_cancellation_message("vj:C:1", "20150929"), *data);
+    }
+    full->build_raptor();
+    incremental->build_raptor_from(*b.data);
+
+    navitia::routing::RAPTOR full_raptor(*full);
+    navitia::routing::RAPTOR incremental_raptor(*incremental);
+    auto compute = [&](navitia::routing::RAPTOR& raptor, const nt::Data& data, nt::RTLevel level,
+                       const std::string& from, const std::string& to, int day) {
+        return raptor.compute(data.pt_data->stop_areas_map.at(from), data.pt_data->stop_areas_map.at(to),
+                              "07:00"_t, day, navitia::DateTimeUtils::inf, level, 2_min, true);
+    };
+
+    for (const auto level: {nt::RTLevel::Base, nt::RTLevel::Adapted, nt::RTLevel::RealTime}) {
+        for (int day = 0; day < 3; ++day) {
+            for (const auto& od: {std::make_pair("stop1", "stop3"), std::make_pair("stop1", "stop4"),
+                                  std::make_pair("stop2", "stop3"), std::make_pair("stop2", "stop4")}) {
+                const auto full_res = compute(full_raptor, *full, level, od.first, od.second, day);
+                const auto res = compute(incremental_raptor, *incremental, level, od.first, od.second, day);
+                BOOST_REQUIRE_EQUAL(res.size(), full_res.size());
+                for (size_t i = 0; i < res.size(); ++i) {
+                    BOOST_REQUIRE_EQUAL(res[i].items.size(), full_res[i].items.size());
+                    for (size_t j = 0; j < res[i].items.size(); ++j) {
+                        BOOST_CHECK_EQUAL(res[i].items[j].departure, full_res[i].items[j].departure);
+                        BOOST_CHECK_EQUAL(res[i].items[j].arrival, full_res[i].items[j].arrival);
+                    }
+                }
+            }
+        }
+    }
+
+    // the realtime is taken into account
+    auto res = compute(incremental_raptor, *incremental, nt::RTLevel::RealTime, "stop1", "stop3", 0);
+    BOOST_REQUIRE_EQUAL(res.size(), 1);
+    BOOST_CHECK_EQUAL(res[0].items[0].arrival, "20150928T1040"_dt);
+    res = compute(incremental_raptor, *incremental, nt::RTLevel::Base, "stop1", "stop3", 0);
+    BOOST_REQUIRE_EQUAL(res.size(), 1);
+    BOOST_CHECK_EQUAL(res[0].items[0].arrival, "20150928T1000"_dt);
+}
@@ -117,9 +117,16 @@ std::vector<std::string> vector_of_admins(const T & admin){
     return result;
 }
 
-Worker::Worker(DataManager<navitia::type::Data>& data_manager, kraken::Configuration conf) :
-    data_manager(data_manager), conf(conf),
-    logger(log4cplus::Logger::getInstance(LOG4CPLUS_TEXT("logger"))){}
+Worker::Worker(DataManager<navitia::type::Data>& data_manager, kraken::Configuration conf,
+               const kraken::Metrics* metrics) :
+    data_manager(data_manager), conf(conf), metrics(metrics),
+    logger(log4cplus::Logger::getInstance(LOG4CPLUS_TEXT("logger"))){
+    if (conf.concurrent_street_network()) {
+        // the arrival and the direct path searches
+        street_network_pool = std::make_unique<navitia::routing::ThreadPool>(2);
+    }
+    matrix_pool = std::make_unique<navitia::routing::ThreadPool>(conf.street_network_matrix_threads() - 1);
+}
 
 Worker::~Worker(){}
 
@@ -147,6 +154,48 @@ pbnavitia::Response Worker::status() {
     status->set_is_connected_to_rabbitmq(d->is_connected_to_rabbitmq);
     status->set_status(get_string_status(d));
     status->set_is_realtime_loaded(d->is_realtime_loaded);
+    // memory used by the raptor labels of this worker
+    status->set_raptor_labels_memory(planner ? planner->labels_memory_size() : 0);
+    if (d->dataRaptor && d->dataRaptor->cached_next_st_manager) {
+        const auto stats = d->dataRaptor->cached_next_st_manager->get_stats();
+        status->set_next_st_cache_hits(stats.nb_calls - stats.nb_cache_miss);
+        status->set_next_st_cache_misses(stats.nb_cache_miss);
+        status->set_next_st_cache_build_time(stats.build_duration.count());
+    }
+    if (d->fallback_cache) {
+        const auto nb_calls = d->fallback_cache->get_nb_calls();
+        const auto nb_cache_miss = d->fallback_cache->get_nb_cache_miss();
+        status->set_fallback_cache_hits(nb_calls - nb_cache_miss);
+        status->set_fallback_cache_misses(nb_cache_miss);
+    }
+    // the last loads and realtime rebuilds, the most recent first
+    for (auto it = d->load_timings.rbegin(); it != d->load_timings.rend(); ++it) {
+        auto* pb_timings = status->add_load_timings();
+        pb_timings->set_operation(it->operation);
+        pb_timings->set_started_at(pt::to_iso_string(it->started_at));
+        pb_timings->set_duration(it->duration_ms);
+        pb_timings->set_peak_rss(it->peak_rss_kb);
+        for (const auto& phase: it->phases) {
+            auto* pb_phase = pb_timings->add_phases();
+            pb_phase->set_name(phase.name);
+            pb_phase->set_duration(phase.duration_ms);
+        }
+    }
+    // the requests handled by all the workers since the start, by api
+    if (metrics) {
+        for (const auto& api: metrics->snapshot()) {
+            auto* pb_metrics = status->add_api_metrics();
+            pb_metrics->set_api(API_Name(pbnavitia::API(api.api)));
+            pb_metrics->set_nb_requests(api.nb_requests);
+            pb_metrics->set_nb_errors(api.nb_errors);
+            pb_metrics->set_response_bytes(api.response_bytes);
+            // latencies in µs
+            pb_metrics->set_latency_p50(api.latency.percentile(0.5));
+            pb_metrics->set_latency_p90(api.latency.percentile(0.9));
+            pb_metrics->set_latency_p99(api.latency.percentile(0.99));
+            pb_metrics->set_latency_max(api.latency.max);
+        }
+    }
     if (d->loaded) {
         status->set_publication_date(pt::to_iso_string(d->meta->publication_date));
         status->set_start_production_date(bg::to_iso_string(d->meta->production_date.begin()));
@@ -216,8 +265,12 @@ void Worker::feed_publisher(pbnavitia::Response& response){
 void Worker::init_worker_data(const boost::shared_ptr<const navitia::type::Data> data){
     //@TODO should be done in data_manager
     if(data->data_identifier != this->last_data_identifier || !planner){
-        planner = std::make_unique<routing::RAPTOR>(*data);
+        planner = std::make_unique<routing::RAPTOR>(*data, conf.raptor_snd_pass_threads());
         street_network_worker = std::make_unique<georef::StreetNetwork>(*data->geo_ref);
+        matrix_path_finders.clear();
+        for (size_t i = 0; i < conf.street_network_matrix_threads(); ++i) {
+            matrix_path_finders.push_back(std::make_unique<georef::PathFinder>(*data->geo_ref));
+        }
         this->last_data_identifier = data->data_identifier;
 
         LOG4CPLUS_INFO(logger, "Instanciate planner");
@@ -368,7 +421,7 @@ type::GeographicalCoord Worker::coord_of_entry_point(
         auto way = data->geo_ref->way_map.find(entry_point.uri);
         if (way != data->geo_ref->way_map.end()){
             const auto geo_way = data->geo_ref->ways[way->second];
-            result = geo_way->nearest_coord(entry_point.house_number, data->geo_ref->graph);
+            result = geo_way->nearest_coord(entry_point.house_number, data->geo_ref->search_graph());
         }
     } else if (entry_point.type == Type_e::StopPoint) {
         auto sp_it = data->pt_data->stop_points_map.find(entry_point.uri);
@@ -663,7 +716,8 @@ pbnavitia::Response Worker::journeys(const pbnavitia::JourneysRequest &request,
                 request.clockwise(), arg.accessibilite_params,
                 arg.forbidden, *street_network_worker,
                 arg.rt_level, current_datetime, seconds{request.walking_transfer_penalty()}, request.max_duration(),
-                request.max_transfers(), request.max_extra_second_pass());
+                request.max_transfers(), request.max_extra_second_pass(), request.datetime_window(),
+                street_network_pool.get());
     }
 }
 
@@ -762,6 +816,8 @@ pbnavitia::Response Worker::dispatch(const pbnavitia::Request& request) {
     case pbnavitia::place_code : response = place_code(request.place_code()); break;
     case pbnavitia::nearest_stop_points : response = nearest_stop_points(request.nearest_stop_points()); break;
     case pbnavitia::graphical_isochron : response = graphical_isochron(request.isochron(), current_datetime); break;
+    case pbnavitia::street_network_routing_matrix:
+        response = street_network_routing_matrix(request.sn_routing_matrix()); break;
     default:
         LOG4CPLUS_WARN(logger, "Unknown API : " + API_Name(request.requested_api()));
         fill_pb_error(pbnavitia::Error::unknown_api, "Unknown API", response.mutable_error());
@@ -828,4 +884,58 @@ pbnavitia::Response Worker::nearest_stop_points(const pbnavitia::NearestStopPoin
     return pb_creator.get_response();
 }
 
+pbnavitia::Response
+Worker::street_network_routing_matrix(const pbnavitia::StreetNetworkRoutingMatrixRequest& request) {
+    const auto data = data_manager.get_data();
+    this->init_worker_data(data);
+    pbnavitia::Response response;
+
+    const auto mode = type::static_data::get()->modeByCaption(request.mode());
+    const float speed_factor = request.speed() / georef::default_speed[mode];
+    if (speed_factor <= 0) {
+        throw navitia::recoverable_exception("invalid speed factor");
+    }
+    const auto max_duration = navitia::seconds(request.max_duration());
+
+    const auto coord_of_place = [&](const std::string& place) {
+        return this->coord_of_entry_point(type::EntryPoint(data->get_type_of_id(place), place, 0), data);
+    };
+    std::vector<type::GeographicalCoord> origins;
+    for (const auto& origin: request.origins()) {
+        origins.push_back(coord_of_place(origin.place()));
+    }
+    // the stop points are already projected on the street network
+    std::vector<georef::ProjectionData> destinations;
+    for (const auto& destination: request.destinations()) {
+        const auto it = data->pt_data->stop_points_map.find(destination.place());
+        if (it != data->pt_data->stop_points_map.end()) {
+            destinations.push_back(data->geo_ref->projected_stop_points[it->second->idx][mode]);
+        } else {
+            destinations.emplace_back(coord_of_place(destination.place()), *data->geo_ref,
+                                      data->geo_ref->offsets[mode]);
+        }
+    }
+
+    std::vector<georef::PathFinder*> path_finders;
+    for (const auto& path_finder: matrix_path_finders) { path_finders.push_back(path_finder.get()); }
+    const auto matrix = georef::compute_duration_matrix(*matrix_pool, path_finders, origins, destinations,
+                                                         mode, speed_factor, max_duration);
+
+    auto* pb_matrix = response.mutable_sn_routing_matrix();
+    for (const auto& row: matrix) {
+        auto* pb_row = pb_matrix->add_rows();
+        for (const auto& duration: row) {
+            auto* elt = pb_row->add_routing_response();
+            if (duration == bt::pos_infin) {
+                elt->set_duration(-1);
+                elt->set_routing_status(pbnavitia::RoutingStatus::unreached);
+            } else {
+                elt->set_duration(duration.total_seconds());
+                elt->set_routing_status(pbnavitia::RoutingStatus::reached);
+            }
+        }
+    }
+    return response;
+}
+
 }
@@ -34,6 +34,7 @@ www.navitia.io
 namespace navitia{
 namespace routing{
     struct RAPTOR;
+    class ThreadPool;
 }
 }
 
@@ -44,6 +45,7 @@ namespace routing{
 #include "kraken/data_manager.h"
 #include "utils/logger.h"
 #include "kraken/configuration.h"
+#include "kraken/metrics.h"
 #include "type/pb_converter.h"
 
 #include <memory>
@@ -70,16 +72,27 @@ class Worker {
     private:
         std::unique_ptr<navitia::routing::RAPTOR> planner;
         std::unique_ptr<navitia::georef::StreetNetwork> street_network_worker;
+        // runs the arrival and direct path searches of a journey during the
+        // departure one, created with the worker if concurrent_street_network
+        std::unique_ptr<navitia::routing::ThreadPool> street_network_pool;
+        // one by thread computing the street network matrices
+        std::vector<std::unique_ptr<navitia::georef::PathFinder>> matrix_path_finders;
+        // runs the searches of all but the first matrix path finder, the
+        // first one running on the worker's thread
+        std::unique_ptr<navitia::routing::ThreadPool> matrix_pool;
 
         // we keep a reference to data_manager in each thread
         DataManager<navitia::type::Data>& data_manager;
         const kraken::Configuration conf;
+        // the request metrics of all the workers, reported by status
+        const kraken::Metrics* metrics;
         log4cplus::Logger logger;
         size_t last_data_identifier = std::numeric_limits<size_t>::max();// to check that data did not change, do not use directly
         boost::posix_time::ptime last_load_at;
 
     public:
-        Worker(DataManager<navitia::type::Data>& data_manager, kraken::Configuration conf);
+        Worker(DataManager<navitia::type::Data>& data_manager, kraken::Configuration conf,
+               const kraken::Metrics* metrics = nullptr);
         //we override de destructor this way we can forward declare Raptor
         //see: https://stackoverflow.com/questions/6012157/is-stdunique-ptrt-required-to-know-the-full-definition-of-t
         ~Worker();
@@ -118,6 +131,7 @@ class Worker {
                                       const boost::posix_time::ptime& current_datetime);
         pbnavitia::Response place_code(const pbnavitia::PlaceCodeRequest &request);
         pbnavitia::Response nearest_stop_points(const pbnavitia::NearestStopPointsRequest& request);
+        pbnavitia::Response street_network_routing_matrix(const pbnavitia::StreetNetworkRoutingMatrixRequest& request);
         pbnavitia::Response graphical_isochron(const pbnavitia::GraphicalIsochronRequest &request,
                                                const boost::posix_time::ptime& current_datetime);
 };
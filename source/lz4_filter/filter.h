@@ -37,9 +37,27 @@ www.navitia.io
 #include <boost/iostreams/write.hpp>
 #include <boost/iostreams/read.hpp>
 #include <boost/cstdint.hpp>
+#include <algorithm>
+#include <condition_variable>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
 
 typedef std::exception LZ4Exception;
 
+/**
+ * Format des chunks : la taille compressée (uint32_t) suivie du chunk compressé.
+ *
+ * Optionnellement, le fichier se termine par un index des blocs :
+ * un chunk de taille 0 (fin des chunks), la taille décompressée de chaque
+ * chunk (uint32_t), le nombre de chunks (uint32_t) et lz4_block_index_magic.
+ */
+const uint32_t lz4_block_index_magic = 0x4c5a3449; // "LZ4I"
+
 
 /**
  * Filtre de compression utilisant l'algorithme de compression LZ4 pour boost::iostreams
@@ -48,18 +66,26 @@ typedef std::exception LZ4Exception;
 class LZ4Compressor : public boost::iostreams::multichar_output_filter {
     std::streamsize buffer_size;
     char*  output_buffer;
+    bool with_block_index;
+    std::vector<uint32_t> block_sizes;
 public:
     
     /**
      * @param buffer_size correspond a la taille des chunk qui seront compressé, 
      * attention une valeur trop faible fait perdre en taux de compression et en vitesse
+     * @param with_block_index écrit l'index des blocs à la fermeture, il
+     * permet à LZ4ParallelSource de dimensionner ses buffers et de détecter
+     * un fichier tronqué (LZ4Decompressor s'arrête avant l'index)
      *
      */
-    LZ4Compressor(std::streamsize buffer_size=1024): buffer_size(buffer_size){
+    LZ4Compressor(std::streamsize buffer_size=1024, bool with_block_index=false):
+        buffer_size(buffer_size), with_block_index(with_block_index){
         output_buffer = new char[buffer_size];
     }
 
-    LZ4Compressor(const LZ4Compressor& other) : buffer_size(other.buffer_size){
+    LZ4Compressor(const LZ4Compressor& other) :
+        buffer_size(other.buffer_size), with_block_index(other.with_block_index),
+        block_sizes(other.block_sizes){
         output_buffer = new char[buffer_size];
     }
 
@@ -81,6 +107,9 @@ public:
         }else{
             throw LZ4Exception();
         }
+        if(with_block_index){
+            block_sizes.push_back(size);
+        }
         if(buffer_size < size){
             return buffer_size;
         }else{
@@ -88,6 +117,23 @@ public:
         }
 
     }
+
+    template<typename Sink>
+    void close(Sink& dest){
+        if(! with_block_index){
+            return;
+        }
+        const uint32_t end_of_chunks = 0;
+        const uint32_t nb_blocks = block_sizes.size();
+        boost::iostreams::write(dest, reinterpret_cast<const char*>(&end_of_chunks), sizeof(uint32_t));
+        if(nb_blocks > 0){
+            boost::iostreams::write(dest, reinterpret_cast<const char*>(block_sizes.data()),
+                                    nb_blocks * sizeof(uint32_t));
+        }
+        boost::iostreams::write(dest, reinterpret_cast<const char*>(&nb_blocks), sizeof(uint32_t));
+        boost::iostreams::write(dest, reinterpret_cast<const char*>(&lz4_block_index_magic), sizeof(uint32_t));
+        block_sizes.clear();
+    }
 };
 
 /**
@@ -124,6 +170,9 @@ public:
         uint32_t chunk_size=0;
 
         boost::iostreams::read(src, reinterpret_cast<char*>(&chunk_size), sizeof(uint32_t));
+        if(chunk_size == 0){
+            return -1;//fin des chunks, l'index des blocs éventuel n'est pas lu
+        }
         read_size = boost::iostreams::read(src, input_buffer, chunk_size);
         if(read_size == chunk_size){
             output_size = LZ4_uncompress_unknownOutputSize(input_buffer, dest, chunk_size, size);
@@ -138,3 +187,226 @@ public:
     }
 };
 
+
+/**
+ * Source boost::iostreams décompressant les chunks LZ4 en parallèle
+ *
+ * Le fichier est lu dans l'ordre, mais les chunks suivants sont lus et
+ * décompressés par des threads en arrière plan dans un anneau de buffers
+ * pendant que le lecteur (la désérialisation) consomme le chunk courant.
+ *
+ * Les fichiers sans index des blocs sont lus comme par LZ4Decompressor.
+ * Si le flux est seekable et se termine par un index, les buffers sont
+ * dimensionnés à la taille des blocs et un fichier tronqué est détecté.
+ *
+ * La source est copiée par boost::iostreams, l'état est donc partagé.
+ */
+class LZ4ParallelSource {
+public:
+    typedef char char_type;
+    typedef boost::iostreams::source_tag category;
+
+    /**
+     * @param is le flux compressé, qui doit survivre à la source
+     * @param nb_threads nombre de threads de décompression
+     * @param max_chunk_size taille maximale d'un chunk décompressé, sans index
+     */
+    LZ4ParallelSource(std::istream& is, size_t nb_threads = 2, std::streamsize max_chunk_size = 8192*500):
+        pipeline(std::make_shared<Pipeline>(is, std::max<size_t>(nb_threads, 1), max_chunk_size)) {}
+
+    std::streamsize read(char* dest, std::streamsize size){
+        return pipeline->read(dest, size);
+    }
+
+private:
+    struct Chunk {
+        std::vector<char> compressed;
+        std::vector<char> data;
+        std::streamsize size = 0;
+        bool ready = false;
+        std::string error;
+    };
+
+    class Pipeline {
+        std::istream& is;
+        // the exceptions of is, disabled while it is read by the pipeline
+        std::ios::iostate is_exceptions;
+        std::streamsize max_chunk_size;
+        // the block sizes read from the index, empty if there is none
+        std::vector<uint32_t> block_sizes;
+        bool has_index = false;
+
+        std::mutex mutex;
+        std::condition_variable chunk_ready;
+        std::condition_variable chunk_free;
+        // the chunk n is in ring[n % ring.size()]
+        std::vector<Chunk> ring;
+        size_t next_to_read = 0;
+        size_t next_to_consume = 0;
+        // number of chunks, known at the end of the chunks
+        size_t nb_chunks = std::numeric_limits<size_t>::max();
+        std::string read_error;
+        bool stop = false;
+        std::vector<std::thread> threads;
+
+        // position in the current chunk, if any
+        Chunk* current = nullptr;
+        std::streamsize current_pos = 0;
+
+    public:
+        Pipeline(std::istream& is, size_t nb_threads, std::streamsize max_chunk_size):
+            is(is), is_exceptions(is.exceptions()), max_chunk_size(max_chunk_size), ring(2 * nb_threads) {
+            is.exceptions(std::ios::goodbit);
+            read_block_index();
+            for(size_t i = 0; i < nb_threads; ++i){
+                threads.emplace_back([this]{ this->work(); });
+            }
+        }
+
+        ~Pipeline(){
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stop = true;
+            }
+            chunk_free.notify_all();
+            for(auto& thread: threads){
+                thread.join();
+            }
+            is.clear();
+            is.exceptions(is_exceptions);
+        }
+
+        Pipeline(const Pipeline&) = delete;
+        Pipeline& operator=(const Pipeline&) = delete;
+
+        std::streamsize read(char* dest, std::streamsize size){
+            std::streamsize copied = 0;
+            while(copied < size){
+                if(current && current_pos < current->size){
+                    const std::streamsize n = std::min(size - copied, current->size - current_pos);
+                    memcpy(dest + copied, current->data.data() + current_pos, n);
+                    current_pos += n;
+                    copied += n;
+                    continue;
+                }
+                if(! next_chunk()){
+                    break;
+                }
+            }
+            return copied > 0 ? copied : -1;
+        }
+
+    private:
+        // reads the index at the end of the stream, if it is seekable
+        void read_block_index(){
+            const auto begin = is.tellg();
+            if(begin == std::streampos(-1)){
+                is.clear();
+                return;
+            }
+            uint32_t footer[2] = {0, 0}; // nb blocks, magic
+            is.seekg(-std::streamoff(sizeof(footer)), std::ios::end);
+            if(is.read(reinterpret_cast<char*>(footer), sizeof(footer)) && footer[1] == lz4_block_index_magic){
+                const std::streamoff index_size = std::streamoff(footer[0] + 2) * sizeof(uint32_t);
+                is.seekg(-index_size, std::ios::end);
+                block_sizes.resize(footer[0]);
+                if(footer[0] == 0 || is.read(reinterpret_cast<char*>(block_sizes.data()), footer[0] * sizeof(uint32_t))){
+                    has_index = std::all_of(block_sizes.begin(), block_sizes.end(),
+                                            [&](uint32_t block_size){ return block_size <= max_chunk_size; });
+                }
+            }
+            if(! has_index){
+                block_sizes.clear();
+            }
+            is.clear();
+            is.seekg(begin);
+        }
+
+        // releases the current chunk and waits for the next one
+        bool next_chunk(){
+            std::unique_lock<std::mutex> lock(mutex);
+            if(current){
+                current->ready = false;
+                current = nullptr;
+                ++next_to_consume;
+                chunk_free.notify_all();
+            }
+            Chunk& chunk = ring[next_to_consume % ring.size()];
+            chunk_ready.wait(lock, [&]{
+                return chunk.ready || next_to_consume >= nb_chunks || ! read_error.empty();
+            });
+            if(chunk.ready){
+                if(! chunk.error.empty()){
+                    throw std::runtime_error(chunk.error);
+                }
+                current = &chunk;
+                current_pos = 0;
+                return true;
+            }
+            if(! read_error.empty()){
+                throw std::runtime_error(read_error);
+            }
+            return false;
+        }
+
+        // the frames are read in order under the lock, then decompressed in parallel
+        void work(){
+            std::unique_lock<std::mutex> lock(mutex);
+            while(true){
+                chunk_free.wait(lock, [&]{
+                    return stop || next_to_read >= nb_chunks || ! read_error.empty()
+                        || next_to_read < next_to_consume + ring.size();
+                });
+                if(stop || next_to_read >= nb_chunks || ! read_error.empty()){
+                    return;
+                }
+                const size_t n = next_to_read;
+                Chunk& chunk = ring[n % ring.size()];
+                if(! read_frame(n, chunk)){
+                    nb_chunks = n;
+                    if(has_index && n != block_sizes.size()){
+                        read_error = "LZ4: truncated stream";
+                    }
+                    chunk_ready.notify_all();
+                    chunk_free.notify_all();
+                    return;
+                }
+                ++next_to_read;
+                const std::streamsize output_size = has_index ? block_sizes[n] : max_chunk_size;
+                lock.unlock();
+                chunk.error.clear();
+                if(std::streamsize(chunk.data.size()) < output_size){
+                    chunk.data.resize(output_size);
+                }
+                chunk.size = LZ4_uncompress_unknownOutputSize(chunk.compressed.data(), chunk.data.data(),
+                                                              chunk.compressed.size(), output_size);
+                if(chunk.size < 0 || (has_index && chunk.size != output_size)){
+                    chunk.error = "LZ4: invalid chunk";
+                }
+                lock.lock();
+                chunk.ready = true;
+                chunk_ready.notify_all();
+            }
+        }
+
+        // reads the frame n in chunk, false at the end of the chunks
+        bool read_frame(size_t n, Chunk& chunk){
+            uint32_t chunk_size = 0;
+            if(! is.read(reinterpret_cast<char*>(&chunk_size), sizeof(uint32_t)) || chunk_size == 0){
+                return false;
+            }
+            if(has_index && n >= block_sizes.size()){
+                read_error = "LZ4: more chunks than in the block index";
+                return false;
+            }
+            chunk.compressed.resize(chunk_size);
+            if(! is.read(chunk.compressed.data(), chunk_size)){
+                read_error = "LZ4: truncated chunk";
+                return false;
+            }
+            return true;
+        }
+    };
+
+    std::shared_ptr<Pipeline> pipeline;
+};
@@ -37,6 +37,8 @@ www.navitia.io
 #include <boost/iostreams/filtering_stream.hpp>
 #include <boost/iostreams/device/file.hpp>
 #include <string>
+#include <sstream>
+#include <vector>
 
 
 BOOST_AUTO_TEST_CASE(tiny_string_compression){
@@ -98,3 +100,72 @@ BOOST_AUTO_TEST_CASE(big_string_compression){
     }
     BOOST_CHECK_EQUAL(str, result);
 }
+
+
+static std::string big_string() {
+    std::string str = "foobariozafiozehfuiozefuigaezgfuzegfpuzheuerfhzeupgf";
+    for (int i = 0; i < 16; i++) {
+        str += str + std::to_string(i);
+    }
+    return str;
+}
+
+static void compress(const std::string& str, bool with_block_index) {
+    boost::iostreams::filtering_ostream out;
+    out.push(LZ4Compressor(2048, with_block_index), 1024, 1024);
+    out.push(boost::iostreams::file_sink("my_file.lz4"));
+    out << str;
+}
+
+static std::string parallel_decompress(size_t nb_threads) {
+    std::ifstream ifs("my_file.lz4", std::ios::in | std::ios::binary);
+    ifs.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+    boost::iostreams::filtering_istream in;
+    in.push(LZ4ParallelSource(ifs, nb_threads, 4096));
+    std::ostringstream result;
+    result << in.rdbuf();
+    return result.str();
+}
+
+BOOST_AUTO_TEST_CASE(parallel_decompression){
+    const std::string str = big_string();
+    for (bool with_block_index: {false, true}) {
+        compress(str, with_block_index);
+        for (size_t nb_threads: {1, 2, 4}) {
+            BOOST_CHECK(parallel_decompress(nb_threads) == str);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(block_index_read_by_decompressor){
+    // LZ4Decompressor stops before the block index
+    const std::string str = big_string();
+    compress(str, true);
+    boost::iostreams::filtering_istream in;
+    in.push(LZ4Decompressor(4096), 4096, 4096);
+    in.push(boost::iostreams::file_source("my_file.lz4"));
+    std::ostringstream result;
+    result << in.rdbuf();
+    BOOST_CHECK(result.str() == str);
+}
+
+BOOST_AUTO_TEST_CASE(truncated_file_with_block_index){
+    compress(big_string(), true);
+    std::string file;
+    {
+        std::ifstream ifs("my_file.lz4", std::ios::in | std::ios::binary);
+        file.assign(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+    }
+    // the first chunk and the index only
+    const uint32_t nb_blocks = *reinterpret_cast<const uint32_t*>(file.data() + file.size() - 8);
+    const size_t first_chunk = *reinterpret_cast<const uint32_t*>(file.data()) + sizeof(uint32_t);
+    const size_t index = (nb_blocks + 3) * sizeof(uint32_t);
+    {
+        std::ofstream ofs("my_file.lz4", std::ios::out | std::ios::binary | std::ios::trunc);
+        ofs << file.substr(0, first_chunk) << file.substr(file.size() - index);
+    }
+    std::ifstream ifs("my_file.lz4", std::ios::in | std::ios::binary);
+    LZ4ParallelSource source(ifs, 2, 4096);
+    std::vector<char> buffer(4096);
+    BOOST_CHECK_THROW(while (source.read(buffer.data(), buffer.size()) > 0) {}, std::runtime_error);
+}
@@ -31,6 +31,11 @@ www.navitia.io
 #pragma once
 
 #include "type/type.h"
+#include "type/flat_file.h"
+#include <boost/serialization/split_member.hpp>
+#include <boost/serialization/vector.hpp>
+#include <algorithm>
+#include <type_traits>
 #include <vector>
 #include <cmath>
 
@@ -55,7 +60,7 @@ struct NotFound : public std::exception{
 template<class T>
 struct ProximityList
 {
-    /// Élement que l'on garde dans le vector 
+    /// Élement ajouté, en attendant l'appel à build
     struct Item {
         GeographicalCoord coord;
         T element;
@@ -66,20 +71,43 @@ struct ProximityList
         }
     };
 
-    /// Contient toutes les coordonnées de manière à trouver rapidement
-    std::vector<Item> items;
+    /** Contient toutes les coordonnées de manière à trouver rapidement, triées par X
+     *
+     * elements[i] is the element of coords[i]. They are two arrays (and
+     * not an array of items, padded after an idx_t) to be written as they
+     * are in the flat file and read in place from it (cf save and map).
+     */
+    type::FlatArray<GeographicalCoord> coords;
+    type::FlatArray<T> elements;
 
     /// Rajoute un nouvel élément. Attention, il faut appeler build avant de pouvoir utiliser la structure
     void add(GeographicalCoord coord, T element){
-        items.push_back(Item(coord,element));
+        to_build.push_back(Item(coord,element));
     }
     void clear(){
-        items.clear();
+        to_build.clear();
+        coords = std::vector<GeographicalCoord>();
+        elements = std::vector<T>();
     }
 
-    /// Construit l'indexe
+    /// Construit l'indexe, avec les éléments déjà indexés et ceux ajoutés depuis
     void build(){
+        std::vector<Item> items = std::move(to_build);
+        to_build.clear();
+        for (size_t i = 0; i < coords.size(); ++i) {
+            items.push_back(Item(coords[i], elements[i]));
+        }
         std::sort(items.begin(), items.end(), [](const Item & a, const Item & b){return a.coord < b.coord;});
+        std::vector<GeographicalCoord> sorted_coords;
+        std::vector<T> sorted_elements;
+        sorted_coords.reserve(items.size());
+        sorted_elements.reserve(items.size());
+        for (const auto& item: items) {
+            sorted_coords.push_back(item.coord);
+            sorted_elements.push_back(item.element);
+        }
+        coords = std::move(sorted_coords);
+        elements = std::move(sorted_elements);
     }
 
     /// Retourne tous les éléments dans un rayon de x mètres
@@ -89,13 +117,13 @@ struct ProximityList
         double DEG_TO_RAD = 0.0174532925199432958;
         double coslat = ::cos(coord.lat() * DEG_TO_RAD);
 
-        auto begin = std::lower_bound(items.begin(), items.end(), coord.lon() - distance_degree / coslat, [](const Item & i, double min){return i.coord.lon() < min;});
-        auto end = std::upper_bound(begin, items.end(), coord.lon() + distance_degree / coslat, [](double max, const Item & i){return max < i.coord.lon();});
+        auto begin = std::lower_bound(coords.begin(), coords.end(), coord.lon() - distance_degree / coslat, [](const GeographicalCoord & c, double min){return c.lon() < min;});
+        auto end = std::upper_bound(begin, coords.end(), coord.lon() + distance_degree / coslat, [](double max, const GeographicalCoord & c){return max < c.lon();});
         std::vector< std::pair<T, GeographicalCoord> > result;
         double max_dist = distance * distance;
-        for(; begin != end; ++begin){
-            if(begin->coord.approx_sqr_distance(coord, coslat) <= max_dist)
-                result.push_back(std::make_pair(begin->element, begin->coord));
+        for(auto it = begin; it != end; ++it){
+            if(it->approx_sqr_distance(coord, coslat) <= max_dist)
+                result.push_back(std::make_pair(elements[it - coords.begin()], *it));
         }
         std::sort(result.begin(), result.end(), [&coord, &coslat](const std::pair<T, GeographicalCoord> & a, const std::pair<T, GeographicalCoord> & b){return a.second.approx_sqr_distance(coord, coslat) < b.second.approx_sqr_distance(coord, coslat);});
         return result;
@@ -121,10 +149,44 @@ struct ProximityList
       *
       * Elle est appelée par boost et pas directement
       */
-    template<class Archive> void serialize(Archive & ar, const unsigned int) {
-        ar & items;
+    template<class Archive> void save(Archive & ar, const unsigned int) const {
+        const std::vector<GeographicalCoord> coords(this->coords.begin(), this->coords.end());
+        const std::vector<T> elements(this->elements.begin(), this->elements.end());
+        ar & coords & elements;
+    }
+    template<class Archive> void load(Archive & ar, const unsigned int) {
+        std::vector<GeographicalCoord> coords;
+        std::vector<T> elements;
+        ar & coords & elements;
+        to_build.clear();
+        this->coords = std::move(coords);
+        this->elements = std::move(elements);
+    }
+    BOOST_SERIALIZATION_SPLIT_MEMBER()
+
+    /// write the built list in a flat file
+    void save(type::FlatWriter& writer) const {
+        // the elements are written as they are, a struct could have padding
+        static_assert(std::is_arithmetic<T>::value, "only the lists of numbers can be written in a flat file");
+        writer.write_array(coords);
+        writer.write_array(elements);
+    }
+
+    /// read the list in place from a flat file written by save()
+    void map(type::FlatReader& reader) {
+        auto coords = reader.read_array<GeographicalCoord>();
+        auto elements = reader.read_array<T>();
+        if (coords.size() != elements.size()) {
+            throw type::flat_file_error("invalid flat file: inconsistent proximity list");
+        }
+        to_build.clear();
+        this->coords = coords;
+        this->elements = elements;
     }
 
+private:
+    /// added since the last build
+    std::vector<Item> to_build;
 };
 
 }} // namespace navitia::proximitylist
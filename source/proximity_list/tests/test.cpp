@@ -37,6 +37,8 @@ www.navitia.io
 #include "type/data.h"
 #include "georef/georef.h"
 #include "type/pt_data.h"
+#include "type/flat_file.h"
+#include <boost/filesystem.hpp>
 
 using namespace navitia::type;
 using namespace navitia::proximitylist;
@@ -116,7 +118,7 @@ BOOST_AUTO_TEST_CASE(find_nearest){
 
     std::vector<unsigned int> expected {1,4,2,6,5,3};
     for(size_t i=0; i < expected.size(); ++i)
-        BOOST_CHECK_EQUAL(pl.items[i].element, expected[i]);
+        BOOST_CHECK_EQUAL(pl.elements[i], expected[i]);
 
 
     c.set_lon(M_TO_DEG *2); c.set_lat(M_TO_DEG *3);
@@ -173,6 +175,37 @@ BOOST_AUTO_TEST_CASE(find_nearest){
     BOOST_CHECK_EQUAL_COLLECTIONS(tmp.begin(), tmp.end(), expected.begin(), expected.end());
 }
 
+// the elements added after a build are indexed with the previous ones, and
+// the list is read in place from a flat file
+BOOST_AUTO_TEST_CASE(flat_proximity_list){
+    ProximityList<idx_t> pl;
+    pl.add(GeographicalCoord(2.36, 48.85), 1);
+    pl.add(GeographicalCoord(-1.57, 47.22), 2);
+    pl.build();
+    pl.add(GeographicalCoord(4.83, 45.76), 3);
+    pl.build();
+    BOOST_CHECK_EQUAL(pl.elements.size(), 3);
+    BOOST_CHECK_EQUAL(pl.find_nearest(4.84, 45.76), 3);
+
+    const auto filename = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()).string();
+    {
+        FlatWriter writer(filename, 1, 1);
+        pl.save(writer);
+        writer.close();
+    }
+    ProximityList<idx_t> mapped;
+    {
+        FlatReader reader(filename, 1, 1);
+        mapped.map(reader);
+    }
+    BOOST_CHECK(mapped.coords.is_mapped());
+    BOOST_CHECK_EQUAL_COLLECTIONS(mapped.elements.begin(), mapped.elements.end(),
+                                  pl.elements.begin(), pl.elements.end());
+    BOOST_CHECK_EQUAL(mapped.find_nearest(2.35, 48.85), 1);
+    BOOST_CHECK_EQUAL(mapped.find_nearest(-1.56, 47.22), 2);
+    boost::filesystem::remove(filename);
+}
+
 BOOST_AUTO_TEST_CASE(test_api) {
     navitia::type::Data data;
     //Everything in the range
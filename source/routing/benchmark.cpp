@@ -59,8 +59,10 @@ struct Result {
     int time;
     int arrival;
     int nb_changes;
+    size_t visited;// number of journey patterns explored by raptor
 
-    Result(Path path) : duration(path.duration.total_seconds()), time(-1), arrival(-1), nb_changes(path.nb_changes) {
+    Result(Path path) : duration(path.duration.total_seconds()), time(-1), arrival(-1), nb_changes(path.nb_changes),
+        visited(0) {
         if(!path.items.empty())
             arrival = path.items.back().arrival.time_of_day().total_seconds();
     }
@@ -87,6 +89,8 @@ int main(int argc, char** argv){
             ("hour,h", po::value<int>(&hour)->default_value(-1),
                     "Begginning hour of a particular journey")
             ("verbose,v", "Verbose debugging output")
+            ("compare_pruning", "Also compute without target pruning, and compare the number "
+                     "of updated labels per round")
             ("stop_files", po::value<std::string>(&stop_input_file), "File with list of start and target")
             ("output,o", po::value<std::string>(&output)->default_value("benchmark.csv"),
                      "Output file");
@@ -94,6 +98,7 @@ int main(int argc, char** argv){
     po::store(po::parse_command_line(argc, argv, desc), vm);
     po::notify(vm);
     bool verbose = vm.count("verbose");
+    bool compare_pruning = vm.count("compare_pruning");
 
     if (vm.count("help")) {
         std::cout << "This is used to benchmark journey computation" << std::endl;
@@ -182,12 +187,15 @@ int main(int argc, char** argv){
     std::vector<Result> results;
     data.build_raptor();
     RAPTOR router(data);
+    RAPTOR router_without_pruning(data);
+    router_without_pruning.target_pruning = false;
 
     std::cout << "On lance le benchmark de l'algo " << std::endl;
     boost::progress_display show_progress(demands.size());
     Timer t("Calcul avec l'algorithme ");
     //ProfilerStart("bench.prof");
     int nb_reponses = 0;
+    size_t nb_rounds = 0;
 #ifdef __BENCH_WITH_CALGRIND__
     CALLGRIND_START_INSTRUMENTATION;
 #endif
@@ -203,6 +211,8 @@ int main(int argc, char** argv){
                       << ", " << demand.hour
                       << "\n";
         }
+        const size_t nb_explored_jps_before = router.nb_explored_jps;
+        const size_t nb_rounds_before = router.nb_rounds;
         auto res = router.compute(data.pt_data->stop_areas[demand.start], data.pt_data->stop_areas[demand.target],
                 demand.hour, demand.date, DateTimeUtils::set(demand.date + 1, demand.hour),
                 type::RTLevel::Base, 2_min, true, {}, 10);
@@ -215,7 +225,16 @@ int main(int argc, char** argv){
 
         Result result(path);
         result.time = t2.ms();
+        result.visited = router.nb_explored_jps - nb_explored_jps_before;
+        nb_rounds += router.nb_rounds - nb_rounds_before;
         results.push_back(result);
+
+        if (compare_pruning) {
+            router_without_pruning.compute(data.pt_data->stop_areas[demand.start],
+                    data.pt_data->stop_areas[demand.target],
+                    demand.hour, demand.date, DateTimeUtils::set(demand.date + 1, demand.hour),
+                    type::RTLevel::Base, 2_min, true, {}, 10);
+        }
     }
     //ProfilerStop();
 #ifdef __BENCH_WITH_CALGRIND__
@@ -247,6 +266,7 @@ int main(int argc, char** argv){
                  << results[i].arrival << ", "
                  << results[i].duration << ", "
                  << results[i].nb_changes << ", "
+                 << results[i].visited << ", "
                  << results[i].time;
 
         out_file << "\n";
@@ -255,4 +275,26 @@ int main(int argc, char** argv){
 
     std::cout << "Number of requests: " << demands.size() << std::endl;
     std::cout << "Number of results with solution: " << nb_reponses << std::endl;
+    // A full scan of the journey patterns at each round would have explored
+    // nb_rounds * nb_jps journey patterns
+    size_t nb_explored_jps = 0;
+    for (const auto& r: results) { nb_explored_jps += r.visited; }
+    std::cout << "Number of explored journey patterns: " << nb_explored_jps
+              << " (full scan: " << nb_rounds * data.dataRaptor->jp_container.nb_jps() << ")" << std::endl;
+
+    if (compare_pruning) {
+        // the labels updated during the first and the second passes
+        std::cout << "Number of updated labels per round (with target pruning / without):" << std::endl;
+        const auto& with = router.nb_updated_labels;
+        const auto& without = router_without_pruning.nb_updated_labels;
+        size_t total_with = 0, total_without = 0;
+        for (size_t round = 1; round < std::max(with.size(), without.size()); ++round) {
+            const size_t nb_with = round < with.size() ? with[round] : 0;
+            const size_t nb_without = round < without.size() ? without[round] : 0;
+            std::cout << "  round " << round << ": " << nb_with << " / " << nb_without << std::endl;
+            total_with += nb_with;
+            total_without += nb_without;
+        }
+        std::cout << "  total: " << total_with << " / " << total_without << std::endl;
+    }
 }
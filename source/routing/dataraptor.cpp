@@ -31,11 +31,22 @@ www.navitia.io
 #include "dataraptor.h"
 #include "routing.h"
 #include "routing/raptor_utils.h"
+#include "routing/valid_jpps.h"
+#include "routing/trip_based.h"
+#include "routing/thread_pool.h"
 
 #include <boost/range/algorithm_ext.hpp>
+#include <algorithm>
+#include <exception>
+#include <future>
+#include <set>
+#include <thread>
 
 namespace navitia { namespace routing {
 
+dataRAPTOR::dataRAPTOR() {}
+dataRAPTOR::~dataRAPTOR() {}
+
 void dataRAPTOR::Connections::load(const type::PT_Data& data) {
     forward_connections.assign(data.stop_points);
     backward_connections.assign(data.stop_points);
@@ -82,42 +93,220 @@ void dataRAPTOR::JppsFromJp::load(const JourneyPatternContainer& jp_container) {
 }
 
 
-void dataRAPTOR::load(const type::PT_Data& data, size_t cache_size)
+// The days of the vjs of the jp are or-ed word by word, a vj valid the
+// day before or the day after making the jp valid (cf check2).
+static void set_jp_validity_pattern(std::vector<boost::dynamic_bitset<>>& jp_vp,
+                                    const JpIdx& jp_idx,
+                                    const JourneyPattern& jp,
+                                    const type::RTLevel rt_level) {
+    nt::ValidityPattern::year_bitset days;
+    jp.for_each_vehicle_journey([&](const nt::VehicleJourney& vj) {
+        days |= vj.validity_patterns[rt_level]->days;
+        return ! days.all();
+    });
+    const auto valid = days | (days << 1) | (days >> 1);
+    for (size_t i = 0; i < valid.size(); ++i) {
+        jp_vp[i][jp_idx.val] = valid[i];
+    }
+}
+
+// f timed as phase if there is a timer
+template<typename F>
+static void timed(type::LoadTimer* timer, const std::string& phase, const F& f) {
+    if (timer) {
+        timer->time(phase, f);
+    } else {
+        f();
+    }
+}
+
+// The threads running the phases of the loads, created by the first
+// load and shared by the following ones.  Its tasks never wait for it.
+static ThreadPool& load_pool() {
+    static ThreadPool pool(std::max(std::thread::hardware_concurrency(), 1u));
+    return pool;
+}
+
+// f run by the load pool, timed as phase if there is a timer
+template<typename F>
+static std::future<void> async_phase(type::LoadTimer* timer, const std::string& phase, const F& f) {
+    return load_pool().submit([timer, phase, f] { timed(timer, phase, f); });
+}
+
+// Unlike the ones of std::async, the futures of the pool don't wait for
+// their task, thus the phases still running are waited for if the loading
+// thread throws, as they use its stack frame.
+namespace {
+struct WaitPhases {
+    std::vector<std::future<void>>& tasks;
+    ~WaitPhases() {
+        for (auto& task: tasks) {
+            if (task.valid()) { task.wait(); }
+        }
+    }
+};
+}
+
+void dataRAPTOR::load(const type::PT_Data& data, size_t cache_size, type::LoadTimer* timer)
 {
-    jp_container.load(data);
-    labels_const.init_inf(data.stop_points);
-    labels_const_reverse.init_min(data.stop_points);
+    trip_transfers.reset();
+    // The phases independent from each other are run concurrently, each
+    // rt level having its own validity patterns.
+    std::vector<std::future<void>> tasks;
+    const WaitPhases wait_phases{tasks};
+    tasks.push_back(async_phase(timer, "raptor.connections", [&] { load_connections(data); }));
 
-    connections.load(data);
-    jpps_from_sp.load(data, jp_container);
-    jpps_from_jp.load(jp_container);
-    next_stop_time_data.load(jp_container);
-
-    for (auto level_cont: jp_validity_patterns) {
-        const auto rt_level = level_cont.first;
-        auto& jp_vp = level_cont.second;
-        jp_vp.assign(366, boost::dynamic_bitset<>(jp_container.nb_jps()));
-        for (const auto& jp: jp_container.get_jps()) {
-            for (int i = 0; i <= 365; ++i) {
-                jp.second.for_each_vehicle_journey([&](const nt::VehicleJourney& vj) {
-                    if (vj.validity_patterns[rt_level]->check2(i)) {
-                        jp_vp[i].set(jp.first.val);
-                        return false;
-                    }
-                    return true;
-                });
+    timed(timer, "raptor.journey_patterns", [&] { jp_container.load(data); });
+    tasks.push_back(async_phase(timer, "raptor.next_stop_times", [&] { next_stop_time_data.load(jp_container); }));
+    for (const auto rt_level: {nt::RTLevel::Base, nt::RTLevel::Adapted, nt::RTLevel::RealTime}) {
+        const auto phase = "raptor.validity_patterns." + type::get_string_from_rt_level(rt_level);
+        tasks.push_back(async_phase(timer, phase, [this, rt_level] {
+            auto& jp_vp = jp_validity_patterns[rt_level];
+            jp_vp.assign(366, boost::dynamic_bitset<>(jp_container.nb_jps()));
+            for (const auto& jp: jp_container.get_jps()) {
+                set_jp_validity_pattern(jp_vp, jp.first, jp.second, rt_level);
             }
+        }));
+    }
+
+    load_derived(data, cache_size, tasks, timer);
+}
+
+void dataRAPTOR::load_from(const type::PT_Data& data, const dataRAPTOR& previous, size_t cache_size,
+                           type::LoadTimer* timer)
+{
+    const size_t nb_previous_vjs = previous.jp_container.get_jp_from_vj().size();
+    if (nb_previous_vjs == 0 || nb_previous_vjs > data.vehicle_journeys.size()
+        || previous.jp_container.get_jps_from_route().size() != data.routes.size()
+        || previous.jp_container.get_jps_from_phy_mode().size() != data.physical_modes.size()
+        || previous.connections.forward_connections.size() != data.stop_points.size()) {
+        // not an older version of the data, everything must be built
+        load(data, cache_size, timer);
+        return;
+    }
+
+    std::vector<std::future<void>> tasks;
+    const WaitPhases wait_phases{tasks};
+    tasks.push_back(async_phase(timer, "raptor.connections", [&] { load_connections(data); }));
+
+    // The vjs added since previous, and the ones whose validity
+    // patterns changed
+    static const auto levels = {nt::RTLevel::Base, nt::RTLevel::Adapted, nt::RTLevel::RealTime};
+    boost::dynamic_bitset<> modified_vjs(data.vehicle_journeys.size());
+    // the trip transfers are only built on the base level
+    bool base_modified = data.stop_point_connections.size() != previous.nb_connections;
+    auto is_base = [](const nt::VehicleJourney& vj) {
+        return vj.validity_patterns[nt::RTLevel::Base]->days.any();
+    };
+    for (const auto& jp: previous.jp_container.get_jps()) {
+        jp.second.for_each_vehicle_journey([&](const nt::VehicleJourney& previous_vj) {
+            const auto& vj = *data.vehicle_journeys[previous_vj.idx];
+            for (const auto rt_level: levels) {
+                if (previous_vj.validity_patterns[rt_level]->days != vj.validity_patterns[rt_level]->days) {
+                    modified_vjs.set(previous_vj.idx);
+                    if (rt_level == nt::RTLevel::Base) { base_modified = true; }
+                }
+            }
+            return true;
+        });
+    }
+    for (size_t vj_idx = nb_previous_vjs; vj_idx < data.vehicle_journeys.size(); ++vj_idx) {
+        modified_vjs.set(vj_idx);
+        if (is_base(*data.vehicle_journeys[vj_idx])) { base_modified = true; }
+    }
+
+    // Only the modified vjs are put again in a jp.  The jps of the vjs
+    // that changed of jp have new next stop times, and the jps of all
+    // the modified vjs have new validity patterns.
+    timed(timer, "raptor.journey_patterns", [&] { jp_container.load_from(data, previous.jp_container); });
+    const auto& jp_from_vj = jp_container.get_jp_from_vj();
+    std::set<JpIdx> moved_jps, modified_jps;
+    auto mark = [&](const JpIdx& previous_jp, const nt::VehicleJourney& vj, const bool has_moved) {
+        if (has_moved && is_base(vj)) { base_modified = true; }
+        for (const auto& jp_idx: {previous_jp, jp_from_vj[VjIdx(vj)]}) {
+            if (! jp_idx.is_valid()) { continue; }
+            modified_jps.insert(jp_idx);
+            if (has_moved) { moved_jps.insert(jp_idx); }
+        }
+    };
+    for (const auto* route: data.routes) {
+        for (const auto* vj: route->discrete_vehicle_journey_list) {
+            if (! modified_vjs[vj->idx]) { continue; }
+            const auto previous_jp = jp_from_vj[VjIdx(*vj)];
+            mark(previous_jp, *vj, jp_container.update_vj(*vj));
+        }
+        for (const auto* vj: route->frequency_vehicle_journey_list) {
+            if (! modified_vjs[vj->idx]) { continue; }
+            const auto previous_jp = jp_from_vj[VjIdx(*vj)];
+            mark(previous_jp, *vj, jp_container.update_vj(*vj));
         }
     }
 
+    boost::dynamic_bitset<> moved_jps_bitset(jp_container.nb_jps());
+    for (const auto& jp_idx: moved_jps) { moved_jps_bitset.set(jp_idx.val); }
+    tasks.push_back(async_phase(timer, "raptor.next_stop_times", [&] {
+        next_stop_time_data.load_from(data, jp_container, previous.next_stop_time_data, moved_jps_bitset);
+    }));
+    for (const auto rt_level: levels) {
+        const auto phase = "raptor.validity_patterns." + type::get_string_from_rt_level(rt_level);
+        tasks.push_back(async_phase(timer, phase, [&, rt_level] {
+            auto& jp_vp = jp_validity_patterns[rt_level];
+            jp_vp = previous.jp_validity_patterns[rt_level];
+            for (auto& vp: jp_vp) { vp.resize(jp_container.nb_jps()); }
+            for (const auto& jp_idx: modified_jps) {
+                set_jp_validity_pattern(jp_vp, jp_idx, jp_container.get(jp_idx), rt_level);
+            }
+        }));
+    }
+
+    load_derived(data, cache_size, tasks, timer);
+    if (! base_modified) { trip_transfers = previous.trip_transfers; }
+}
+
+void dataRAPTOR::load_connections(const type::PT_Data& data)
+{
+    connections.load(data);
+    nb_connections = data.stop_point_connections.size();
     min_connection_time = std::numeric_limits<uint32_t>::max();
     for (const auto& conns : connections.forward_connections) {
         for (const auto& conn : conns.second) {
             min_connection_time = std::min(min_connection_time, conn.duration);
         }
     }
+}
+
+void dataRAPTOR::load_derived(const type::PT_Data& data, size_t cache_size,
+                              std::vector<std::future<void>>& tasks, type::LoadTimer* timer)
+{
+    tasks.push_back(async_phase(timer, "raptor.jpps_from_sp", [&] { jpps_from_sp.load(data, jp_container); }));
+    tasks.push_back(async_phase(timer, "raptor.jpps_from_jp", [&] { jpps_from_jp.load(jp_container); }));
+
+    labels_const.init_inf(data.stop_points);
+    labels_const_reverse.init_min(data.stop_points);
+
+    // all the tasks are waited for before an exception is forwarded,
+    // as they use this
+    std::exception_ptr error;
+    for (auto& task: tasks) {
+        try {
+            task.get();
+        } catch (...) {
+            if (! error) { error = std::current_exception(); }
+        }
+    }
+    if (error) { std::rethrow_exception(error); }
+
+    // the entries missed by a request are built by its own thread, the
+    // other workers being busy with their requests
+    cached_next_st_manager = std::make_unique<CachedNextStopTimeManager>(*this, cache_size, 1);
+    cached_valid_jpps_manager = std::make_unique<CachedValidJppsManager>(data, *this, cache_size);
+}
 
-    cached_next_st_manager = std::make_unique<CachedNextStopTimeManager>(*this, cache_size);
+void dataRAPTOR::load_trip_transfers(const type::PT_Data& data) {
+    if (trip_transfers) { return; }
+    auto transfers = std::make_shared<TripTransfers>();
+    transfers->load(data, *this);
+    trip_transfers = std::move(transfers);
 }
 
 }}
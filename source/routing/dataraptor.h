@@ -31,6 +31,7 @@ www.navitia.io
 #pragma once
 #include "type/pt_data.h"
 #include "type/datetime.h"
+#include "type/load_timings.h"
 #include "routing/raptor_utils.h"
 #include "utils/idx_map.h"
 #include "routing/next_stop_time.h"
@@ -38,9 +39,14 @@ www.navitia.io
 
 #include <boost/foreach.hpp>
 #include <boost/dynamic_bitset.hpp>
+#include <future>
+#include <memory>
 
 namespace navitia { namespace routing {
 
+struct CachedValidJppsManager;
+struct TripTransfers;
+
 /** Données statiques qui ne sont pas modifiées pendant le calcul */
 struct dataRAPTOR {
 
@@ -59,6 +65,7 @@ struct dataRAPTOR {
     };
     Connections connections;
     DateTime min_connection_time;
+    size_t nb_connections = 0;
 
     // cache friendly access to JourneyPatternPoints from a StopPoint
     struct JppsFromSp {
@@ -102,6 +109,7 @@ struct dataRAPTOR {
 
     NextStopTimeData next_stop_time_data;
     std::unique_ptr<CachedNextStopTimeManager> cached_next_st_manager;
+    std::unique_ptr<CachedValidJppsManager> cached_valid_jpps_manager;
 
     JourneyPatternContainer jp_container;
 
@@ -112,8 +120,31 @@ struct dataRAPTOR {
     // jp_validity_patterns[date][jp_idx] == any(vj.validity_pattern->check2(date) for vj in jp)
     flat_enum_map<type::RTLevel, std::vector<boost::dynamic_bitset<>>> jp_validity_patterns;
 
-    dataRAPTOR() {}
-    void load(const navitia::type::PT_Data&, size_t cache_size = 10);
+    dataRAPTOR();
+    ~dataRAPTOR();
+    // the duration of the phases is added to timer, if any
+    void load(const navitia::type::PT_Data&, size_t cache_size = 10, type::LoadTimer* timer = nullptr);
+    // Loads the data by updating the one built on an older version of
+    // the data, typically before some realtime updates: only the
+    // journey patterns of the vehicle journeys added or modified since
+    // are built again.
+    void load_from(const navitia::type::PT_Data&, const dataRAPTOR& previous, size_t cache_size = 10,
+                   type::LoadTimer* timer = nullptr);
+
+    // The transfers of the trip based engine, only built if it is
+    // enabled.  They are shared by load_from while the base level and
+    // the connections don't change.
+    std::shared_ptr<const TripTransfers> trip_transfers;
+    // builds trip_transfers if it is not done yet
+    void load_trip_transfers(const navitia::type::PT_Data&);
+
+private:
+    // everything but the journey patterns and their next stop times,
+    // once the given tasks are done
+    void load_derived(const navitia::type::PT_Data&, size_t cache_size,
+                      std::vector<std::future<void>>& tasks, type::LoadTimer* timer);
+    // the connections and min_connection_time
+    void load_connections(const navitia::type::PT_Data&);
 };
 
 }}
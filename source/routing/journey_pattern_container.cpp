@@ -31,6 +31,7 @@ www.navitia.io
 #include "journey_pattern_container.h"
 #include "type/pt_data.h"
 #include "tests/utils_test.h"
+#include <algorithm>
 #include <type_traits>
 
 namespace navitia { namespace routing {
@@ -65,6 +66,32 @@ void JourneyPatternContainer::load(const nt::PT_Data& pt_data) {
     }
 }
 
+void JourneyPatternContainer::load_from(const nt::PT_Data& pt_data,
+                                        const JourneyPatternContainer& previous) {
+    map = previous.map;
+    jps = previous.jps;
+    jpps = previous.jpps;
+    jps_from_route = previous.jps_from_route;
+    jps_from_phy_mode = previous.jps_from_phy_mode;
+    jp_from_vj.assign(pt_data.vehicle_journeys);
+    for (const auto& vj_jp: previous.jp_from_vj) { jp_from_vj[vj_jp.first] = vj_jp.second; }
+    for (auto& jp: jps) {
+        for (auto& vj: jp.discrete_vjs) {
+            vj = static_cast<const nt::DiscreteVehicleJourney*>(pt_data.vehicle_journeys[vj->idx]);
+        }
+        for (auto& vj: jp.freq_vjs) {
+            vj = static_cast<const nt::FrequencyVehicleJourney*>(pt_data.vehicle_journeys[vj->idx]);
+        }
+    }
+}
+
+bool JourneyPatternContainer::update_vj(const nt::DiscreteVehicleJourney& vj) {
+    return impl_update_vj(vj);
+}
+bool JourneyPatternContainer::update_vj(const nt::FrequencyVehicleJourney& vj) {
+    return impl_update_vj(vj);
+}
+
 const JppIdx& JourneyPatternContainer::get_jpp(const type::StopTime& st) const {
     const auto& jp = get(jp_from_vj[VjIdx(*st.vehicle_journey)]);
     return jp.jpps.at(st.order());
@@ -189,6 +216,22 @@ void JourneyPatternContainer::add_vj(const VJ& vj) {
     jp_from_vj[VjIdx(vj)] = jp_idx;
 }
 
+template<typename VJ>
+bool JourneyPatternContainer::impl_update_vj(const VJ& vj) {
+    const auto jp_idx = jp_from_vj[VjIdx(vj)];
+    if (jp_idx.is_valid()) {
+        // The vj stays in its jp if it still does not overtake
+        auto& vjs = get_mut(jp_idx).template get_vjs<VJ>();
+        const auto it = vjs.erase(std::find(vjs.begin(), vjs.end(), &vj));
+        if (! overtake(vj, vjs)) {
+            vjs.insert(it, &vj);
+            return false;
+        }
+    }
+    add_vj(vj);
+    return true;
+}
+
 JpIdx JourneyPatternContainer::make_jp(const JpKey& key) {
     const auto jp_idx = JpIdx(jps.size());
     JourneyPattern jp;
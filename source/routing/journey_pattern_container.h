@@ -88,6 +88,15 @@ struct JourneyPatternContainer {
     using JppRange = boost::iterator_range<JppIterator>;
 
     void load(const navitia::type::PT_Data&);
+    // Loads the container built on an older version of the data, the
+    // vehicle journeys being matched by idx with the ones of pt_data.
+    // The vehicle journeys added since are not in the container.
+    void load_from(const navitia::type::PT_Data&, const JourneyPatternContainer& previous);
+    // Puts a vehicle journey added or modified since load_from in a
+    // journey pattern it does not overtake in.  Returns true if the
+    // vehicle journey changed of journey pattern.
+    bool update_vj(const type::DiscreteVehicleJourney&);
+    bool update_vj(const type::FrequencyVehicleJourney&);
     size_t nb_jps() const { return jps.size(); }
     size_t nb_jpps() const { return jpps.size(); }
     const JourneyPattern& get(const JpIdx& idx) const {
@@ -181,6 +190,7 @@ private:
     IdxMap<type::PhysicalMode, std::vector<JpIdx>> jps_from_phy_mode;
 
     template<typename VJ> void add_vj(const VJ&);
+    template<typename VJ> bool impl_update_vj(const VJ&);
     template<typename VJ> static JpKey make_key(const VJ&);
     JpIdx make_jp(const JpKey&);
     JppIdx make_jpp(const JpIdx&, const SpIdx&, uint16_t order);
@@ -37,6 +37,7 @@ www.navitia.io
 
 #include <boost/range/algorithm/sort.hpp>
 #include <boost/range/algorithm_ext/push_back.hpp>
+#include <future>
 
 namespace navitia { namespace routing {
 
@@ -86,6 +87,39 @@ void NextStopTimeData::TimesStopTimes<Getter>::init(const JourneyPattern& jp,
     }
 }
 
+template<typename Getter>
+void NextStopTimeData::TimesStopTimes<Getter>::init_from(const type::PT_Data& pt_data,
+                                                        const TimesStopTimes& other) {
+    // same times, the stop times being the ones of the vjs of pt_data
+    times = other.times;
+    stop_times.reserve(other.stop_times.size());
+    for (const auto* st: other.stop_times) {
+        const auto* vj = pt_data.vehicle_journeys[st->vehicle_journey->idx];
+        stop_times.push_back(&vj->stop_time_list[st->order()]);
+    }
+}
+
+void NextStopTimeData::load_from(const type::PT_Data& pt_data,
+                                 const JourneyPatternContainer& jp_container,
+                                 const NextStopTimeData& previous,
+                                 const boost::dynamic_bitset<>& modified_jps) {
+    departure.assign(jp_container.get_jpps_values());
+    arrival.assign(jp_container.get_jpps_values());
+
+    for (const auto& jp: jp_container.get_jps()) {
+        for (const auto& jpp_idx: jp.second.jpps) {
+            if (modified_jps[jp.first.val]) {
+                const auto& jpp = jp_container.get(jpp_idx);
+                departure[jpp_idx].init(jp.second, jpp);
+                arrival[jpp_idx].init(jp.second, jpp);
+            } else {
+                departure[jpp_idx].init_from(pt_data, previous.departure[jpp_idx]);
+                arrival[jpp_idx].init_from(pt_data, previous.arrival[jpp_idx]);
+            }
+        }
+    }
+}
+
 void NextStopTimeData::load(const JourneyPatternContainer& jp_container) {
     departure.assign(jp_container.get_jpps_values());
     arrival.assign(jp_container.get_jpps_values());
@@ -431,6 +465,7 @@ bool CachedNextStopTimeKey::operator<(const CachedNextStopTimeKey& other) const
 }
 
 CachedNextStopTime CachedNextStopTimeManager::CacheCreator::operator()(const CachedNextStopTimeKey& key) const {
+    const auto start = std::chrono::steady_clock::now();
     CachedNextStopTime::vDtStByJpp departure, arrival;
     const auto& jp_container = dataRaptor.jp_container;
 
@@ -439,22 +474,47 @@ CachedNextStopTime CachedNextStopTimeManager::CacheCreator::operator()(const Cac
     DateTime dt_from = DateTimeUtils::set(key.from, 0);
     DateTime dt_to = DateTimeUtils::set(key.from + 2, 0); //cache window is 2-days wide (journeys : 24h max)
 
-    for( const auto& jp : jp_container.get_jps_values() ) {
-        fill_cache(dt_from, dt_to, key.rt_level, key.accessibilite_params, jp,
-                jp.discrete_vjs, arrival, departure);
-        fill_cache(dt_from, dt_to, key.rt_level, key.accessibilite_params, jp,
-                jp.freq_vjs, arrival, departure);
-    }
     auto compare = [](const CachedNextStopTime::DtSt& lhs, const CachedNextStopTime::DtSt& rhs) noexcept{
         return lhs.first < rhs.first;
     };
-    for (const auto& jpp_dtst : arrival) {
-        boost::sort(jpp_dtst.second, compare);
-    }
-    for (const auto& jpp_dtst : departure) {
-        boost::sort(jpp_dtst.second, compare);
-    }
-    return {departure, arrival};
+    // Each journey pattern has its own jpps, thus the journey patterns
+    // can be filled and sorted in parallel without locking.  The
+    // threads take the next journey pattern to do as they vary a lot
+    // in size.
+    const auto& jps = jp_container.get_jps_values();
+    std::atomic<size_t> next_jp(0);
+    const auto fill_jps = [&]() {
+        for (size_t i = next_jp++; i < jps.size(); i = next_jp++) {
+            const auto& jp = jps[i];
+            fill_cache(dt_from, dt_to, key.rt_level, key.accessibilite_params, jp,
+                    jp.discrete_vjs, arrival, departure);
+            fill_cache(dt_from, dt_to, key.rt_level, key.accessibilite_params, jp,
+                    jp.freq_vjs, arrival, departure);
+            for (const auto& jpp_idx: jp.jpps) {
+                boost::sort(arrival[jpp_idx], compare);
+                boost::sort(departure[jpp_idx], compare);
+            }
+        }
+    };
+    std::vector<std::future<void>> tasks;
+    for (size_t i = 1; i < std::min(pool->size() + 1, jps.size()); ++i) {
+        tasks.push_back(pool->submit(fill_jps));
+    }
+    std::exception_ptr error;
+    try {
+        fill_jps();
+    } catch (...) {
+        error = std::current_exception();
+    }
+    // the tasks use this stack frame, they must end before leaving it
+    for (auto& task: tasks) { task.wait(); }
+    if (error) { std::rethrow_exception(error); }
+    for (auto& task: tasks) { task.get(); }
+
+    CachedNextStopTime res(departure, arrival, dt_to);
+    *build_duration += std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    return res;
 }
 
 CachedNextStopTime::DtStFromJpp::DtStFromJpp(const vDtStByJpp& map) {
@@ -503,7 +563,43 @@ CachedNextStopTime::next_stop_time(const StopEvent stop_event,
 
 CachedNextStopTimeManager::~CachedNextStopTimeManager() {
     auto logger = log4cplus::Logger::getInstance("log");
-    LOG4CPLUS_INFO(logger, "Cache miss : " << lru.get_nb_cache_miss() << " / " << lru.get_nb_calls());
+    const auto stats = get_stats();
+    LOG4CPLUS_INFO(logger, "Cache miss : " << stats.nb_cache_miss << " / " << stats.nb_calls
+                   << ", build duration : " << stats.build_duration.count() << " ms");
+}
+
+CachedNextStopTimeManager::Stats CachedNextStopTimeManager::get_stats() const {
+    Stats stats;
+    stats.nb_calls = lru.get_nb_calls();
+    stats.nb_cache_miss = lru.get_nb_cache_miss();
+    stats.build_duration = std::chrono::milliseconds(*build_duration / 1000);
+    return stats;
+}
+
+void CachedNextStopTimeManager::warm_up(const DateTime from, const NextStopTimeWarmUp& policy) {
+    auto logger = log4cplus::Logger::getInstance("log");
+    const size_t nb_entries = policy.nb_days * policy.rt_levels.size() * policy.accessibilities.size();
+    if (nb_entries > max_cache) {
+        LOG4CPLUS_WARN(logger, "the warm up of " << nb_entries << " entries is bigger than the cache ("
+                       << max_cache << "), the first ones will be dropped");
+    }
+    const auto start = std::chrono::steady_clock::now();
+
+    // the threads warming up the policy take its next entry to build,
+    // until the end or the cancellation of the warm up
+    size_t nb_built = 0;
+    for (size_t i = (*policy.next_entry)++; i < nb_entries; i = (*policy.next_entry)++) {
+        if (policy.cancelled && *policy.cancelled) { break; }
+        const size_t day = i / (policy.rt_levels.size() * policy.accessibilities.size());
+        const auto rt_level = policy.rt_levels[(i / policy.accessibilities.size()) % policy.rt_levels.size()];
+        const auto& accessibilite_params = policy.accessibilities[i % policy.accessibilities.size()];
+        load(from + day * DateTimeUtils::SECONDS_PER_DAY, rt_level, accessibilite_params);
+        ++nb_built;
+    }
+
+    LOG4CPLUS_INFO(logger, "Cache warm up: " << nb_built << " of the " << nb_entries << " entries built in "
+                   << std::chrono::duration_cast<std::chrono::milliseconds>(
+                       std::chrono::steady_clock::now() - start).count() << " ms");
 }
 
 std::shared_ptr<const CachedNextStopTime>
@@ -32,6 +32,7 @@ www.navitia.io
 
 #include "routing/stop_event.h"
 #include "routing/raptor_utils.h"
+#include "routing/thread_pool.h"
 #include "utils/idx_map.h"
 #include "utils/lru.h"
 #include "type/rt_level.h"
@@ -41,6 +42,9 @@ www.navitia.io
 #include <boost/range/algorithm/upper_bound.hpp>
 #include <boost/optional.hpp>
 #include <boost/dynamic_bitset.hpp>
+#include <atomic>
+#include <chrono>
+#include <thread>
 
 namespace navitia {
 
@@ -62,6 +66,14 @@ struct NextStopTimeData {
     typedef boost::iterator_range<std::vector<const type::StopTime*>::const_reverse_iterator> StopTimeReverseIter;
 
     void load(const JourneyPatternContainer&);
+    // Loads the data built on an older version of the journey
+    // patterns: the jpps of the journey patterns marked in
+    // modified_jps are built again, the others take their stop times
+    // from the vehicle journeys of pt_data.
+    void load_from(const type::PT_Data&,
+                   const JourneyPatternContainer&,
+                   const NextStopTimeData& previous,
+                   const boost::dynamic_bitset<>& modified_jps);
 
     // Returns the range of the stop times in increasing time order
     inline StopTimeIter stop_time_range_forward(const JppIdx jpp_idx,
@@ -138,6 +150,7 @@ private:
             return boost::make_iterator_range(stop_times.rend() - idx, stop_times.rend());
         }
         void init(const JourneyPattern& jp, const JourneyPatternPoint& jpp);
+        void init_from(const type::PT_Data& pt_data, const TimesStopTimes& other);
     };
     IdxMap<JourneyPatternPoint, TimesStopTimes<Departure>> departure;
     IdxMap<JourneyPatternPoint, TimesStopTimes<Arrival>> arrival;
@@ -218,7 +231,8 @@ struct CachedNextStopTime {
     using vDtSt = std::vector<DtSt>;
     using vDtStByJpp = IdxMap<JourneyPatternPoint, vDtSt>;
 
-    CachedNextStopTime(const vDtStByJpp& d, const vDtStByJpp& a): departure(d), arrival(a) {}
+    CachedNextStopTime(const vDtStByJpp& d, const vDtStByJpp& a, const DateTime end_dt):
+        end_dt(end_dt), departure(d), arrival(a) {}
     // Returns the next stop time at given journey pattern point
     // either a vehicle that leaves or that arrives depending on
     // clockwise.
@@ -228,6 +242,9 @@ struct CachedNextStopTime {
                    const DateTime dt,
                    const bool clockwise) const;
 
+    // the stop times after end_dt are not in the cache
+    DateTime end_dt;
+
 private:
     // This structure provide the same interface as a vDtStByJpp, but
     // in a condensed and read only view.
@@ -266,9 +283,32 @@ private:
     DtStFromJpp arrival;
 };
 
+// The cache entries to build before the data is used, to avoid the
+// spike of the first requests
+struct NextStopTimeWarmUp {
+    size_t nb_days = 0; // number of days from the first one, 0 to disable the warm up
+    std::vector<type::RTLevel> rt_levels = {type::RTLevel::Base};
+    std::vector<type::AccessibiliteParams> accessibilities = {type::AccessibiliteParams()};
+    // the next entry to build, shared by the copies of the policy
+    std::shared_ptr<std::atomic<size_t>> next_entry = std::make_shared<std::atomic<size_t>>(0);
+    // if given, the warm up stops once it is set
+    std::shared_ptr<const std::atomic<bool>> cancelled;
+};
+
 struct CachedNextStopTimeManager {
-    explicit CachedNextStopTimeManager(const dataRAPTOR& dataRaptor, size_t max_cache) :
-            lru({dataRaptor}, max_cache) {}
+    struct Stats {
+        size_t nb_calls = 0;
+        size_t nb_cache_miss = 0; // the warm up entries are counted as misses
+        std::chrono::milliseconds build_duration{0}; // total duration of the builds
+    };
+
+    // Each entry is built by nb_threads threads: the one needing it and
+    // the nb_threads - 1 threads of the pool of the manager
+    explicit CachedNextStopTimeManager(const dataRAPTOR& dataRaptor, size_t max_cache, size_t nb_threads = 1) :
+            build_duration(std::make_shared<std::atomic<uint64_t>>(0)),
+            max_cache(max_cache),
+            pool(std::make_unique<ThreadPool>(std::max(nb_threads, size_t(1)) - 1)),
+            lru({dataRaptor, *pool, build_duration}, max_cache) {}
     CachedNextStopTimeManager& operator=(CachedNextStopTimeManager&&) = default;
     ~CachedNextStopTimeManager();
 
@@ -277,12 +317,30 @@ struct CachedNextStopTimeManager {
          const type::RTLevel rt_level,
          const type::AccessibiliteParams& accessibilite_params);
 
+    // Build the entries of the policy, the first day being the one of
+    // from.  Several threads can warm up the copies of a policy at the
+    // same time, each one building the next entry not taken by the others.
+    void warm_up(const DateTime from, const NextStopTimeWarmUp& policy);
+
+    Stats get_stats() const;
+
 private:
+    // in microseconds, shared with the creator
+    std::shared_ptr<std::atomic<uint64_t>> build_duration;
+    size_t max_cache;
+    // helps the threads building an entry, its tasks never wait for it
+    std::unique_ptr<ThreadPool> pool;
+
     struct CacheCreator {
         typedef CachedNextStopTimeKey const& argument_type;
         typedef CachedNextStopTime result_type;
         const dataRAPTOR& dataRaptor;
-        CacheCreator(const dataRAPTOR& d): dataRaptor(d) {}
+        ThreadPool* pool;
+        std::shared_ptr<std::atomic<uint64_t>> build_duration;
+        CacheCreator(const dataRAPTOR& d, ThreadPool& p, std::shared_ptr<std::atomic<uint64_t>> b):
+            dataRaptor(d),
+            pool(&p),
+            build_duration(std::move(b)) {}
         CachedNextStopTime operator()(const CachedNextStopTimeKey& key) const;
     };
 
@@ -35,7 +35,13 @@ www.navitia.io
 #include <boost/range/adaptor/filtered.hpp>
 #include <boost/range/algorithm/find_if.hpp>
 #include <boost/range/algorithm/fill.hpp>
+#include <boost/range/algorithm/sort.hpp>
+#include <boost/range/algorithm_ext/erase.hpp>
 #include <chrono>
+#include <exception>
+#include <future>
+#include <set>
+#include <tuple>
 
 namespace bt = boost::posix_time;
 
@@ -86,9 +92,12 @@ bool RAPTOR::apply_vj_extension(const Visitor& v,
             const auto sp_idx = SpIdx(*sp);
 
             if (! v.comp(workingDt, best_labels_pts[sp_idx])) { continue; }
+            if (! v.comp(workingDt, working_labels.dt_pt(sp_idx))) { continue; }
+            if (v.comp(target_bound, workingDt)) { continue; }
 
             working_labels.mut_dt_pt(sp_idx) = workingDt;
             best_labels_pts[sp_idx] = workingDt;
+            marked_sps.mark(sp_idx);
             result = true;
         }
         vj = v.get_extension_vj(vj);
@@ -105,45 +114,65 @@ bool RAPTOR::foot_path(const Visitor& v) {
                 data.dataRaptor->connections.forward_connections :
                 data.dataRaptor->connections.backward_connections;
 
-    for (const auto sp_cnx: cnx_list) {
-        // for all stop point, we check if we can improve the stop points they are in connection with
-        const auto& sp_idx = sp_cnx.first;
-
-        if (! working_labels.pt_is_initialized(sp_idx)) { continue; }
+    if (nb_updated_labels.size() <= count) { nb_updated_labels.resize(count + 1, 0); }
+    nb_updated_labels[count] += marked_sps.size();
 
+    // only the stop points improved during this round can improve
+    // the stop points they are in connection with
+    for (const auto sp_idx: marked_sps) {
         const DateTime previous = working_labels.dt_pt(sp_idx);
 
-        for (const auto& conn: sp_cnx.second) {
+        for (const auto& conn: cnx_list[sp_idx]) {
             const SpIdx destination_sp_idx = conn.sp_idx;
             const DateTime next = v.combine(previous, conn.duration);
 
             if (! v.comp(next, best_labels_transfers[destination_sp_idx])) { continue; }
+            if (! v.comp(next, working_labels.dt_transfer(destination_sp_idx))) { continue; }
+            if (v.comp(target_bound, next)) { continue; }
 
             //if we can improve the best label, we mark it
             working_labels.mut_dt_transfer(destination_sp_idx) = next;
             best_labels_transfers[destination_sp_idx] = next;
+            marked_transfer_sps.mark(destination_sp_idx);
             result = true;
         }
     }
+    marked_sps.clear();
+    nb_updated_labels[count] += marked_transfer_sps.size();
 
-    for (const auto sp_jpps: jpps_from_sp) {
-        if (! working_labels.transfer_is_initialized(sp_jpps.first)) { continue; }
-
+    for (const auto sp_idx: marked_transfer_sps) {
         // we mark the jpp order
-        for (const auto& jpp: sp_jpps.second) {
+        for (const auto& jpp: valid_jpps->jpps_from_sp[sp_idx]) {
             if (v.comp(jpp.order, Q[jpp.jp_idx])) {
+                if (Q[jpp.jp_idx] == v.init_queue_item()) {
+                    marked_jps.push_back(jpp.jp_idx);
+                }
                 Q[jpp.jp_idx] = jpp.order;
             }
         }
     }
+    marked_transfer_sps.clear();
 
     return result;
 }
 
 
-void RAPTOR::clear(const bool clockwise, const DateTime bound) {
+void RAPTOR::clear_queue(const bool clockwise) {
     const int queue_value = clockwise ?  std::numeric_limits<int>::max() : -1;
-    Q.assign(data.dataRaptor->jp_container.get_jps_values(), queue_value);
+    if (queue_value == Q_init_value) {
+        // only the marked journey patterns are not at their initial value
+        for (const auto& jp_idx: marked_jps) { Q[jp_idx] = queue_value; }
+    } else {
+        Q.assign(data.dataRaptor->jp_container.get_jps_values(), queue_value);
+        Q_init_value = queue_value;
+    }
+    marked_jps.clear();
+    marked_sps.clear();
+    marked_transfer_sps.clear();
+}
+
+void RAPTOR::clear_labels(const bool clockwise) {
+    clear_queue(clockwise);
     if (labels.empty()) {
         labels.resize(5);
     }
@@ -152,11 +181,38 @@ void RAPTOR::clear(const bool clockwise, const DateTime bound) {
     for(auto& lbl_list : labels) {
         lbl_list.clear(clean_labels);
     }
+}
 
+void RAPTOR::clear(const bool clockwise, const DateTime bound) {
+    clear_labels(clockwise);
     boost::fill(best_labels_pts.values(), bound);
     boost::fill(best_labels_transfers.values(), bound);
 }
 
+void RAPTOR::clear_snd_pass(const bool clockwise,
+                            const IdxMap<type::StopPoint, DateTime>& best_pts,
+                            const IdxMap<type::StopPoint, DateTime>& best_transfers) {
+    // a best label is only modified with the label of the same stop
+    // point, thus we only have to restore the touched labels
+    for (const auto& lbl_list: labels) {
+        for (const auto& sp_idx: lbl_list.get_touched_pts()) {
+            best_labels_pts[sp_idx] = best_pts[sp_idx];
+        }
+        for (const auto& sp_idx: lbl_list.get_touched_transfers()) {
+            best_labels_transfers[sp_idx] = best_transfers[sp_idx];
+        }
+    }
+    clear_labels(clockwise);
+}
+
+size_t RAPTOR::labels_memory_size() const {
+    size_t res = (best_labels_pts.size() + best_labels_transfers.size()) * sizeof(DateTime);
+    for (const auto& lbl_list: labels) { res += lbl_list.memory_size(); }
+    for (const auto& lbl_list: first_pass_labels) { res += lbl_list.memory_size(); }
+    for (const auto& helper: snd_pass_helpers) { res += helper->labels_memory_size(); }
+    return res;
+}
+
 void RAPTOR::init(const map_stop_point_duration& dep,
                   const DateTime bound,
                   const bool clockwise,
@@ -168,10 +224,12 @@ void RAPTOR::init(const map_stop_point_duration& dep,
         const DateTime begin_dt = bound + (clockwise ? sn_dur : -sn_dur);
         labels[0].mut_dt_transfer(sp_dt.first) = begin_dt;
         best_labels_transfers[sp_dt.first] = begin_dt;
-        for (const auto jpp: jpps_from_sp[sp_dt.first]) {
-            if (clockwise && Q[jpp.jp_idx] > jpp.order) {
-                Q[jpp.jp_idx] = jpp.order;
-            } else if (! clockwise && Q[jpp.jp_idx] < jpp.order) {
+        const int queue_value = clockwise ?  std::numeric_limits<int>::max() : -1;
+        for (const auto jpp: valid_jpps->jpps_from_sp[sp_dt.first]) {
+            if ((clockwise && Q[jpp.jp_idx] > jpp.order) || (! clockwise && Q[jpp.jp_idx] < jpp.order)) {
+                if (Q[jpp.jp_idx] == queue_value) {
+                    marked_jps.push_back(jpp.jp_idx);
+                }
                 Q[jpp.jp_idx] = jpp.order;
             }
         }
@@ -203,7 +261,22 @@ void RAPTOR::first_raptor_loop(const map_stop_point_duration& dep,
     clear(clockwise, bound);
     init(dep, departure_datetime, clockwise, accessibilite_params.properties);
 
-    boucleRAPTOR(clockwise, rt_level, max_transfers);
+    if (use_trip_based(clockwise, rt_level, accessibilite_params)) {
+        trip_based_loop(dep, departure_datetime, bound, max_transfers);
+    } else {
+        boucleRAPTOR(clockwise, rt_level, max_transfers);
+    }
+}
+
+bool RAPTOR::use_trip_based(const bool clockwise,
+                            const nt::RTLevel rt_level,
+                            const type::AccessibiliteParams& accessibilite_params) {
+    const auto& trip_transfers = data.dataRaptor->trip_transfers;
+    if (! trip_based_first_pass || ! trip_transfers) { return false; }
+    if (! trip_based || trip_based->trip_transfers != trip_transfers) {
+        trip_based = std::make_unique<TripBased>(data);
+    }
+    return trip_based->handles(clockwise, rt_level, accessibilite_params, *valid_jpps);
 }
 
 namespace {
@@ -371,6 +444,170 @@ static void init_best_pts_snd_pass(const routing::map_stop_point_duration& depar
     }
 }
 
+namespace {
+// parameters shared by all the second passes of a compute_all
+struct SndPassArgs {
+    const bool clockwise;
+    const DateTime& departure_datetime;
+    const map_stop_point_duration& departures;
+    const map_stop_point_duration& destinations;
+    const nt::RTLevel rt_level;
+    const type::AccessibiliteParams& accessibilite_params;
+    const navitia::time_duration& transfer_penalty;
+    const uint32_t max_transfers;
+    const IdxMap<type::StopPoint, DateTime>& best_labels_pts;
+    const IdxMap<type::StopPoint, DateTime>& best_labels_transfers;
+};
+}
+
+// Run the backward raptor of the second pass from the given starting
+// point, and add the journeys found to solutions
+static void run_snd_pass(RAPTOR& raptor,
+                         Solutions& solutions,
+                         const StartingPointSndPhase& start,
+                         const DateTime start_dt,
+                         const SndPassArgs& args) {
+    raptor.clear_snd_pass(!args.clockwise, args.best_labels_pts, args.best_labels_transfers);
+    map_stop_point_duration init_map;
+    init_map[start.sp_idx] = 0_s;
+    raptor.init(init_map, start_dt, !args.clockwise, args.accessibilite_params.properties);
+    raptor.boucleRAPTOR(!args.clockwise, args.rt_level, args.max_transfers);
+    read_solutions(raptor,
+                   solutions,
+                   !args.clockwise,
+                   args.departure_datetime,
+                   args.departures,
+                   args.destinations,
+                   args.rt_level,
+                   args.accessibilite_params,
+                   args.transfer_penalty,
+                   start);
+}
+
+static unsigned lower_bound_fallback(const map_stop_point_duration& deps) {
+    unsigned lower_bound_fb = std::numeric_limits<unsigned>::max();
+    for (const auto& pair_sp_dt : deps) {
+        lower_bound_fb = std::min(lower_bound_fb, unsigned(pair_sp_dt.second.seconds()));
+    }
+    return lower_bound_fb;
+}
+
+// The datetime at which the backward raptor of a second pass starts,
+// i.e. the arrival (resp. departure) at the stop point of the first pass
+static DateTime snd_pass_start_dt(const StartingPointSndPhase& start, const bool clockwise) {
+    return clockwise ? start.end_dt - start.fallback_dur : start.end_dt + start.fallback_dur;
+}
+
+namespace {
+struct SndPassStats {
+    size_t nb_snd_pass = 0;
+    size_t nb_useless = 0;
+};
+}
+
+// Run the second passes of the starting points (sorted by
+// CompSndPhase) that are not useless, until more than
+// max_extra_second_pass non priority ones are needed.
+//
+// The second passes are run by batches of workers.size() starting
+// points.  The solutions of a batch are merged in the CompSndPhase
+// order, skipping the ones that a sequential run would not have
+// computed, thus the result does not depend on the scheduling of the
+// threads.  The first worker of a batch runs on the calling thread, the
+// others on the pool.
+template<typename IsUseless>
+static SndPassStats run_snd_passes(const std::vector<RAPTOR*>& workers,
+                                   ThreadPool* pool,
+                                   Solutions& solutions,
+                                   const std::vector<StartingPointSndPhase>& starting_points,
+                                   const IsUseless& is_useless,
+                                   const size_t max_extra_second_pass,
+                                   const SndPassArgs& args) {
+    SndPassStats stats;
+    size_t supplementary_2nd_pass = 0;
+    size_t next_start = 0;
+    bool stop = false;
+    while (! stop && next_start < starting_points.size()) {
+        // we select the next starting points worth a second pass
+        std::vector<size_t> batch;
+        size_t nb_supplementary = supplementary_2nd_pass;
+        for (; next_start < starting_points.size() && batch.size() < workers.size(); ++next_start) {
+            const auto& start = starting_points[next_start];
+            if (is_useless(start)) { continue; }
+            if (! start.has_priority && ++nb_supplementary > max_extra_second_pass) { break; }
+            batch.push_back(next_start);
+        }
+        if (batch.empty()) { break; }
+
+        if (batch.size() == 1) {
+            const auto& start = starting_points[batch.front()];
+            if (! start.has_priority) { ++supplementary_2nd_pass; }
+            run_snd_pass(*workers.front(), solutions, start, snd_pass_start_dt(start, args.clockwise), args);
+            ++stats.nb_snd_pass;
+            continue;
+        }
+
+        std::vector<Solutions> batch_solutions(batch.size(), solutions);
+        std::vector<std::future<void>> futures;
+        for (size_t i = 1; i < batch.size(); ++i) {
+            futures.push_back(pool->submit([&, i]() {
+                const auto& start = starting_points[batch[i]];
+                run_snd_pass(*workers[i], batch_solutions[i], start, snd_pass_start_dt(start, args.clockwise), args);
+            }));
+        }
+        const auto& first_start = starting_points[batch.front()];
+        std::exception_ptr error;
+        try {
+            run_snd_pass(*workers.front(), batch_solutions.front(), first_start,
+                         snd_pass_start_dt(first_start, args.clockwise), args);
+        } catch (...) {
+            error = std::current_exception();
+        }
+        // the tasks use this stack frame, they must end before leaving it
+        for (auto& future: futures) { future.wait(); }
+        if (error) { std::rethrow_exception(error); }
+        for (auto& future: futures) { future.get(); }
+
+        for (size_t i = 0; i < batch.size(); ++i) {
+            const auto& start = starting_points[batch[i]];
+            // the solutions of the previous starting points may have
+            // made this one useless
+            if (is_useless(start)) {
+                ++stats.nb_useless;
+                continue;
+            }
+            if (! start.has_priority && ++supplementary_2nd_pass > max_extra_second_pass) {
+                stop = true;
+                break;
+            }
+            for (const auto& journey: batch_solutions[i]) { solutions.add(journey); }
+            ++stats.nb_snd_pass;
+        }
+    }
+    return stats;
+}
+
+std::vector<RAPTOR*>
+RAPTOR::prepare_snd_pass_helpers(const size_t nb_helpers,
+                                 const bool clockwise,
+                                 const IdxMap<type::StopPoint, DateTime>& best_pts,
+                                 const IdxMap<type::StopPoint, DateTime>& best_transfers) {
+    while (snd_pass_helpers.size() < nb_helpers) {
+        snd_pass_helpers.push_back(std::make_unique<RAPTOR>(data));
+    }
+    std::vector<RAPTOR*> res;
+    for (size_t i = 0; i < nb_helpers; ++i) {
+        auto& helper = *snd_pass_helpers[i];
+        helper.valid_jpps = valid_jpps;
+        helper.next_st = next_st;
+        helper.clear_labels(clockwise);
+        helper.best_labels_pts = best_pts;
+        helper.best_labels_transfers = best_transfers;
+        res.push_back(&helper);
+    }
+    return res;
+}
+
 std::vector<Path>
 RAPTOR::compute_all(const map_stop_point_duration& departures,
                     const map_stop_point_duration& destinations,
@@ -404,8 +641,10 @@ RAPTOR::compute_all(const map_stop_point_duration& departures,
     const auto& calc_dep = clockwise ? departures : destinations;
     const auto& calc_dest = clockwise ? destinations : departures;
 
+    set_targets(calc_dest, accessibilite_params.properties);
     first_raptor_loop(calc_dep, departure_datetime, rt_level,
                       bound, max_transfers, accessibilite_params, forbidden_uri, clockwise);
+    targets.clear();
 
     auto end_first_pass = std::chrono::system_clock::now();
 
@@ -428,57 +667,45 @@ RAPTOR::compute_all(const map_stop_point_duration& departures,
     init_best_pts_snd_pass(calc_dep, departure_datetime, clockwise, best_labels_pts_for_snd_pass);
     auto best_labels_transfers_for_snd_pass = snd_pass_best_labels(clockwise, best_labels_pts);
 
-    unsigned lower_bound_fb = std::numeric_limits<unsigned>::max();
-    for (const auto& pair_sp_dt : calc_dep) {
-        lower_bound_fb = std::min(lower_bound_fb, unsigned(pair_sp_dt.second.seconds()));
-    }
-
-    size_t nb_snd_pass = 0, nb_useless= 0, last_usefull_2nd_pass = 0, supplementary_2nd_pass = 0;
-    for (const auto& start: starting_points) {
+    // The best labels are copied only once, then each second pass
+    // only restores what the previous one has modified.
+    const SndPassArgs args = {clockwise, departure_datetime, departures, destinations, rt_level,
+                              accessibilite_params, transfer_penalty, max_transfers,
+                              best_labels_pts_for_snd_pass, best_labels_transfers_for_snd_pass};
+    clear_labels(!clockwise);
+    best_labels_pts = best_labels_pts_for_snd_pass;
+    best_labels_transfers = best_labels_transfers_for_snd_pass;
+
+    const unsigned lower_bound_fb = lower_bound_fallback(calc_dep);
+    const auto is_useless = [&](const StartingPointSndPhase& start) {
         Journey fake_journey = convert_to_bound(start,
                                                 lower_bound_fb,
                                                 data.dataRaptor->min_connection_time,
                                                 transfer_penalty,
                                                 clockwise);
-        if (solutions.contains_better_than(fake_journey)) {
-            continue;
-        }
-
-        if (!start.has_priority) {
-            ++supplementary_2nd_pass;
-        }
-        if (supplementary_2nd_pass > max_extra_second_pass) {
-            break;
-        }
-
-        const auto& working_labels = first_pass_labels[start.count];
-
-        clear(!clockwise, departure_datetime + (clockwise ? -1 : 1));
-        map_stop_point_duration init_map;
-        init_map[start.sp_idx] = 0_s;
-        best_labels_pts = best_labels_pts_for_snd_pass;
-        best_labels_transfers = best_labels_transfers_for_snd_pass;
-        init(init_map, working_labels.dt_pt(start.sp_idx),
-             !clockwise, accessibilite_params.properties);
-        boucleRAPTOR(!clockwise, rt_level, max_transfers);
-        read_solutions(*this,
-                       solutions,
-                       !clockwise,
-                       departure_datetime,
-                       departures,
-                       destinations,
-                       rt_level,
-                       accessibilite_params,
-                       transfer_penalty,
-                       start);
-
-        ++nb_snd_pass;
+        return solutions.contains_better_than(fake_journey);
+    };
+
+    std::vector<RAPTOR*> workers = {this};
+    if (nb_snd_pass_threads > 1 && starting_points.size() > 1) {
+        const size_t nb_helpers = std::min(nb_snd_pass_threads, starting_points.size()) - 1;
+        boost::push_back(workers, prepare_snd_pass_helpers(nb_helpers,
+                                                           !clockwise,
+                                                           best_labels_pts_for_snd_pass,
+                                                           best_labels_transfers_for_snd_pass));
     }
+    const auto stats = run_snd_passes(workers, snd_pass_pool.get(), solutions, starting_points,
+                                      is_useless, max_extra_second_pass, args);
+
+    // the first pass labels are kept for the first pass of the next
+    // computation: as they are filled in the same direction, clearing
+    // them will only reset the touched labels
+    swap(labels, first_pass_labels);
     log4cplus::Logger logger = log4cplus::Logger::getInstance(LOG4CPLUS_TEXT("logger"));
     LOG4CPLUS_DEBUG(logger, "[2nd pass] lower bound fallback duration = " << lower_bound_fb
             << " s, lower bound connection duration = " << data.dataRaptor->min_connection_time << " s");
-    LOG4CPLUS_DEBUG(logger, "[2nd pass] number of 2nd pass = " << nb_snd_pass << " / " << starting_points.size()
-            << " (nb useless = " << nb_useless << ", last usefull try = " << last_usefull_2nd_pass << ")");
+    LOG4CPLUS_DEBUG(logger, "[2nd pass] number of 2nd pass = " << stats.nb_snd_pass << " / " << starting_points.size()
+            << " (nb useless = " << stats.nb_useless << ")");
     auto end_raptor = std::chrono::system_clock::now();
     LOG4CPLUS_DEBUG(logger, "[2nd pass] Run times: 1st pass = "
             << std::chrono::duration_cast<std::chrono::milliseconds>(end_first_pass - start_raptor).count()
@@ -493,6 +720,195 @@ RAPTOR::compute_all(const map_stop_point_duration& departures,
     return result;
 }
 
+std::vector<DateTime>
+profile_datetimes(const type::Data& data,
+                  const ValidJpps& valid_jpps,
+                  const map_stop_point_duration& deps,
+                  const DateTime window_begin,
+                  const DateTime window_end,
+                  const nt::RTLevel rt_level,
+                  const type::AccessibiliteParams& accessibilite_params,
+                  const bool clockwise) {
+    const NextStopTime next_stop_time(data);
+    const StopEvent stop_event = clockwise ? StopEvent::pick_up : StopEvent::drop_off;
+    std::vector<DateTime> res;
+    for (const auto& sp_dt: deps) {
+        if (! data.pt_data->stop_points[sp_dt.first.val]->accessible(accessibilite_params.properties)) {
+            continue;
+        }
+        const DateTime sn_dur = sp_dt.second.total_seconds();
+        if (! clockwise && window_end < sn_dur) { continue; }
+        const DateTime first = clockwise ? window_begin + sn_dur : window_end - sn_dur;
+        const DateTime last = clockwise ? window_end + sn_dur :
+                                          (window_begin > sn_dur ? window_begin - sn_dur : 0);
+
+        for (const auto& jpp: valid_jpps.jpps_from_sp[sp_dt.first]) {
+            DateTime dt = first;
+            while (true) {
+                const auto st_dt = next_stop_time.next_stop_time(stop_event, jpp.idx, dt, clockwise, rt_level,
+                                                                 accessibilite_params.vehicle_properties,
+                                                                 true, last);
+                if (st_dt.first == nullptr) { break; }
+                if (clockwise ? st_dt.second > last : st_dt.second < last) { break; }
+                res.push_back(clockwise ? st_dt.second - sn_dur : st_dt.second + sn_dur);
+                if (! clockwise && st_dt.second == 0) { break; }
+                dt = clockwise ? st_dt.second + 1 : st_dt.second - 1;
+            }
+        }
+    }
+    if (clockwise) {
+        boost::sort(res, std::greater<DateTime>());
+    } else {
+        boost::sort(res);
+    }
+    res.erase(std::unique(res.begin(), res.end()), res.end());
+    return res;
+}
+
+std::vector<Path>
+RAPTOR::compute_profile(const map_stop_point_duration& departures,
+                        const map_stop_point_duration& destinations,
+                        const DateTime& window_begin,
+                        const DateTime& window_end,
+                        const nt::RTLevel rt_level,
+                        const navitia::time_duration& transfer_penalty,
+                        const uint32_t max_duration,
+                        const uint32_t max_transfers,
+                        const type::AccessibiliteParams& accessibilite_params,
+                        const std::vector<std::string>& forbidden_uri,
+                        bool clockwise,
+                        const size_t max_extra_second_pass) {
+    auto start_raptor = std::chrono::system_clock::now();
+    log4cplus::Logger logger = log4cplus::Logger::getInstance(LOG4CPLUS_TEXT("logger"));
+
+    const auto& calc_dep = clockwise ? departures : destinations;
+    const auto& calc_dest = clockwise ? destinations : departures;
+    const auto bound_of = [&](const DateTime dt) {
+        DateTime bound = clockwise ? DateTimeUtils::inf : DateTimeUtils::min;
+        if (max_duration != std::numeric_limits<uint32_t>::max()) {
+            bound = clockwise ? dt + max_duration : (dt > max_duration ? dt - max_duration : 0);
+        }
+        return limit_bound(clockwise, dt, bound);
+    };
+
+    set_valid_jp_and_jpp(DateTimeUtils::date(window_begin),
+                         accessibilite_params,
+                         forbidden_uri,
+                         rt_level);
+
+    const auto datetimes = profile_datetimes(data, *valid_jpps, calc_dep, window_begin,
+                                             std::min(window_end, window_begin + DateTimeUtils::SECONDS_PER_DAY),
+                                             rt_level, accessibilite_params, clockwise);
+    std::vector<Path> result;
+    if (datetimes.empty()) { return result; }
+
+    assert(data.dataRaptor->cached_next_st_manager);
+    auto profile = ParetoFront<Journey, ProfileDominates>(ProfileDominates());
+    // the starting points of the second pass already done by a
+    // previous datetime, i.e. not improved by the current one
+    std::set<std::tuple<unsigned, SpIdx, DateTime>> done_starting_points;
+    const unsigned lower_bound_fb = lower_bound_fallback(calc_dep);
+    unsigned max_count = 0;
+    size_t nb_snd_pass = 0;
+
+    clear(clockwise, bound_of(datetimes.front()));
+    for (const DateTime dt: datetimes) {
+        const DateTime bound = bound_of(dt);
+        next_st = data.dataRaptor->cached_next_st_manager->load(
+            clockwise ? dt : bound,
+            rt_level,
+            accessibilite_params);
+
+        // The labels of the previous datetimes are still valid for
+        // this one, as we can wait for them.  Thus they are kept, and
+        // only the labels improved by this datetime are explored.  The
+        // best labels are reset to keep the solutions with less
+        // transfers that would be dominated by the ones of a previous
+        // datetime.
+        clear_queue(clockwise);
+        boost::fill(best_labels_pts.values(), bound);
+        boost::fill(best_labels_transfers.values(), bound);
+        init(calc_dep, dt, clockwise, accessibilite_params.properties);
+        // as in raptor_loop, the arrivals of the trip based engine are
+        // written only if they improve the labels of the previous datetimes
+        if (use_trip_based(clockwise, rt_level, accessibilite_params)) {
+            trip_based_loop(calc_dep, dt, bound, max_transfers);
+        } else {
+            boucleRAPTOR(clockwise, rt_level, max_transfers);
+        }
+        max_count = std::max(max_count, count);
+        count = max_count;
+
+        auto starting_points =
+            make_starting_points_snd_phase(*this, calc_dest, accessibilite_params, clockwise);
+        boost::remove_erase_if(starting_points, [&](const StartingPointSndPhase& start) {
+            return ! done_starting_points.emplace(start.count, start.sp_idx, start.end_dt).second;
+        });
+        if (starting_points.empty()) { continue; }
+
+        // The bounds of the second pass are given by the best of the
+        // labels of every round, as in compute_all.
+        IdxMap<type::StopPoint, DateTime> first_pass_pts = best_labels_pts;
+        IdxMap<type::StopPoint, DateTime> first_pass_transfers = best_labels_transfers;
+        const auto improve = [&](DateTime& best, const DateTime dt) {
+            if (clockwise ? dt < best : dt > best) { best = dt; }
+        };
+        for (unsigned round = 0; round <= max_count; ++round) {
+            const auto& lbl_list = labels[round];
+            for (const auto& sp_idx: lbl_list.get_touched_pts()) {
+                improve(first_pass_pts[sp_idx], lbl_list.dt_pt(sp_idx));
+            }
+            for (const auto& sp_idx: lbl_list.get_touched_transfers()) {
+                improve(first_pass_transfers[sp_idx], lbl_list.dt_transfer(sp_idx));
+            }
+        }
+        auto best_labels_pts_for_snd_pass = snd_pass_best_labels(clockwise, first_pass_transfers);
+        init_best_pts_snd_pass(calc_dep, dt, clockwise, best_labels_pts_for_snd_pass);
+        const auto best_labels_transfers_for_snd_pass = snd_pass_best_labels(clockwise, first_pass_pts);
+
+        // the second passes are run by the helpers, as this worker
+        // keeps its labels for the next datetime
+        auto solutions = Solutions(Dominates(clockwise));
+        const SndPassArgs args = {clockwise, dt, departures, destinations, rt_level,
+                                  accessibilite_params, transfer_penalty, max_transfers,
+                                  best_labels_pts_for_snd_pass, best_labels_transfers_for_snd_pass};
+        const auto is_useless = [&](const StartingPointSndPhase& start) {
+            Journey fake_journey = convert_to_bound(start,
+                                                    lower_bound_fb,
+                                                    data.dataRaptor->min_connection_time,
+                                                    transfer_penalty,
+                                                    clockwise);
+            return profile.contains_better_than(fake_journey) || solutions.contains_better_than(fake_journey);
+        };
+        const auto workers = prepare_snd_pass_helpers(std::min(nb_snd_pass_threads, starting_points.size()),
+                                                      !clockwise,
+                                                      best_labels_pts_for_snd_pass,
+                                                      best_labels_transfers_for_snd_pass);
+        nb_snd_pass += run_snd_passes(workers, snd_pass_pool.get(), solutions, starting_points,
+                                      is_useless, max_extra_second_pass, args).nb_snd_pass;
+        for (const auto& journey: solutions) { profile.add(journey); }
+    }
+
+    std::vector<Journey> journeys;
+    for (const auto& j: profile) {
+        if (j.sections.empty()) { continue; }
+        journeys.push_back(j);
+    }
+    auto end_raptor = std::chrono::system_clock::now();
+    LOG4CPLUS_DEBUG(logger, "[profile] " << datetimes.size() << " datetimes, " << nb_snd_pass
+            << " 2nd pass, " << journeys.size() << " solutions in "
+            << std::chrono::duration_cast<std::chrono::milliseconds>(end_raptor - start_raptor).count()
+            << " ms");
+    boost::sort(journeys, [](const Journey& lhs, const Journey& rhs) {
+        if (lhs.departure_dt != rhs.departure_dt) { return lhs.departure_dt < rhs.departure_dt; }
+        return lhs.arrival_dt < rhs.arrival_dt;
+    });
+    for (const auto& j: journeys) {
+        result.push_back(make_path(j, data));
+    }
+    return result;
+}
+
 void
 RAPTOR::isochrone(const map_stop_point_duration& departures,
                   const DateTime& departure_datetime,
@@ -526,108 +942,44 @@ void RAPTOR::set_valid_jp_and_jpp(
     const std::vector<std::string>& forbidden,
     const nt::RTLevel rt_level)
 {
-    const auto& jp_container = data.dataRaptor->jp_container;
-    valid_journey_patterns = data.dataRaptor->jp_validity_patterns[rt_level][date];
-    boost::dynamic_bitset<> valid_journey_pattern_points(jp_container.nb_jpps());
-    valid_journey_pattern_points.set();
-
-
-    valid_stop_points.set();
-
-    // We will forbiden every object designated in forbidden
-    for (const auto& uri : forbidden) {
-        const auto it_line = data.pt_data->lines_map.find(uri);
-        if (it_line != data.pt_data->lines_map.end()) {
-            for (const auto route : it_line->second->route_list) {
-                for (const auto& jp_idx: jp_container.get_jps_from_route()[RouteIdx(*route)]) {
-                    valid_journey_patterns.set(jp_idx.val, false);
-                }
-            }
-            continue;
-        }
-        const auto it_route = data.pt_data->routes_map.find(uri);
-        if (it_route != data.pt_data->routes_map.end()) {
-            for (const auto& jp_idx: jp_container.get_jps_from_route()[RouteIdx(*it_route->second)]) {
-                valid_journey_patterns.set(jp_idx.val, false);
-            }
-            continue;
-        }
-        const auto it_commercial_mode = data.pt_data->commercial_modes_map.find(uri);
-        if (it_commercial_mode != data.pt_data->commercial_modes_map.end()) {
-            for (const auto line : it_commercial_mode->second->line_list) {
-                for (auto route : line->route_list) {
-                    for (const auto& jp_idx: jp_container.get_jps_from_route()[RouteIdx(*route)]) {
-                        valid_journey_patterns.set(jp_idx.val, false);
-                    }
-                }
-            }
-            continue;
-        }
-        const auto it_physical_mode = data.pt_data->physical_modes_map.find(uri);
-        if (it_physical_mode != data.pt_data->physical_modes_map.end()) {
-            const auto phy_mode_idx = PhyModeIdx(*it_physical_mode->second);
-            for (const auto& jp_idx: jp_container.get_jps_from_phy_mode()[phy_mode_idx]) {
-                valid_journey_patterns.set(jp_idx.val, false);
-            }
-            continue;
-        }
-        const auto it_network = data.pt_data->networks_map.find(uri);
-        if (it_network != data.pt_data->networks_map.end()) {
-            for (const auto line : it_network->second->line_list) {
-                for (const auto route : line->route_list) {
-                    for (const auto& jp_idx: jp_container.get_jps_from_route()[RouteIdx(*route)]) {
-                        valid_journey_patterns.set(jp_idx.val, false);
-                    }
-                }
-            }
-            continue;
-        }
-        const auto it_sp = data.pt_data->stop_points_map.find(uri);
-        if (it_sp !=  data.pt_data->stop_points_map.end()) {
-            valid_stop_points.set(it_sp->second->idx, false);
-            for (const auto& jpp: data.dataRaptor->jpps_from_sp[SpIdx(*it_sp->second)]) {
-                valid_journey_pattern_points.set(jpp.idx.val, false);
-            }
-            continue;
-        }
-        const auto it_sa = data.pt_data->stop_areas_map.find(uri);
-        if (it_sa !=  data.pt_data->stop_areas_map.end()) {
-            for (const auto sp : it_sa->second->stop_point_list) {
-                valid_stop_points.set(sp->idx, false);
-                for (const auto& jpp: data.dataRaptor->jpps_from_sp[SpIdx(*sp)]) {
-                    valid_journey_pattern_points.set(jpp.idx.val, false);
-                }
-            }
-            continue;
-        }
-    }
+    assert(data.dataRaptor->cached_valid_jpps_manager);
+    valid_jpps = data.dataRaptor->cached_valid_jpps_manager->load(date, rt_level, accessibilite_params, forbidden);
+}
 
-    // filter accessibility
-    if (accessibilite_params.properties.any()) {
-        for (const auto* sp: data.pt_data->stop_points) {
-            if (sp->accessible(accessibilite_params.properties)) { continue; }
-            valid_stop_points.set(sp->idx, false);
-            for (const auto& jpp: data.dataRaptor->jpps_from_sp[SpIdx(*sp)]) {
-                valid_journey_pattern_points.set(jpp.idx.val, false);
-            }
-        }
+void RAPTOR::set_targets(const map_stop_point_duration& destinations,
+                         const type::Properties& properties) {
+    targets.clear();
+    if (! target_pruning) { return; }
+    for (const auto& sp_dt: destinations) {
+        if (! get_sp(sp_dt.first)->accessible(properties)) { continue; }
+        targets.push_back(sp_dt.first);
     }
+}
 
-    // propagate the invalid jp in their jpp
-    for (JpIdx jp_idx = JpIdx(0); jp_idx.val < valid_journey_patterns.size(); ++jp_idx.val) {
-        if (valid_journey_patterns[jp_idx.val]) { continue; }
-        const auto& jp = jp_container.get(jp_idx);
-        for (const auto& jpp_idx: jp.jpps) {
-            valid_journey_pattern_points.set(jpp_idx.val, false);
-        }
+/*
+ * The second passes start from the labels of the targets found by the
+ * first pass, a label being set only if it strictly improves the best
+ * label of its target.  A journey continued from a label can only
+ * reach the targets after (resp. before) it, thus a label worse than
+ * the best labels of all the targets cannot give a new starting point.
+ *
+ * The bound does not use the walking durations: a journey arriving
+ * later with less walking (fallback or transfers) is not dominated, but
+ * it is still found as long as it improves the label of its target.
+ * Thus the starting points of the second passes, and the solutions,
+ * are the same as without pruning.
+ */
+template<typename Visitor>
+void RAPTOR::update_target_bound(const Visitor& v) {
+    if (targets.empty()) { return; }
+    DateTime bound = v.clockwise() ? DateTimeUtils::min : DateTimeUtils::inf;
+    for (const auto& target: targets) {
+        const DateTime dt = best_labels_pts[target];
+        // an unreached target can be improved by any label
+        if (dt == v.worst_datetime()) { return; }
+        bound = v.clockwise() ? std::max(bound, dt) : std::min(bound, dt);
     }
-
-    // We get our own copy of jpps_from_sp to filter every invalid
-    // jpps.  Thanks to that, we don't need to check
-    // valid_journey_pattern[_point]s as we iterate only on the
-    // feasible ones.
-    jpps_from_sp = data.dataRaptor->jpps_from_sp;
-    jpps_from_sp.filter_jpps(valid_journey_pattern_points);
+    target_bound = bound;
 }
 
 template<typename Visitor>
@@ -636,9 +988,13 @@ void RAPTOR::raptor_loop(Visitor visitor,
                          uint32_t max_transfers) {
     bool continue_algorithm = true;
     count = 0; //< Count iteration of raptor algorithm
+    std::vector<JpIdx> jps_to_explore;
+    const auto& valid_stop_points = valid_jpps->valid_stop_points;
+    target_bound = visitor.worst_datetime();
 
     while(continue_algorithm && count <= max_transfers) {
         ++count;
+        ++nb_rounds;
         continue_algorithm = false;
         if(count == labels.size()) {
             if(visitor.clockwise()) {
@@ -654,97 +1010,147 @@ void RAPTOR::raptor_loop(Visitor visitor,
          * We want to do it, to favoritize normal vj against stay_in vjs
          */
         std::vector<RoutingState> states_stay_in;
-        for (auto q_elt: Q) {
-            const JpIdx jp_idx = q_elt.first;
-            if(q_elt.second != visitor.init_queue_item()) {
-                bool is_onboard = false;
-                DateTime workingDt = visitor.worst_datetime();
-                typename Visitor::stop_time_iterator it_st;
-                uint16_t l_zone = std::numeric_limits<uint16_t>::max();
-                const auto& jpps_to_explore = visitor.jpps_from_order(data.dataRaptor->jpps_from_jp,
-                                                                      jp_idx,
-                                                                      q_elt.second);
-
-                for (const auto& jpp: jpps_to_explore) {
-                    if (is_onboard) {
-                        ++it_st;
-                        // We update workingDt with the new arrival time
-                        // We need at each journey pattern point when we have a st
-                        // If we don't it might cause problem with overmidnight vj
-                        const type::StopTime& st = *it_st;
-                        workingDt = st.section_end(workingDt, visitor.clockwise());
-
-                        // We check if there are no drop_off_only and if the local_zone is okay
-                        if (st.valid_end(visitor.clockwise())
-                            && (l_zone == std::numeric_limits<uint16_t>::max() ||
-                                l_zone != st.local_traffic_zone)
-                            && visitor.comp(workingDt, best_labels_pts[jpp.sp_idx])
-                            && valid_stop_points[jpp.sp_idx.val]) // we need to check the accessibility
-                        {
-                            working_labels.mut_dt_pt(jpp.sp_idx) = workingDt;
-                            best_labels_pts[jpp.sp_idx] = working_labels.dt_pt(jpp.sp_idx);
-                            continue_algorithm = true;
-                        }
+        // Only the journey patterns marked during the previous round
+        // are explored.  They are sorted to keep the order of a full
+        // scan of Q.
+        jps_to_explore.clear();
+        swap(jps_to_explore, marked_jps);
+        std::sort(jps_to_explore.begin(), jps_to_explore.end());
+        nb_explored_jps += jps_to_explore.size();
+        for (const JpIdx jp_idx: jps_to_explore) {
+            int& q_elt = Q[jp_idx];
+            bool is_onboard = false;
+            DateTime workingDt = visitor.worst_datetime();
+            typename Visitor::stop_time_iterator it_st;
+            uint16_t l_zone = std::numeric_limits<uint16_t>::max();
+            const auto& jpps_to_explore = visitor.jpps_from_order(data.dataRaptor->jpps_from_jp,
+                                                                  jp_idx,
+                                                                  q_elt);
+
+            for (const auto& jpp: jpps_to_explore) {
+                if (is_onboard) {
+                    ++it_st;
+                    // We update workingDt with the new arrival time
+                    // We need at each journey pattern point when we have a st
+                    // If we don't it might cause problem with overmidnight vj
+                    const type::StopTime& st = *it_st;
+                    workingDt = st.section_end(workingDt, visitor.clockwise());
+
+                    // We check if there are no drop_off_only and if the local_zone is okay
+                    if (st.valid_end(visitor.clockwise())
+                        && (l_zone == std::numeric_limits<uint16_t>::max() ||
+                            l_zone != st.local_traffic_zone)
+                        && visitor.comp(workingDt, best_labels_pts[jpp.sp_idx])
+                        // only useful for profile computation, where
+                        // the labels are kept from one departure to
+                        // the other while the best labels are reset
+                        && visitor.comp(workingDt, working_labels.dt_pt(jpp.sp_idx))
+                        && ! visitor.comp(target_bound, workingDt)
+                        && valid_stop_points[jpp.sp_idx.val]) // we need to check the accessibility
+                    {
+                        working_labels.mut_dt_pt(jpp.sp_idx) = workingDt;
+                        best_labels_pts[jpp.sp_idx] = working_labels.dt_pt(jpp.sp_idx);
+                        marked_sps.mark(jpp.sp_idx);
+                        continue_algorithm = true;
                     }
+                }
+
+                // We try to get on a vehicle, if we were already on a vehicle, but we arrived
+                // before on the previous via a connection, we try to catch a vehicle leaving this
+                // journey pattern point before
+                const DateTime previous_dt = prec_labels.dt_transfer(jpp.sp_idx);
+                if (prec_labels.transfer_is_initialized(jpp.sp_idx) &&
+                    (!is_onboard || visitor.better_or_equal(previous_dt, workingDt, *it_st))) {
+                    const auto tmp_st_dt = next_st->next_stop_time(
+                        visitor.stop_event(), jpp.idx, previous_dt, visitor.clockwise());
+
+                    if (tmp_st_dt.first != nullptr) {
+                        if (! is_onboard || &*it_st != tmp_st_dt.first) {
+                            // st_range is quite cache
+                            // unfriendly, so avoid using it if
+                            // not really needed.
+                            it_st = visitor.st_range(*tmp_st_dt.first).begin();
+                            is_onboard = true;
+                            l_zone = it_st->local_traffic_zone;
+                            // note that if we have found a better
+                            // pickup, and that this pickup does
+                            // not have the same local traffic
+                            // zone, we may miss some interesting
+                            // solutions.
+                        } else if (l_zone != it_st->local_traffic_zone) {
+                            // if we can pick up in this vj with 2
+                            // different zones, we can drop off
+                            // anywhere (we'll chose later at
+                            // which stop we pickup)
+                            l_zone = std::numeric_limits<uint16_t>::max();
+                        }
+                        workingDt = tmp_st_dt.second;
+                        BOOST_ASSERT(! visitor.comp(workingDt, previous_dt));
 
-                    // We try to get on a vehicle, if we were already on a vehicle, but we arrived
-                    // before on the previous via a connection, we try to catch a vehicle leaving this
-                    // journey pattern point before
-                    const DateTime previous_dt = prec_labels.dt_transfer(jpp.sp_idx);
-                    if (prec_labels.transfer_is_initialized(jpp.sp_idx) &&
-                        (!is_onboard || visitor.better_or_equal(previous_dt, workingDt, *it_st))) {
-                        const auto tmp_st_dt = next_st->next_stop_time(
-                            visitor.stop_event(), jpp.idx, previous_dt, visitor.clockwise());
-
-                        if (tmp_st_dt.first != nullptr) {
-                            if (! is_onboard || &*it_st != tmp_st_dt.first) {
-                                // st_range is quite cache
-                                // unfriendly, so avoid using it if
-                                // not really needed.
-                                it_st = visitor.st_range(*tmp_st_dt.first).begin();
-                                is_onboard = true;
-                                l_zone = it_st->local_traffic_zone;
-                                // note that if we have found a better
-                                // pickup, and that this pickup does
-                                // not have the same local traffic
-                                // zone, we may miss some interesting
-                                // solutions.
-                            } else if (l_zone != it_st->local_traffic_zone) {
-                                // if we can pick up in this vj with 2
-                                // different zones, we can drop off
-                                // anywhere (we'll chose later at
-                                // which stop we pickup)
-                                l_zone = std::numeric_limits<uint16_t>::max();
-                            }
-                            workingDt = tmp_st_dt.second;
-                            BOOST_ASSERT(! visitor.comp(workingDt, previous_dt));
-
-                            if (tmp_st_dt.first->is_frequency()) {
-                                // we need to update again the working dt for it to always
-                                // be the arrival (resp departure) in the stoptimes
-                                workingDt = tmp_st_dt.first->begin_from_end(workingDt, visitor.clockwise());
-                            }
+                        if (tmp_st_dt.first->is_frequency()) {
+                            // we need to update again the working dt for it to always
+                            // be the arrival (resp departure) in the stoptimes
+                            workingDt = tmp_st_dt.first->begin_from_end(workingDt, visitor.clockwise());
                         }
                     }
                 }
-                if (is_onboard) {
-                    const type::VehicleJourney* vj_stay_in = visitor.get_extension_vj(it_st->vehicle_journey);
-                    if (vj_stay_in) {
-                        states_stay_in.emplace_back(vj_stay_in, l_zone, workingDt);
-                    }
+            }
+            if (is_onboard) {
+                const type::VehicleJourney* vj_stay_in = visitor.get_extension_vj(it_st->vehicle_journey);
+                if (vj_stay_in) {
+                    states_stay_in.emplace_back(vj_stay_in, l_zone, workingDt);
                 }
             }
-            q_elt.second = visitor.init_queue_item();
+            q_elt = visitor.init_queue_item();
         }
         for (auto state : states_stay_in) {
             bool applied = apply_vj_extension(visitor, rt_level, state);
             continue_algorithm = continue_algorithm || applied;
         }
+        update_target_bound(visitor);
         continue_algorithm = continue_algorithm && this->foot_path(visitor);
     }
 }
 
 
+void RAPTOR::trip_based_loop(const map_stop_point_duration& dep,
+                             const DateTime departure_datetime,
+                             const DateTime bound,
+                             const uint32_t max_transfers) {
+    const raptor_visitor visitor;
+    bool continue_algorithm = true;
+    count = 0;
+    target_bound = visitor.worst_datetime();
+    trip_based->init(dep, departure_datetime, *next_st, *valid_jpps);
+
+    while (continue_algorithm && count <= max_transfers) {
+        ++count;
+        ++nb_rounds;
+        continue_algorithm = false;
+        if (count == labels.size()) {
+            labels.push_back(data.dataRaptor->labels_const);
+        }
+        auto& working_labels = labels[count];
+        // the same conditions as in raptor_loop, all the stop points
+        // being valid
+        trip_based->for_each_arrival(target_bound, bound, [&](const SpIdx sp_idx, const DateTime dt) {
+            if (dt < best_labels_pts[sp_idx] && dt < working_labels.dt_pt(sp_idx)) {
+                working_labels.mut_dt_pt(sp_idx) = dt;
+                best_labels_pts[sp_idx] = dt;
+                marked_sps.mark(sp_idx);
+                continue_algorithm = true;
+            }
+        });
+        update_target_bound(visitor);
+        continue_algorithm = continue_algorithm && foot_path(visitor);
+        if (continue_algorithm && count <= max_transfers) {
+            trip_based->next_round(target_bound, bound, best_labels_transfers, *next_st, *valid_jpps);
+        }
+    }
+    // the journey patterns marked by foot_path are not explored
+    clear_queue(true);
+}
+
 void RAPTOR::boucleRAPTOR(bool clockwise,
                           const nt::RTLevel rt_level,
                           uint32_t max_transfers) {
@@ -40,13 +40,31 @@ www.navitia.io
 #include "utils/timer.h"
 #include "boost/dynamic_bitset.hpp"
 #include "dataraptor.h"
+#include "valid_jpps.h"
+#include "trip_based.h"
 #include "raptor_utils.h"
+#include "thread_pool.h"
 #include "type/time_duration.h"
 
 namespace navitia { namespace routing {
 
 DateTime limit_bound(const bool clockwise, const DateTime departure_datetime, const DateTime bound);
 
+// The datetimes of the window at which a vehicle can be caught (resp.
+// left) from the departure stop points, including the walking
+// duration.  They are sorted from the latest to the earliest (resp.
+// from the earliest to the latest), i.e. the order of the profile
+// computation.
+std::vector<DateTime>
+profile_datetimes(const type::Data& data,
+                  const ValidJpps& valid_jpps,
+                  const map_stop_point_duration& deps,
+                  const DateTime window_begin,
+                  const DateTime window_end,
+                  const nt::RTLevel rt_level,
+                  const type::AccessibiliteParams& accessibilite_params,
+                  const bool clockwise);
+
 struct StartingPointSndPhase {
     SpIdx sp_idx;
     unsigned count;
@@ -84,30 +102,99 @@ struct RAPTOR
 
     /// Number of transfers done for the moment
     unsigned int count;
-    /// Are the journey pattern valid
-    boost::dynamic_bitset<> valid_journey_patterns;
-    dataRAPTOR::JppsFromSp jpps_from_sp;
+    /// The journey patterns, jpps and stop points valid for the
+    /// request, shared with the other workers through a cache
+    std::shared_ptr<const ValidJpps> valid_jpps;
     /// Order of the first journey_pattern point of each journey_pattern
     IdxMap<JourneyPattern, int> Q;
+    /// Value of the elements of Q that are not marked
+    int Q_init_value = 0;
+    /// Journey patterns having a valid order in Q, i.e. the only ones
+    /// to explore during the next round
+    std::vector<JpIdx> marked_jps;
+
+    /// Stop points improved by a public transport during the current round
+    MarkedIdxs<type::StopPoint> marked_sps;
+    /// Stop points improved by a transfer during the current round
+    MarkedIdxs<type::StopPoint> marked_transfer_sps;
+
+    /// Number of rounds and of explored journey patterns since the
+    /// creation of the worker (for benchmark purpose)
+    size_t nb_rounds = 0;
+    size_t nb_explored_jps = 0;
+    /// Number of labels updated by round since the creation of the
+    /// worker (for benchmark purpose)
+    std::vector<size_t> nb_updated_labels;
+
+    /// Destinations of the first pass.  Empty if there is no target pruning.
+    std::vector<SpIdx> targets;
+    /// A label worse than target_bound cannot improve the label of any
+    /// target, thus cannot give a starting point to the second passes
+    DateTime target_bound = DateTimeUtils::inf;
+    /// Can be disabled to measure the target pruning (for benchmark purpose)
+    bool target_pruning = true;
+
+    /// Engine replacing the journey pattern scan of the first pass of
+    /// compute_all and of the rounds of compute_profile when it gives
+    /// the same labels, created by the first search using it
+    std::unique_ptr<TripBased> trip_based;
+    /// Can be disabled to compare with the journey pattern scan (for
+    /// benchmark and test purpose)
+    bool trip_based_first_pass = true;
 
-    // set to store if the stop_point is valid
-    boost::dynamic_bitset<> valid_stop_points;
+    /// Maximum number of second passes of compute_all run in parallel
+    /// (1 means that they are run sequentially)
+    size_t nb_snd_pass_threads;
+    /// Workers used to run the second passes in parallel.  They share
+    /// the read only data and have their own labels.
+    std::vector<std::unique_ptr<RAPTOR>> snd_pass_helpers;
+    /// Threads running the second passes of the helpers, the calling
+    /// thread running one of them.  Only if nb_snd_pass_threads > 1.
+    std::unique_ptr<ThreadPool> snd_pass_pool;
 
-    explicit RAPTOR(const navitia::type::Data& data) :
+    explicit RAPTOR(const navitia::type::Data& data, const size_t nb_snd_pass_threads = 1) :
         data(data),
         best_labels_pts(data.pt_data->stop_points),
         best_labels_transfers(data.pt_data->stop_points),
         count(0),
-        valid_journey_patterns(data.dataRaptor->jp_container.nb_jps()),
         Q(data.dataRaptor->jp_container.get_jps_values()),
-        valid_stop_points(data.pt_data->stop_points.size())
+        nb_snd_pass_threads(std::max(nb_snd_pass_threads, size_t(1)))
     {
         labels.assign(10, data.dataRaptor->labels_const);
         first_pass_labels.assign(10, data.dataRaptor->labels_const);
+        marked_sps.init(data.pt_data->stop_points);
+        marked_transfer_sps.init(data.pt_data->stop_points);
+        if (this->nb_snd_pass_threads > 1) {
+            snd_pass_pool = std::make_unique<ThreadPool>(this->nb_snd_pass_threads - 1);
+        }
     }
 
+    /// Reset the labels, and fill the best labels with bound
     void clear(bool clockwise, DateTime bound);
 
+    /// Reset the queue and the marked stop points, the labels are kept
+    void clear_queue(bool clockwise);
+
+    /// Reset the labels and the queue. Only the labels and the
+    /// journey patterns modified since the last clear are reset.
+    void clear_labels(bool clockwise);
+
+    /// Reset the labels for a second pass, the modified best labels
+    /// are restored from the given ones
+    void clear_snd_pass(bool clockwise,
+                        const IdxMap<type::StopPoint, DateTime>& best_pts,
+                        const IdxMap<type::StopPoint, DateTime>& best_transfers);
+
+    /// Prepare nb_helpers second pass helpers for a raptor in the
+    /// given direction, with the given best labels
+    std::vector<RAPTOR*> prepare_snd_pass_helpers(size_t nb_helpers,
+                                                  bool clockwise,
+                                                  const IdxMap<type::StopPoint, DateTime>& best_pts,
+                                                  const IdxMap<type::StopPoint, DateTime>& best_transfers);
+
+    /// Memory used by the labels of this worker, in bytes
+    size_t labels_memory_size() const;
+
     ///Initialize starting points
     void init(const map_stop_point_duration& dep,
               const DateTime bound,
@@ -154,6 +241,30 @@ struct RAPTOR
                 const size_t max_extra_second_pass = 0);
 
 
+    /** Profile computation (rRAPTOR): computes the journeys leaving
+     * (resp. arriving if not clockwise) in the window [window_begin,
+     * window_end], limited to 24h.
+     *
+     * The datetimes at which a vehicle can be caught in the window are
+     * scanned from the latest to the earliest (resp. the earliest to
+     * the latest), reusing the labels from one datetime to the next.
+     * Returns the pareto front on departure, arrival, transfers and
+     * walking, sorted by departure.
+     */
+    std::vector<Path>
+    compute_profile(const map_stop_point_duration& departs,
+                    const map_stop_point_duration& destinations,
+                    const DateTime& window_begin,
+                    const DateTime& window_end,
+                    const nt::RTLevel rt_level,
+                    const navitia::time_duration& transfer_penalty,
+                    const uint32_t max_duration = std::numeric_limits<uint32_t>::max(),
+                    const uint32_t max_transfers = 10,
+                    const type::AccessibiliteParams& accessibilite_params = type::AccessibiliteParams(),
+                    const std::vector<std::string>& forbidden = std::vector<std::string>(),
+                    bool clockwise = true,
+                    const size_t max_extra_second_pass = 0);
+
     /** Calcul l'isochrone à partir de tous les points contenus dans departs,
      *  vers tous les autres points.
      *  Renvoie toutes les arrivées vers tous les stop points.
@@ -171,6 +282,7 @@ struct RAPTOR
 
     /// Désactive les journey_patterns qui n'ont pas de vj valides la veille, le jour, et le lendemain du calcul
     /// Gère également les lignes, modes, journey_patterns et VJ interdits
+    /// The result is shared by the requests with the same filters
     void set_valid_jp_and_jpp(uint32_t date,
                               const type::AccessibiliteParams&,
                               const std::vector<std::string>& forbidden,
@@ -183,6 +295,7 @@ struct RAPTOR
 
     /// Apply foot pathes to labels
     /// Return true if it improves at least one label, false otherwise
+    /// Only the stop points marked during the round are considered
     template<typename Visitor> bool foot_path(const Visitor& v);
 
     /// Returns true if we improve at least one label, false otherwise
@@ -191,12 +304,32 @@ struct RAPTOR
                             const nt::RTLevel rt_level,
                             const RoutingState& state);
 
+    /// Can the trip based engine replace raptor_loop for a search?  It
+    /// is created if needed.
+    bool use_trip_based(const bool clockwise,
+                        const nt::RTLevel rt_level,
+                        const type::AccessibiliteParams& accessibilite_params);
+
+    /// Main loop of the first pass with the trip based engine, giving
+    /// the same labels as raptor_loop
+    void trip_based_loop(const map_stop_point_duration& dep,
+                         const DateTime departure_datetime,
+                         const DateTime bound,
+                         const uint32_t max_transfers);
+
     ///Main loop
     template<typename Visitor>
     void raptor_loop(Visitor visitor,
                      const nt::RTLevel rt_level,
                      uint32_t max_transfers=std::numeric_limits<uint32_t>::max());
 
+    /// Set the targets of the target pruning
+    void set_targets(const map_stop_point_duration& destinations,
+                     const type::Properties& properties);
+
+    /// Update target_bound with the labels of the targets
+    template<typename Visitor> void update_target_bound(const Visitor& v);
+
     /// Return the round that has found the best solution for this stop point
     /// Return -1 if no solution found
     int best_round(SpIdx sp_idx);
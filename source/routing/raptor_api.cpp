@@ -838,7 +838,9 @@ get_stop_points( const type::EntryPoint &ep, const type::Data& data,
         //we need to check if the admin has zone odt
         const auto& admins = find_admins(ep, data);
         for (const auto* admin: admins) {
-            for (const auto* odt_admin_stop_point: admin->odt_stop_points) {
+            const auto it_odt = data.pt_data->odt_stop_points_by_admin.find(admin->idx);
+            if (it_odt == data.pt_data->odt_stop_points_by_admin.end()) { continue; }
+            for (const auto* odt_admin_stop_point: it_odt->second) {
                 const SpIdx sp_idx{*odt_admin_stop_point};
                 if (result.find(sp_idx) == result.end()) {
                     concerned_path_finder.distance_to_entry_point[sp_idx] = {};
@@ -860,7 +862,8 @@ get_stop_points( const type::EntryPoint &ep, const type::Data& data,
         auto tmp_sn = worker.find_nearest_stop_points(
                     ep.streetnetwork_params.max_duration,
                     data.pt_data->stop_point_proximity_list,
-                    use_second);
+                    use_second,
+                    data.fallback_cache.get());
         LOG4CPLUS_TRACE(logger, "find " << tmp_sn.size() << " stop_points");
         for(auto idx_duration : tmp_sn) {
             const SpIdx sp_idx{idx_duration.first};
@@ -886,12 +889,14 @@ get_stop_points( const type::EntryPoint &ep, const type::Data& data,
         auto nearest = worker.find_nearest_stop_points(
                     ep.streetnetwork_params.max_duration,
                     data.pt_data->stop_point_proximity_list,
-                    use_second);
+                    use_second,
+                    data.fallback_cache.get());
         for (const auto& elt: nearest) {
             result[SpIdx{elt.first}] = elt.second;
         }
-        if (! admin->main_stop_areas.empty()) {
-            for (auto stop_area: admin->main_stop_areas) {
+        const auto it_main = data.pt_data->main_stop_areas_by_admin.find(admin->idx);
+        if (it_main != data.pt_data->main_stop_areas_by_admin.end()) {
+            for (auto stop_area: it_main->second) {
                 for(auto sp : stop_area->stop_point_list) {
                     const SpIdx sp_idx{*sp};
                     result[sp_idx] = {};
@@ -1011,7 +1016,9 @@ make_response(RAPTOR &raptor,
               const navitia::time_duration& transfer_penalty,
               uint32_t max_duration,
               uint32_t max_transfers,
-              uint32_t max_extra_second_pass) {
+              uint32_t max_extra_second_pass,
+              uint32_t datetime_window,
+              ThreadPool* street_network_pool) {
 
     log4cplus::Logger logger = log4cplus::Logger::getInstance(LOG4CPLUS_TEXT("logger"));
     PbCreator pb_creator(raptor.data, current_datetime, null_time_period);
@@ -1023,9 +1030,35 @@ make_response(RAPTOR &raptor,
         return pb_creator.get_response();
     }
     worker.init(origin, {destination});
-    auto departures = get_stop_points(origin, raptor.data, worker);
-    auto destinations = get_stop_points(destination, raptor.data, worker, true);
-    const auto direct_path = get_direct_path(worker, origin, destination);
+    routing::map_stop_point_duration departures, destinations;
+    georef::Path direct_path;
+    if (street_network_pool) {
+        // each search uses its own path finder, thus the arrival and the
+        // direct path are searched on the pool during the departure
+        auto arrival_search = street_network_pool->submit([&]() {
+            return get_stop_points(destination, raptor.data, worker, true);
+        });
+        auto direct_path_search = street_network_pool->submit([&]() {
+            return get_direct_path(worker, origin, destination);
+        });
+        std::exception_ptr error;
+        try {
+            departures = get_stop_points(origin, raptor.data, worker);
+        } catch (...) {
+            error = std::current_exception();
+        }
+        // the tasks use the path finders of worker and this stack frame,
+        // they must end before leaving it, even on an error
+        arrival_search.wait();
+        direct_path_search.wait();
+        if (error) { std::rethrow_exception(error); }
+        destinations = arrival_search.get();
+        direct_path = direct_path_search.get();
+    } else {
+        departures = get_stop_points(origin, raptor.data, worker);
+        destinations = get_stop_points(destination, raptor.data, worker, true);
+        direct_path = get_direct_path(worker, origin, destination);
+    }
 
     if(departures.size() == 0 && destinations.size() == 0){
         make_pathes(pb_creator, pathes, worker, direct_path, origin, destination, datetimes, clockwise);
@@ -1058,6 +1091,26 @@ make_response(RAPTOR &raptor,
 
 
 
+    // With a datetime window, every journey leaving (resp. arriving)
+    // in the window is computed at once
+    if (datetime_window > 0 && datetimes.size() == 1) {
+        const auto& datetime = datetimes.front();
+        int day = (datetime.date() - raptor.data.meta->production_date.begin()).days();
+        int time = datetime.time_of_day().total_seconds();
+        DateTime window_begin = DateTimeUtils::set(day, time);
+
+        pathes = raptor.compute_profile(
+            departures, destinations, window_begin, window_begin + datetime_window, rt_level,
+            transfer_penalty, max_duration, max_transfers, accessibilite_params, forbidden, clockwise,
+            max_extra_second_pass);
+        LOG4CPLUS_DEBUG(logger, "profile found " << pathes.size() << " solutions");
+        for (auto& path : pathes) {
+            path.request_time = datetime;
+        }
+        make_pathes(pb_creator, pathes, worker, direct_path, origin, destination, datetimes, clockwise);
+        return pb_creator.get_response();
+    }
+
     DateTime bound = clockwise ? DateTimeUtils::inf : DateTimeUtils::min;
     typedef boost::optional<navitia::time_duration> OptTimeDur;
     const OptTimeDur direct_path_dur = direct_path.path_items.empty() ?
@@ -52,7 +52,14 @@ namespace navitia{
 namespace navitia { namespace routing {
 
 struct RAPTOR;
+class ThreadPool;
 
+/// If datetime_window is not null, the journeys leaving (resp.
+/// arriving) during datetime_window seconds after datetimes[0] are
+/// computed at once by a profile computation
+///
+/// If street_network_pool is set, the arrival and direct path street
+/// network searches are run on it during the departure one
 pbnavitia::Response make_response(RAPTOR &raptor,
                                   const type::EntryPoint &origin,
                                   const type::EntryPoint &destination,
@@ -66,7 +73,9 @@ pbnavitia::Response make_response(RAPTOR &raptor,
                                   const navitia::time_duration& transfer_penalty,
                                   uint32_t max_duration=std::numeric_limits<uint32_t>::max(),
                                   uint32_t max_transfers=std::numeric_limits<uint32_t>::max(),
-                                  uint32_t max_extra_second_pass = 0);
+                                  uint32_t max_extra_second_pass = 0,
+                                  uint32_t datetime_window = 0,
+                                  ThreadPool* street_network_pool = nullptr);
 
 pbnavitia::Response make_isochrone(RAPTOR &raptor,
                                    type::EntryPoint origin,
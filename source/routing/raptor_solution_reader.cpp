@@ -450,7 +450,7 @@ struct RaptorSolutionReader {
             const SpIdx end_sp_idx = SpIdx(*end_st.stop_point);
             const DateTime end_limit = raptor.labels[count - 1].dt_transfer(end_sp_idx);
             if (v.comp(end_limit, cur_dt)) { continue; }
-            if (! raptor.valid_stop_points[end_sp_idx.val]) { continue; }
+            if (! raptor.valid_jpps->valid_stop_points[end_sp_idx.val]) { continue; }
 
             // great, we can end
             if (count == 1) {
@@ -505,7 +505,7 @@ struct RaptorSolutionReader {
         const unsigned transfer_t =
             v.clockwise() ? begin_dt - end_st_dt.second : end_st_dt.second - begin_dt;
         const DateTime begin_limit = raptor.labels[count].dt_pt(begin_sp_idx);
-        for (const auto jpp: raptor.jpps_from_sp[begin_sp_idx]) {
+        for (const auto jpp: raptor.valid_jpps->jpps_from_sp[begin_sp_idx]) {
             // trying to begin
             const auto begin_st_dt = raptor.next_st->next_stop_time(
                         v.stop_event(), jpp.idx, begin_dt, v.clockwise());
@@ -542,7 +542,7 @@ struct RaptorSolutionReader {
                   const SpIdx begin_sp_idx,
                   const DateTime begin_dt) {
         const DateTime begin_limit = raptor.labels[count].dt_pt(begin_sp_idx);
-        for (const auto jpp: raptor.jpps_from_sp[begin_sp_idx]) {
+        for (const auto jpp: raptor.valid_jpps->jpps_from_sp[begin_sp_idx]) {
             // trying to begin
             const auto begin_st_dt = raptor.next_st->next_stop_time(
                                 v.stop_event(), jpp.idx, begin_dt, v.clockwise());
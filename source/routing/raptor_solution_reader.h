@@ -79,6 +79,17 @@ struct Dominates {
 
 typedef ParetoFront<Journey, Dominates> Solutions;
 
+// Dominance of the profile computation: on the contrary of
+// Dominates, the departure and the arrival are both criteria.
+struct ProfileDominates {
+    bool operator()(const Journey& lhs, const Journey& rhs) const {
+        return lhs.departure_dt >= rhs.departure_dt
+            && lhs.arrival_dt <= rhs.arrival_dt
+            && lhs.better_on_transfer(rhs, true)
+            && lhs.better_on_sn(rhs, true);
+    }
+};
+
 // deps (resp. arrs) are departure (resp. arrival) stop points and
 // durations (not clockwise dependent).
 void read_solutions(const RAPTOR& raptor,
@@ -31,6 +31,7 @@ www.navitia.io
 #pragma once
 
 #include <boost/container/flat_map.hpp>
+#include <boost/dynamic_bitset.hpp>
 #include "type/datetime.h"
 #include "utils/idx_map.h"
 
@@ -67,6 +68,9 @@ struct Labels {
     inline friend void swap(Labels& lhs, Labels& rhs) {
         swap(lhs.dt_pts, rhs.dt_pts);
         swap(lhs.dt_transfers, rhs.dt_transfers);
+        swap(lhs.touched_pts, rhs.touched_pts);
+        swap(lhs.touched_transfers, rhs.touched_transfers);
+        std::swap(lhs.fill_value, rhs.fill_value);
     }
     // initialize the structure according to the number of jpp
     inline void init_inf(const std::vector<type::StopPoint*>& stops) {
@@ -76,11 +80,20 @@ struct Labels {
     inline void init_min(const std::vector<type::StopPoint*>& stops) {
         init(stops, DateTimeUtils::min);
     }
-    // clear the structure according to a given structure. Same as a
-    // copy without touching the boarding_jpp fields
+    // clear the structure according to a given structure. If clean
+    // is filled with the same value as this, only the labels modified
+    // since the last clear are reset, else it is a copy.
     inline void clear(const Labels& clean) {
-        dt_pts = clean.dt_pts;
-        dt_transfers = clean.dt_transfers;
+        if (fill_value == clean.fill_value && dt_pts.size() == clean.dt_pts.size()) {
+            for (const auto& sp_idx: touched_pts) { dt_pts[sp_idx] = fill_value; }
+            for (const auto& sp_idx: touched_transfers) { dt_transfers[sp_idx] = fill_value; }
+        } else {
+            dt_pts = clean.dt_pts;
+            dt_transfers = clean.dt_transfers;
+            fill_value = clean.fill_value;
+        }
+        touched_pts.clear();
+        touched_transfers.clear();
     }
     inline const DateTime& dt_transfer(SpIdx sp_idx) const {
         return dt_transfers[sp_idx];
@@ -89,10 +102,14 @@ struct Labels {
         return dt_pts[sp_idx];
     }
     inline DateTime& mut_dt_transfer(SpIdx sp_idx) {
-        return dt_transfers[sp_idx];
+        auto& dt = dt_transfers[sp_idx];
+        if (dt == fill_value) { touched_transfers.push_back(sp_idx); }
+        return dt;
     }
     inline DateTime& mut_dt_pt(SpIdx sp_idx) {
-        return dt_pts[sp_idx];
+        auto& dt = dt_pts[sp_idx];
+        if (dt == fill_value) { touched_pts.push_back(sp_idx); }
+        return dt;
     }
 
     inline bool pt_is_initialized(SpIdx sp_idx) const {
@@ -101,10 +118,23 @@ struct Labels {
     inline bool transfer_is_initialized(SpIdx sp_idx) const {
         return is_dt_initialized(dt_transfer(sp_idx));
     }
+
+    // the stop points modified since the last clear (may contain duplicates)
+    inline const std::vector<SpIdx>& get_touched_pts() const { return touched_pts; }
+    inline const std::vector<SpIdx>& get_touched_transfers() const { return touched_transfers; }
+
+    // memory used by the labels, in bytes
+    inline size_t memory_size() const {
+        return (dt_pts.size() + dt_transfers.size()) * sizeof(DateTime)
+            + (touched_pts.capacity() + touched_transfers.capacity()) * sizeof(SpIdx);
+    }
 private:
     inline void init(const std::vector<type::StopPoint*>& stops, DateTime val) {
         dt_pts.assign(stops, val);
         dt_transfers.assign(stops, val);
+        touched_pts.clear();
+        touched_transfers.clear();
+        fill_value = val;
     }
 
     // All these vectors are indexed by sp_idx
@@ -113,6 +143,45 @@ private:
     IdxMap<type::StopPoint, DateTime> dt_pts;
     // At what time wan we reach this label with a transfer
     IdxMap<type::StopPoint, DateTime> dt_transfers;
+
+    // The labels that do not have fill_value anymore, thus the only
+    // ones to reset on clear
+    std::vector<SpIdx> touched_pts;
+    std::vector<SpIdx> touched_transfers;
+    DateTime fill_value = DateTimeUtils::inf;
+};
+
+// A set of indexes that can be iterated and cleared in O(nb marked
+// elements): the bitset avoids duplicates, the list gives the marked
+// elements without scanning the whole bitset.
+template<typename T> struct MarkedIdxs {
+    using const_iterator = typename std::vector<Idx<T>>::const_iterator;
+
+    template<typename C> inline void init(const C& objects) {
+        is_marked_bits.clear();
+        is_marked_bits.resize(objects.size());
+        marked.clear();
+    }
+    // returns true if idx was not already marked
+    inline bool mark(const Idx<T> idx) {
+        if (is_marked_bits[idx.val]) { return false; }
+        is_marked_bits.set(idx.val);
+        marked.push_back(idx);
+        return true;
+    }
+    inline bool is_marked(const Idx<T> idx) const { return is_marked_bits[idx.val]; }
+    inline void clear() {
+        for (const auto& idx: marked) { is_marked_bits.reset(idx.val); }
+        marked.clear();
+    }
+    inline bool empty() const { return marked.empty(); }
+    inline size_t size() const { return marked.size(); }
+    inline const_iterator begin() const { return marked.begin(); }
+    inline const_iterator end() const { return marked.end(); }
+
+private:
+    boost::dynamic_bitset<> is_marked_bits;
+    std::vector<Idx<T>> marked;
 };
 
 } // namespace routing
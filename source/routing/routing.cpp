@@ -87,10 +87,12 @@ bool use_crow_fly(const type::EntryPoint& point, const type::StopPoint* stop_poi
         //we handle the main_stop_area of an admin here
         //we want a crowfly for all main_stop_areas of an admin,
         //even if the stop_area is not in the admin
-        auto admin = data.geo_ref->admins[data.geo_ref->admin_map[point.uri]];
-        auto it = find_if(begin(admin->main_stop_areas), end(admin->main_stop_areas),
+        const auto& main_stop_areas = data.pt_data->main_stop_areas_by_admin;
+        auto it_admin = main_stop_areas.find(data.geo_ref->admin_map[point.uri]);
+        if (it_admin == main_stop_areas.end()) { return false; }
+        auto it = find_if(begin(it_admin->second), end(it_admin->second),
                 [stop_point](const type::StopArea* stop_area){return stop_area == stop_point->stop_area;});
-        return it != end(admin->main_stop_areas);
+        return it != end(it_admin->second);
     }else{
         //if the request is on any other type we don't want a crowfly section
         return false;
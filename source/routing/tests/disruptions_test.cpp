@@ -83,3 +83,24 @@ BOOST_AUTO_TEST_CASE(ok_before_and_after_disruption) {
     resp = w.dispatch(req);
     BOOST_REQUIRE(resp.journeys_size() != 0);
 }
+
+// the clone shares the street network and the fares with its source,
+// only the public transport data is cloned
+BOOST_AUTO_TEST_CASE(clone_shares_street_network) {
+    routing_api_data<normal_speed_provider> data;
+    auto* admin = data.b.data->geo_ref->admins.front();
+    for (auto* sa: data.b.data->pt_data->stop_areas) { sa->admin_list.push_back(admin); }
+    DataManager<navitia::type::Data> data_manager;
+    data_manager.set_data(data.b.data.release());
+    const auto source = data_manager.get_data();
+
+    const auto data_cloned = data_manager.get_data_clone();
+    BOOST_CHECK_EQUAL(data_cloned->geo_ref, source->geo_ref);
+    BOOST_CHECK_EQUAL(data_cloned->fare, source->fare);
+    BOOST_CHECK_NE(data_cloned->pt_data.get(), source->pt_data.get());
+    BOOST_REQUIRE_EQUAL(data_cloned->pt_data->stop_areas.size(), source->pt_data->stop_areas.size());
+    for (const auto* sa: data_cloned->pt_data->stop_areas) {
+        BOOST_REQUIRE_EQUAL(sa->admin_list.size(), 1);
+        BOOST_CHECK_EQUAL(sa->admin_list.front(), admin);
+    }
+}
@@ -2203,3 +2203,50 @@ BOOST_FIXTURE_TEST_CASE(test_get_next_dep_overnight_midnight_case, midnight_freq
 
     BOOST_REQUIRE_EQUAL(next_dt, DateTimeUtils::set(1, 17 * 60 * 60 + 30));
 }
+
+/*
+ * The cache built by several threads must be the one built by only one
+ * thread, and the warmed up entries must not be built again.
+ */
+BOOST_AUTO_TEST_CASE(parallel_cache_and_warm_up) {
+    ed::builder b("20120614");
+    b.vj("A", "11")("stop1", 8000, 8050)("stop2", 8100, 8150)("stop3", 8200, 8250);
+    b.vj("A", "11")("stop1", 9000, 9050)("stop2", 9100, 9150)("stop3", 9200, 9250);
+    b.vj("B", "01")("stop2", 8500, 8550)("stop4", 8600, 8650);
+    b.vj("C", "10")("stop3", 7000, 7050)("stop1", 7100, 7150);
+    b.finish();
+    b.data->pt_data->index();
+    b.data->build_uri();
+    b.data->build_raptor();
+    const auto& data_raptor = *b.data->dataRaptor;
+
+    CachedNextStopTimeManager sequential(data_raptor, 10, 1);
+    CachedNextStopTimeManager parallel(data_raptor, 10, 4);
+    const type::AccessibiliteParams accessibilite_params;
+    NextStopTimeWarmUp policy;
+    policy.nb_days = 3;
+    // two threads warming up the same policy
+    ThreadPool warm_up_pool(1);
+    auto warm_up_task = warm_up_pool.submit([&]() { parallel.warm_up(DateTimeUtils::set(0, 0), policy); });
+    parallel.warm_up(DateTimeUtils::set(0, 0), policy);
+    warm_up_task.get();
+    BOOST_CHECK_EQUAL(parallel.get_stats().nb_cache_miss, 3);
+
+    for (unsigned day = 0; day < 3; ++day) {
+        const auto from = DateTimeUtils::set(day, 0);
+        const auto seq_cache = sequential.load(from, nt::RTLevel::Base, accessibilite_params);
+        const auto par_cache = parallel.load(from, nt::RTLevel::Base, accessibilite_params);
+        for (const auto& jpp: data_raptor.jp_container.get_jpps()) {
+            for (const auto event: {StopEvent::pick_up, StopEvent::drop_off}) {
+                for (DateTime dt = from; dt < from + 2 * DateTimeUtils::SECONDS_PER_DAY; dt += 500) {
+                    const bool clockwise = event == StopEvent::pick_up;
+                    BOOST_CHECK(seq_cache->next_stop_time(event, jpp.first, dt, clockwise)
+                                == par_cache->next_stop_time(event, jpp.first, dt, clockwise));
+                }
+            }
+        }
+    }
+    const auto stats = parallel.get_stats();
+    BOOST_CHECK_EQUAL(stats.nb_cache_miss, 3);
+    BOOST_CHECK_EQUAL(stats.nb_calls, 6);
+}
@@ -34,6 +34,7 @@ www.navitia.io
 #include "routing/raptor.h"
 #include "routing/routing.h"
 #include "ed/build_helper.h"
+#include <set>
 #include "tests/utils_test.h"
 
 struct logger_initialized {
@@ -45,6 +46,31 @@ using namespace navitia;
 using namespace routing;
 namespace bt = boost::posix_time;
 
+// The journeys of compute(raptor), the first pass of raptor being done
+// by the trip based engine, must be the same as with the journey
+// pattern scan
+template<typename F>
+static std::vector<Path> check_trip_based(type::Data& data, const F& compute) {
+    data.dataRaptor->load_trip_transfers(*data.pt_data);
+    RAPTOR raptor(data);
+    RAPTOR raptor_without_trip_based(data);
+    raptor_without_trip_based.trip_based_first_pass = false;
+
+    const std::vector<Path> res = compute(raptor);
+    const std::vector<Path> expected = compute(raptor_without_trip_based);
+    BOOST_CHECK(raptor.trip_based && raptor.trip_based->nb_first_passes > 0);
+    BOOST_CHECK(! raptor_without_trip_based.trip_based);
+    BOOST_REQUIRE_EQUAL(res.size(), expected.size());
+    for (size_t i = 0; i < res.size(); ++i) {
+        BOOST_CHECK_EQUAL(res[i].nb_changes, expected[i].nb_changes);
+        BOOST_REQUIRE_EQUAL(res[i].items.size(), expected[i].items.size());
+        for (size_t j = 0; j < res[i].items.size(); ++j) {
+            BOOST_CHECK_EQUAL(res[i].items[j].print(), expected[i].items[j].print());
+        }
+    }
+    return res;
+}
+
 BOOST_AUTO_TEST_CASE(direct){
     ed::builder b("20120614");
     b.vj("A")("stop1", 8000, 8050)("stop2", 8100,8150);
@@ -126,8 +152,10 @@ BOOST_AUTO_TEST_CASE(change){
     RAPTOR raptor(*(b.data));
     type::PT_Data & d = *b.data->pt_data;
 
-    auto res1 = raptor.compute(d.stop_areas[0], d.stop_areas[4], 7900, 0, DateTimeUtils::inf,
-            type::RTLevel::Base, 2_min, true);
+    auto res1 = check_trip_based(*b.data, [&](RAPTOR& r) {
+        return r.compute(d.stop_areas[0], d.stop_areas[4], 7900, 0, DateTimeUtils::inf,
+                type::RTLevel::Base, 2_min, true);
+    });
     BOOST_REQUIRE_EQUAL(res1.size(), 1);
 
     auto res = res1.back();
@@ -153,8 +181,10 @@ BOOST_AUTO_TEST_CASE(change){
     BOOST_CHECK_EQUAL(DateTimeUtils::date(to_datetime(res.items[0].arrival, *(b.data))), 0);
     BOOST_CHECK_EQUAL(DateTimeUtils::date(to_datetime(res.items[1].arrival, *(b.data))), 0);
 
-    res1 = raptor.compute(d.stop_areas[0], d.stop_areas[4], 7900, 0, DateTimeUtils::set(0,8500),
-            type::RTLevel::Base, 2_min, true);
+    res1 = check_trip_based(*b.data, [&](RAPTOR& r) {
+        return r.compute(d.stop_areas[0], d.stop_areas[4], 7900, 0, DateTimeUtils::set(0,8500),
+                type::RTLevel::Base, 2_min, true);
+    });
     BOOST_REQUIRE_EQUAL(res1.size(), 1);
 
     res = res1.back();
@@ -175,8 +205,10 @@ BOOST_AUTO_TEST_CASE(change){
     BOOST_CHECK_EQUAL(DateTimeUtils::date(to_datetime(res.items[0].arrival, *(b.data))), 0);
     BOOST_CHECK_EQUAL(DateTimeUtils::date(to_datetime(res.items[1].arrival, *(b.data))), 0);
 
-    res1 = raptor.compute(d.stop_areas[0], d.stop_areas[4], 7900, 0, DateTimeUtils::set(0, 8401),
-            type::RTLevel::Base, 2_min, true);
+    res1 = check_trip_based(*b.data, [&](RAPTOR& r) {
+        return r.compute(d.stop_areas[0], d.stop_areas[4], 7900, 0, DateTimeUtils::set(0, 8401),
+                type::RTLevel::Base, 2_min, true);
+    });
     BOOST_REQUIRE_EQUAL(res1.size(), 1);
 
     res = res1.back();
@@ -198,8 +230,10 @@ BOOST_AUTO_TEST_CASE(change){
     BOOST_CHECK_EQUAL(DateTimeUtils::date(to_datetime(res.items[1].arrival, *(b.data))), 0);
 
 
-    res1 = raptor.compute(d.stop_areas[0], d.stop_areas[4], 7900, 0, DateTimeUtils::set(0, 8400),
-            type::RTLevel::Base, 2_min, true);
+    res1 = check_trip_based(*b.data, [&](RAPTOR& r) {
+        return r.compute(d.stop_areas[0], d.stop_areas[4], 7900, 0, DateTimeUtils::set(0, 8400),
+                type::RTLevel::Base, 2_min, true);
+    });
     BOOST_REQUIRE_EQUAL(res1.size(), 0);
 }
 /****
@@ -243,8 +277,10 @@ BOOST_AUTO_TEST_CASE(different_connection_time) {
     RAPTOR raptor(*(b.data));
     type::PT_Data & d = *b.data->pt_data;
 
-    auto res1 = raptor.compute(d.stop_areas_map["A"], d.stop_areas_map["D"], 7*3600, 0, DateTimeUtils::inf,
-            type::RTLevel::Base, 2_min, true);
+    auto res1 = check_trip_based(*b.data, [&](RAPTOR& r) {
+        return r.compute(d.stop_areas_map["A"], d.stop_areas_map["D"], 7*3600, 0, DateTimeUtils::inf,
+                type::RTLevel::Base, 2_min, true);
+    });
     BOOST_REQUIRE_EQUAL(res1.size(), 1);
 
     auto res = res1.back();
@@ -253,8 +289,10 @@ BOOST_AUTO_TEST_CASE(different_connection_time) {
     BOOST_CHECK_EQUAL(DateTimeUtils::date(to_datetime(res.items.back().arrival, *(b.data))), 0);
     BOOST_CHECK_EQUAL(DateTimeUtils::hour(to_datetime(res.items.back().arrival, *(b.data))), 7*3600 + 15*60);
 
-    res1 = raptor.compute(d.stop_areas_map["D"], d.stop_areas_map["A"], 7*3600, 0, DateTimeUtils::inf,
-            type::RTLevel::Base, 2_min, true);
+    res1 = check_trip_based(*b.data, [&](RAPTOR& r) {
+        return r.compute(d.stop_areas_map["D"], d.stop_areas_map["A"], 7*3600, 0, DateTimeUtils::inf,
+                type::RTLevel::Base, 2_min, true);
+    });
     BOOST_REQUIRE_EQUAL(res1.size(), 1);
 
     res = res1.back();
@@ -278,8 +316,10 @@ BOOST_AUTO_TEST_CASE(over_midnight){
     RAPTOR raptor(*(b.data));
     type::PT_Data & d = *b.data->pt_data;
 
-    auto res1 = raptor.compute(d.stop_areas[0], d.stop_areas[2], "22:00"_t, 0, DateTimeUtils::inf,
-            type::RTLevel::Base, 2_min, true);
+    auto res1 = check_trip_based(*b.data, [&](RAPTOR& r) {
+        return r.compute(d.stop_areas[0], d.stop_areas[2], "22:00"_t, 0, DateTimeUtils::inf,
+                type::RTLevel::Base, 2_min, true);
+    });
     BOOST_REQUIRE_EQUAL(res1.size(), 1);
 
     auto res = res1.back();
@@ -293,8 +333,10 @@ BOOST_AUTO_TEST_CASE(over_midnight){
     BOOST_CHECK_EQUAL(DateTimeUtils::date(to_datetime(res.items[0].departure, *(b.data))), 0);
     BOOST_CHECK_EQUAL(DateTimeUtils::date(to_datetime(res.items[1].arrival, *(b.data))), 1);
 
-    res1 = raptor.compute(d.stop_areas[0], d.stop_areas[2], "22:00"_t, 0, DateTimeUtils::set(1, 8500),
-            type::RTLevel::Base, 2_min, true);
+    res1 = check_trip_based(*b.data, [&](RAPTOR& r) {
+        return r.compute(d.stop_areas[0], d.stop_areas[2], "22:00"_t, 0, DateTimeUtils::set(1, 8500),
+                type::RTLevel::Base, 2_min, true);
+    });
     std::cout << d.stop_areas[0]->uri << std::endl;
     std::cout << d.stop_areas[2]->uri << std::endl;
     BOOST_REQUIRE_EQUAL(res1.size(), 1);
@@ -309,8 +351,10 @@ BOOST_AUTO_TEST_CASE(over_midnight){
     BOOST_CHECK_EQUAL(DateTimeUtils::date(to_datetime(res.items[0].departure, *(b.data))), 0);
     BOOST_CHECK_EQUAL(DateTimeUtils::date(to_datetime(res.items[1].arrival, *(b.data))), 1);
 
-    res1 = raptor.compute(d.stop_areas[0], d.stop_areas[2], 22*3600, 0, DateTimeUtils::set(1, 20*60 + 1),
-            type::RTLevel::Base, 2_min, true);
+    res1 = check_trip_based(*b.data, [&](RAPTOR& r) {
+        return r.compute(d.stop_areas[0], d.stop_areas[2], 22*3600, 0, DateTimeUtils::set(1, 20*60 + 1),
+                type::RTLevel::Base, 2_min, true);
+    });
     BOOST_REQUIRE_EQUAL(res1.size(), 1);
 
     res = res1.back();
@@ -323,8 +367,10 @@ BOOST_AUTO_TEST_CASE(over_midnight){
     BOOST_CHECK_EQUAL(DateTimeUtils::date(to_datetime(res.items[0].departure, *(b.data))), 0);
     BOOST_CHECK_EQUAL(DateTimeUtils::date(to_datetime(res.items[1].arrival, *(b.data))), 1);
 
-    res1 = raptor.compute(d.stop_areas[0], d.stop_areas[2], 22*3600, 0, DateTimeUtils::set(1, 20*60),
-            type::RTLevel::Base, 2_min, true);
+    res1 = check_trip_based(*b.data, [&](RAPTOR& r) {
+        return r.compute(d.stop_areas[0], d.stop_areas[2], 22*3600, 0, DateTimeUtils::set(1, 20*60),
+                type::RTLevel::Base, 2_min, true);
+    });
     BOOST_REQUIRE_EQUAL(res1.size(), 0);
 }
 
@@ -461,30 +507,40 @@ BOOST_AUTO_TEST_CASE(validity_pattern){
     RAPTOR raptor(*(b.data));
     type::PT_Data & d = *b.data->pt_data;
 
-    auto res1 = raptor.compute(d.stop_areas_map["stop1"], d.stop_areas_map["stop2"], 7800, 0, DateTimeUtils::inf, type::RTLevel::Base, 2_min, true);
+    auto res1 = check_trip_based(*b.data, [&](RAPTOR& r) {
+        return r.compute(d.stop_areas_map["stop1"], d.stop_areas_map["stop2"], 7800, 0, DateTimeUtils::inf, type::RTLevel::Base, 2_min, true);
+    });
     BOOST_REQUIRE_EQUAL(res1.size(), 1);
 
     auto res = res1.back();
     BOOST_REQUIRE_EQUAL(res.items.size(), 1);
     BOOST_CHECK_EQUAL(res.items[0].arrival.time_of_day().total_seconds(), 9200);
 
-    res1 = raptor.compute(d.stop_areas_map["stop1"], d.stop_areas_map["stop2"], 7800, 0, DateTimeUtils::set(0, 10000), type::RTLevel::Base, 2_min, true);
+    res1 = check_trip_based(*b.data, [&](RAPTOR& r) {
+        return r.compute(d.stop_areas_map["stop1"], d.stop_areas_map["stop2"], 7800, 0, DateTimeUtils::set(0, 10000), type::RTLevel::Base, 2_min, true);
+    });
     BOOST_REQUIRE_EQUAL(res1.size(), 1);
     res = res1.back();
     BOOST_REQUIRE_EQUAL(res.items.size(), 1);
     BOOST_CHECK_EQUAL(res.items[0].arrival.time_of_day().total_seconds(), 9200);
 
 
-    res1 = raptor.compute(d.stop_areas_map["stop1"], d.stop_areas_map["stop2"], 7800, 0, DateTimeUtils::set(0, 9201), type::RTLevel::Base, 2_min, true);
+    res1 = check_trip_based(*b.data, [&](RAPTOR& r) {
+        return r.compute(d.stop_areas_map["stop1"], d.stop_areas_map["stop2"], 7800, 0, DateTimeUtils::set(0, 9201), type::RTLevel::Base, 2_min, true);
+    });
     BOOST_REQUIRE_EQUAL(res1.size(), 1);
     res = res1.back();
     BOOST_REQUIRE_EQUAL(res.items.size(), 1);
     BOOST_CHECK_EQUAL(res.items[0].arrival.time_of_day().total_seconds(), 9200);
 
-    res1 = raptor.compute(d.stop_areas_map["stop1"], d.stop_areas_map["stop2"], 7800, 0, DateTimeUtils::set(0, 9200), type::RTLevel::Base, 2_min, true);
+    res1 = check_trip_based(*b.data, [&](RAPTOR& r) {
+        return r.compute(d.stop_areas_map["stop1"], d.stop_areas_map["stop2"], 7800, 0, DateTimeUtils::set(0, 9200), type::RTLevel::Base, 2_min, true);
+    });
     BOOST_REQUIRE_EQUAL(res1.size(), 0);
 
-    res1 = raptor.compute(d.stop_areas_map["stop1"], d.stop_areas_map["stop2"], 7900, 2, DateTimeUtils::inf, type::RTLevel::Base, 2_min, true);
+    res1 = check_trip_based(*b.data, [&](RAPTOR& r) {
+        return r.compute(d.stop_areas_map["stop1"], d.stop_areas_map["stop2"], 7900, 2, DateTimeUtils::inf, type::RTLevel::Base, 2_min, true);
+    });
     BOOST_REQUIRE_EQUAL(res1.size(), 0);
 }
 
@@ -527,6 +583,30 @@ BOOST_AUTO_TEST_CASE(forbidden_uri){
 }
 
 
+// the valid jpps are shared by the requests with the same filters
+BOOST_AUTO_TEST_CASE(valid_jpps_cache){
+    ed::builder b("20120614");
+    b.vj("A")("stop1", 8000)("stop2", 8100,8150);
+    b.vj("B")("stop3", 9500)("stop4", 10000);
+
+    b.data->pt_data->index(); b.finish();
+    b.data->build_raptor();
+    b.data->build_uri();
+    RAPTOR raptor(*b.data);
+    RAPTOR other_raptor(*b.data);
+
+    raptor.set_valid_jp_and_jpp(0, {}, {"stop2", "B"}, type::RTLevel::Base);
+    other_raptor.set_valid_jp_and_jpp(0, {}, {"B", "stop2", "B"}, type::RTLevel::Base);
+    BOOST_CHECK_EQUAL(raptor.valid_jpps, other_raptor.valid_jpps);
+    BOOST_CHECK(! raptor.valid_jpps->valid_stop_points[b.data->pt_data->stop_points_map["stop2"]->idx]);
+    BOOST_CHECK(raptor.valid_jpps->jpps_from_sp[SpIdx(*b.data->pt_data->stop_points_map["stop3"])].empty());
+    BOOST_CHECK_EQUAL(raptor.valid_jpps->jpps_from_sp[SpIdx(*b.data->pt_data->stop_points_map["stop1"])].size(), 1);
+
+    other_raptor.set_valid_jp_and_jpp(0, {}, {"stop2"}, type::RTLevel::Base);
+    BOOST_CHECK_NE(raptor.valid_jpps, other_raptor.valid_jpps);
+    BOOST_CHECK_EQUAL(other_raptor.valid_jpps->jpps_from_sp[SpIdx(*b.data->pt_data->stop_points_map["stop3"])].size(), 1);
+}
+
 BOOST_AUTO_TEST_CASE(marche_a_pied_milieu){
     ed::builder b("20120614");
     b.vj("A", "11111111", "", true)("stop1", 8000,8050)("stop2", 8200,8250);
@@ -544,7 +624,9 @@ BOOST_AUTO_TEST_CASE(marche_a_pied_milieu){
     RAPTOR raptor(*(b.data));
     type::PT_Data & d = *b.data->pt_data;
 
-    auto res1 = raptor.compute(d.stop_areas_map["stop1"], d.stop_areas_map["stop4"], 7900, 0, DateTimeUtils::inf, type::RTLevel::Base, 2_min, true);
+    auto res1 = check_trip_based(*b.data, [&](RAPTOR& r) {
+        return r.compute(d.stop_areas_map["stop1"], d.stop_areas_map["stop4"], 7900, 0, DateTimeUtils::inf, type::RTLevel::Base, 2_min, true);
+    });
     BOOST_REQUIRE_EQUAL(res1.size(), 1);
 
     auto res = res1.back();
@@ -552,7 +634,9 @@ BOOST_AUTO_TEST_CASE(marche_a_pied_milieu){
     BOOST_REQUIRE_EQUAL(res.items.size(), 4);
     BOOST_CHECK_EQUAL(res.items[3].arrival.time_of_day().total_seconds(), 9200);
 
-    res1 = raptor.compute(d.stop_areas_map["stop1"], d.stop_areas_map["stop4"], 7900, 0, DateTimeUtils::set(0,10000), type::RTLevel::Base, 2_min, true);
+    res1 = check_trip_based(*b.data, [&](RAPTOR& r) {
+        return r.compute(d.stop_areas_map["stop1"], d.stop_areas_map["stop4"], 7900, 0, DateTimeUtils::set(0,10000), type::RTLevel::Base, 2_min, true);
+    });
     BOOST_REQUIRE_EQUAL(res1.size(), 1);
 
     res = res1.back();
@@ -560,7 +644,9 @@ BOOST_AUTO_TEST_CASE(marche_a_pied_milieu){
     BOOST_REQUIRE_EQUAL(res.items.size(), 4);
     BOOST_CHECK_EQUAL(res.items[3].arrival.time_of_day().total_seconds(), 9200);
 
-    res1 = raptor.compute(d.stop_areas_map["stop1"], d.stop_areas_map["stop4"], 7900, 0, DateTimeUtils::set(0,9201), type::RTLevel::Base, 2_min, true);
+    res1 = check_trip_based(*b.data, [&](RAPTOR& r) {
+        return r.compute(d.stop_areas_map["stop1"], d.stop_areas_map["stop4"], 7900, 0, DateTimeUtils::set(0,9201), type::RTLevel::Base, 2_min, true);
+    });
     BOOST_REQUIRE_EQUAL(res1.size(), 1);
 
     res = res1.back();
@@ -568,7 +654,9 @@ BOOST_AUTO_TEST_CASE(marche_a_pied_milieu){
     BOOST_REQUIRE_EQUAL(res.items.size(), 4);
     BOOST_CHECK_EQUAL(res.items[3].arrival.time_of_day().total_seconds(), 9200);
 
-    res1 = raptor.compute(d.stop_areas_map["stop1"], d.stop_areas_map["stop4"], 7900, 0, DateTimeUtils::set(0,9200), type::RTLevel::Base, 2_min, true);
+    res1 = check_trip_based(*b.data, [&](RAPTOR& r) {
+        return r.compute(d.stop_areas_map["stop1"], d.stop_areas_map["stop4"], 7900, 0, DateTimeUtils::set(0,9200), type::RTLevel::Base, 2_min, true);
+    });
     BOOST_REQUIRE_EQUAL(res1.size(), 0);
 }
 
@@ -639,7 +727,9 @@ BOOST_AUTO_TEST_CASE(test_rattrapage) {
     RAPTOR raptor(*(b.data));
     type::PT_Data & d = *b.data->pt_data;
 
-    auto res1 = raptor.compute(d.stop_areas_map["stop1"], d.stop_areas_map["stop4"], 8*3600 + 15*60, 0, DateTimeUtils::inf, type::RTLevel::Base, 2_min, true);
+    auto res1 = check_trip_based(*b.data, [&](RAPTOR& r) {
+        return r.compute(d.stop_areas_map["stop1"], d.stop_areas_map["stop4"], 8*3600 + 15*60, 0, DateTimeUtils::inf, type::RTLevel::Base, 2_min, true);
+    });
 
 
     BOOST_REQUIRE_EQUAL(res1.size(), 2);
@@ -664,7 +754,9 @@ BOOST_AUTO_TEST_CASE(test_rattrapage) {
                 p.items[4].arrival.time_of_day().total_seconds() == 8*3600+45*60;
     }));
 
-    res1 = raptor.compute(d.stop_areas_map["stop1"], d.stop_areas_map["stop4"], 8*3600 + 15*60, 0, DateTimeUtils::set(0, (9*3600+45*60)), type::RTLevel::Base, 2_min, true);
+    res1 = check_trip_based(*b.data, [&](RAPTOR& r) {
+        return r.compute(d.stop_areas_map["stop1"], d.stop_areas_map["stop4"], 8*3600 + 15*60, 0, DateTimeUtils::set(0, (9*3600+45*60)), type::RTLevel::Base, 2_min, true);
+    });
 
     BOOST_REQUIRE_EQUAL(res1.size(), 2);
     BOOST_CHECK(std::any_of(res1.begin(), res1.end(),
@@ -687,7 +779,9 @@ BOOST_AUTO_TEST_CASE(test_rattrapage) {
                 p.items[4].arrival.time_of_day().total_seconds() == 8*3600+45*60;
     }
     ));
-    res1 = raptor.compute(d.stop_areas_map["stop1"], d.stop_areas_map["stop4"], 8*3600 + 15*60, 0, DateTimeUtils::set(0, 8*3600+45*60+1), type::RTLevel::Base, 2_min, true);
+    res1 = check_trip_based(*b.data, [&](RAPTOR& r) {
+        return r.compute(d.stop_areas_map["stop1"], d.stop_areas_map["stop4"], 8*3600 + 15*60, 0, DateTimeUtils::set(0, 8*3600+45*60+1), type::RTLevel::Base, 2_min, true);
+    });
 
     // As the bound is tight, we now only have the shortest trip.
     BOOST_REQUIRE_EQUAL(res1.size(), 1);
@@ -713,7 +807,9 @@ BOOST_AUTO_TEST_CASE(test_rattrapage) {
 
 
 
-    res1 = raptor.compute(d.stop_areas_map["stop1"], d.stop_areas_map["stop4"], 8*3600 + 15*60, 0, DateTimeUtils::set(0, 8*3600+45*60), type::RTLevel::Base, 2_min, true);
+    res1 = check_trip_based(*b.data, [&](RAPTOR& r) {
+        return r.compute(d.stop_areas_map["stop1"], d.stop_areas_map["stop4"], 8*3600 + 15*60, 0, DateTimeUtils::set(0, 8*3600+45*60), type::RTLevel::Base, 2_min, true);
+    });
 
     BOOST_REQUIRE_EQUAL(res1.size(), 0);
 }
@@ -1103,7 +1199,9 @@ BOOST_AUTO_TEST_CASE(multiples_vj) {
     RAPTOR raptor(*(b.data));
     type::PT_Data & d = *b.data->pt_data;
 
-    auto res1 = raptor.compute(d.stop_areas_map["stop1"], d.stop_areas_map["stop4"], 5*60, 0, DateTimeUtils::inf, type::RTLevel::Base, 2_min, true);
+    auto res1 = check_trip_based(*b.data, [&](RAPTOR& r) {
+        return r.compute(d.stop_areas_map["stop1"], d.stop_areas_map["stop4"], 5*60, 0, DateTimeUtils::inf, type::RTLevel::Base, 2_min, true);
+    });
 
     BOOST_CHECK_EQUAL(res1.size(), 1);
 }
@@ -1148,8 +1246,10 @@ BOOST_AUTO_TEST_CASE(max_transfers){
 
     for(uint32_t nb_transfers=0; nb_transfers<=2; ++nb_transfers) {
         //        type::Properties p;
-        auto res1 = raptor.compute(d.stop_areas_map["stop1"], d.stop_areas_map["stop2"], 7900, 0, DateTimeUtils::inf,
-                nt::RTLevel::Base, 2_min, true, type::AccessibiliteParams(), nb_transfers);
+        auto res1 = check_trip_based(*b.data, [&](RAPTOR& r) {
+            return r.compute(d.stop_areas_map["stop1"], d.stop_areas_map["stop2"], 7900, 0, DateTimeUtils::inf,
+                    nt::RTLevel::Base, 2_min, true, type::AccessibiliteParams(), nb_transfers);
+        });
         BOOST_REQUIRE(res1.size()>=1);
         for(auto r : res1) {
             BOOST_REQUIRE(r.nb_changes <= nb_transfers);
@@ -1316,7 +1416,9 @@ BOOST_AUTO_TEST_CASE(less_fallback) {
     destinations[SpIdx(*d.stop_areas_map["stop1"]->stop_point_list.front())] = 560_s;
     destinations[SpIdx(*d.stop_areas_map["stop2"]->stop_point_list.front())] = 320_s;
     destinations[SpIdx(*d.stop_areas_map["stop3"]->stop_point_list.front())] = 0_s;
-    auto res1 = raptor.compute_all(departs, destinations, DateTimeUtils::set(0, 8*3600), type::RTLevel::Base, 2_min);
+    auto res1 = check_trip_based(*b.data, [&](RAPTOR& r) {
+        return r.compute_all(departs, destinations, DateTimeUtils::set(0, 8*3600), type::RTLevel::Base, 2_min);
+    });
 
     BOOST_REQUIRE_EQUAL(res1.size(), 2);
     BOOST_CHECK(std::any_of(res1.begin(), res1.end(),
@@ -1369,7 +1471,9 @@ BOOST_AUTO_TEST_CASE(pareto_front) {
     // We are going to J point, so we add the walking times
     destinations[SpIdx(*d.stop_areas_map["stop2"]->stop_point_list.front())] = 15_min;
     destinations[SpIdx(*d.stop_areas_map["stop3"]->stop_point_list.front())] = 0_s;
-    auto res1 = raptor.compute_all(departs, destinations, DateTimeUtils::set(0, 8*3600), type::RTLevel::Base, 2_min);
+    auto res1 = check_trip_based(*b.data, [&](RAPTOR& r) {
+        return r.compute_all(departs, destinations, DateTimeUtils::set(0, 8*3600), type::RTLevel::Base, 2_min);
+    });
 
     BOOST_REQUIRE_EQUAL(res1.size(), 2);
     BOOST_CHECK(std::any_of(res1.begin(), res1.end(),
@@ -1632,6 +1736,307 @@ BOOST_AUTO_TEST_CASE(finish_on_foot_path) {
     BOOST_CHECK_EQUAL(raptor.count, 2);
 }
 
+/*
+ *    A --------------- B --------------- C
+ *
+ * l1   ----------------x---------------->
+ *
+ *    D --------------- E
+ *
+ * l2   ---------------->
+ *
+ * l2 is not reachable from A, raptor must never explore it: only the
+ * journey patterns of the stop points improved during a round are
+ * explored during the next one
+ * */
+BOOST_AUTO_TEST_CASE(explore_only_marked_journey_patterns) {
+    ed::builder b("20120614");
+    b.vj("l1", "1", "", true)("A", 8000, 8000)("B", 8100, 8100)("C", 8300, 8300);
+    b.vj("l2", "1", "", true)("D", 8000, 8000)("E", 8100, 8100);
+
+    b.connection("B", "B", 10);
+    b.connection("C", "C", 10);
+
+    b.data->pt_data->index();
+    b.data->build_uri();
+    b.data->build_raptor();
+    RAPTOR raptor(*(b.data));
+    type::PT_Data& d = *b.data->pt_data;
+
+    routing::map_stop_point_duration departs;
+    departs[routing::SpIdx(*d.stop_points_map["A"])] = {};
+
+    raptor.first_raptor_loop(departs, DateTimeUtils::set(0, 7900), type::RTLevel::Base, DateTimeUtils::inf,
+                             std::numeric_limits<uint32_t>::max(), {}, {}, true);
+
+    BOOST_CHECK_EQUAL(raptor.count, 2);
+    // l1 is explored at each round, l2 is never explored
+    BOOST_CHECK_EQUAL(raptor.nb_rounds, 2);
+    BOOST_CHECK_EQUAL(raptor.nb_explored_jps, 2);
+    BOOST_CHECK(raptor.labels[1].pt_is_initialized(routing::SpIdx(*d.stop_points_map["C"])));
+    BOOST_CHECK(! raptor.labels[1].pt_is_initialized(routing::SpIdx(*d.stop_points_map["E"])));
+}
+
+/*
+ *    A --------------- B --------------- C --------------- D
+ *
+ * l1   ---------------------------------->
+ * l2                                     ----------------->
+ *
+ * The destination is B.  Once B is reached, going on to D cannot give
+ * a better journey: with the target pruning, l2 is never explored.
+ * */
+BOOST_AUTO_TEST_CASE(target_pruning) {
+    ed::builder b("20120614");
+    b.vj("l1")("A", "08:00"_t)("B", "08:10"_t)("C", "08:20"_t);
+    b.vj("l2")("C", "08:30"_t)("D", "08:40"_t);
+    b.connection("B", "B", 120);
+    b.connection("C", "C", 120);
+
+    b.data->pt_data->index();
+    b.finish();
+    b.data->build_raptor();
+    b.data->build_uri();
+    type::PT_Data& d = *b.data->pt_data;
+
+    routing::map_stop_point_duration departures, arrivals;
+    departures[SpIdx(*d.stop_points_map["A"])] = 0_s;
+    arrivals[SpIdx(*d.stop_points_map["B"])] = 0_s;
+    const auto sp_d = SpIdx(*d.stop_points_map["D"]);
+
+    RAPTOR raptor(*b.data);
+    raptor.set_targets(arrivals, {});
+    raptor.first_raptor_loop(departures, DateTimeUtils::set(0, "07:55"_t), type::RTLevel::Base,
+                             DateTimeUtils::inf, std::numeric_limits<uint32_t>::max(), {}, {}, true);
+    BOOST_CHECK_EQUAL(raptor.target_bound, DateTimeUtils::set(0, "08:10"_t));
+    BOOST_CHECK(! raptor.labels[2].pt_is_initialized(sp_d));
+
+    RAPTOR raptor_without_pruning(*b.data);
+    raptor_without_pruning.target_pruning = false;
+    raptor_without_pruning.set_targets(arrivals, {});
+    raptor_without_pruning.first_raptor_loop(departures, DateTimeUtils::set(0, "07:55"_t), type::RTLevel::Base,
+                                             DateTimeUtils::inf, std::numeric_limits<uint32_t>::max(),
+                                             {}, {}, true);
+    BOOST_CHECK(raptor_without_pruning.labels[2].pt_is_initialized(sp_d));
+
+    // the pruning does not change the solutions
+    const auto res = raptor.compute_all(departures, arrivals, DateTimeUtils::set(0, "07:55"_t),
+                                        type::RTLevel::Base, 2_min);
+    const auto res_without_pruning = raptor_without_pruning.compute_all(
+        departures, arrivals, DateTimeUtils::set(0, "07:55"_t), type::RTLevel::Base, 2_min);
+    BOOST_REQUIRE_EQUAL(res.size(), 1);
+    BOOST_REQUIRE_EQUAL(res_without_pruning.size(), 1);
+    BOOST_CHECK_EQUAL(res[0].items.back().arrival, "20120614T081000"_dt);
+    BOOST_CHECK_EQUAL(res[0].items.back().arrival, res_without_pruning[0].items.back().arrival);
+
+    size_t nb_updated = 0, nb_updated_without_pruning = 0;
+    for (const auto nb: raptor.nb_updated_labels) { nb_updated += nb; }
+    for (const auto nb: raptor_without_pruning.nb_updated_labels) { nb_updated_without_pruning += nb; }
+    BOOST_CHECK_LT(nb_updated, nb_updated_without_pruning);
+}
+
+/*
+ * A1 ------------------ B             (20 min of walking to A1)
+ * A2 ------ X ------------------ C    (no walking to A2, 1 transfer)
+ *
+ * The journey to C arrives later but with less walking than the one to
+ * B: it is not dominated, thus the target pruning must keep it.
+ * */
+BOOST_AUTO_TEST_CASE(target_pruning_keeps_less_walking) {
+    ed::builder b("20120614");
+    b.vj("l1")("A1", "08:00"_t)("B", "08:10"_t);
+    b.vj("l2")("A2", "07:45"_t)("X", "07:55"_t);
+    b.vj("l3")("X", "08:05"_t)("C", "08:20"_t);
+    b.connection("X", "X", 120);
+
+    b.data->pt_data->index();
+    b.finish();
+    b.data->build_raptor();
+    b.data->build_uri();
+    type::PT_Data& d = *b.data->pt_data;
+
+    routing::map_stop_point_duration departures, arrivals;
+    departures[SpIdx(*d.stop_points_map["A1"])] = 20_min;
+    departures[SpIdx(*d.stop_points_map["A2"])] = 0_s;
+    arrivals[SpIdx(*d.stop_points_map["B"])] = 0_s;
+    arrivals[SpIdx(*d.stop_points_map["C"])] = 0_s;
+
+    RAPTOR raptor(*b.data);
+    RAPTOR raptor_without_pruning(*b.data);
+    raptor_without_pruning.target_pruning = false;
+    for (auto* r: {&raptor, &raptor_without_pruning}) {
+        const auto res = r->compute_all(departures, arrivals, DateTimeUtils::set(0, "07:40"_t),
+                                        type::RTLevel::Base, 2_min);
+        BOOST_REQUIRE_EQUAL(res.size(), 2);
+        std::set<std::string> arrival_sps;
+        for (const auto& path: res) {
+            arrival_sps.insert(path.items.back().stop_points.back()->uri);
+        }
+        BOOST_CHECK_EQUAL(arrival_sps.count("B"), 1);
+        BOOST_CHECK_EQUAL(arrival_sps.count("C"), 1);
+    }
+}
+
+/*
+ * The second passes run in parallel must give the same solutions as
+ * the sequential ones.
+ *
+ * A ---------------------------------------------- D    (0 transfer, slow)
+ * A -------------- B ----------------------------- D    (1 transfer)
+ * A ------ C ------ E ---------------------------- D    (2 transfers, fast)
+ * A ------ C ----------------- F                        (other destination)
+ * */
+BOOST_AUTO_TEST_CASE(parallel_second_passes) {
+    ed::builder b("20120614");
+    b.vj("l1")("A", "08:00"_t)("D", "10:00"_t);
+    b.vj("l2")("A", "08:05"_t)("B", "08:30"_t);
+    b.vj("l3")("B", "08:35"_t)("D", "09:00"_t);
+    b.vj("l4")("A", "08:10"_t)("C", "08:20"_t);
+    b.vj("l5")("C", "08:25"_t)("E", "08:30"_t)("F", "08:50"_t);
+    b.vj("l6")("E", "08:35"_t)("D", "08:45"_t);
+    for (const auto* sp: {"B", "C", "E"}) { b.connection(sp, sp, 120); }
+
+    b.data->pt_data->index();
+    b.finish();
+    b.data->build_raptor();
+    b.data->build_uri();
+    type::PT_Data& d = *b.data->pt_data;
+
+    routing::map_stop_point_duration departures, arrivals;
+    departures[SpIdx(*d.stop_points_map["A"])] = 0_s;
+    arrivals[SpIdx(*d.stop_points_map["D"])] = 0_s;
+    arrivals[SpIdx(*d.stop_points_map["F"])] = 10_min;
+
+    RAPTOR sequential_raptor(*b.data);
+    RAPTOR parallel_raptor(*b.data, 3);
+    for (const bool clockwise: {true, false}) {
+        const auto dt = DateTimeUtils::set(0, clockwise ? "07:55"_t : "10:05"_t);
+        const auto bound = clockwise ? DateTimeUtils::inf : DateTimeUtils::min;
+        const auto seq_res = sequential_raptor.compute_all(departures, arrivals, dt, type::RTLevel::Base, 2_min,
+                                                           bound, 10, {}, {}, clockwise);
+        const auto par_res = parallel_raptor.compute_all(departures, arrivals, dt, type::RTLevel::Base, 2_min,
+                                                         bound, 10, {}, {}, clockwise);
+
+        BOOST_REQUIRE_EQUAL(seq_res.size(), 3);
+        BOOST_REQUIRE_EQUAL(seq_res.size(), par_res.size());
+        for (size_t i = 0; i < seq_res.size(); ++i) {
+            BOOST_CHECK_EQUAL(seq_res[i].nb_changes, par_res[i].nb_changes);
+            BOOST_REQUIRE_EQUAL(seq_res[i].items.size(), par_res[i].items.size());
+            for (size_t j = 0; j < seq_res[i].items.size(); ++j) {
+                BOOST_CHECK_EQUAL(seq_res[i].items[j].departure, par_res[i].items[j].departure);
+                BOOST_CHECK_EQUAL(seq_res[i].items[j].arrival, par_res[i].items[j].arrival);
+            }
+        }
+    }
+}
+
+/*
+ * Profile computation between A and B from 08:00 to 09:00
+ *
+ * l1: A 08:00 -> B 08:20, A 08:30 -> B 08:50, A 09:00 -> B 09:20, A 09:30 -> B 09:50
+ * l2: A 08:05 -> C 08:10, l3: C 08:15 -> B 08:55 (dominated by l1 at 08:30)
+ * l4: A 08:40 -> D 08:45, l5: D 08:50 -> B 08:55 (leaves later, but with a transfer)
+ *
+ * The journeys leaving at 08:00, 08:30, 08:40 and 09:00 are expected.
+ * */
+/*
+ * The transfer from A to B at stop2 is removed as staying in A reaches
+ * stop3 earlier.  The forbidden stop points are not handled by the trip
+ * based engine, thus raptor does the first pass.
+ */
+BOOST_AUTO_TEST_CASE(trip_based_first_pass) {
+    ed::builder b("20120614");
+    b.vj("A")("stop1", "08:00"_t)("stop2", "08:10"_t)("stop3", "08:20"_t);
+    b.vj("B")("stop2", "08:15"_t)("stop3", "08:30"_t);
+    b.vj("C")("stop2", "08:15"_t)("stop4", "08:30"_t);
+    b.connection("stop2", "stop2", 120);
+    b.connection("stop3", "stop3", 120);
+
+    b.data->pt_data->index();
+    b.finish();
+    b.data->build_raptor();
+    b.data->build_uri();
+    b.data->dataRaptor->load_trip_transfers(*b.data->pt_data);
+    const auto& trip_transfers = *b.data->dataRaptor->trip_transfers;
+    BOOST_CHECK(trip_transfers.usable);
+    BOOST_CHECK_EQUAL(trip_transfers.nb_transfers(), 1);
+    BOOST_CHECK_EQUAL(trip_transfers.nb_reduced, 1);
+    const type::PT_Data& d = *b.data->pt_data;
+
+    auto res = check_trip_based(*b.data, [&](RAPTOR& r) {
+        return r.compute(d.stop_areas_map.at("stop1"), d.stop_areas_map.at("stop4"), "07:55"_t, 0,
+                         DateTimeUtils::inf, type::RTLevel::Base, 2_min, true);
+    });
+    BOOST_REQUIRE_EQUAL(res.size(), 1);
+    BOOST_CHECK_EQUAL(res[0].items.back().arrival, "20120614T083000"_dt);
+
+    res = check_trip_based(*b.data, [&](RAPTOR& r) {
+        return r.compute(d.stop_areas_map.at("stop1"), d.stop_areas_map.at("stop3"), "07:55"_t, 0,
+                         DateTimeUtils::inf, type::RTLevel::Base, 2_min, true);
+    });
+    BOOST_REQUIRE_EQUAL(res.size(), 1);
+    BOOST_CHECK_EQUAL(res[0].items.back().arrival, "20120614T082000"_dt);
+
+    RAPTOR raptor(*b.data);
+    res = raptor.compute(d.stop_areas_map.at("stop1"), d.stop_areas_map.at("stop3"), "07:55"_t, 0,
+                         DateTimeUtils::inf, type::RTLevel::Base, 2_min, true,
+                         type::AccessibiliteParams(), std::numeric_limits<uint32_t>::max(), {"stop2"});
+    BOOST_REQUIRE_EQUAL(res.size(), 1);
+    BOOST_REQUIRE(raptor.trip_based);
+    BOOST_CHECK_EQUAL(raptor.trip_based->nb_first_passes, 0);
+}
+
+BOOST_AUTO_TEST_CASE(profile_departure_window) {
+    ed::builder b("20120614");
+    b.vj("l1")("A", "08:00"_t)("B", "08:20"_t);
+    b.vj("l1")("A", "08:30"_t)("B", "08:50"_t);
+    b.vj("l1")("A", "09:00"_t)("B", "09:20"_t);
+    b.vj("l1")("A", "09:30"_t)("B", "09:50"_t);
+    b.vj("l2")("A", "08:05"_t)("C", "08:10"_t);
+    b.vj("l3")("C", "08:15"_t)("B", "08:55"_t);
+    b.vj("l4")("A", "08:40"_t)("D", "08:45"_t);
+    b.vj("l5")("D", "08:50"_t)("B", "08:55"_t);
+    b.connection("C", "C", 120);
+    b.connection("D", "D", 120);
+
+    b.data->pt_data->index();
+    b.finish();
+    b.data->build_raptor();
+    b.data->build_uri();
+    type::PT_Data& d = *b.data->pt_data;
+
+    routing::map_stop_point_duration departures, arrivals;
+    departures[SpIdx(*d.stop_points_map["A"])] = 0_s;
+    arrivals[SpIdx(*d.stop_points_map["B"])] = 0_s;
+
+    RAPTOR raptor(*b.data);
+    auto res = raptor.compute_profile(departures, arrivals, DateTimeUtils::set(0, "08:00"_t),
+                                      DateTimeUtils::set(0, "09:00"_t), type::RTLevel::Base, 2_min);
+
+    BOOST_REQUIRE_EQUAL(res.size(), 4);
+    BOOST_CHECK_EQUAL(res[0].items.front().departure, "20120614T080000"_dt);
+    BOOST_CHECK_EQUAL(res[0].items.back().arrival, "20120614T082000"_dt);
+    BOOST_CHECK_EQUAL(res[0].nb_changes, 0);
+    BOOST_CHECK_EQUAL(res[1].items.front().departure, "20120614T083000"_dt);
+    BOOST_CHECK_EQUAL(res[1].items.back().arrival, "20120614T085000"_dt);
+    BOOST_CHECK_EQUAL(res[1].nb_changes, 0);
+    BOOST_CHECK_EQUAL(res[2].items.front().departure, "20120614T084000"_dt);
+    BOOST_CHECK_EQUAL(res[2].items.back().arrival, "20120614T085500"_dt);
+    BOOST_CHECK_EQUAL(res[2].nb_changes, 1);
+    BOOST_CHECK_EQUAL(res[3].items.front().departure, "20120614T090000"_dt);
+    BOOST_CHECK_EQUAL(res[3].items.back().arrival, "20120614T092000"_dt);
+    BOOST_CHECK_EQUAL(res[3].nb_changes, 0);
+
+    // each journey is the one that compute_all finds at its departure
+    for (const auto& path: res) {
+        const auto dep = to_datetime(path.items.front().departure, *b.data);
+        auto res_all = raptor.compute_all(departures, arrivals, dep, type::RTLevel::Base, 2_min);
+        BOOST_CHECK(std::any_of(res_all.begin(), res_all.end(), [&](const Path& p) {
+            return p.items.back().arrival == path.items.back().arrival && p.nb_changes == path.nb_changes;
+        }));
+    }
+}
+
 // instance:
 // A---1---B=======B
 //         A---1---B=======B
@@ -1840,7 +2245,9 @@ BOOST_AUTO_TEST_CASE(dont_return_dominated_solutions) {
     departures[SpIdx(*d.stop_areas_map.at("A")->stop_point_list.front())] = 1000_s;
     departures[SpIdx(*d.stop_areas_map.at("D")->stop_point_list.front())] = 3000_s;
     arrivals[SpIdx(*d.stop_areas_map.at("C")->stop_point_list.front())] = 0_s;
-    auto res = raptor.compute_all(departures, arrivals, 1000, type::RTLevel::Base, 2_min);
+    auto res = check_trip_based(*b.data, [&](RAPTOR& r) {
+        return r.compute_all(departures, arrivals, 1000, type::RTLevel::Base, 2_min);
+    });
 
     BOOST_REQUIRE_EQUAL(res.size(), 2);
     const auto& direct = res[0].items.size() == 1 ? res[0] : res[1];
@@ -1898,8 +2305,10 @@ BOOST_AUTO_TEST_CASE(second_pass) {
     arrivals[SpIdx(*d.stop_areas_map.at("GM1")->stop_point_list.front())] = 0_s;
     arrivals[SpIdx(*d.stop_areas_map.at("GM2")->stop_point_list.front())] = 0_s;
 
-    auto res = raptor.compute_all(departures, arrivals, DateTimeUtils::set(2, "08:30"_t), type::RTLevel::Base, 2_min,
-                                  DateTimeUtils::inf, 10, {}, {}, true);
+    auto res = check_trip_based(*b.data, [&](RAPTOR& r) {
+        return r.compute_all(departures, arrivals, DateTimeUtils::set(2, "08:30"_t), type::RTLevel::Base, 2_min,
+                             DateTimeUtils::inf, 10, {}, {}, true);
+    });
 
     BOOST_REQUIRE_EQUAL(res.size(), 1);
     BOOST_REQUIRE_EQUAL(res[0].items.size(), 4);
@@ -2016,20 +2425,23 @@ BOOST_AUTO_TEST_CASE(direct_path_filter) {
     departures[SpIdx(*d.stop_areas_map.at("A")->stop_point_list.front())] = 10_s;
     arrivals[SpIdx(*d.stop_areas_map.at("B")->stop_point_list.front())] = 10_s;
 
-    auto res = raptor.compute_all(departures,
-                                  arrivals,
-                                  DateTimeUtils::set(2, "08:00"_t),
-                                  type::RTLevel::Base,
-                                  2_min,
-                                  DateTimeUtils::inf,
-                                  10,
-                                  {},
-                                  {},
-                                  true,
-                                  135_s); // 135s direct path
+    auto res = check_trip_based(*b.data, [&](RAPTOR& r) {
+        return r.compute_all(departures,
+                             arrivals,
+                             DateTimeUtils::set(2, "08:00"_t),
+                             type::RTLevel::Base,
+                             2_min,
+                             DateTimeUtils::inf,
+                             10,
+                             {},
+                             {},
+                             true,
+                             135_s); // 135s direct path
+    });
     BOOST_CHECK_EQUAL(res.size(), 0);
 
-    res = raptor.compute_all(departures,
+    res = check_trip_based(*b.data, [&](RAPTOR& r) {
+        return r.compute_all(departures,
                              arrivals,
                              DateTimeUtils::set(2, "08:00"_t),
                              type::RTLevel::Base,
@@ -2040,6 +2452,7 @@ BOOST_AUTO_TEST_CASE(direct_path_filter) {
                              {},
                              true,
                              145_s); // 145s direct path
+    });
     BOOST_CHECK_EQUAL(res.size(), 1);
 
     // reverse clockwise
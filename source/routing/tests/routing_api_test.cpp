@@ -799,13 +799,15 @@ BOOST_AUTO_TEST_CASE(journey_array){
 template <typename speed_provider_trait>
 struct streetnetworkmode_fixture : public routing_api_data<speed_provider_trait> {
 
-    pbnavitia::Response make_response() {
+    pbnavitia::Response make_response(nr::ThreadPool* street_network_pool = nullptr) {
         ng::StreetNetwork sn_worker(*this->b.data->geo_ref);
         nr::RAPTOR raptor(*this->b.data);
         return nr::make_response(raptor, this->origin, this->destination, this->datetimes,
                                  true, navitia::type::AccessibiliteParams(),
                                  this->forbidden, sn_worker, nt::RTLevel::Base,
-                                 boost::gregorian::not_a_date_time, 2_min);
+                                 boost::gregorian::not_a_date_time, 2_min,
+                                 std::numeric_limits<uint32_t>::max(), std::numeric_limits<uint32_t>::max(),
+                                 0, 0, street_network_pool);
     }
 };
 
@@ -1015,6 +1017,34 @@ BOOST_FIXTURE_TEST_CASE(biking, streetnetworkmode_fixture<test_speed_provider>)
     BOOST_CHECK_EQUAL(resp.journeys(1).co2_emission().unit(), "gEC");
 }
 
+// the street network searches run at the same time give the same journeys
+BOOST_FIXTURE_TEST_CASE(biking_concurrent_street_network, streetnetworkmode_fixture<test_speed_provider>) {
+    origin.streetnetwork_params.mode = navitia::type::Mode_e::Bike;
+    origin.streetnetwork_params.offset = b.data->geo_ref->offsets[navitia::type::Mode_e::Bike];
+    origin.streetnetwork_params.max_duration = navitia::minutes(15);
+    origin.streetnetwork_params.speed_factor = 1;
+    destination.streetnetwork_params.mode = navitia::type::Mode_e::Bike;
+    destination.streetnetwork_params.offset = b.data->geo_ref->offsets[navitia::type::Mode_e::Bike];
+    destination.streetnetwork_params.max_duration = navitia::minutes(15);
+    destination.streetnetwork_params.speed_factor = 1;
+
+    const auto resp = make_response();
+    nr::ThreadPool pool(2);
+    const auto concurrent_resp = make_response(&pool);
+
+    BOOST_REQUIRE_EQUAL(concurrent_resp.response_type(), resp.response_type());
+    BOOST_REQUIRE_EQUAL(concurrent_resp.journeys_size(), resp.journeys_size());
+    for (int i = 0; i < resp.journeys_size(); ++i) {
+        const auto& journey = resp.journeys(i);
+        const auto& concurrent_journey = concurrent_resp.journeys(i);
+        BOOST_CHECK_EQUAL(concurrent_journey.duration(), journey.duration());
+        BOOST_REQUIRE_EQUAL(concurrent_journey.sections_size(), journey.sections_size());
+        for (int j = 0; j < journey.sections_size(); ++j) {
+            BOOST_CHECK_EQUAL(concurrent_journey.sections(j).duration(), journey.sections(j).duration());
+        }
+    }
+}
+
 //biking
 BOOST_FIXTURE_TEST_CASE(biking_walking, streetnetworkmode_fixture<test_speed_provider>) {
     origin.streetnetwork_params.mode = navitia::type::Mode_e::Bike;
@@ -1724,12 +1754,13 @@ BOOST_AUTO_TEST_CASE(projection_on_one_way) {
     b.data->pt_data->index();
     b.data->build_raptor();
     b.data->build_uri();
+    b.data->geo_ref->build_street_network_indexes();
     b.data->build_proximity_list();
     b.data->meta->production_date = boost::gregorian::date_period(boost::gregorian::date(2012,06,14),
                                                                   7_days);
 
     //first we want to check that the projection is done on A->B (the whole point of this test)
-    auto starting_edge = ng::ProjectionData(start, *b.data->geo_ref, 0, b.data->geo_ref->pl);
+    auto starting_edge = ng::ProjectionData(start, *b.data->geo_ref, 0);
     BOOST_REQUIRE(starting_edge.found);
 
     BOOST_CHECK_EQUAL(starting_edge.vertices[ng::ProjectionData::Direction::Target], AA);
@@ -1778,6 +1809,7 @@ BOOST_AUTO_TEST_CASE(use_crow_fly){
 
     sa.uri = "sa:foo";
     admin->uri = "admin";
+    admin->idx = 0;
     navitia::type::Data data;
     data.geo_ref->admins.push_back(admin);
     data.geo_ref->admin_map[admin->uri] = 0;
@@ -1825,7 +1857,7 @@ BOOST_AUTO_TEST_CASE(use_crow_fly){
     BOOST_CHECK(nr::use_crow_fly(ep, &sp2, empty_sn_path, data));
     BOOST_CHECK(! nr::use_crow_fly(ep, &sp2, filled_sn_path, data));
 
-    admin->main_stop_areas.push_back(&sa2);
+    data.pt_data->main_stop_areas_by_admin[admin->idx].push_back(&sa2);
     BOOST_CHECK(nr::use_crow_fly(ep, &sp2, empty_sn_path, data));
     BOOST_CHECK(nr::use_crow_fly(ep, &sp2, filled_sn_path, data));
 }
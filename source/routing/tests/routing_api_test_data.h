@@ -448,6 +448,7 @@ struct routing_api_data {
         b.data->pt_data->index();
         b.data->build_raptor();
 
+        b.data->geo_ref->build_street_network_indexes();
         b.data->build_proximity_list();
         b.data->meta->production_date = boost::gregorian::date_period("20120614"_d, 365_days);
         b.data->compute_labels();
@@ -463,6 +464,7 @@ struct routing_api_data {
         b.data->geo_ref->default_time_parking_leave = 2_s;
         b.data->geo_ref->add_parking_edges(D);
         b.data->geo_ref->add_parking_edges(E);
+        b.data->geo_ref->build_street_network_indexes();
 
         std::string origin_lon = boost::lexical_cast<std::string>(S.lon()),
                 origin_lat = boost::lexical_cast<std::string>(S.lat()),
@@ -0,0 +1,204 @@
+/* Copyright © 2001-2014, Canal TP and/or its affiliates. All rights reserved.
+  
+This file is part of Navitia,
+    the software to build cool stuff with public transport.
+
+Hope you'll enjoy and contribute to this project,
+    powered by Canal TP (www.canaltp.fr).
+Help us simplify mobility and open public transport:
+    a non ending quest to the responsive locomotion way of traveling!
+
+LICENCE: This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Affero General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+Stay tuned using
+twitter @navitia 
+IRC #navitia on freenode
+https://groups.google.com/d/forum/navitia
+www.navitia.io
+*/
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE test_trip_based
+#include <boost/test/unit_test.hpp>
+#include "routing/raptor.h"
+#include "routing/trip_based.h"
+#include "routing/routing.h"
+#include "ed/build_helper.h"
+#include "tests/utils_test.h"
+#include <algorithm>
+#include <numeric>
+#include <random>
+
+struct logger_initialized {
+    logger_initialized() { init_logger(); }
+};
+BOOST_GLOBAL_FIXTURE( logger_initialized )
+
+using namespace navitia;
+using namespace routing;
+
+// The journeys found with the trip based engine must be the ones found
+// by the journey pattern scan
+static void check_same_journeys(const std::vector<Path>& res, const std::vector<Path>& expected) {
+    BOOST_REQUIRE_EQUAL(res.size(), expected.size());
+    for (size_t i = 0; i < res.size(); ++i) {
+        BOOST_CHECK_EQUAL(res[i].nb_changes, expected[i].nb_changes);
+        BOOST_REQUIRE_EQUAL(res[i].items.size(), expected[i].items.size());
+        for (size_t j = 0; j < res[i].items.size(); ++j) {
+            BOOST_CHECK_EQUAL(res[i].items[j].print(), expected[i].items[j].print());
+        }
+    }
+}
+
+// A random network: lines on random stops, with vehicle journeys
+// running random days, and random connections between the stops.  The
+// seed is fixed, thus a failure can be replayed.
+struct RandomNetwork {
+    static const size_t nb_stops = 15;
+    std::mt19937 rand{42};
+    ed::builder b{"20120614"};
+
+    size_t uniform(const size_t min, const size_t max) {
+        return std::uniform_int_distribution<size_t>(min, max)(rand);
+    }
+    std::string stop(const size_t i) const { return "stop" + std::to_string(i); }
+
+    RandomNetwork() {
+        const std::vector<std::string> validity_patterns = {"11111111", "10101010", "01111110", "00001111"};
+        for (size_t line = 0; line < 10; ++line) {
+            std::vector<size_t> stops(nb_stops);
+            std::iota(stops.begin(), stops.end(), 0);
+            std::shuffle(stops.begin(), stops.end(), rand);
+            stops.resize(uniform(2, 6));
+            std::vector<int> durations;
+            for (size_t i = 1; i < stops.size(); ++i) { durations.push_back(int(uniform(2, 20)) * 60); }
+
+            const auto nb_vjs = uniform(2, 8);
+            for (size_t i = 0; i < nb_vjs; ++i) {
+                auto vj = b.vj("l" + std::to_string(line), validity_patterns[uniform(0, 3)]);
+                int dt = int(uniform(6 * 60, 12 * 60)) * 60;
+                for (size_t j = 0; j < stops.size(); ++j) {
+                    if (j > 0) { dt += durations[j - 1]; }
+                    vj(stop(stops[j]), dt, dt + 60);
+                }
+            }
+        }
+        for (size_t i = 0; i < 2 * nb_stops; ++i) {
+            const auto from = uniform(0, nb_stops - 1);
+            const auto to = uniform(0, nb_stops - 1);
+            b.connection(stop(from), stop(to), uniform(1, 10) * 60);
+        }
+        for (size_t i = 0; i < nb_stops; ++i) {
+            b.connection(stop(i), stop(i), 120);
+        }
+        b.data->pt_data->index();
+        b.finish();
+        b.data->build_raptor();
+        b.data->build_uri();
+        b.data->dataRaptor->load_trip_transfers(*b.data->pt_data);
+    }
+
+    routing::map_stop_point_duration random_stops() {
+        routing::map_stop_point_duration res;
+        const auto nb = uniform(1, 2);
+        for (size_t i = 0; i < nb; ++i) {
+            res[SpIdx(*b.data->pt_data->stop_points_map[stop(uniform(0, nb_stops - 1))])]
+                = navitia::seconds(uniform(0, 5) * 60);
+        }
+        return res;
+    }
+};
+
+BOOST_AUTO_TEST_CASE(random_queries) {
+    RandomNetwork network;
+    RAPTOR raptor(*network.b.data);
+    RAPTOR raptor_without_trip_based(*network.b.data);
+    raptor_without_trip_based.trip_based_first_pass = false;
+
+    for (size_t i = 0; i < 200; ++i) {
+        const auto departures = network.random_stops();
+        const auto arrivals = network.random_stops();
+        const auto dt = DateTimeUtils::set(network.uniform(0, 3), network.uniform(5 * 60, 13 * 60) * 60);
+        const auto max_transfers = uint32_t(network.uniform(0, 5));
+        BOOST_TEST_CHECKPOINT("query " << i);
+
+        check_same_journeys(
+            raptor.compute_all(departures, arrivals, dt, type::RTLevel::Base, 2_min,
+                               DateTimeUtils::inf, max_transfers),
+            raptor_without_trip_based.compute_all(departures, arrivals, dt, type::RTLevel::Base, 2_min,
+                                                  DateTimeUtils::inf, max_transfers));
+
+        const auto window_end = dt + network.uniform(10, 120) * 60;
+        check_same_journeys(
+            raptor.compute_profile(departures, arrivals, dt, window_end, type::RTLevel::Base, 2_min,
+                                   std::numeric_limits<uint32_t>::max(), max_transfers),
+            raptor_without_trip_based.compute_profile(departures, arrivals, dt, window_end,
+                                                      type::RTLevel::Base, 2_min,
+                                                      std::numeric_limits<uint32_t>::max(),
+                                                      max_transfers));
+    }
+    BOOST_REQUIRE(raptor.trip_based);
+    BOOST_CHECK_GT(raptor.trip_based->nb_first_passes, 200);
+    BOOST_CHECK(! raptor_without_trip_based.trip_based);
+}
+
+// Same instance as the profile_departure_window test of raptor
+BOOST_AUTO_TEST_CASE(profile) {
+    ed::builder b("20120614");
+    b.vj("l1")("A", "08:00"_t)("B", "08:20"_t);
+    b.vj("l1")("A", "08:30"_t)("B", "08:50"_t);
+    b.vj("l1")("A", "09:00"_t)("B", "09:20"_t);
+    b.vj("l1")("A", "09:30"_t)("B", "09:50"_t);
+    b.vj("l2")("A", "08:05"_t)("C", "08:10"_t);
+    b.vj("l3")("C", "08:15"_t)("B", "08:55"_t);
+    b.vj("l4")("A", "08:40"_t)("D", "08:45"_t);
+    b.vj("l5")("D", "08:50"_t)("B", "08:55"_t);
+    b.connection("C", "C", 120);
+    b.connection("D", "D", 120);
+
+    b.data->pt_data->index();
+    b.finish();
+    b.data->build_raptor();
+    b.data->build_uri();
+    b.data->dataRaptor->load_trip_transfers(*b.data->pt_data);
+    type::PT_Data& d = *b.data->pt_data;
+
+    routing::map_stop_point_duration departures, arrivals;
+    departures[SpIdx(*d.stop_points_map["A"])] = 0_s;
+    arrivals[SpIdx(*d.stop_points_map["B"])] = 0_s;
+
+    RAPTOR raptor(*b.data);
+    const auto begin = DateTimeUtils::set(0, "08:00"_t);
+    const auto end = DateTimeUtils::set(0, "09:00"_t);
+    auto res = raptor.compute_profile(departures, arrivals, begin, end, type::RTLevel::Base, 2_min);
+    BOOST_REQUIRE(raptor.trip_based);
+    BOOST_CHECK_GT(raptor.trip_based->nb_first_passes, 0);
+
+    BOOST_REQUIRE_EQUAL(res.size(), 4);
+    BOOST_CHECK_EQUAL(res[0].items.front().departure, "20120614T080000"_dt);
+    BOOST_CHECK_EQUAL(res[0].items.back().arrival, "20120614T082000"_dt);
+    BOOST_CHECK_EQUAL(res[1].items.front().departure, "20120614T083000"_dt);
+    BOOST_CHECK_EQUAL(res[1].items.back().arrival, "20120614T085000"_dt);
+    BOOST_CHECK_EQUAL(res[2].items.front().departure, "20120614T084000"_dt);
+    BOOST_CHECK_EQUAL(res[2].items.back().arrival, "20120614T085500"_dt);
+    BOOST_CHECK_EQUAL(res[2].nb_changes, 1);
+    BOOST_CHECK_EQUAL(res[3].items.front().departure, "20120614T090000"_dt);
+    BOOST_CHECK_EQUAL(res[3].items.back().arrival, "20120614T092000"_dt);
+
+    // the anticlockwise profiles are not handled by the trip based engine
+    const auto nb_first_passes = raptor.trip_based->nb_first_passes;
+    raptor.compute_profile(departures, arrivals, begin, end, type::RTLevel::Base, 2_min,
+                           std::numeric_limits<uint32_t>::max(), 10, type::AccessibiliteParams(), {}, false);
+    BOOST_CHECK_EQUAL(raptor.trip_based->nb_first_passes, nb_first_passes);
+}
@@ -0,0 +1,112 @@
+/* Copyright © 2001-2016, Canal TP and/or its affiliates. All rights reserved.
+
+This file is part of Navitia,
+    the software to build cool stuff with public transport.
+
+Hope you'll enjoy and contribute to this project,
+    powered by Canal TP (www.canaltp.fr).
+Help us simplify mobility and open public transport:
+    a non ending quest to the responsive locomotion way of traveling!
+
+LICENCE: This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Affero General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+Stay tuned using
+twitter @navitia
+IRC #navitia on freenode
+https://groups.google.com/d/forum/navitia
+www.navitia.io
+*/
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace navitia { namespace routing {
+
+/** A fixed number of long lived threads running the submitted tasks
+ *
+ * The threads are created with the pool and joined by its destructor,
+ * thus a request does not pay for a thread creation.  The exceptions
+ * of a task are rethrown by the get() of its future.
+ *
+ * It is header only, thus georef (which routing depends on) can use it.
+ */
+class ThreadPool {
+public:
+    explicit ThreadPool(const size_t nb_threads) {
+        for (size_t i = 0; i < nb_threads; ++i) {
+            threads.emplace_back([this]() { run(); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        cond.notify_all();
+        for (auto& thread: threads) { thread.join(); }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t size() const { return threads.size(); }
+
+    template<typename F>
+    auto submit(F f) -> std::future<decltype(f())> {
+        // std::function needs a copyable callable
+        auto task = std::make_shared<std::packaged_task<decltype(f())()>>(std::move(f));
+        auto res = task->get_future();
+        push([task]() { (*task)(); });
+        return res;
+    }
+
+private:
+    void push(std::function<void()>&& task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.push_back(std::move(task));
+        }
+        cond.notify_one();
+    }
+
+    void run() {
+        while (true) {
+            std::unique_lock<std::mutex> lock(mutex);
+            cond.wait(lock, [this]() { return stopping || ! tasks.empty(); });
+            if (tasks.empty()) { return; }
+            auto task = std::move(tasks.front());
+            tasks.pop_front();
+            lock.unlock();
+            // the exceptions are stored in the future of the task
+            task();
+        }
+    }
+
+    std::vector<std::thread> threads;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable cond;
+    bool stopping = false;
+};
+
+}} // namespace navitia::routing
@@ -0,0 +1,385 @@
+/* Copyright © 2001-2016, Canal TP and/or its affiliates. All rights reserved.
+
+This file is part of Navitia,
+    the software to build cool stuff with public transport.
+
+Hope you'll enjoy and contribute to this project,
+    powered by Canal TP (www.canaltp.fr).
+Help us simplify mobility and open public transport:
+    a non ending quest to the responsive locomotion way of traveling!
+
+LICENCE: This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Affero General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+Stay tuned using
+twitter @navitia
+IRC #navitia on freenode
+https://groups.google.com/d/forum/navitia
+www.navitia.io
+*/
+
+#include "trip_based.h"
+#include "type/pt_data.h"
+
+#include <boost/range/algorithm/fill.hpp>
+#include <atomic>
+#include <future>
+#include <thread>
+
+namespace navitia { namespace routing {
+
+static const uint32_t SECONDS_PER_DAY = DateTimeUtils::SECONDS_PER_DAY;
+
+static bool is_base(const type::VehicleJourney& vj) {
+    const auto* vp = vj.validity_patterns[type::RTLevel::Base];
+    return vp && vp->days.any();
+}
+
+// Does the vehicle journey of days, boarded shift days later, run
+// every day of the days?
+static bool covers(const type::ValidityPattern::year_bitset& days,
+                   const type::ValidityPattern::year_bitset& candidate_days,
+                   const int shift) {
+    const auto shifted = shift >= 0 ? candidate_days >> shift : candidate_days << -shift;
+    return (days & ~shifted).none();
+}
+
+namespace {
+// The transfers of the vehicle journeys of a journey pattern, the
+// journey patterns being built independently from each other
+struct JpTransfers {
+    // number of transfers of each stop time, vj by vj
+    std::vector<uint32_t> nb_transfers;
+    // the candidates are numbered from the ones of the journey pattern
+    std::vector<TripTransfers::Transfer> transfers;
+    std::vector<TripTransfers::Candidate> candidates;
+    size_t nb_reduced = 0;
+};
+
+class TransfersBuilder {
+public:
+    TransfersBuilder(const type::PT_Data& data, const dataRAPTOR& dataRaptor):
+        dataRaptor(dataRaptor),
+        tau(data.stop_points.size(), std::numeric_limits<int64_t>::max())
+    {}
+
+    void build(const JourneyPattern& jp, JpTransfers& res) {
+        for (const auto* vj: jp.discrete_vjs) {
+            const auto& sts = vj->stop_time_list;
+            const size_t first = res.nb_transfers.size();
+            res.nb_transfers.resize(first + sts.size(), 0);
+            // never boarded on the base level
+            if (! is_base(*vj)) { continue; }
+
+            // From the last stop time to the first, tau being the
+            // arrivals by staying in vj.  The vehicle is not left at
+            // its first stop.
+            for (size_t i = sts.size() - 1; i > 0; --i) {
+                const auto& st = sts[i];
+                if (! st.drop_off_allowed()) { continue; }
+                const SpIdx sp_idx(*st.stop_point);
+                set_tau(sp_idx, st.arrival_time);
+                const size_t nb_before = res.transfers.size();
+                for (const auto& conn: dataRaptor.connections.forward_connections[sp_idx]) {
+                    for (const auto& jpp: dataRaptor.jpps_from_sp[conn.sp_idx]) {
+                        // nobody boards at the last stop
+                        const auto& to_jp = dataRaptor.jp_container.get(jpp.jp_idx);
+                        if (size_t(jpp.order) + 1 >= to_jp.jpps.size()) { continue; }
+                        add_transfer(*vj, st.arrival_time + conn.duration, jpp.idx, conn.duration, res);
+                    }
+                }
+                res.nb_transfers[first + i] = res.transfers.size() - nb_before;
+            }
+            for (const auto& sp_idx: touched) { tau[sp_idx.val] = std::numeric_limits<int64_t>::max(); }
+            touched.clear();
+        }
+    }
+
+private:
+    const dataRAPTOR& dataRaptor;
+    // arrival at each stop point by staying in the current vj, relative
+    // to the day of the vj
+    std::vector<int64_t> tau;
+    std::vector<SpIdx> touched;
+
+    void set_tau(const SpIdx sp_idx, const int64_t dt) {
+        auto& t = tau[sp_idx.val];
+        if (t == std::numeric_limits<int64_t>::max()) { touched.push_back(sp_idx); }
+        t = std::min(t, dt);
+    }
+
+    // Staying in the vj left reaches every stop of the candidate as
+    // early, the candidate leaving at its stop time of order `order`
+    // shift days after the day of the vj left.
+    bool is_dominated(const type::VehicleJourney& candidate, const uint16_t order, const int shift) const {
+        const auto& sts = candidate.stop_time_list;
+        for (size_t k = order + 1; k < sts.size(); ++k) {
+            if (! sts[k].drop_off_allowed()) { continue; }
+            const int64_t dt = int64_t(shift) * SECONDS_PER_DAY + sts[k].arrival_time;
+            if (dt < tau[sts[k].stop_point->idx]) { return false; }
+        }
+        return true;
+    }
+
+    // The candidates are the ones of the next stop time search from
+    // ready, on the day of ready and the next one as the next stop time
+    // cache: the first one valid a given day is the one the cache gives.
+    void add_transfer(const type::VehicleJourney& vj,
+                      const DateTime ready,
+                      const JppIdx jpp_idx,
+                      const DateTime duration,
+                      JpTransfers& res) {
+        const auto& days = vj.validity_patterns[type::RTLevel::Base]->days;
+        const auto& next_st_data = dataRaptor.next_stop_time_data;
+        const uint32_t first_day = DateTimeUtils::date(ready);
+        const uint32_t last_dt = (first_day + 2) * SECONDS_PER_DAY;
+        TripTransfers::Transfer transfer = {jpp_idx, duration, uint32_t(res.candidates.size()), 0, false};
+        bool dominated = true;
+        bool done = false;
+        for (uint32_t day = first_day; day <= first_day + 2 && ! done; ++day) {
+            const auto range = day == first_day
+                ? next_st_data.stop_time_range_after(jpp_idx, ready, StopEvent::pick_up)
+                : next_st_data.stop_time_range_forward(jpp_idx, StopEvent::pick_up);
+            for (const auto* st: range) {
+                const uint32_t dt = day * SECONDS_PER_DAY + DateTimeUtils::hour(st->departure_time);
+                if (dt > last_dt) {
+                    transfer.complete = true;
+                    done = true;
+                    break;
+                }
+                const auto& candidate = *st->vehicle_journey;
+                if (! is_base(candidate)) { continue; }
+                // the day of the candidate, relative to the one of vj
+                const int shift = int(day) - int(st->departure_time / SECONDS_PER_DAY);
+                res.candidates.push_back({VjIdx(candidate), dt});
+                dominated = dominated && is_dominated(candidate, st->order(), shift);
+                if (covers(days, candidate.validity_patterns[type::RTLevel::Base]->days, shift)) {
+                    transfer.complete = true;
+                    done = true;
+                    break;
+                }
+                if (res.candidates.size() - transfer.candidates_begin >= TripTransfers::max_candidates) {
+                    done = true;
+                    break;
+                }
+            }
+        }
+        // all the stop times of the days were seen
+        if (! done) { transfer.complete = true; }
+
+        if (transfer.complete && dominated) {
+            res.candidates.resize(transfer.candidates_begin);
+            ++res.nb_reduced;
+            return;
+        }
+        transfer.candidates_end = res.candidates.size();
+        res.transfers.push_back(transfer);
+    }
+};
+}
+
+// The vehicle journeys the trip based engine can't handle
+static bool is_usable(const JourneyPattern& jp) {
+    for (const auto* vj: jp.freq_vjs) {
+        if (is_base(*vj)) { return false; }
+    }
+    for (const auto* vj: jp.discrete_vjs) {
+        if (! is_base(*vj)) { continue; }
+        if (vj->next_vj || vj->prev_vj) { return false; }
+        for (const auto& st: vj->stop_time_list) {
+            if (st.local_traffic_zone != std::numeric_limits<uint16_t>::max()) { return false; }
+        }
+    }
+    return true;
+}
+
+void TripTransfers::load(const type::PT_Data& data, const dataRAPTOR& dataRaptor) {
+    const auto& jps = dataRaptor.jp_container.get_jps_values();
+    std::vector<JpTransfers> jp_transfers(jps.size());
+
+    // The threads take the next journey pattern to do as they vary a
+    // lot in size.
+    std::atomic<size_t> next_jp(0);
+    std::atomic<bool> all_usable(true);
+    const auto build_jps = [&]() {
+        TransfersBuilder builder(data, dataRaptor);
+        for (size_t i = next_jp++; i < jps.size(); i = next_jp++) {
+            if (! is_usable(jps[i])) { all_usable = false; }
+            builder.build(jps[i], jp_transfers[i]);
+        }
+    };
+    std::vector<std::future<void>> tasks;
+    const size_t nb_threads = std::max(std::thread::hardware_concurrency(), 1u);
+    for (size_t i = 1; i < std::min(nb_threads, jps.size()); ++i) {
+        tasks.push_back(std::async(std::launch::async, build_jps));
+    }
+    build_jps();
+    for (auto& task: tasks) { task.get(); }
+    usable = all_usable;
+
+    // the journey patterns are put together, in order
+    first_event.assign(data.vehicle_journeys, 0);
+    until.assign(1, 0);
+    transfers.clear();
+    candidates.clear();
+    nb_reduced = 0;
+    for (size_t i = 0; i < jps.size(); ++i) {
+        const auto& res = jp_transfers[i];
+        const uint32_t candidates_offset = candidates.size();
+        auto transfer_it = res.transfers.begin();
+        auto nb_it = res.nb_transfers.begin();
+        for (const auto* vj: jps[i].discrete_vjs) {
+            first_event[VjIdx(*vj)] = until.size() - 1;
+            for (size_t order = 0; order < vj->stop_time_list.size(); ++order, ++nb_it) {
+                for (const auto end = transfer_it + *nb_it; transfer_it != end; ++transfer_it) {
+                    transfers.push_back(*transfer_it);
+                    transfers.back().candidates_begin += candidates_offset;
+                    transfers.back().candidates_end += candidates_offset;
+                }
+                until.push_back(transfers.size());
+            }
+        }
+        candidates.insert(candidates.end(), res.candidates.begin(), res.candidates.end());
+        nb_reduced += res.nb_reduced;
+        jp_transfers[i] = JpTransfers();
+    }
+    until.shrink_to_fit();
+    transfers.shrink_to_fit();
+    candidates.shrink_to_fit();
+
+    auto logger = log4cplus::Logger::getInstance("log");
+    LOG4CPLUS_INFO(logger, "trip transfers: " << transfers.size() << " transfers (" << nb_reduced
+                   << " removed by the reduction), " << candidates.size() << " candidates, "
+                   << memory_size() / 1024 << " kB");
+    if (! usable) {
+        LOG4CPLUS_INFO(logger, "the trip based engine can't be used: the base level has frequency "
+                       "vehicle journeys, stay in or local traffic zones");
+    }
+}
+
+size_t TripTransfers::memory_size() const {
+    return first_event.size() * sizeof(uint32_t) + until.size() * sizeof(uint32_t)
+        + transfers.size() * sizeof(Transfer) + candidates.size() * sizeof(Candidate);
+}
+
+TripBased::TripBased(const type::Data& data):
+    data(data),
+    trip_transfers(data.dataRaptor->trip_transfers)
+{
+    reached.assign(data.dataRaptor->jp_container.get_jps_values());
+}
+
+bool TripBased::handles(const bool clockwise,
+                        const nt::RTLevel rt_level,
+                        const type::AccessibiliteParams& accessibilite_params,
+                        const ValidJpps& valid_jpps) const {
+    return clockwise
+        && rt_level == nt::RTLevel::Base
+        && trip_transfers->usable
+        && accessibilite_params.properties.none()
+        && accessibilite_params.vehicle_properties.none()
+        && valid_jpps.valid_stop_points.all();
+}
+
+void TripBased::clear() {
+    for (const auto& jp_idx: reached_jps) { reached[jp_idx].clear(); }
+    reached_jps.clear();
+    segments.clear();
+    next_segments.clear();
+}
+
+void TripBased::init(const map_stop_point_duration& departures,
+                     const DateTime departure_datetime,
+                     const CachedNextStopTime& next_st,
+                     const ValidJpps& valid_jpps) {
+    ++nb_first_passes;
+    clear();
+    for (const auto& sp_dur: departures) {
+        const DateTime dt = departure_datetime + sp_dur.second.total_seconds();
+        for (const auto& jpp: valid_jpps.jpps_from_sp[sp_dur.first]) {
+            const auto st_dt = next_st.next_stop_time(StopEvent::pick_up, jpp.idx, dt, true);
+            if (st_dt.first == nullptr) { continue; }
+            enqueue(*st_dt.first, st_dt.second);
+        }
+    }
+    swap(segments, next_segments);
+}
+
+void TripBased::enqueue(const type::StopTime& st, const DateTime dt) {
+    const auto* vj = st.vehicle_journey;
+    const uint16_t from = st.order();
+    const DateTime base = dt - st.departure_time;
+    const auto jp_idx = data.dataRaptor->jp_container.get_jp_from_vj()[VjIdx(*vj)];
+    auto& jp_reached = reached[jp_idx];
+
+    for (const auto& r: jp_reached) {
+        if (r.base == base && r.from <= from
+            && r.vj->stop_time_list[from].departure_time <= st.departure_time) {
+            return;
+        }
+    }
+
+    if (jp_reached.empty()) { reached_jps.push_back(jp_idx); }
+    jp_reached.push_back({vj, base, from});
+    next_segments.push_back({vj, base, from});
+}
+
+std::pair<const type::StopTime*, DateTime>
+TripBased::board(const TripTransfers::Transfer& transfer,
+                 const DateTime base,
+                 const DateTime dt,
+                 const CachedNextStopTime& next_st) const {
+    const auto order = data.dataRaptor->jp_container.get(transfer.jpp_idx).order;
+    for (const auto& candidate: trip_transfers->candidates_of(transfer)) {
+        const DateTime candidate_dt = base + candidate.dt;
+        // not in the cache either
+        if (candidate_dt > next_st.end_dt) { return {nullptr, DateTimeUtils::inf}; }
+        const auto* vj = data.pt_data->vehicle_journeys[candidate.vj_idx.val];
+        const auto& st = vj->stop_time_list[order];
+        const auto day = DateTimeUtils::date(base) + candidate.dt / SECONDS_PER_DAY;
+        if (! st.is_valid_day(day, false, nt::RTLevel::Base)) { continue; }
+        return {&st, candidate_dt};
+    }
+    if (transfer.complete) { return {nullptr, DateTimeUtils::inf}; }
+    return next_st.next_stop_time(StopEvent::pick_up, transfer.jpp_idx, dt + transfer.duration, true);
+}
+
+void TripBased::next_round(const DateTime target_bound,
+                           const DateTime bound,
+                           const IdxMap<type::StopPoint, DateTime>& best_labels_transfers,
+                           const CachedNextStopTime& next_st,
+                           const ValidJpps& valid_jpps) {
+    const auto& jp_container = data.dataRaptor->jp_container;
+    next_segments.clear();
+    for (const auto& seg: segments) {
+        const auto& sts = seg.vj->stop_time_list;
+        for (size_t i = seg.from + 1; i < sts.size(); ++i) {
+            const auto& st = sts[i];
+            const DateTime dt = seg.base + st.arrival_time;
+            if (dt > target_bound || dt >= bound) { break; }
+            if (! st.drop_off_allowed()) { continue; }
+            for (const auto& transfer: (*trip_transfers)(*seg.vj, uint16_t(i))) {
+                const DateTime ready = dt + transfer.duration;
+                const auto sp_idx = jp_container.get(transfer.jpp_idx).sp_idx;
+                if (ready > target_bound || ready > best_labels_transfers[sp_idx]) { continue; }
+                if (! valid_jpps.valid_journey_pattern_points[transfer.jpp_idx.val]) { continue; }
+                const auto st_dt = board(transfer, seg.base, dt, next_st);
+                if (st_dt.first == nullptr || st_dt.second > target_bound) { continue; }
+                enqueue(*st_dt.first, st_dt.second);
+            }
+        }
+    }
+    swap(segments, next_segments);
+}
+
+}} // namespace navitia::routing
@@ -0,0 +1,219 @@
+/* Copyright © 2001-2016, Canal TP and/or its affiliates. All rights reserved.
+
+This file is part of Navitia,
+    the software to build cool stuff with public transport.
+
+Hope you'll enjoy and contribute to this project,
+    powered by Canal TP (www.canaltp.fr).
+Help us simplify mobility and open public transport:
+    a non ending quest to the responsive locomotion way of traveling!
+
+LICENCE: This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Affero General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+Stay tuned using
+twitter @navitia
+IRC #navitia on freenode
+https://groups.google.com/d/forum/navitia
+www.navitia.io
+*/
+#pragma once
+
+#include "routing/routing.h"
+#include "routing/dataraptor.h"
+#include "routing/valid_jpps.h"
+#include "type/data.h"
+#include "type/rt_level.h"
+
+#include <boost/range/iterator_range.hpp>
+#include <limits>
+#include <memory>
+#include <vector>
+
+namespace navitia { namespace routing {
+
+/** The transfers between the vehicle journeys, precomputed for the
+ * trip based engine when the raptor data is loaded.
+ *
+ * A transfer goes from the stop time of a vehicle journey to the
+ * vehicle journeys that can be boarded at a journey pattern point
+ * reachable by a stop point connection.  As the vehicle journey to
+ * board depends on the day, the candidates are kept in the order of the
+ * next stop time search, until the first one running every day the
+ * vehicle journey left runs.  At query time, the first valid candidate
+ * is the one the next stop time cache would give.
+ *
+ * Only the base level is handled.  A transfer is removed when staying
+ * in the vehicle journey reaches every stop of every candidate as early,
+ * thus the earliest arrivals with a given number of vehicles are kept
+ * for every request.
+ */
+struct TripTransfers {
+    struct Candidate {
+        VjIdx vj_idx;
+        // departure from the jpp, relative to the day of the vehicle
+        // journey left: the candidate is on the calendar day
+        // dt / SECONDS_PER_DAY after this one
+        uint32_t dt;
+    };
+    struct Transfer {
+        JppIdx jpp_idx;
+        DateTime duration; // duration of the connection
+        uint32_t candidates_begin;
+        uint32_t candidates_end;
+        // false if the next stop time cache must be asked when no
+        // candidate is valid
+        bool complete;
+    };
+    using TransferRange = boost::iterator_range<std::vector<Transfer>::const_iterator>;
+    using CandidateRange = boost::iterator_range<std::vector<Candidate>::const_iterator>;
+
+    // the candidates of a transfer are limited to this number
+    static const size_t max_candidates = 8;
+
+    void load(const type::PT_Data&, const dataRAPTOR&);
+
+    // the transfers from the stop time of order `order` of vj
+    inline TransferRange operator()(const type::VehicleJourney& vj, const uint16_t order) const {
+        const VjIdx vj_idx(vj);
+        // the vehicle journeys added since the load are not on the base level
+        if (vj_idx.val >= first_event.size()) {
+            return boost::make_iterator_range(transfers.end(), transfers.end());
+        }
+        const auto event = first_event[vj_idx] + order;
+        return boost::make_iterator_range(transfers.begin() + until[event],
+                                          transfers.begin() + until[event + 1]);
+    }
+    inline CandidateRange candidates_of(const Transfer& transfer) const {
+        return boost::make_iterator_range(candidates.begin() + transfer.candidates_begin,
+                                          candidates.begin() + transfer.candidates_end);
+    }
+    size_t nb_transfers() const { return transfers.size(); }
+    size_t nb_candidates() const { return candidates.size(); }
+    size_t memory_size() const;
+
+    // The frequency vehicle journeys, the stay in and the local traffic
+    // zones are not handled by the trip based engine, thus it can only
+    // be used if no vehicle journey of the base level has one.
+    bool usable = true;
+    // number of transfers removed by the reduction
+    size_t nb_reduced = 0;
+
+private:
+    // the stop times are numbered vj by vj, first_event[vj] being the
+    // number of the first stop time of vj
+    IdxMap<type::VehicleJourney, uint32_t> first_event;
+    // the transfers of the stop time n are transfers[until[n]] to
+    // transfers[until[n + 1]] (excluded)
+    std::vector<uint32_t> until;
+    std::vector<Transfer> transfers;
+    std::vector<Candidate> candidates;
+};
+
+/** Trip based engine, used instead of the journey pattern scan for
+ * the first pass of RAPTOR::compute_all and for each datetime of
+ * RAPTOR::compute_profile: one instance by raptor, it contains the data
+ * modified by the computation.
+ *
+ * Instead of scanning the journey patterns from the marked stop points,
+ * the rounds are a breadth first search on the vehicle journeys, round
+ * n containing the parts of vehicle journeys boarded with n transfers,
+ * the vehicle journeys of the next round being read from the
+ * precomputed TripTransfers.  The arrivals are written in the labels of
+ * raptor, whose best labels, foot paths and target bound are used as
+ * in its own loop.  As both give, for every stop point and round, the
+ * earliest arrival when it improves the previous rounds, the labels,
+ * thus the second passes and the journeys, are the same.
+ */
+struct TripBased {
+    const navitia::type::Data& data;
+    const std::shared_ptr<const TripTransfers> trip_transfers;
+
+    explicit TripBased(const navitia::type::Data& data);
+
+    /// Can the first pass of a request be done by the trip based
+    /// engine?  Only the clockwise requests on the base level without
+    /// accessibility constraint nor forbidden stop point are handled.
+    bool handles(const bool clockwise,
+                 const nt::RTLevel rt_level,
+                 const type::AccessibiliteParams& accessibilite_params,
+                 const ValidJpps& valid_jpps) const;
+
+    /// The vehicle journeys boarded from the departures, as a first round
+    void init(const map_stop_point_duration& departures,
+              const DateTime departure_datetime,
+              const CachedNextStopTime& next_st,
+              const ValidJpps& valid_jpps);
+
+    /// Calls f(sp_idx, dt) for the arrivals of the current round not after
+    /// target_bound and before bound
+    template<typename F>
+    void for_each_arrival(const DateTime target_bound, const DateTime bound, const F& f);
+
+    /// The vehicle journeys boarded from the current round become the
+    /// current round.  The transfers reaching a stop point after its
+    /// best label or after target_bound can't improve a label.
+    void next_round(const DateTime target_bound,
+                    const DateTime bound,
+                    const IdxMap<type::StopPoint, DateTime>& best_labels_transfers,
+                    const CachedNextStopTime& next_st,
+                    const ValidJpps& valid_jpps);
+
+    /// Number of searches (first passes or datetimes of a profile) and of
+    /// explored vehicle journey parts since the creation of the worker
+    /// (for benchmark purpose)
+    size_t nb_first_passes = 0;
+    size_t nb_segments = 0;
+
+private:
+    // A vehicle journey boarded at the stop time of order `from`, its
+    // stop times being shifted by base, the beginning of its day.
+    struct Segment {
+        const type::VehicleJourney* vj;
+        DateTime base;
+        uint16_t from;
+    };
+
+    std::vector<Segment> segments;
+    std::vector<Segment> next_segments;
+    // The segments already reached by journey pattern: the vehicles of
+    // a journey pattern running the same day don't overtake, thus a
+    // later segment boarded at the same stop or after can't do better.
+    IdxMap<JourneyPattern, std::vector<Segment>> reached;
+    std::vector<JpIdx> reached_jps;
+
+    void clear();
+    void enqueue(const type::StopTime& st, const DateTime dt);
+    std::pair<const type::StopTime*, DateTime>
+    board(const TripTransfers::Transfer& transfer,
+          const DateTime base,
+          const DateTime dt,
+          const CachedNextStopTime& next_st) const;
+};
+
+template<typename F>
+void TripBased::for_each_arrival(const DateTime target_bound, const DateTime bound, const F& f) {
+    nb_segments += segments.size();
+    for (const auto& seg: segments) {
+        const auto& sts = seg.vj->stop_time_list;
+        for (size_t i = seg.from + 1; i < sts.size(); ++i) {
+            const auto& st = sts[i];
+            const DateTime dt = seg.base + st.arrival_time;
+            if (dt > target_bound || dt >= bound) { break; }
+            if (! st.drop_off_allowed()) { continue; }
+            f(SpIdx(*st.stop_point), dt);
+        }
+    }
+}
+
+}} // namespace navitia::routing
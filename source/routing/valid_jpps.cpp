@@ -0,0 +1,182 @@
+/* Copyright © 2001-2014, Canal TP and/or its affiliates. All rights reserved.
+  
+This file is part of Navitia,
+    the software to build cool stuff with public transport.
+ 
+Hope you'll enjoy and contribute to this project,
+    powered by Canal TP (www.canaltp.fr).
+Help us simplify mobility and open public transport:
+    a non ending quest to the responsive locomotion way of traveling!
+  
+LICENCE: This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Affero General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+   
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Affero General Public License for more details.
+   
+You should have received a copy of the GNU Affero General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+  
+Stay tuned using
+twitter @navitia 
+IRC #navitia on freenode
+https://groups.google.com/d/forum/navitia
+www.navitia.io
+*/
+
+
+#include "valid_jpps.h"
+
+#include "type/pt_data.h"
+#include "type/data.h"
+
+#include <boost/range/algorithm/sort.hpp>
+
+namespace navitia { namespace routing {
+
+ValidJppsKey::ValidJppsKey(uint32_t date,
+                           type::RTLevel rt_level,
+                           const type::Properties& properties,
+                           std::vector<std::string> f):
+    date(date), rt_level(rt_level), properties(properties), forbidden(std::move(f))
+{
+    boost::sort(forbidden);
+    forbidden.erase(std::unique(forbidden.begin(), forbidden.end()), forbidden.end());
+}
+
+bool ValidJppsKey::operator<(const ValidJppsKey& other) const {
+    if (date != other.date) {
+        return date < other.date;
+    } else if (rt_level != other.rt_level) {
+        return rt_level < other.rt_level;
+    } else if (properties.to_ulong() != other.properties.to_ulong()) {
+        return properties.to_ulong() < other.properties.to_ulong();
+    }
+    return forbidden < other.forbidden;
+}
+
+ValidJpps CachedValidJppsManager::CacheCreator::operator()(const ValidJppsKey& key) const {
+    const auto& jp_container = dataRaptor.jp_container;
+    ValidJpps res;
+    res.valid_journey_patterns = dataRaptor.jp_validity_patterns[key.rt_level][key.date];
+    res.valid_journey_pattern_points.resize(jp_container.nb_jpps());
+    res.valid_journey_pattern_points.set();
+
+    res.valid_stop_points.resize(pt_data.stop_points.size());
+    res.valid_stop_points.set();
+
+    auto& valid_journey_patterns = res.valid_journey_patterns;
+    auto& valid_stop_points = res.valid_stop_points;
+    auto& valid_journey_pattern_points = res.valid_journey_pattern_points;
+
+    // We will forbiden every object designated in forbidden
+    for (const auto& uri : key.forbidden) {
+        const auto it_line = pt_data.lines_map.find(uri);
+        if (it_line != pt_data.lines_map.end()) {
+            for (const auto route : it_line->second->route_list) {
+                for (const auto& jp_idx: jp_container.get_jps_from_route()[RouteIdx(*route)]) {
+                    valid_journey_patterns.set(jp_idx.val, false);
+                }
+            }
+            continue;
+        }
+        const auto it_route = pt_data.routes_map.find(uri);
+        if (it_route != pt_data.routes_map.end()) {
+            for (const auto& jp_idx: jp_container.get_jps_from_route()[RouteIdx(*it_route->second)]) {
+                valid_journey_patterns.set(jp_idx.val, false);
+            }
+            continue;
+        }
+        const auto it_commercial_mode = pt_data.commercial_modes_map.find(uri);
+        if (it_commercial_mode != pt_data.commercial_modes_map.end()) {
+            for (const auto line : it_commercial_mode->second->line_list) {
+                for (auto route : line->route_list) {
+                    for (const auto& jp_idx: jp_container.get_jps_from_route()[RouteIdx(*route)]) {
+                        valid_journey_patterns.set(jp_idx.val, false);
+                    }
+                }
+            }
+            continue;
+        }
+        const auto it_physical_mode = pt_data.physical_modes_map.find(uri);
+        if (it_physical_mode != pt_data.physical_modes_map.end()) {
+            const auto phy_mode_idx = PhyModeIdx(*it_physical_mode->second);
+            for (const auto& jp_idx: jp_container.get_jps_from_phy_mode()[phy_mode_idx]) {
+                valid_journey_patterns.set(jp_idx.val, false);
+            }
+            continue;
+        }
+        const auto it_network = pt_data.networks_map.find(uri);
+        if (it_network != pt_data.networks_map.end()) {
+            for (const auto line : it_network->second->line_list) {
+                for (const auto route : line->route_list) {
+                    for (const auto& jp_idx: jp_container.get_jps_from_route()[RouteIdx(*route)]) {
+                        valid_journey_patterns.set(jp_idx.val, false);
+                    }
+                }
+            }
+            continue;
+        }
+        const auto it_sp = pt_data.stop_points_map.find(uri);
+        if (it_sp !=  pt_data.stop_points_map.end()) {
+            valid_stop_points.set(it_sp->second->idx, false);
+            for (const auto& jpp: dataRaptor.jpps_from_sp[SpIdx(*it_sp->second)]) {
+                valid_journey_pattern_points.set(jpp.idx.val, false);
+            }
+            continue;
+        }
+        const auto it_sa = pt_data.stop_areas_map.find(uri);
+        if (it_sa !=  pt_data.stop_areas_map.end()) {
+            for (const auto sp : it_sa->second->stop_point_list) {
+                valid_stop_points.set(sp->idx, false);
+                for (const auto& jpp: dataRaptor.jpps_from_sp[SpIdx(*sp)]) {
+                    valid_journey_pattern_points.set(jpp.idx.val, false);
+                }
+            }
+            continue;
+        }
+    }
+
+    // filter accessibility
+    if (key.properties.any()) {
+        for (const auto* sp: pt_data.stop_points) {
+            if (sp->accessible(key.properties)) { continue; }
+            valid_stop_points.set(sp->idx, false);
+            for (const auto& jpp: dataRaptor.jpps_from_sp[SpIdx(*sp)]) {
+                valid_journey_pattern_points.set(jpp.idx.val, false);
+            }
+        }
+    }
+
+    // propagate the invalid jp in their jpp
+    for (JpIdx jp_idx = JpIdx(0); jp_idx.val < valid_journey_patterns.size(); ++jp_idx.val) {
+        if (valid_journey_patterns[jp_idx.val]) { continue; }
+        const auto& jp = jp_container.get(jp_idx);
+        for (const auto& jpp_idx: jp.jpps) {
+            valid_journey_pattern_points.set(jpp_idx.val, false);
+        }
+    }
+
+    res.jpps_from_sp = dataRaptor.jpps_from_sp;
+    res.jpps_from_sp.filter_jpps(valid_journey_pattern_points);
+    return res;
+}
+
+std::shared_ptr<const ValidJpps>
+CachedValidJppsManager::load(const uint32_t date,
+                             const type::RTLevel rt_level,
+                             const type::AccessibiliteParams& accessibilite_params,
+                             const std::vector<std::string>& forbidden) {
+    return lru(ValidJppsKey(date, rt_level, accessibilite_params.properties, forbidden));
+}
+
+CachedValidJppsManager::~CachedValidJppsManager() {
+    auto logger = log4cplus::Logger::getInstance("log");
+    LOG4CPLUS_INFO(logger, "Valid jpps cache miss : " << lru.get_nb_cache_miss() << " / " << lru.get_nb_calls());
+}
+
+}}
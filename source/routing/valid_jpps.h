@@ -0,0 +1,96 @@
+/* Copyright © 2001-2014, Canal TP and/or its affiliates. All rights reserved.
+  
+This file is part of Navitia,
+    the software to build cool stuff with public transport.
+ 
+Hope you'll enjoy and contribute to this project,
+    powered by Canal TP (www.canaltp.fr).
+Help us simplify mobility and open public transport:
+    a non ending quest to the responsive locomotion way of traveling!
+  
+LICENCE: This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Affero General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+   
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Affero General Public License for more details.
+   
+You should have received a copy of the GNU Affero General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+  
+Stay tuned using
+twitter @navitia 
+IRC #navitia on freenode
+https://groups.google.com/d/forum/navitia
+www.navitia.io
+*/
+
+#pragma once
+
+#include "routing/dataraptor.h"
+#include "type/rt_level.h"
+#include "utils/lru.h"
+
+#include <boost/dynamic_bitset.hpp>
+#include <string>
+#include <vector>
+
+namespace navitia { namespace routing {
+
+// The journey patterns, journey pattern points and stop points that
+// can be used by a request, given its date, realtime level,
+// accessibility and forbidden uris.
+struct ValidJpps {
+    boost::dynamic_bitset<> valid_journey_patterns;
+    boost::dynamic_bitset<> valid_stop_points;
+    boost::dynamic_bitset<> valid_journey_pattern_points;
+    // jpps_from_sp without the invalid jpps.  Thanks to that, we don't
+    // need to check the validity of the jpps as we iterate only on
+    // the feasible ones.
+    dataRAPTOR::JppsFromSp jpps_from_sp;
+};
+
+struct ValidJppsKey {
+    uint32_t date;
+    type::RTLevel rt_level;
+    type::Properties properties; // only the stop point accessibility is concerned
+    std::vector<std::string> forbidden; // sorted and without duplicates
+    ValidJppsKey(uint32_t date,
+                 type::RTLevel rt_level,
+                 const type::Properties& properties,
+                 std::vector<std::string> forbidden);
+
+    bool operator<(const ValidJppsKey& other) const;
+};
+
+// Most of the requests share the same filters, thus the valid jpps
+// are computed once and shared by the workers.  The cache is owned by
+// the dataRAPTOR, thus it is dropped with the data.
+struct CachedValidJppsManager {
+    CachedValidJppsManager(const type::PT_Data& pt_data, const dataRAPTOR& dataRaptor, size_t max_cache) :
+            lru({pt_data, dataRaptor}, max_cache) {}
+    ~CachedValidJppsManager();
+
+    std::shared_ptr<const ValidJpps>
+    load(const uint32_t date,
+         const type::RTLevel rt_level,
+         const type::AccessibiliteParams& accessibilite_params,
+         const std::vector<std::string>& forbidden);
+
+private:
+    struct CacheCreator {
+        typedef ValidJppsKey const& argument_type;
+        typedef ValidJpps result_type;
+        const type::PT_Data& pt_data;
+        const dataRAPTOR& dataRaptor;
+        CacheCreator(const type::PT_Data& p, const dataRAPTOR& d): pt_data(p), dataRaptor(d) {}
+        ValidJpps operator()(const ValidJppsKey& key) const;
+    };
+
+    ConcurrentLru<CacheCreator> lru;
+};
+
+}}
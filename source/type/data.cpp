@@ -31,6 +31,7 @@ www.navitia.io
 #include "data.h"
 
 #include <fstream>
+#include <sstream>
 #include <boost/archive/binary_oarchive.hpp>
 #include <boost/archive/binary_iarchive.hpp>
 #include <boost/iostreams/filtering_streambuf.hpp>
@@ -42,7 +43,9 @@ www.navitia.io
 #include <boost/serialization/variant.hpp>
 #include <boost/range/algorithm/find.hpp>
 #include <boost/container/container_fwd.hpp>
+#include <boost/make_shared.hpp>
 #include <thread>
+#include <unordered_set>
 
 #include "third_party/eos_portable_archive/portable_iarchive.hpp"
 #include "third_party/eos_portable_archive/portable_oarchive.hpp"
@@ -54,6 +57,7 @@ www.navitia.io
 #include "pt_data.h"
 #include "routing/dataraptor.h"
 #include "georef/georef.h"
+#include "georef/fallback_cache.h"
 #include "fare/fare.h"
 #include "type/meta_data.h"
 #include "kraken/fill_disruption_from_database.h"
@@ -64,15 +68,17 @@ namespace navitia { namespace type {
 
 wrong_version::~wrong_version() noexcept {}
 
-const unsigned int Data::data_version = 58; //< *INCREMENT* every time serialized data are modified
+const unsigned int Data::data_version = 63; //< *INCREMENT* every time serialized data are modified
+const size_t Data::max_load_timings;
 
 Data::Data(size_t data_identifier) :
     data_identifier(data_identifier),
     meta(std::make_unique<MetaData>()),
     pt_data(std::make_unique<PT_Data>()),
-    geo_ref(std::make_unique<navitia::georef::GeoRef>()),
+    geo_ref(boost::make_shared<navitia::georef::GeoRef>()),
     dataRaptor(std::make_unique<navitia::routing::dataRAPTOR>()),
-    fare(std::make_unique<navitia::fare::Fare>()),
+    fallback_cache(std::make_unique<navitia::georef::FallbackCache>()),
+    fare(boost::make_shared<navitia::fare::Fare>()),
     find_admins(
             [&](const GeographicalCoord &c){
             return geo_ref->find_admins(c);
@@ -90,10 +96,13 @@ bool Data::load(const std::string& filename,
         const std::vector<std::string>& contributors) {
     log4cplus::Logger logger = log4cplus::Logger::getInstance(LOG4CPLUS_TEXT("logger"));
     loading = true;
+    LoadTimer timer("load");
     try {
         std::ifstream ifs(filename.c_str(), std::ios::in | std::ios::binary);
         ifs.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        this->load(ifs);
+        // the reading and the decompression are done during the deserialization
+        timer.time("deserialization", [&] { this->load(ifs); });
+        timer.time("street_network_indexes", [&] { load_street_network_indexes(filename); });
         last_load_at = pt::microsec_clock::universal_time();
         last_load = true;
         loaded = true;
@@ -103,9 +112,12 @@ bool Data::load(const std::string& filename,
                        % pt_data->stop_points.size()
             );
         if (chaos_database) {
-            fill_disruption_from_database(*chaos_database, *pt_data, *meta, contributors);
+            timer.time("disruptions", [&] {
+                fill_disruption_from_database(*chaos_database, *pt_data, *meta, contributors);
+            });
         }
-        build_raptor();
+        build_raptor(10, &timer);
+        add_load_timings(timer.finish());
     } catch(const wrong_version& ex) {
         LOG4CPLUS_ERROR(logger, "Cannot load data: " << ex.what());
         last_load = false;
@@ -120,10 +132,47 @@ bool Data::load(const std::string& filename,
     return this->last_load;
 }
 
+void Data::load_street_network_indexes(const std::string& filename) {
+    log4cplus::Logger logger = log4cplus::Logger::getInstance(LOG4CPLUS_TEXT("logger"));
+    const auto flat = flat_filename(filename);
+    // without the indexes in the archive, there is nothing to fall back on
+    const bool flat_required = geo_ref->flat_indexes || pt_data->flat_indexes;
+    if (boost::filesystem::exists(flat)) {
+        try {
+            navitia::type::FlatReader reader(flat, data_version, flat_archive_id());
+            proximitylist::ProximityList<idx_t> stop_areas, stop_points;
+            stop_areas.map(reader);
+            stop_points.map(reader);
+            if (stop_areas.elements.size() != pt_data->stop_areas.size()
+                    || stop_points.elements.size() != pt_data->stop_points.size()) {
+                throw navitia::type::flat_file_error("the flat file does not match the proximity lists");
+            }
+            geo_ref->load_flat(reader);
+            pt_data->stop_area_proximity_list = std::move(stop_areas);
+            pt_data->stop_point_proximity_list = std::move(stop_points);
+            LOG4CPLUS_INFO(logger, "street network indexes and proximity lists mapped from " << flat);
+            return;
+        } catch (const navitia::type::flat_file_error& e) {
+            if (flat_required) {
+                throw navitia::exception("Cannot map " + flat + ", required by " + filename + ": " + e.what());
+            }
+            LOG4CPLUS_WARN(logger, "Cannot map " << flat << ", the indexes are built: " << e.what());
+        }
+    } else if (flat_required) {
+        throw navitia::exception(filename + " has been written with a flat file, " + flat + " is missing");
+    }
+    // the street topology has been deserialized, only the edge index is built
+    geo_ref->build_edge_index();
+    LOG4CPLUS_INFO(logger, "edge index built, street topology: "
+                   << geo_ref->search_graph().memory_size() / 1024 << " kB");
+}
+
 void Data::load(std::istream& ifs) {
+    // the next chunks are read and decompressed on background threads
+    // while the archive deserializes the current one
+    const size_t nb_threads = std::min(4u, std::max(1u, std::thread::hardware_concurrency()));
     boost::iostreams::filtering_streambuf<boost::iostreams::input> in;
-    in.push(LZ4Decompressor(2048*500),8192*500, 8192*500);
-    in.push(ifs);
+    in.push(LZ4ParallelSource(ifs, nb_threads, 8192*500), 8192*500, 8192*500);
     eos::portable_iarchive ia(in);
     ia >> *this;
 }
@@ -170,9 +219,33 @@ void Data::save(const std::string& filename) const {
     }
 }
 
+uint64_t Data::flat_archive_id() const {
+    // set by ed2nav at each run, with a microsecond resolution
+    const auto& date = meta->publication_date;
+    if (date.is_special()) { return 0; }
+    return (date - pt::ptime(boost::gregorian::date(1970, 1, 1))).total_microseconds();
+}
+
+void Data::save_flat(const std::string& filename) const {
+    try {
+        navitia::type::FlatWriter writer(flat_filename(filename), data_version, flat_archive_id());
+        pt_data->stop_area_proximity_list.save(writer);
+        pt_data->stop_point_proximity_list.save(writer);
+        geo_ref->save_flat(writer);
+        writer.close();
+    } catch (const navitia::type::flat_file_error& e) {
+        throw navitia::exception(std::string("Unable to write flat file: ") + e.what());
+    }
+}
+
+void Data::set_flat_indexes(bool flat) {
+    pt_data->flat_indexes = flat;
+    geo_ref->flat_indexes = flat;
+}
+
 void Data::save(std::ostream& ofs) const {
     boost::iostreams::filtering_streambuf<boost::iostreams::output> out;
-    out.push(LZ4Compressor(2048*500), 1024*500, 1024*500);
+    out.push(LZ4Compressor(2048*500, true), 1024*500, 1024*500);
     out.push(ofs);
     eos::portable_oarchive oa(out);
     oa << *this;
@@ -239,7 +312,7 @@ void  Data::build_administrative_regions() {
     for (const auto* sa: pt_data->stop_areas)
         for (auto admin: sa->admin_list)
             if (!admin->from_original_dataset)
-                admin->main_stop_areas.push_back(sa);
+                pt_data->main_stop_areas_by_admin[admin->idx].push_back(sa);
 }
 
 void Data::build_autocomplete(){
@@ -248,14 +321,22 @@ void Data::build_autocomplete(){
     pt_data->compute_score_autocomplete(*geo_ref);
 }
 
-void Data::build_raptor(size_t cache_size) {
+void Data::build_raptor(size_t cache_size, LoadTimer* timer) {
     LOG4CPLUS_DEBUG(log4cplus::Logger::getInstance("log"),
                     "Start to build dataRaptor");
-    dataRaptor->load(*this->pt_data, cache_size);
+    dataRaptor->load(*this->pt_data, cache_size, timer);
     LOG4CPLUS_DEBUG(log4cplus::Logger::getInstance("log"),
                     "Finished to build dataRaptor");
 }
 
+void Data::build_raptor_from(const Data& previous, size_t cache_size, LoadTimer* timer) {
+    LOG4CPLUS_DEBUG(log4cplus::Logger::getInstance("log"),
+                    "Start to update dataRaptor");
+    dataRaptor->load_from(*this->pt_data, *previous.dataRaptor, cache_size, timer);
+    LOG4CPLUS_DEBUG(log4cplus::Logger::getInstance("log"),
+                    "Finished to update dataRaptor");
+}
+
 ValidityPattern* Data::get_similar_validity_pattern(ValidityPattern* vp) const{
     auto find_vp_predicate = [&](ValidityPattern* vp1) { return ((*vp) == (*vp1));};
     auto it = std::find_if(this->pt_data->validity_patterns.begin(),
@@ -485,7 +566,7 @@ void Data::aggregate_odt(){
     //we first store the stops in a set not to have dupplicates
     for (const auto& p: odt_stops_by_admin) {
         for (const auto& sp: p.second) {
-            p.first->odt_stop_points.push_back(sp);
+            pt_data->odt_stop_points_by_admin[p.first->idx].push_back(sp);
         }
     }
 }
@@ -779,9 +860,9 @@ struct Pipe {
 };
 } // anonymous namespace
 
-// We want to do a deep clone of a Data.  The problem is that there is a
-// lot of pointers that point to each other, and thus writing a copy
-// assignment operator is really tricky.
+// We want to do a deep clone of the public transport data.  The
+// problem is that there is a lot of pointers that point to each other,
+// and thus writing a copy assignment operator is really tricky.
 //
 // But we already have a framework that allow this deep clone: boost
 // serialize.  Maybe we can write a dedicated Archive that clone the
@@ -789,11 +870,87 @@ struct Pipe {
 // stream the source object in a binary_oarchive, and then stream it
 // in our object.  To avoid having the whole binary_oarchive in
 // memory, we construct a pipe between 2 threads.
+//
+// The street network and the fares are not modified by the realtime,
+// thus they are shared with the source instead of being cloned.
 void Data::clone_from(const Data& from) {
     Pipe p;
-    std::thread write([&]() {boost::archive::binary_oarchive oa(p.out); oa << from;});
-    { boost::archive::binary_iarchive ia(p.in); ia >> *this; }
+    std::thread write([&]() {
+        boost::archive::binary_oarchive oa(p.out);
+        oa << from.pt_data << from.meta;
+    });
+    { boost::archive::binary_iarchive ia(p.in); ia >> pt_data >> meta; }
     write.join();
+    if (pt_data->flat_indexes) {
+        // not in the archive, the clone shares the mapped ones
+        pt_data->stop_area_proximity_list = from.pt_data->stop_area_proximity_list;
+        pt_data->stop_point_proximity_list = from.pt_data->stop_point_proximity_list;
+    }
+
+    geo_ref = from.geo_ref;
+    fare = from.fare;
+    share_admins();
+
+    version = from.version;
+    last_load_at = from.last_load_at;
+    loaded = from.loaded.load();
+    last_load = from.last_load;
+    is_connected_to_rabbitmq = from.is_connected_to_rabbitmq.load();
+    is_realtime_loaded = from.is_realtime_loaded.load();
+    load_timings = from.load_timings;
+}
+
+void Data::add_load_timings(LoadTimings timings) {
+    auto logger = log4cplus::Logger::getInstance(LOG4CPLUS_TEXT("logger"));
+    std::stringstream phases;
+    for (const auto& phase: timings.phases) {
+        phases << " " << phase.name << "=" << phase.duration_ms << "ms";
+    }
+    LOG4CPLUS_INFO(logger, timings.operation << " done in " << timings.duration_ms << "ms, peak RSS "
+                   << timings.peak_rss_kb << "kB:" << phases.str());
+    load_timings.push_back(std::move(timings));
+    if (load_timings.size() > max_load_timings) {
+        load_timings.erase(load_timings.begin());
+    }
+}
+
+void Data::add_load_phase(const std::string& phase, std::chrono::steady_clock::duration duration) {
+    if (! load_timings.empty()) {
+        load_timings.back().add(phase, duration);
+    }
+}
+
+void Data::keep_load_timings(const Data& previous) {
+    load_timings.insert(load_timings.begin(), previous.load_timings.begin(), previous.load_timings.end());
+    if (load_timings.size() > max_load_timings) {
+        load_timings.erase(load_timings.begin(), load_timings.end() - max_load_timings);
+    }
+}
+
+// The admins of the stop areas and stop points have been cloned with
+// them.  They are replaced by the ones of the shared street network,
+// and the clones are deleted.
+void Data::share_admins() {
+    std::unordered_set<const georef::Admin*> clones;
+    auto share = [&](std::vector<georef::Admin*>& admins) {
+        for (auto& admin: admins) {
+            clones.insert(admin);
+            admin = geo_ref->admins.at(admin->idx);
+        }
+    };
+    for (auto* sa: pt_data->stop_areas) { share(sa->admin_list); }
+    for (auto* sp: pt_data->stop_points) { share(sp->admin_list); }
+
+    // the parents of the cloned admins are also cloned
+    std::vector<const georef::Admin*> to_visit(clones.begin(), clones.end());
+    while (! to_visit.empty()) {
+        const auto* admin = to_visit.back();
+        to_visit.pop_back();
+        for (const auto* parent: admin->admin_list) {
+            if (clones.insert(parent).second) { to_visit.push_back(parent); }
+        }
+    }
+    for (const auto* admin: clones) { delete admin; }
 }
 
 }} //namespace navitia::type
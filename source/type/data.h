@@ -34,8 +34,10 @@ www.navitia.io
 #include <boost/serialization/version.hpp>
 #include <boost/format.hpp>
 #include <boost/optional.hpp>
+#include <boost/shared_ptr.hpp>
 #include <atomic>
 #include "type/type.h"
+#include "type/load_timings.h"
 #include "utils/serialization_unique_ptr.h"
 #include "utils/serialization_atomic.h"
 #include "utils/exception.h"
@@ -45,6 +47,7 @@ www.navitia.io
 namespace navitia {
     namespace georef {
         struct GeoRef;
+        struct FallbackCache;
         struct POI;
         struct POIType;
     }
@@ -142,13 +145,18 @@ public:
     /// public transport (PT) referential
     std::unique_ptr<PT_Data> pt_data;
 
-    std::unique_ptr<navitia::georef::GeoRef> geo_ref;
+    /// street network, shared by the data snapshots as it is not
+    /// modified by the realtime
+    boost::shared_ptr<navitia::georef::GeoRef> geo_ref;
 
     /// precomputed data for raptor (public transport routing algorithm)
     std::unique_ptr<navitia::routing::dataRAPTOR> dataRaptor;
 
+    /// stop points reachable from the most used starting points, not serialized
+    std::unique_ptr<navitia::georef::FallbackCache> fallback_cache;
+
     /// Fare data
-    std::unique_ptr<navitia::fare::Fare> fare;
+    boost::shared_ptr<navitia::fare::Fare> fare;
 
     // functor to find admins
     std::function<std::vector<georef::Admin*>(const GeographicalCoord&)> find_admins;
@@ -192,6 +200,16 @@ public:
 
     boost::posix_time::ptime last_rt_data_loaded; //datetime of the last Real Time loaded data
 
+    /// timings of the last loads and realtime rebuilds, the oldest
+    /// first, kept from a data to the next one (not serialized)
+    std::vector<LoadTimings> load_timings;
+    static const size_t max_load_timings = 10;
+    void add_load_timings(LoadTimings timings);
+    /// add a phase to the last timings (when the data is prepared after its load)
+    void add_load_phase(const std::string& phase, std::chrono::steady_clock::duration duration);
+    /// the previous timings, before the ones of this data
+    void keep_load_timings(const Data& previous);
+
     // This object is the only field mutated in this object. As it is
     // thread safe to mutate it, we mark it as mutable.  Maybe we can
     // find in the future a cleaner way, but now, this is cleaner than
@@ -228,6 +246,20 @@ public:
     /** Sauvegarde les données */
     void save(const std::string & filename) const;
 
+    /** Write the street network indexes, the contraction hierarchies and
+      * the proximity lists in a flat file next to the data file, load()
+      * maps them instead of building or deserializing them
+      *
+      * The file is identified by the publication date of the data, thus it
+      * must be written after the data by the same ed2nav run
+      */
+    void save_flat(const std::string& filename) const;
+    /** Leave what save_flat writes out of the archive written by save():
+      * the flat file is then required to load the archive
+      */
+    void set_flat_indexes(bool flat);
+    static std::string flat_filename(const std::string& filename) { return filename + ".flat"; }
+
     /** Construit l'indexe ExternelCode */
     void build_uri();
 
@@ -240,7 +272,10 @@ public:
     /** Set admins*/
     void build_administrative_regions();
     /** Construit les données raptor */
-    void build_raptor(size_t cache_size = 10);
+    void build_raptor(size_t cache_size = 10, LoadTimer* timer = nullptr);
+    /** Construit les données raptor en mettant à jour celles de previous,
+      * dont cette donnée est une copie modifiée par le temps réel */
+    void build_raptor_from(const Data& previous, size_t cache_size = 10, LoadTimer* timer = nullptr);
 
     void build_associated_calendar();
 
@@ -268,9 +303,20 @@ public:
     /** Sauvegarde les données en binaire compressé avec LZ4*/
     void save(std::ostream& ifs) const;
 
-    // Deep clone from the given Data.
+    // Snapshot of the given Data, to be modified by the realtime: the
+    // public transport data is deep cloned, the street network and the
+    // fares are shared.
     void clone_from(const Data&);
 private:
+    /** Map the street network indexes and the proximity lists from the flat
+      * file of filename, or build the edge index if the archive contains the rest */
+    void load_street_network_indexes(const std::string& filename);
+    /// identity of the data archive written in its flat file
+    uint64_t flat_archive_id() const;
+
+    /** Replace the admins cloned with the public transport data by the shared ones */
+    void share_admins();
+
     /** Get similar validitypattern **/
     ValidityPattern* get_similar_validity_pattern(ValidityPattern* vp) const;
 };
@@ -0,0 +1,107 @@
+/* Copyright © 2001-2016, Canal TP and/or its affiliates. All rights reserved.
+
+This file is part of Navitia,
+    the software to build cool stuff with public transport.
+
+Hope you'll enjoy and contribute to this project,
+    powered by Canal TP (www.canaltp.fr).
+Help us simplify mobility and open public transport:
+    a non ending quest to the responsive locomotion way of traveling!
+
+LICENCE: This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Affero General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+Stay tuned using
+twitter @navitia
+IRC #navitia on freenode
+https://groups.google.com/d/forum/navitia
+www.navitia.io
+*/
+
+#pragma once
+
+#include <initializer_list>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace navitia { namespace type {
+
+/** Read only array of trivially copyable values
+ *
+ * The values are either owned (they have been built in memory) or read in
+ * place from a memory mapped file (cf FlatReader), the mapping being kept
+ * alive as long as an array uses it. A mapped array does not cost any
+ * private memory, and its pages are shared by every process mapping the
+ * same file.
+ */
+template<typename T>
+class FlatArray {
+    static_assert(std::is_trivially_copyable<T>::value, "FlatArray values must be trivially copyable");
+
+public:
+    typedef T value_type;
+    typedef const T* const_iterator;
+    typedef const T* iterator;
+
+    FlatArray() = default;
+    FlatArray(std::vector<T>&& values) { *this = std::move(values); }
+    FlatArray(std::initializer_list<T> values): FlatArray(std::vector<T>(values)) {}
+    FlatArray(const FlatArray& other) { *this = other; }
+    FlatArray& operator=(const FlatArray& other) {
+        if (this == &other) { return *this; }
+        owned = other.owned;
+        mapping = other.mapping;
+        if (mapping) {
+            first = other.first;
+            nb = other.nb;
+        } else {
+            first = owned.data();
+            nb = owned.size();
+        }
+        return *this;
+    }
+    FlatArray& operator=(std::vector<T>&& values) {
+        owned = std::move(values);
+        mapping.reset();
+        first = owned.data();
+        nb = owned.size();
+        return *this;
+    }
+
+    /// nb values read in place at first, mapping owning the memory
+    static FlatArray mapped(const T* first, size_t nb, std::shared_ptr<const void> mapping) {
+        FlatArray result;
+        result.first = first;
+        result.nb = nb;
+        result.mapping = std::move(mapping);
+        return result;
+    }
+
+    size_t size() const { return nb; }
+    bool empty() const { return nb == 0; }
+    const T* data() const { return first; }
+    const T& operator[](size_t i) const { return first[i]; }
+    const T& back() const { return first[nb - 1]; }
+    const_iterator begin() const { return first; }
+    const_iterator end() const { return first + nb; }
+    bool is_mapped() const { return bool(mapping); }
+
+private:
+    std::vector<T> owned;
+    std::shared_ptr<const void> mapping;
+    const T* first = nullptr;
+    size_t nb = 0;
+};
+
+}} // namespace navitia::type
@@ -0,0 +1,128 @@
+/* Copyright © 2001-2016, Canal TP and/or its affiliates. All rights reserved.
+
+This file is part of Navitia,
+    the software to build cool stuff with public transport.
+
+Hope you'll enjoy and contribute to this project,
+    powered by Canal TP (www.canaltp.fr).
+Help us simplify mobility and open public transport:
+    a non ending quest to the responsive locomotion way of traveling!
+
+LICENCE: This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Affero General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+Stay tuned using
+twitter @navitia
+IRC #navitia on freenode
+https://groups.google.com/d/forum/navitia
+www.navitia.io
+*/
+
+#include "type/flat_file.h"
+#include <boost/iostreams/device/mapped_file.hpp>
+#include <boost/format.hpp>
+
+namespace navitia { namespace type {
+
+namespace {
+const char magic[8] = {'N', 'A', 'V', 'F', 'L', 'A', 'T', '\0'};
+const uint32_t format_version = 2;
+// written in the host byte order, to refuse a file written by another architecture
+const uint32_t byte_order_mark = 0x01020304;
+const size_t alignment = 16;
+}
+
+flat_file_error::~flat_file_error() noexcept {}
+
+FlatWriter::FlatWriter(const std::string& filename, uint32_t version, uint64_t archive_id) {
+    ofs.exceptions(std::ofstream::failbit | std::ofstream::badbit);
+    try {
+        ofs.open(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    } catch (const std::ofstream::failure& e) {
+        throw flat_file_error("Unable to open " + filename + ": " + e.what());
+    }
+    write_bytes(magic, sizeof(magic));
+    write(format_version);
+    write(byte_order_mark);
+    write(version);
+    write(archive_id);
+}
+
+void FlatWriter::write_bytes(const void* bytes, size_t size) {
+    try {
+        ofs.write(static_cast<const char*>(bytes), size);
+    } catch (const std::ofstream::failure& e) {
+        throw flat_file_error(std::string("Unable to write flat file: ") + e.what());
+    }
+    pos += size;
+}
+
+void FlatWriter::align() {
+    static const char padding[alignment] = {};
+    if (pos % alignment != 0) { write_bytes(padding, alignment - pos % alignment); }
+}
+
+void FlatWriter::close() {
+    try {
+        ofs.close();
+    } catch (const std::ofstream::failure& e) {
+        throw flat_file_error(std::string("Unable to write flat file: ") + e.what());
+    }
+}
+
+FlatReader::FlatReader(const std::string& filename, uint32_t version, uint64_t archive_id) {
+    std::shared_ptr<const boost::iostreams::mapped_file_source> file;
+    try {
+        file = std::make_shared<const boost::iostreams::mapped_file_source>(filename);
+    } catch (const std::exception& e) {
+        throw flat_file_error("Unable to map " + filename + ": " + e.what());
+    }
+    mapping = file;
+    begin = file->data();
+    size = file->size();
+
+    if (size < sizeof(magic) || std::memcmp(take(sizeof(magic)), magic, sizeof(magic)) != 0) {
+        throw flat_file_error(filename + " is not a flat file");
+    }
+    const auto file_format = read<uint32_t>();
+    if (file_format != format_version) {
+        throw flat_file_error((boost::format("%s has the format version %d, %d expected")
+                               % filename % file_format % format_version).str());
+    }
+    if (read<uint32_t>() != byte_order_mark) {
+        throw flat_file_error(filename + " has been written with another byte order");
+    }
+    const auto file_version = read<uint32_t>();
+    if (file_version != version) {
+        throw flat_file_error((boost::format("%s has the version %d, %d expected")
+                               % filename % file_version % version).str());
+    }
+    if (read<uint64_t>() != archive_id) {
+        throw flat_file_error(filename + " has been written for another data archive");
+    }
+}
+
+const char* FlatReader::take(size_t nb_bytes) {
+    if (nb_bytes > size_left()) {
+        throw flat_file_error("invalid flat file: unexpected end of file");
+    }
+    const char* result = begin + pos;
+    pos += nb_bytes;
+    return result;
+}
+
+void FlatReader::align() {
+    if (pos % alignment != 0) { take(alignment - pos % alignment); }
+}
+
+}} // namespace navitia::type
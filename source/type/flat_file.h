@@ -0,0 +1,144 @@
+/* Copyright © 2001-2016, Canal TP and/or its affiliates. All rights reserved.
+
+This file is part of Navitia,
+    the software to build cool stuff with public transport.
+
+Hope you'll enjoy and contribute to this project,
+    powered by Canal TP (www.canaltp.fr).
+Help us simplify mobility and open public transport:
+    a non ending quest to the responsive locomotion way of traveling!
+
+LICENCE: This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Affero General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+Stay tuned using
+twitter @navitia
+IRC #navitia on freenode
+https://groups.google.com/d/forum/navitia
+www.navitia.io
+*/
+
+#pragma once
+
+#include "type/flat_array.h"
+#include "utils/exception.h"
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace navitia { namespace type {
+
+struct flat_file_error: public navitia::exception {
+    flat_file_error(const std::string& msg): navitia::exception(msg) {}
+    flat_file_error(const flat_file_error&) = default;
+    flat_file_error& operator=(const flat_file_error&) = default;
+    virtual ~flat_file_error() noexcept;
+};
+
+/** Writer of a flat file, read in place by FlatReader
+ *
+ * The file starts with a header (magic, format version, byte order, and the
+ * version and the identity of the archive it goes with, given by the
+ * writer), followed by the values and the arrays in the order they have
+ * been written, each array being aligned on 16 bytes.
+ *
+ * The values are stored with the memory layout of the host, the header
+ * ensures that a file is only read by a build compatible with its writer.
+ * They are written byte for byte, thus a struct must not have any padding
+ * (its bytes would be undefined in the file): make it explicit, and
+ * static_assert the size of the struct next to its definition.
+ */
+class FlatWriter {
+public:
+    FlatWriter(const std::string& filename, uint32_t version, uint64_t archive_id);
+
+    template<typename T>
+    void write(const T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "only trivially copyable values can be written");
+        write_bytes(&value, sizeof(T));
+    }
+
+    template<typename T>
+    void write_array(const T* values, size_t nb) {
+        static_assert(std::is_trivially_copyable<T>::value, "only trivially copyable values can be written");
+        write<uint64_t>(nb);
+        write<uint64_t>(sizeof(T));
+        align();
+        write_bytes(values, nb * sizeof(T));
+    }
+    template<typename T>
+    void write_array(const std::vector<T>& values) { write_array(values.data(), values.size()); }
+    template<typename T>
+    void write_array(const FlatArray<T>& values) { write_array(values.data(), values.size()); }
+
+    /// flush the file, throws flat_file_error if it has not been fully written
+    void close();
+
+private:
+    std::ofstream ofs;
+    uint64_t pos = 0;
+
+    void write_bytes(const void* bytes, size_t size);
+    void align();
+};
+
+/** Reader of a file written by FlatWriter
+ *
+ * The file is memory mapped read only, and the arrays are read in place:
+ * they keep the mapping alive after the destruction of the reader.
+ * flat_file_error is thrown if the file cannot be mapped, if its header
+ * does not match the version or the archive identity, or if it is truncated.
+ */
+class FlatReader {
+public:
+    FlatReader(const std::string& filename, uint32_t version, uint64_t archive_id);
+
+    template<typename T>
+    T read() {
+        static_assert(std::is_trivially_copyable<T>::value, "only trivially copyable values can be read");
+        T value;
+        std::memcpy(&value, take(sizeof(T)), sizeof(T));
+        return value;
+    }
+
+    template<typename T>
+    FlatArray<T> read_array() {
+        const uint64_t nb = read<uint64_t>();
+        if (read<uint64_t>() != sizeof(T)) {
+            throw flat_file_error("invalid flat file: unexpected array value size");
+        }
+        align();
+        if (nb > size_left() / sizeof(T)) {
+            throw flat_file_error("invalid flat file: truncated array");
+        }
+        const T* first = reinterpret_cast<const T*>(take(nb * sizeof(T)));
+        return FlatArray<T>::mapped(first, nb, mapping);
+    }
+
+private:
+    // the mapped file, shared by the arrays read in place
+    std::shared_ptr<const void> mapping;
+    const char* begin = nullptr;
+    size_t size = 0;
+    size_t pos = 0;
+
+    size_t size_left() const { return size - pos; }
+    const char* take(size_t nb_bytes);
+    void align();
+};
+
+}} // namespace navitia::type
@@ -125,6 +125,8 @@ private:
     double _lon;
     double _lat;
 };
+// written as it is in the flat files (cf FlatWriter), thus without padding
+static_assert(sizeof(GeographicalCoord) == 2 * sizeof(double), "GeographicalCoord must not have padding");
 
 std::ostream& operator<<(std::ostream&, const GeographicalCoord&);
 
@@ -0,0 +1,91 @@
+/* Copyright © 2001-2016, Canal TP and/or its affiliates. All rights reserved.
+
+This file is part of Navitia,
+    the software to build cool stuff with public transport.
+
+Hope you'll enjoy and contribute to this project,
+    powered by Canal TP (www.canaltp.fr).
+Help us simplify mobility and open public transport:
+    a non ending quest to the responsive locomotion way of traveling!
+
+LICENCE: This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Affero General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+Stay tuned using
+twitter @navitia
+IRC #navitia on freenode
+https://groups.google.com/d/forum/navitia
+www.navitia.io
+*/
+
+#include "type/load_timings.h"
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <fstream>
+#include <sys/resource.h>
+
+namespace navitia { namespace type {
+
+namespace pt = boost::posix_time;
+
+static uint64_t to_ms(std::chrono::steady_clock::duration duration) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(duration).count();
+}
+
+void LoadTimings::add(const std::string& phase, std::chrono::steady_clock::duration duration) {
+    for (auto& p: phases) {
+        if (p.name == phase) {
+            p.duration_ms += to_ms(duration);
+            return;
+        }
+    }
+    phases.push_back({phase, to_ms(duration)});
+}
+
+LoadTimer::LoadTimer(const std::string& operation): start(std::chrono::steady_clock::now()) {
+    timings.operation = operation;
+    timings.started_at = pt::microsec_clock::universal_time();
+    // the peak RSS (VmHWM) is reset to the current RSS (linux >= 4.0)
+    std::ofstream clear_refs("/proc/self/clear_refs");
+    clear_refs << "5";
+}
+
+void LoadTimer::add(const std::string& phase, std::chrono::steady_clock::duration duration) {
+    std::lock_guard<std::mutex> lock(mutex);
+    timings.add(phase, duration);
+}
+
+LoadTimings LoadTimer::finish() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    LoadTimings result = timings;
+    result.duration_ms = to_ms(std::chrono::steady_clock::now() - start);
+    result.peak_rss_kb = get_peak_rss_kb();
+    return result;
+}
+
+uint64_t get_peak_rss_kb() {
+    // VmHWM is reset by LoadTimer, unlike ru_maxrss
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, 6, "VmHWM:") == 0) {
+            return std::stoull(line.substr(6));
+        }
+    }
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        return usage.ru_maxrss;
+    }
+    return 0;
+}
+
+}} // namespace navitia::type
@@ -0,0 +1,100 @@
+/* Copyright © 2001-2016, Canal TP and/or its affiliates. All rights reserved.
+
+This file is part of Navitia,
+    the software to build cool stuff with public transport.
+
+Hope you'll enjoy and contribute to this project,
+    powered by Canal TP (www.canaltp.fr).
+Help us simplify mobility and open public transport:
+    a non ending quest to the responsive locomotion way of traveling!
+
+LICENCE: This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Affero General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+Stay tuned using
+twitter @navitia
+IRC #navitia on freenode
+https://groups.google.com/d/forum/navitia
+www.navitia.io
+*/
+
+#pragma once
+
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace navitia { namespace type {
+
+/** Durations of the phases of a load or of a rebuild of the data
+ *
+ * The phases run concurrently (the raptor data is built by concurrent
+ * tasks) thus their sum can be greater than the total duration.
+ */
+struct LoadTimings {
+    struct Phase {
+        std::string name;
+        uint64_t duration_ms;
+    };
+    std::string operation; // "load" or "realtime"
+    boost::posix_time::ptime started_at;
+    std::vector<Phase> phases;
+    uint64_t duration_ms = 0; // wall clock duration of the operation, set by LoadTimer::finish()
+    // peak resident set size of the process during the operation, in kB
+    uint64_t peak_rss_kb = 0;
+
+    /// add the duration to the phase (created if needed)
+    void add(const std::string& phase, std::chrono::steady_clock::duration duration);
+};
+
+/** Measures the phases of a load with a monotonic clock
+ *
+ * The phases can be timed from several threads.
+ */
+class LoadTimer {
+public:
+    /// the peak RSS of the process is reset, if the system allows it
+    explicit LoadTimer(const std::string& operation);
+
+    /// run f, its duration being added to phase
+    template<typename F>
+    auto time(const std::string& phase, const F& f) -> decltype(f()) {
+        const Guard guard{*this, phase, std::chrono::steady_clock::now()};
+        return f();
+    }
+
+    void add(const std::string& phase, std::chrono::steady_clock::duration duration);
+
+    /// the timings of the phases so far, with the total duration and the peak RSS
+    LoadTimings finish() const;
+
+private:
+    struct Guard {
+        LoadTimer& timer;
+        const std::string& phase;
+        std::chrono::steady_clock::time_point start;
+        ~Guard() { timer.add(phase, std::chrono::steady_clock::now() - start); }
+    };
+
+    std::chrono::steady_clock::time_point start;
+    LoadTimings timings;
+    mutable std::mutex mutex;
+};
+
+/// peak resident set size of the process, in kB
+uint64_t get_peak_rss_kb();
+
+}} // namespace navitia::type
@@ -81,6 +81,8 @@ struct PT_Data : boost::noncopyable{
     // Proximity list
     proximitylist::ProximityList<idx_t> stop_area_proximity_list;
     proximitylist::ProximityList<idx_t> stop_point_proximity_list;
+    /// the proximity lists are in the flat file next to the archive (cf GeoRef::flat_indexes)
+    bool flat_indexes = false;
 
     //Message
     disruption::DisruptionHolder disruption_holder;
@@ -88,6 +90,13 @@ struct PT_Data : boost::noncopyable{
     // rtree for zonal stop_points
     MultiPolygonMap<const StopPoint*> stop_points_by_area;
 
+    // Relations from the admins (by idx) to the public transport
+    // objects. They are not stored in the admins as the street network
+    // is shared by the data snapshots.
+    std::map<idx_t, std::vector<const StopArea*>> main_stop_areas_by_admin;
+    // TODO ODT NTFSv0.3: remove that when we stop to support NTFSv0.1
+    std::map<idx_t, std::vector<const StopPoint*>> odt_stop_points_by_admin;
+
     // Comments container
     Comments comments;
 
@@ -116,15 +125,20 @@ struct PT_Data : boost::noncopyable{
                 ITERATE_NAVITIA_PT_TYPES(SERIALIZE_ELEMENTS)
                 & stop_area_autocomplete & stop_point_autocomplete & line_autocomplete
                 & network_autocomplete & mode_autocomplete & route_autocomplete
-                & stop_area_proximity_list & stop_point_proximity_list
                 & stop_point_connections
                 & disruption_holder
                 & meta_vjs
                 & stop_points_by_area
+                & main_stop_areas_by_admin
+                & odt_stop_points_by_admin
                 & comments
                 & codes
                 & headsign_handler
-                & tz_manager;
+                & tz_manager
+                & flat_indexes;
+        if (! flat_indexes) {
+            ar & stop_area_proximity_list & stop_point_proximity_list;
+        }
     }
 
     /** Initialise tous les indexes